@@ -0,0 +1,175 @@
+#include "AutoExposure.h"
+#include <glad/glad.h>
+#include <iostream>
+
+AutoExposure::AutoExposure() :
+	mHistogramFrameBufferId(0),
+	mHistogramTextureId(0),
+	mLuminanceFrameBufferIds{ 0, 0 },
+	mLuminanceTextureIds{ 0, 0 },
+	mLuminanceIndex(0),
+	mHistoryValid(false),
+	mEmptyVAO(0),
+	mReadbackBuffers{},
+	mReadbackFences{},
+	mReadbackFrames{},
+	mNextReadback(0),
+	mNumPendingReadbacks(0),
+	mFrameIndex(0),
+	mReadbackLuminance(0.0f),
+	mReadbackLatency(0)
+{
+}
+
+AutoExposure::~AutoExposure()
+{
+	Release();
+}
+
+static unsigned int CreateFloatTarget(int width, unsigned int& textureId, const char* name)
+{
+	glGenTextures(1, &textureId);
+	glBindTexture(GL_TEXTURE_2D, textureId);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, width, 1, 0, GL_RED, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	unsigned int frameBufferId = 0;
+	glGenFramebuffers(1, &frameBufferId);
+	glBindFramebuffer(GL_FRAMEBUFFER, frameBufferId);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureId, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ERROR: " << name << " Framebuffer is not complete" << std::endl;
+	}
+	return frameBufferId;
+}
+
+void AutoExposure::Create()
+{
+	Release();
+
+	mHistogramFrameBufferId = CreateFloatTarget(HISTOGRAM_BINS, mHistogramTextureId, "Luminance histogram");
+	for (int i = 0; i < 2; i++)
+	{
+		mLuminanceFrameBufferIds[i] = CreateFloatTarget(1, mLuminanceTextureIds[i], "Adapted luminance");
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenVertexArrays(1, &mEmptyVAO);
+
+	glGenBuffers(NUM_READBACK_BUFFERS, mReadbackBuffers);
+	for (unsigned int buffer : mReadbackBuffers)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(float), NULL, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	mHistoryValid = false;
+}
+
+void AutoExposure::BindHistogram()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, mHistogramFrameBufferId);
+	glViewport(0, 0, HISTOGRAM_BINS, 1);
+}
+
+void AutoExposure::BindAdaptation()
+{
+	mLuminanceIndex = 1 - mLuminanceIndex;
+	glBindFramebuffer(GL_FRAMEBUFFER, mLuminanceFrameBufferIds[mLuminanceIndex]);
+	glViewport(0, 0, 1, 1);
+	mHistoryValid = true;
+}
+
+void AutoExposure::DrawSamplePoints(unsigned int numPoints)
+{
+	glBindVertexArray(mEmptyVAO);
+	glDrawArrays(GL_POINTS, 0, numPoints);
+	glBindVertexArray(0);
+}
+
+void AutoExposure::QueueReadback()
+{
+	mFrameIndex++;
+
+	// with every buffer still in flight the oldest copy is dropped rather than waited for
+	if (mNumPendingReadbacks == NUM_READBACK_BUFFERS)
+	{
+		unsigned int oldest = (mNextReadback + NUM_READBACK_BUFFERS - mNumPendingReadbacks) % NUM_READBACK_BUFFERS;
+		glDeleteSync(static_cast<GLsync>(mReadbackFences[oldest]));
+		mReadbackFences[oldest] = nullptr;
+		mNumPendingReadbacks--;
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, mLuminanceFrameBufferIds[mLuminanceIndex]);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, mReadbackBuffers[mNextReadback]);
+	glReadPixels(0, 0, 1, 1, GL_RED, GL_FLOAT, NULL);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+	mReadbackFences[mNextReadback] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	mReadbackFrames[mNextReadback] = mFrameIndex;
+	mNextReadback = (mNextReadback + 1) % NUM_READBACK_BUFFERS;
+	mNumPendingReadbacks++;
+}
+
+bool AutoExposure::PollReadback()
+{
+	bool hasResult = false;
+	while (mNumPendingReadbacks > 0)
+	{
+		unsigned int oldest = (mNextReadback + NUM_READBACK_BUFFERS - mNumPendingReadbacks) % NUM_READBACK_BUFFERS;
+		GLsync fence = static_cast<GLsync>(mReadbackFences[oldest]);
+		GLenum status = glClientWaitSync(fence, 0, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		{
+			break;
+		}
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, mReadbackBuffers[oldest]);
+		const float* luminance = static_cast<const float*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, sizeof(float), GL_MAP_READ_BIT));
+		if (luminance)
+		{
+			mReadbackLuminance = *luminance;
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		glDeleteSync(fence);
+		mReadbackFences[oldest] = nullptr;
+		mReadbackLatency = mFrameIndex - mReadbackFrames[oldest];
+		mNumPendingReadbacks--;
+		hasResult = true;
+	}
+	return hasResult;
+}
+
+void AutoExposure::Release()
+{
+	glDeleteFramebuffers(1, &mHistogramFrameBufferId);
+	glDeleteFramebuffers(2, mLuminanceFrameBufferIds);
+
+	unsigned int textureIds[3]{
+		mHistogramTextureId,
+		mLuminanceTextureIds[0],
+		mLuminanceTextureIds[1]
+	};
+	glDeleteTextures(3, textureIds);
+
+	glDeleteVertexArrays(1, &mEmptyVAO);
+	glDeleteBuffers(NUM_READBACK_BUFFERS, mReadbackBuffers);
+	for (void*& fence : mReadbackFences)
+	{
+		if (fence)
+		{
+			glDeleteSync(static_cast<GLsync>(fence));
+			fence = nullptr;
+		}
+	}
+	mNumPendingReadbacks = 0;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+// Targets of the eye adaptation. Every frame a grid of samples of the lit scene is scattered as points
+// into a luminance histogram (one R32F texel per bin, counted with additive blending), then a single
+// texel pass averages it and eases the result towards it over time. The adapted luminance stays on the
+// GPU for the tone mapping, the CPU only gets a copy through a ring of pixel buffers a few frames later.
+class AutoExposure
+{
+public:
+	AutoExposure();
+	virtual ~AutoExposure();
+
+	void Create();
+	// the first adaptation after this takes the measured luminance as is
+	inline void Reset() { mHistoryValid = false; }
+
+	// sets the viewport to the target as well
+	void BindHistogram();
+	// swaps the adapted luminance targets, the one bound is written and the other holds the previous frame
+	void BindAdaptation();
+	// one point per sample, the positions come from gl_VertexID
+	void DrawSamplePoints(unsigned int numPoints);
+
+	// copies the adapted luminance into the next pixel buffer, to be picked up by PollReadback()
+	void QueueReadback();
+	// never waits, returns whether a queued copy has finished since the last call
+	bool PollReadback();
+
+	inline unsigned int GetHistogramTextureId() const { return mHistogramTextureId; }
+	inline unsigned int GetLuminanceTextureId() const { return mLuminanceTextureIds[mLuminanceIndex]; }
+	inline unsigned int GetPrevLuminanceTextureId() const { return mLuminanceTextureIds[1 - mLuminanceIndex]; }
+	inline bool IsHistoryValid() const { return mHistoryValid; }
+	inline float GetReadbackLuminance() const { return mReadbackLuminance; }
+	// frames between queueing a copy and the CPU reading it
+	inline unsigned int GetReadbackLatency() const { return mReadbackLatency; }
+
+	static constexpr int HISTOGRAM_BINS = 64;
+	static constexpr unsigned int NUM_READBACK_BUFFERS = 3;
+
+private:
+	void Release();
+
+	unsigned int mHistogramFrameBufferId;
+	unsigned int mHistogramTextureId;
+	unsigned int mLuminanceFrameBufferIds[2];
+	unsigned int mLuminanceTextureIds[2];
+	unsigned int mLuminanceIndex;
+	bool mHistoryValid;
+	// the points take their positions from gl_VertexID, but the core profile still needs a vertex array bound
+	unsigned int mEmptyVAO;
+
+	unsigned int mReadbackBuffers[NUM_READBACK_BUFFERS];
+	void* mReadbackFences[NUM_READBACK_BUFFERS];
+	unsigned int mReadbackFrames[NUM_READBACK_BUFFERS];
+	unsigned int mNextReadback;
+	unsigned int mNumPendingReadbacks;
+	unsigned int mFrameIndex;
+	float mReadbackLuminance;
+	unsigned int mReadbackLatency;
+};
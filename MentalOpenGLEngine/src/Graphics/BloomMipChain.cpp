@@ -0,0 +1,103 @@
+#include "BloomMipChain.h"
+#include <glad/glad.h>
+#include <iostream>
+#include <algorithm>
+
+static constexpr int MIN_MIP_SIZE = 8;
+
+BloomMipChain::~BloomMipChain()
+{
+	Release();
+}
+
+void BloomMipChain::Build(int width, int height, unsigned int maxMips)
+{
+	Release();
+
+	width = std::max(width / 2, 1);
+	height = std::max(height / 2, 1);
+	// always at least one level, the post-processing samples it
+	while (mMips.empty() || (mMips.size() < maxMips && width >= MIN_MIP_SIZE && height >= MIN_MIP_SIZE))
+	{
+		Mip mip;
+		mip.Width = width;
+		mip.Height = height;
+
+		glGenTextures(1, &mip.TextureId);
+		glBindTexture(GL_TEXTURE_2D, mip.TextureId);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F, width, height, 0, GL_RGB, GL_FLOAT, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glGenFramebuffers(1, &mip.FrameBufferId);
+		glBindFramebuffer(GL_FRAMEBUFFER, mip.FrameBufferId);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mip.TextureId, 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "ERROR: Bloom mip Framebuffer is not complete" << std::endl;
+		}
+
+		mMips.push_back(mip);
+		width /= 2;
+		height /= 2;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void BloomMipChain::BindMip(unsigned int mip)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, mMips[mip].FrameBufferId);
+	glViewport(0, 0, mMips[mip].Width, mMips[mip].Height);
+}
+
+size_t BloomMipChain::GetMemorySize() const
+{
+	size_t size = 0;
+	for (const Mip& mip : mMips)
+	{
+		size += size_t(mip.Width) * mip.Height * BYTES_PER_TEXEL;
+	}
+	return size;
+}
+
+size_t BloomMipChain::GetBytesPerFrame(int sourceWidth, int sourceHeight, unsigned int sourceBytesPerTexel) const
+{
+	if (mMips.empty())
+	{
+		return 0;
+	}
+
+	// the first downsample reads the source, every other one the previous level
+	size_t bytes = size_t(sourceWidth) * sourceHeight * sourceBytesPerTexel;
+	for (size_t i = 0; i < mMips.size(); i++)
+	{
+		size_t mipBytes = size_t(mMips[i].Width) * mMips[i].Height * BYTES_PER_TEXEL;
+		bytes += mipBytes;
+		if (i + 1 < mMips.size())
+		{
+			bytes += mipBytes;
+		}
+	}
+
+	// every upsample reads a level and blends into the next larger one, which is a read and a write
+	for (size_t i = mMips.size() - 1; i > 0; i--)
+	{
+		bytes += size_t(mMips[i].Width) * mMips[i].Height * BYTES_PER_TEXEL;
+		bytes += 2 * size_t(mMips[i - 1].Width) * mMips[i - 1].Height * BYTES_PER_TEXEL;
+	}
+	return bytes;
+}
+
+void BloomMipChain::Release()
+{
+	for (Mip& mip : mMips)
+	{
+		glDeleteFramebuffers(1, &mip.FrameBufferId);
+		glDeleteTextures(1, &mip.TextureId);
+	}
+	mMips.clear();
+}
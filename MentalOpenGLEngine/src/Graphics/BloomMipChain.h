@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+
+// Progressively halved R11F_G11F_B10F targets for the bloom. The first level is half the screen resolution,
+// every level is its own texture and framebuffer, so one level can be sampled while the next is rendered.
+class BloomMipChain
+{
+public:
+	struct Mip
+	{
+		int Width = 0;
+		int Height = 0;
+		unsigned int FrameBufferId = 0;
+		unsigned int TextureId = 0;
+	};
+
+	virtual ~BloomMipChain();
+
+	// stops at maxMips or when a level would drop below a few texels, but always creates the first level
+	void Build(int width, int height, unsigned int maxMips);
+	// sets the viewport to the level as well
+	void BindMip(unsigned int mip);
+
+	inline unsigned int GetNumMips() const { return static_cast<unsigned int>(mMips.size()); }
+	inline const Mip& GetMip(unsigned int mip) const { return mMips[mip]; }
+	size_t GetMemorySize() const;
+	// bytes read and written by one downsample/upsample sweep fed from a source of the given size,
+	// counting every texel once per pass as if the caches were perfect
+	size_t GetBytesPerFrame(int sourceWidth, int sourceHeight, unsigned int sourceBytesPerTexel) const;
+
+	static constexpr unsigned int BYTES_PER_TEXEL = 4;
+
+private:
+	void Release();
+
+	std::vector<Mip> mMips;
+};
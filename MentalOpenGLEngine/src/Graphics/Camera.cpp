@@ -38,9 +38,11 @@ glm::mat4 Camera::GetViewMatrix() const
 	return result;
 }
 
-glm::mat4 Camera::GetProjectionMatrix(float aspectRatio, float near, float far) const
+glm::mat4 Camera::GetProjectionMatrix(float aspectRatio, float near, float far, const glm::vec2& jitter) const
 {
-	return glm::perspective(glm::radians(mZoom), aspectRatio, near, far);
+	glm::mat4 projection = glm::perspective(glm::radians(mZoom), aspectRatio, near, far);
+	// scaled by clip w along with x and y, so after the divide every depth moves by the same NDC offset
+	return glm::translate(glm::mat4(1.0f), glm::vec3(jitter, 0.0f)) * projection;
 }
 
 void Camera::Move(Movement movement)
@@ -17,7 +17,8 @@ public:
 	);
 
 	glm::mat4 GetViewMatrix() const;
-	glm::mat4 GetProjectionMatrix(float aspectRatio, float near = 0.1f, float far = 500.0f) const;
+	// jitter shifts the image by a sub-pixel offset in NDC units, for temporal anti-aliasing
+	glm::mat4 GetProjectionMatrix(float aspectRatio, float near = 0.1f, float far = 500.0f, const glm::vec2& jitter = glm::vec2(0.0f)) const;
 	inline float GetZoom() const { return mZoom; }
 	inline const glm::vec3& GetWorldPosition() const { return mCameraPos; }
 	inline const glm::vec3& GetForwardDirection() const { return mCameraForward; }
@@ -0,0 +1,133 @@
+#include "CascadedShadowMap.h"
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "Camera.h"
+
+CascadedShadowMap::CascadedShadowMap() :
+	mResolution(0), mNumCascades(0),
+	mFBO(0), mTextureId(0),
+	mSplitLambda(0.75f), mShadowDistance(100.0f), mCasterDistance(50.0f)
+{
+}
+
+CascadedShadowMap::~CascadedShadowMap()
+{
+	glDeleteFramebuffers(1, &mFBO);
+	glDeleteTextures(1, &mTextureId);
+}
+
+void CascadedShadowMap::Build(unsigned int resolution, unsigned int numCascades)
+{
+	glDeleteFramebuffers(1, &mFBO);
+	glDeleteTextures(1, &mTextureId);
+
+	mResolution = resolution;
+	mNumCascades = std::clamp(numCascades, 1u, MAX_CASCADES);
+
+	glGenFramebuffers(1, &mFBO);
+	glGenTextures(1, &mTextureId);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, mTextureId);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, resolution, resolution, mNumCascades, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	float borderColor[4]{ 1.0f, 1.0f, 1.0f, 1.0f };
+	glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, mTextureId, 0, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ERROR: Cascaded shadow map Framebuffer is not complete" << std::endl;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void CascadedShadowMap::Update(const Camera& camera, float aspectRatio, float nearPlane, const glm::vec3& lightDirection)
+{
+	float fovY = glm::radians(camera.GetZoom());
+	glm::vec3 up = std::abs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+	float splitNear = nearPlane;
+	for (unsigned int i = 0; i < mNumCascades; i++)
+	{
+		// practical split scheme, a blend of the uniform and the logarithmic split
+		float p = static_cast<float>(i + 1) / static_cast<float>(mNumCascades);
+		float logSplit = nearPlane * std::pow(mShadowDistance / nearPlane, p);
+		float uniformSplit = nearPlane + (mShadowDistance - nearPlane) * p;
+		float splitFar = mSplitLambda * logSplit + (1.0f - mSplitLambda) * uniformSplit;
+
+		// the slice centre lies on the view axis, its radius only depends on the split distances
+		float centerDistance = 0.0f;
+		float radius = GetSliceRadius(splitNear, splitFar, fovY, aspectRatio, &centerDistance);
+		glm::vec3 center = camera.GetWorldPosition() + camera.GetForwardDirection() * centerDistance;
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+
+		float depthRange = 2.0f * radius + mCasterDistance;
+		glm::mat4 lightView = glm::lookAt(center - lightDirection * (radius + mCasterDistance), center, up);
+		glm::mat4 lightProjection = glm::ortho(-radius, radius, -radius, radius, 0.0f, depthRange);
+
+		// move the projection by the sub-texel part of the world origin, so the texel grid stays fixed in world space
+		glm::vec4 origin = lightProjection * lightView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		origin *= 0.5f * static_cast<float>(mResolution);
+		glm::vec4 snappedOrigin = glm::round(origin);
+		glm::vec4 offset = (snappedOrigin - origin) * (2.0f / static_cast<float>(mResolution));
+		lightProjection[3][0] += offset.x;
+		lightProjection[3][1] += offset.y;
+
+		Cascade& cascade = mCascades[i];
+		cascade.LightSpaceMatrix = lightProjection * lightView;
+		cascade.CullingFrustum = Frustum(cascade.LightSpaceMatrix);
+		cascade.SplitFar = splitFar;
+		cascade.TexelWorldSize = 2.0f * radius / static_cast<float>(mResolution);
+		cascade.DepthRange = depthRange;
+
+		splitNear = splitFar;
+	}
+}
+
+float CascadedShadowMap::GetSliceRadius(float nearDistance, float farDistance, float fovY, float aspectRatio, float* centerDistance)
+{
+	// sphere through the near and far corners of the slice, centred on the view axis
+	float tanSquared = std::tan(0.5f * fovY) * std::tan(0.5f * fovY) * (1.0f + aspectRatio * aspectRatio);
+	float distance = 0.5f * (nearDistance + farDistance) * (1.0f + tanSquared);
+	float radius = 0.0f;
+	if (distance > farDistance)
+	{
+		// wide slices: the sphere around the far rectangle already contains the near corners
+		distance = farDistance;
+		radius = farDistance * std::sqrt(tanSquared);
+	}
+	else
+	{
+		float toNear = distance - nearDistance;
+		radius = std::sqrt(toNear * toNear + nearDistance * nearDistance * tanSquared);
+	}
+
+	if (centerDistance)
+	{
+		*centerDistance = distance;
+	}
+	return radius;
+}
+
+void CascadedShadowMap::BindCascade(unsigned int cascade)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, mTextureId, 0, cascade);
+}
+
+void CascadedShadowMap::Unbind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
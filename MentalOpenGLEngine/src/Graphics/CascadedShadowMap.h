@@ -0,0 +1,55 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include "Frustum.h"
+
+class Camera;
+
+// Directional light shadows split into cascades along the view depth, stored as the layers of one depth texture array.
+// Every cascade is fitted around the bounding sphere of its camera frustum slice, so its size does not change when
+// the camera rotates, and its origin is snapped to whole shadow map texels, so edges do not shimmer while moving.
+class CascadedShadowMap
+{
+public:
+	static constexpr unsigned int MAX_CASCADES = 4;
+
+	struct Cascade
+	{
+		glm::mat4 LightSpaceMatrix{ 1.0f };
+		Frustum CullingFrustum;
+		float SplitFar{ 0.0f };
+		float TexelWorldSize{ 0.0f };
+		float DepthRange{ 0.0f };
+	};
+
+	CascadedShadowMap();
+	virtual ~CascadedShadowMap();
+
+	void Build(unsigned int resolution, unsigned int numCascades);
+	void Update(const Camera& camera, float aspectRatio, float nearPlane, const glm::vec3& lightDirection);
+	void BindCascade(unsigned int cascade);
+	void Unbind();
+
+	static float GetSliceRadius(float nearDistance, float farDistance, float fovY, float aspectRatio, float* centerDistance = nullptr);
+
+	// 0 splits the shadow distance uniformly, 1 logarithmically
+	inline void SetSplitLambda(float lambda) { mSplitLambda = lambda; }
+	inline float GetSplitLambda() const { return mSplitLambda; }
+	inline void SetShadowDistance(float distance) { mShadowDistance = distance; }
+	inline float GetShadowDistance() const { return mShadowDistance; }
+	// how far behind a cascade casters are still rendered
+	inline void SetCasterDistance(float distance) { mCasterDistance = distance; }
+
+	inline unsigned int GetResolution() const { return mResolution; }
+	inline unsigned int GetNumCascades() const { return mNumCascades; }
+	inline unsigned int GetTextureId() const { return mTextureId; }
+	inline const Cascade& GetCascade(unsigned int cascade) const { return mCascades[cascade]; }
+	inline size_t GetMemorySize() const { return size_t(mResolution) * mResolution * mNumCascades * sizeof(float); }
+
+private:
+	unsigned int mResolution, mNumCascades;
+	unsigned int mFBO, mTextureId;
+	float mSplitLambda, mShadowDistance, mCasterDistance;
+
+	Cascade mCascades[MAX_CASCADES];
+};
@@ -0,0 +1,199 @@
+#include "ConeStepMap.h"
+
+#include <iostream>
+#include <fstream>
+#include <format>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include "External/stb_image.h"
+
+// wider cones are clamped, a ray stepping that far in one go already skips most of the texture
+static constexpr float MAX_CONE_RATIO = 1.0f;
+
+struct ConeOffset
+{
+	int X;
+	int Y;
+	float Distance;
+};
+
+static inline float SampleDepth(const std::vector<float>& depths, int width, int height, int x, int y)
+{
+	// the maps tile, so the search wraps around the edges
+	x = ((x % width) + width) % width;
+	y = ((y % height) + height) % height;
+	return depths[static_cast<size_t>(y) * width + x];
+}
+
+// Every neighbour closer than the surface of the texel constrains its cone: the ray from the top of the texel through
+// the neighbour's surface point enters the surface there, and the cone must not reach the point where it comes out again
+static float BakeCone(const std::vector<float>& depths, int width, int height, int x, int y, const std::vector<ConeOffset>& offsets, int maxSteps)
+{
+	float srcDepth = SampleDepth(depths, width, height, x, y);
+	float cone = MAX_CONE_RATIO;
+
+	for (const ConeOffset& offset : offsets)
+	{
+		// the exit point is at least as far away as the neighbour and no deeper than the texel,
+		// so no neighbour from here on can narrow the cone
+		if (offset.Distance >= cone * srcDepth)
+		{
+			break;
+		}
+
+		float dstDepth = SampleDepth(depths, width, height, x + offset.X, y + offset.Y);
+		if (dstDepth >= srcDepth)
+		{
+			continue;
+		}
+
+		// march one texel at a time along the ray, beyond the neighbour, while it stays inside the surface
+		float length = std::sqrt(static_cast<float>(offset.X * offset.X + offset.Y * offset.Y));
+		float stepX = offset.X / length;
+		float stepY = offset.Y / length;
+		float stepDepth = dstDepth / length;
+
+		float exitX = static_cast<float>(offset.X);
+		float exitY = static_cast<float>(offset.Y);
+		float exitDepth = dstDepth;
+		for (int i = 0; i < maxSteps && stepDepth > 0.0f; i++)
+		{
+			float rayX = exitX + stepX;
+			float rayY = exitY + stepY;
+			float rayDepth = exitDepth + stepDepth;
+			if (rayDepth >= srcDepth)
+			{
+				break;
+			}
+			float surfaceDepth = SampleDepth(depths, width, height, x + static_cast<int>(std::lround(rayX)), y + static_cast<int>(std::lround(rayY)));
+			if (rayDepth < surfaceDepth)
+			{
+				break;
+			}
+			exitX = rayX;
+			exitY = rayY;
+			exitDepth = rayDepth;
+		}
+
+		float u = exitX / width;
+		float v = exitY / height;
+		cone = std::min(cone, std::sqrt(u * u + v * v) / (srcDepth - exitDepth));
+	}
+
+	return cone;
+}
+
+std::vector<float> BakeRelaxedCones(const std::vector<float>& depths, int width, int height, int searchRadius, unsigned int numThreads)
+{
+	std::vector<float> cones(depths.size(), MAX_CONE_RATIO);
+	if (width <= 0 || height <= 0 || depths.size() != static_cast<size_t>(width) * height)
+	{
+		return cones;
+	}
+
+	// sorted by their distance in texture coordinates, so the search can stop at the first one too far to matter
+	std::vector<ConeOffset> offsets;
+	for (int y = -searchRadius; y <= searchRadius; y++)
+	{
+		for (int x = -searchRadius; x <= searchRadius; x++)
+		{
+			if ((x != 0 || y != 0) && x * x + y * y <= searchRadius * searchRadius)
+			{
+				float u = static_cast<float>(x) / width;
+				float v = static_cast<float>(y) / height;
+				offsets.push_back({ x, y, std::sqrt(u * u + v * v) });
+			}
+		}
+	}
+	std::sort(offsets.begin(), offsets.end(), [](const ConeOffset& a, const ConeOffset& b) { return a.Distance < b.Distance; });
+
+	if (numThreads == 0)
+	{
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	numThreads = std::clamp(numThreads, 1u, static_cast<unsigned int>(height));
+
+	// rows are interleaved between the threads, deep and flat regions of the map cost very different amounts
+	auto worker = [&](unsigned int thread) {
+		for (int y = static_cast<int>(thread); y < height; y += static_cast<int>(numThreads))
+		{
+			for (int x = 0; x < width; x++)
+			{
+				cones[static_cast<size_t>(y) * width + x] = BakeCone(depths, width, height, x, y, offsets, 2 * searchRadius);
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(numThreads - 1);
+	for (unsigned int i = 1; i < numThreads; i++)
+	{
+		threads.emplace_back(worker, i);
+	}
+	worker(0);
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	return cones;
+}
+
+bool BakeConeStepMap(const char* heightMapPath, const char* outputPath, int searchRadius, unsigned int numThreads)
+{
+	int width, height, numChannels;
+	unsigned char* data = stbi_load(heightMapPath, &width, &height, &numChannels, 1);
+	if (!data)
+	{
+		std::cout << "Error: Failed to load height map " << heightMapPath << std::endl;
+		return false;
+	}
+
+	std::vector<float> depths(static_cast<size_t>(width) * height);
+	for (size_t i = 0; i < depths.size(); i++)
+	{
+		depths[i] = data[i] / 255.0f;
+	}
+	stbi_image_free(data);
+
+	auto start = std::chrono::high_resolution_clock::now();
+	std::vector<float> cones = BakeRelaxedCones(depths, width, height, searchRadius, numThreads);
+	auto end = std::chrono::high_resolution_clock::now();
+
+	std::ofstream file(outputPath, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Error: Failed to write cone step map " << outputPath << std::endl;
+		return false;
+	}
+
+	// the square root keeps more of the 8 bits for the narrow cones, which decide how slowly the ray converges
+	std::vector<unsigned char> pixels(depths.size() * 3);
+	for (size_t i = 0; i < depths.size(); i++)
+	{
+		pixels[i * 3 + 0] = static_cast<unsigned char>(std::lround(depths[i] * 255.0f));
+		pixels[i * 3 + 1] = static_cast<unsigned char>(std::lround(std::sqrt(cones[i] / MAX_CONE_RATIO) * 255.0f));
+		pixels[i * 3 + 2] = 0;
+	}
+	file << "P6\n" << width << " " << height << "\n255\n";
+	file.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+
+	std::cout << std::format(
+		"Baked cone step map {} ({}x{}, search radius {}) in {:.1f} ms\n",
+		outputPath, width, height, searchRadius, std::chrono::duration<double, std::milli>(end - start).count()
+	);
+	return true;
+}
+
+std::string GetConeStepMapPath(const char* heightMapPath)
+{
+	std::string path(heightMapPath);
+	size_t extension = path.find_last_of('.');
+	if (extension != std::string::npos && path.find_first_of("/\\", extension) == std::string::npos)
+	{
+		path.erase(extension);
+	}
+	return path + "_cone.ppm";
+}
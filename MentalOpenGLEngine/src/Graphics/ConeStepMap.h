@@ -0,0 +1,21 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+// Texels searched around every texel by default, the cones of farther texels are rarely narrower
+static constexpr int CONE_STEP_SEARCH_RADIUS = 32;
+
+// Bakes relaxed cone step ratios (horizontal texture coordinate distance per unit of depth) for a tiling depth map
+// with values in [0, 1], 0 being the top of the surface. The cone above each texel is the widest one that a view ray
+// can enter without crossing the surface more than once, so a shader can step along the ray by cone intersections
+// and refine the last step with a short binary search. Only texels within searchRadius are tested.
+// numThreads = 0 uses every hardware thread.
+std::vector<float> BakeRelaxedCones(const std::vector<float>& depths, int width, int height, int searchRadius, unsigned int numThreads = 0);
+
+// Bakes the depth map at heightMapPath into a binary PPM with the depth in red and the square root of
+// the cone ratio in green, which the parallax shader reads from the height texture
+bool BakeConeStepMap(const char* heightMapPath, const char* outputPath, int searchRadius = CONE_STEP_SEARCH_RADIUS, unsigned int numThreads = 0);
+
+// resources/textures/bricks2_disp.jpg -> resources/textures/bricks2_disp_cone.ppm
+std::string GetConeStepMapPath(const char* heightMapPath);
@@ -43,6 +43,15 @@ namespace Core
 		glm::vec3 Tangent;
 	};
 
+	struct BoundingBox
+	{
+		glm::vec3 Min{ 0.0f };
+		glm::vec3 Max{ 0.0f };
+
+		inline glm::vec3 GetCenter() const { return (Min + Max) * 0.5f; }
+		inline glm::vec3 GetExtents() const { return (Max - Min) * 0.5f; }
+	};
+
 	struct Texture
 	{
 		unsigned int ID;
@@ -58,6 +67,23 @@ namespace Core
 		glm::vec3 RotationAxis{ 1.0f, 0.0f, 0.0f };
 	};
 
+	struct Material
+	{
+		float TexTiling{ 1.0f };
+		float NormalsMultiplier{ 1.0f };
+		bool TwoSided{ false };
+		// the height texture is a baked cone step map rather than a plain depth map
+		bool ConeStepMap{ false };
+
+		inline bool operator==(const Material& other) const
+		{
+			return TexTiling == other.TexTiling &&
+				NormalsMultiplier == other.NormalsMultiplier &&
+				TwoSided == other.TwoSided &&
+				ConeStepMap == other.ConeStepMap;
+		}
+	};
+
 	struct TextureImport
 	{
 		const char* path;
@@ -2,10 +2,12 @@
 #include <glad/glad.h>
 #include <iostream>
 
-void DepthMap::Build(unsigned int width, unsigned int height, DepthMapType type)
+void DepthMap::Build(unsigned int width, unsigned int height, DepthMapType type, DepthMapFormat format)
 {
 	mWidth = width;
 	mHeight = height;
+	mFormat = format;
+	GLint internalFormat = format == Depth16 ? GL_DEPTH_COMPONENT16 : GL_DEPTH_COMPONENT;
 
 	glGenFramebuffers(1, &mFBO);
 	glGenTextures(1, &mDepthMapTexture);
@@ -13,7 +15,7 @@ void DepthMap::Build(unsigned int width, unsigned int height, DepthMapType type)
 	if (type == Directional)
 	{
 		glBindTexture(GL_TEXTURE_2D, mDepthMapTexture);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
@@ -29,7 +31,7 @@ void DepthMap::Build(unsigned int width, unsigned int height, DepthMapType type)
 		glBindTexture(GL_TEXTURE_CUBE_MAP, mDepthMapTexture);
 		for (unsigned int i = 0; i < 6; i++)
 		{
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
+			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, internalFormat, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, 0);
 		}
 		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -56,6 +58,20 @@ void DepthMap::Build(unsigned int width, unsigned int height, DepthMapType type)
 void DepthMap::Bind()
 {
 	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+
+	// a single face was attached for a per-face pass, the whole cubemap goes back for layered rendering
+	if (mBoundFace >= 0)
+	{
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, mDepthMapTexture, 0);
+		mBoundFace = -1;
+	}
+}
+
+void DepthMap::BindFace(unsigned int face)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mDepthMapTexture, 0);
+	mBoundFace = static_cast<int>(face);
 }
 
 void DepthMap::Unbind()
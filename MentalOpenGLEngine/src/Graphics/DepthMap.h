@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstddef>
+
 class DepthMap
 {
 public:
@@ -8,15 +10,25 @@ public:
 		Directional, Point
 	};
 
-	void Build(unsigned int width, unsigned int height, DepthMapType type = Directional);
+	enum DepthMapFormat
+	{
+		Depth32 = 0, Depth16
+	};
+
+	void Build(unsigned int width, unsigned int height, DepthMapType type = Directional, DepthMapFormat format = Depth32);
 	void Bind();
+	void BindFace(unsigned int face);
 	void Unbind();
 	virtual ~DepthMap();
 
 	inline unsigned int GetWidth() const { return mWidth; }
 	inline unsigned int GetHeight() const { return mHeight; }
 	inline unsigned int GetTextureColorId() const { return mDepthMapTexture; }
+	inline DepthMapFormat GetFormat() const { return mFormat; }
+	inline static size_t GetBytesPerTexel(DepthMapFormat format) { return format == Depth16 ? 2 : 4; }
 
 private:
 	unsigned int mWidth, mHeight, mFBO, mDepthMapTexture;
+	int mBoundFace{ -1 };
+	DepthMapFormat mFormat{ Depth32 };
 };
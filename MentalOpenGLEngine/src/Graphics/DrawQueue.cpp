@@ -0,0 +1,557 @@
+#include "DrawQueue.h"
+
+#include <algorithm>
+#include <climits>
+#include <cassert>
+#include <cmath>
+#include <iterator>
+#include <glad/glad.h>
+#include <glm/gtc/type_ptr.hpp>
+
+// sort key layout, from the most to the least significant bits:
+// | pass: 2 | shader features: 6 | material: 20 | depth bucket: 16 | mesh: 20 |
+static constexpr unsigned int MESH_BITS = 20;
+static constexpr unsigned int DEPTH_BITS = 16;
+static constexpr unsigned int MATERIAL_BITS = 20;
+static constexpr unsigned int SHADER_BITS = 6;
+
+static constexpr unsigned int DEPTH_SHIFT = MESH_BITS;
+static constexpr unsigned int MATERIAL_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+static constexpr unsigned int SHADER_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+static constexpr unsigned int PASS_SHIFT = SHADER_SHIFT + SHADER_BITS;
+
+// transparent keys hold only the pass and the full float depth, so packets at equal depth
+// keep their submission order: | pass: 2 | unused: 30 | depth: 32 |
+
+// meshes below this size are cheaper to draw unsorted than to sort per frame
+static constexpr unsigned int MIN_TRIANGLES_FOR_SORTING = 512;
+
+// projected diameter of the bounds as a fraction of the screen height, below which each coarser level of detail is used
+static constexpr float LOD_SCREEN_SIZES[]{ 0.25f, 0.125f, 0.0625f };
+static_assert(std::size(LOD_SCREEN_SIZES) == MAX_MESH_LODS - 1, "one threshold per level after the first");
+// an instance only changes level once its size is this much past the threshold, so it doesn't flicker at the boundary
+static constexpr float LOD_HYSTERESIS = 0.1f;
+
+static constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+static constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+static constexpr uint64_t Mask(unsigned int bits)
+{
+	return (uint64_t(1) << bits) - 1;
+}
+
+static unsigned int LodForScreenSize(float screenSize)
+{
+	unsigned int lod = 0;
+	while (lod < std::size(LOD_SCREEN_SIZES) && screenSize < LOD_SCREEN_SIZES[lod])
+	{
+		lod++;
+	}
+	return lod;
+}
+
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * FNV_PRIME;
+	}
+	return hash;
+}
+
+DrawQueue::DrawQueue() :
+	mInstanceVBO(0u),
+	mInstanceMatrixLocation(0u),
+	mInstanceBufferCapacity(0),
+	mBatchingEnabled(true),
+	mSortingEnabled(true),
+	mTriangleSortingEnabled(false),
+	mLodSelectionEnabled(true),
+	mIsDirty(true),
+	mViewPosition(0.0f),
+	mViewForward(0.0f, 0.0f, -1.0f),
+	mFarPlane(100.0f),
+	mLodProjectionScale(1.0f),
+	mFrameIndex(0),
+	mStaticHash(FNV_OFFSET_BASIS),
+	mShaderFeatureSets(0),
+	mNumDynamicItems(0)
+{
+
+}
+
+DrawQueue::~DrawQueue()
+{
+	glDeleteBuffers(1, &mInstanceVBO);
+}
+
+void DrawQueue::Create(unsigned int instanceMatrixLocation)
+{
+	mInstanceMatrixLocation = instanceMatrixLocation;
+	glGenBuffers(1, &mInstanceVBO);
+}
+
+void DrawQueue::Clear()
+{
+	mItems.clear();
+	mStats = {};
+	mStaticHash = FNV_OFFSET_BASIS;
+	mShaderFeatureSets = 0;
+	mNumDynamicItems = 0;
+	mDynamicBounds = {};
+	mFrameIndex++;
+	mIsDirty = true;
+}
+
+void DrawQueue::Reserve(size_t numItems)
+{
+	mItems.reserve(numItems);
+	mSortItems.reserve(numItems);
+	mSortScratch.reserve(numItems);
+	mBatches.reserve(numItems);
+	mInstanceMatrices.reserve(numItems);
+	mInstanceBounds.reserve(numItems);
+}
+
+void DrawQueue::SetView(const glm::vec3& position, const glm::vec3& forward, float farPlane, float fovY)
+{
+	mViewPosition = position;
+	mViewForward = forward;
+	mFarPlane = farPlane;
+	mLodProjectionScale = 1.0f / std::tan(0.5f * fovY);
+	mIsDirty = true;
+}
+
+void DrawQueue::Submit(
+	const Model& model,
+	const glm::mat4& modelMat,
+	const Core::Material& material,
+	Pass pass,
+	Mobility mobility
+)
+{
+	for (const std::shared_ptr<Mesh>& mesh : model.GetMeshes())
+	{
+		// world-space box around the transformed local box, for culling
+		glm::vec3 center = glm::vec3(modelMat * glm::vec4(mesh->GetBounds().GetCenter(), 1.0f));
+		glm::vec3 localExtents = mesh->GetBounds().GetExtents();
+		glm::vec3 extents = glm::abs(glm::vec3(modelMat[0])) * localExtents.x +
+			glm::abs(glm::vec3(modelMat[1])) * localExtents.y +
+			glm::abs(glm::vec3(modelMat[2])) * localExtents.z;
+		Core::BoundingBox bounds{ center - extents, center + extents };
+		float depth = glm::dot(center - mViewPosition, mViewForward);
+
+		// transparent packets may sort the triangles of the full resolution level only
+		unsigned int lod = pass == Opaque ? SelectLod(*mesh, center, glm::length(extents)) : 0u;
+
+		// two sided materials only change the culling state, but sort apart like a shader feature
+		unsigned int meshFeatures = mesh->GetShaderFeatures();
+		unsigned int shaderFeatures = meshFeatures | (material.TwoSided ? 8u : 0u);
+		if (pass == Opaque)
+		{
+			mShaderFeatureSets |= uint64_t(1) << meshFeatures;
+		}
+
+		mItems.push_back({
+			mesh.get(), modelMat, bounds, material, pass, mobility, shaderFeatures,
+			GetMaterialId(*mesh, material), GetMeshId(mesh.get()) * MAX_MESH_LODS + lod, lod, depth
+		});
+
+		if (mobility == Static)
+		{
+			// a static packet that changes its level changes the shadows cached from it
+			mStaticHash = HashBytes(mStaticHash, &lod, sizeof(lod));
+		}
+
+		if (mobility == Dynamic)
+		{
+			bool isFirst = mNumDynamicItems == 0;
+			mDynamicBounds.Min = isFirst ? bounds.Min : glm::min(mDynamicBounds.Min, bounds.Min);
+			mDynamicBounds.Max = isFirst ? bounds.Max : glm::max(mDynamicBounds.Max, bounds.Max);
+			mNumDynamicItems++;
+		}
+	}
+
+	if (mobility == Static)
+	{
+		const Model* modelPtr = &model;
+		mStaticHash = HashBytes(mStaticHash, &modelPtr, sizeof(modelPtr));
+		mStaticHash = HashBytes(mStaticHash, &modelMat, sizeof(modelMat));
+	}
+
+	mStats.NumItems = static_cast<unsigned int>(mItems.size());
+	mIsDirty = true;
+}
+
+void DrawQueue::Prepare()
+{
+	if (mIsDirty)
+	{
+		BuildBatches();
+		mIsDirty = false;
+	}
+}
+
+void DrawQueue::Flush(
+	ShaderProgram& shader,
+	ShaderProgram* const shaderInstanced,
+	Pass pass,
+	const Frustum* frustum,
+	unsigned int mobilityMask
+)
+{
+	FlushBatches(&shader, shaderInstanced, nullptr, nullptr, pass, frustum, mobilityMask);
+}
+
+void DrawQueue::Flush(
+	ShaderPermutations& shaders,
+	ShaderPermutations* const shadersInstanced,
+	Pass pass,
+	const Frustum* frustum,
+	unsigned int mobilityMask
+)
+{
+	FlushBatches(nullptr, nullptr, &shaders, shadersInstanced, pass, frustum, mobilityMask);
+}
+
+void DrawQueue::FlushBatches(
+	ShaderProgram* const shader,
+	ShaderProgram* const shaderInstanced,
+	ShaderPermutations* const shaders,
+	ShaderPermutations* const shadersInstanced,
+	Pass pass,
+	const Frustum* frustum,
+	unsigned int mobilityMask
+)
+{
+	Prepare();
+
+	ShaderProgram* boundShader = nullptr;
+	unsigned int boundMaterialId = UINT_MAX;
+	const Mesh* boundMesh = nullptr;
+	bool isCullingEnabled = true;
+
+	for (const Batch& batch : mBatches)
+	{
+		if (batch.BatchPass != pass || (batch.BatchMobility & mobilityMask) == 0)
+		{
+			continue;
+		}
+
+		bool instanced = (shaders ? shadersInstanced != nullptr : shaderInstanced != nullptr) && batch.NumInstances > 1;
+		ShaderProgram& batchShader = shaders ?
+			batch.MeshPtr->SelectProgram(instanced ? *shadersInstanced : *shaders) :
+			(instanced ? *shaderInstanced : *shader);
+
+		if (boundShader != &batchShader)
+		{
+			batchShader.Bind();
+			boundShader = &batchShader;
+			boundMaterialId = UINT_MAX; // material uniforms live in the program
+			mStats.NumProgramChanges++;
+		}
+
+		if (boundMaterialId != batch.MaterialId)
+		{
+			ApplyMaterial(batchShader, batch.Material);
+			batch.MeshPtr->BindTextures(batchShader, shaders == nullptr);
+			boundMaterialId = batch.MaterialId;
+			mStats.NumMaterialChanges++;
+		}
+
+		if (boundMesh != batch.MeshPtr)
+		{
+			boundMesh = batch.MeshPtr;
+			mStats.NumMeshChanges++;
+		}
+
+		if (isCullingEnabled == batch.Material.TwoSided)
+		{
+			isCullingEnabled = !batch.Material.TwoSided;
+			isCullingEnabled ? glEnable(GL_CULL_FACE) : glDisable(GL_CULL_FACE);
+		}
+
+		if (instanced && !frustum)
+		{
+			DrawInstances(batch, batch.FirstInstance, batch.NumInstances);
+		}
+		else if (instanced)
+		{
+			// culled instances split the batch into runs of visible ones, each run is still one instanced draw
+			unsigned int runStart = batch.FirstInstance;
+			unsigned int batchEnd = batch.FirstInstance + batch.NumInstances;
+			for (unsigned int i = batch.FirstInstance; i < batchEnd; i++)
+			{
+				if (!frustum->Intersects(mInstanceBounds[i]))
+				{
+					if (i > runStart)
+					{
+						DrawInstances(batch, runStart, i - runStart);
+					}
+					runStart = i + 1;
+					mStats.NumCulledItems++;
+				}
+			}
+			if (batchEnd > runStart)
+			{
+				DrawInstances(batch, runStart, batchEnd - runStart);
+			}
+		}
+		else
+		{
+			for (unsigned int i = 0; i < batch.NumInstances; i++)
+			{
+				if (frustum && !frustum->Intersects(mInstanceBounds[batch.FirstInstance + i]))
+				{
+					mStats.NumCulledItems++;
+					continue;
+				}
+
+				const glm::mat4& modelMat = mInstanceMatrices[batch.FirstInstance + i];
+
+				bool sortTriangles = mTriangleSortingEnabled && batch.BatchPass == Transparent &&
+					batch.MeshPtr->SupportsTriangleSorting() &&
+					batch.MeshPtr->GetNumTriangles() >= MIN_TRIANGLES_FOR_SORTING;
+				if (sortTriangles)
+				{
+					batch.MeshPtr->SortTriangles(glm::vec3(glm::inverse(modelMat) * glm::vec4(mViewPosition, 1.0f)));
+					mStats.NumTriangleSorts++;
+				}
+
+				batchShader.SetUniformMat4("uModel", glm::value_ptr(modelMat));
+				batch.MeshPtr->DrawGeometry(batch.Lod);
+				mStats.NumDrawCalls++;
+				mStats.NumTriangles += batch.MeshPtr->GetNumTriangles(batch.Lod);
+			}
+		}
+	}
+
+	if (!isCullingEnabled)
+	{
+		glEnable(GL_CULL_FACE);
+	}
+	Mesh::UnbindTextures();
+}
+
+void DrawQueue::GetDrawOrder(Pass pass, std::vector<Packet>& packets)
+{
+	Prepare();
+
+	// the batches are built in the order of the sort items, so this is the order they are drawn in
+	packets.clear();
+	for (const SortItem& sortItem : mSortItems)
+	{
+		const Item& item = mItems[sortItem.Index];
+		if (item.ItemPass == pass)
+		{
+			packets.push_back({ sortItem.Index, item.Depth });
+		}
+	}
+}
+
+void DrawQueue::BuildBatches()
+{
+	size_t numItems = mItems.size();
+
+	// with batching, all instances of a mesh share the depth bucket of the nearest one,
+	// so they stay adjacent after sorting and still go front-to-back as a group
+	bool useGroupDepth = mSortingEnabled && mBatchingEnabled;
+	if (useGroupDepth)
+	{
+		mGroupDepths.clear();
+		for (const Item& item : mItems)
+		{
+			uint64_t group = (uint64_t(item.MaterialId) << 32) | item.MeshId;
+			auto it = mGroupDepths.try_emplace(group, item.Depth).first;
+			it->second = std::min(it->second, item.Depth);
+		}
+	}
+
+	mSortItems.resize(numItems);
+	for (size_t i = 0; i < numItems; i++)
+	{
+		const Item& item = mItems[i];
+		uint64_t key = i;
+		if (mSortingEnabled)
+		{
+			float depth = item.Depth;
+			if (useGroupDepth && item.ItemPass == Opaque)
+			{
+				depth = mGroupDepths[(uint64_t(item.MaterialId) << 32) | item.MeshId];
+			}
+			key = MakeSortKey(item, depth);
+		}
+		mSortItems[i] = { key, static_cast<uint32_t>(i) };
+	}
+
+	if (mSortingEnabled)
+	{
+		RadixSort(mSortItems, mSortScratch);
+	}
+
+	mBatches.clear();
+	mInstanceMatrices.clear();
+	mInstanceBounds.clear();
+	for (const SortItem& sortItem : mSortItems)
+	{
+		const Item& item = mItems[sortItem.Index];
+		unsigned int instanceIndex = static_cast<unsigned int>(mInstanceMatrices.size());
+		mInstanceMatrices.push_back(item.ModelMat);
+		mInstanceBounds.push_back(item.Bounds);
+
+		// sorted transparent packets must keep their back-to-front order, so they are only merged when unsorted
+		bool extendsLastBatch = mBatchingEnabled && (item.ItemPass == Opaque || !mSortingEnabled) && !mBatches.empty() &&
+			mBatches.back().BatchPass == item.ItemPass &&
+			mBatches.back().BatchMobility == item.ItemMobility &&
+			mBatches.back().MeshPtr == item.MeshPtr &&
+			mBatches.back().Lod == item.Lod &&
+			mBatches.back().MaterialId == item.MaterialId;
+
+		if (extendsLastBatch)
+		{
+			mBatches.back().NumInstances++;
+		}
+		else
+		{
+			mBatches.push_back({ item.MeshPtr, item.Material, item.ItemPass, item.ItemMobility, item.MaterialId, instanceIndex, 1u, item.Lod });
+		}
+	}
+
+	assert(mInstanceMatrices.size() == mItems.size() && "every submitted packet must be drawn exactly once");
+
+	if (mBatchingEnabled)
+	{
+		UploadInstanceMatrices();
+	}
+}
+
+uint64_t DrawQueue::MakeSortKey(const Item& item, float depth) const
+{
+	if (item.ItemPass == Transparent)
+	{
+		// inverted, so the farthest packet comes first
+		uint64_t depthKey = ~FloatToSortableUint(depth);
+		return (uint64_t(item.ItemPass) << PASS_SHIFT) | depthKey;
+	}
+
+	float normalizedDepth = std::clamp(depth / mFarPlane, 0.0f, 1.0f);
+	uint64_t depthBucket = static_cast<uint64_t>(normalizedDepth * static_cast<float>(Mask(DEPTH_BITS)));
+
+	return
+		(uint64_t(item.ItemPass) << PASS_SHIFT) |
+		((uint64_t(item.ShaderFeatures) & Mask(SHADER_BITS)) << SHADER_SHIFT) |
+		((uint64_t(item.MaterialId) & Mask(MATERIAL_BITS)) << MATERIAL_SHIFT) |
+		(depthBucket << DEPTH_SHIFT) |
+		(uint64_t(item.MeshId) & Mask(MESH_BITS));
+}
+
+unsigned int DrawQueue::SelectLod(const Mesh& mesh, const glm::vec3& center, float radius)
+{
+	unsigned int numLods = mesh.GetNumLods();
+	if (!mLodSelectionEnabled || numLods < 2)
+	{
+		return 0;
+	}
+
+	float distance = glm::length(center - mViewPosition);
+	float screenSize = distance > radius ? radius * mLodProjectionScale / distance : 1.0f;
+	unsigned int finestLod = LodForScreenSize(screenSize * (1.0f + LOD_HYSTERESIS));
+	unsigned int coarsestLod = LodForScreenSize(screenSize * (1.0f - LOD_HYSTERESIS));
+
+	// the n-th submission of a mesh in a frame is taken to be the same instance as the n-th one of the frame before
+	LodHistory& history = mLodHistories[&mesh];
+	if (history.Frame != mFrameIndex)
+	{
+		history.Frame = mFrameIndex;
+		history.NumSubmitted = 0;
+	}
+	unsigned int instance = history.NumSubmitted++;
+
+	unsigned int lod = LodForScreenSize(screenSize);
+	if (instance < history.Lods.size())
+	{
+		lod = std::clamp<unsigned int>(history.Lods[instance], finestLod, coarsestLod);
+	}
+	else
+	{
+		history.Lods.resize(instance + 1);
+	}
+	lod = std::min(lod, numLods - 1);
+	history.Lods[instance] = static_cast<unsigned char>(lod);
+	return lod;
+}
+
+unsigned int DrawQueue::GetMeshId(const Mesh* mesh)
+{
+	auto it = mMeshIds.try_emplace(mesh, static_cast<unsigned int>(mMeshIds.size())).first;
+	return it->second;
+}
+
+unsigned int DrawQueue::GetMaterialId(const Mesh& mesh, const Core::Material& material)
+{
+	MaterialKey key{
+		mesh.GetTextureId(Core::Diffuse),
+		mesh.GetTextureId(Core::Specular),
+		mesh.GetTextureId(Core::Normal),
+		mesh.GetTextureId(Core::Height),
+		material.TexTiling,
+		material.NormalsMultiplier,
+		material.TwoSided,
+		material.ConeStepMap
+	};
+
+	auto it = mMaterialIds.try_emplace(key, static_cast<unsigned int>(mMaterialIds.size())).first;
+	return it->second;
+}
+
+void DrawQueue::UploadInstanceMatrices()
+{
+	size_t size = mInstanceMatrices.size() * sizeof(glm::mat4);
+
+	glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
+	if (size > mInstanceBufferCapacity)
+	{
+		mInstanceBufferCapacity = size;
+		glBufferData(GL_ARRAY_BUFFER, size, mInstanceMatrices.data(), GL_STREAM_DRAW);
+	}
+	else
+	{
+		// orphan the previous storage so the driver doesn't wait for draws still reading it
+		glBufferData(GL_ARRAY_BUFFER, mInstanceBufferCapacity, NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, size, mInstanceMatrices.data());
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void DrawQueue::BindInstanceBuffer(const Mesh& mesh, unsigned int firstInstance) const
+{
+	size_t offset = static_cast<size_t>(firstInstance) * sizeof(glm::mat4);
+
+	glBindVertexArray(mesh.GetVAO());
+	glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		glEnableVertexAttribArray(mInstanceMatrixLocation + i);
+		glVertexAttribPointer(mInstanceMatrixLocation + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(offset + i * sizeof(glm::vec4)));
+		glVertexAttribDivisor(mInstanceMatrixLocation + i, 1);
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void DrawQueue::DrawInstances(const Batch& batch, unsigned int firstInstance, unsigned int numInstances)
+{
+	BindInstanceBuffer(*batch.MeshPtr, firstInstance);
+	batch.MeshPtr->DrawGeometryInstanced(numInstances, batch.Lod);
+	mStats.NumInstancedDrawCalls++;
+	mStats.NumDrawCalls++;
+	mStats.NumTriangles += batch.MeshPtr->GetNumTriangles(batch.Lod) * numInstances;
+}
+
+void DrawQueue::ApplyMaterial(ShaderProgram& shader, const Core::Material& material) const
+{
+	shader.SetUniform1f("uTexTiling", material.TexTiling);
+	shader.SetUniform1f("uNormalsMultiplier", material.NormalsMultiplier);
+	shader.SetUniform1i("uHasConeSteps", material.ConeStepMap);
+}
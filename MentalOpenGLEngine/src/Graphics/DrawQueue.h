@@ -0,0 +1,195 @@
+#pragma once
+
+#include <vector>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <glm/glm.hpp>
+#include "CoreTypes.h"
+#include "Model.h"
+#include "ShaderProgram.h"
+#include "ShaderPermutations.h"
+#include "RadixSort.h"
+#include "Frustum.h"
+
+// Collects the draws of a frame as per-mesh packets with a 64-bit sort key. Opaque packets are keyed by
+// (pass, shader features, material, depth bucket, mesh) and drawn front-to-back within a state group,
+// transparent packets by their full float view depth and drawn strictly back-to-front.
+// Packets are radix sorted before submission, and consecutive opaque packets that share a mesh
+// and a material are merged into instanced draws. Instance matrices are streamed into a transient buffer
+// once per frame and reused by every pass that flushes the queue. Opaque packets of meshes with levels of detail
+// pick theirs from the projected size of their bounds, with some hysteresis against switching back and forth.
+class DrawQueue
+{
+public:
+	enum Pass
+	{
+		Opaque = 0, Transparent
+	};
+
+	// bit mask, so a flush can select static casters, dynamic ones or both
+	enum Mobility
+	{
+		Static = 1, Dynamic = 2, AnyMobility = Static | Dynamic
+	};
+
+	struct Stats
+	{
+		unsigned int NumItems{ 0 };
+		unsigned int NumDrawCalls{ 0 };
+		unsigned int NumInstancedDrawCalls{ 0 };
+		unsigned int NumProgramChanges{ 0 };
+		unsigned int NumMaterialChanges{ 0 };
+		unsigned int NumMeshChanges{ 0 };
+		unsigned int NumCulledItems{ 0 };
+		unsigned int NumTriangles{ 0 };
+		// transparent meshes whose triangles were sorted back-to-front before drawing
+		unsigned int NumTriangleSorts{ 0 };
+	};
+
+	DrawQueue();
+	virtual ~DrawQueue();
+
+	void Create(unsigned int instanceMatrixLocation);
+	void Clear();
+	void Reserve(size_t numItems);
+	// the vertical field of view scales the projected sizes the levels of detail are selected by
+	void SetView(const glm::vec3& position, const glm::vec3& forward, float farPlane, float fovY);
+	void Submit(
+		const Model& model,
+		const glm::mat4& modelMat,
+		const Core::Material& material = {},
+		Pass pass = Opaque,
+		Mobility mobility = Static
+	);
+	void Prepare();
+	void Flush(
+		ShaderProgram& shader,
+		ShaderProgram* const shaderInstanced,
+		Pass pass = Opaque,
+		const Frustum* frustum = nullptr,
+		unsigned int mobilityMask = AnyMobility
+	);
+	// every mesh is drawn with the variant for its own shader features
+	void Flush(
+		ShaderPermutations& shaders,
+		ShaderPermutations* const shadersInstanced,
+		Pass pass = Opaque,
+		const Frustum* frustum = nullptr,
+		unsigned int mobilityMask = AnyMobility
+	);
+	struct Packet
+	{
+		unsigned int SubmissionIndex;
+		float Depth;
+	};
+	// the packets of a pass in the order they are drawn, numbered in the order they were submitted
+	void GetDrawOrder(Pass pass, std::vector<Packet>& packets);
+
+	inline void SetBatchingEnabled(bool enabled) { mBatchingEnabled = enabled; mIsDirty = true; }
+	inline bool IsBatchingEnabled() const { return mBatchingEnabled; }
+	inline void SetSortingEnabled(bool enabled) { mSortingEnabled = enabled; mIsDirty = true; }
+	inline bool IsSortingEnabled() const { return mSortingEnabled; }
+	inline void SetTriangleSortingEnabled(bool enabled) { mTriangleSortingEnabled = enabled; }
+	inline bool IsTriangleSortingEnabled() const { return mTriangleSortingEnabled; }
+	// applies to the packets submitted after the call
+	inline void SetLodSelectionEnabled(bool enabled) { mLodSelectionEnabled = enabled; }
+	inline bool IsLodSelectionEnabled() const { return mLodSelectionEnabled; }
+	inline const Stats& GetStats() const { return mStats; }
+	// bit i is set when an opaque packet uses the mesh shader feature mask i
+	inline uint64_t GetShaderFeatureSets() const { return mShaderFeatureSets; }
+	// changes whenever a static packet is added, removed or moved
+	inline uint64_t GetStaticHash() const { return mStaticHash; }
+	inline unsigned int GetNumDynamicItems() const { return mNumDynamicItems; }
+	// box around all dynamic packets, only meaningful while there are any
+	inline const Core::BoundingBox& GetDynamicBounds() const { return mDynamicBounds; }
+
+private:
+	struct Item
+	{
+		Mesh* MeshPtr;
+		glm::mat4 ModelMat;
+		Core::BoundingBox Bounds;
+		Core::Material Material;
+		Pass ItemPass;
+		Mobility ItemMobility;
+		unsigned int ShaderFeatures;
+		unsigned int MaterialId;
+		unsigned int MeshId;
+		unsigned int Lod;
+		float Depth;
+	};
+
+	struct Batch
+	{
+		Mesh* MeshPtr;
+		Core::Material Material;
+		Pass BatchPass;
+		Mobility BatchMobility;
+		unsigned int MaterialId;
+		unsigned int FirstInstance;
+		unsigned int NumInstances;
+		unsigned int Lod;
+	};
+
+	// the levels the submissions of a mesh were drawn at, in the order they were submitted
+	struct LodHistory
+	{
+		std::vector<unsigned char> Lods;
+		unsigned int NumSubmitted{ 0 };
+		uint64_t Frame{ UINT64_MAX };
+	};
+
+	using MaterialKey = std::tuple<unsigned int, unsigned int, unsigned int, unsigned int, float, float, bool, bool>;
+
+	void FlushBatches(
+		ShaderProgram* const shader,
+		ShaderProgram* const shaderInstanced,
+		ShaderPermutations* const shaders,
+		ShaderPermutations* const shadersInstanced,
+		Pass pass,
+		const Frustum* frustum,
+		unsigned int mobilityMask
+	);
+	void BuildBatches();
+	uint64_t MakeSortKey(const Item& item, float depth) const;
+	unsigned int SelectLod(const Mesh& mesh, const glm::vec3& center, float radius);
+	unsigned int GetMeshId(const Mesh* mesh);
+	unsigned int GetMaterialId(const Mesh& mesh, const Core::Material& material);
+	void UploadInstanceMatrices();
+	void BindInstanceBuffer(const Mesh& mesh, unsigned int firstInstance) const;
+	void DrawInstances(const Batch& batch, unsigned int firstInstance, unsigned int numInstances);
+	void ApplyMaterial(ShaderProgram& shader, const Core::Material& material) const;
+
+	unsigned int mInstanceVBO;
+	unsigned int mInstanceMatrixLocation;
+	size_t mInstanceBufferCapacity;
+	bool mBatchingEnabled;
+	bool mSortingEnabled;
+	bool mTriangleSortingEnabled;
+	bool mLodSelectionEnabled;
+	bool mIsDirty;
+
+	glm::vec3 mViewPosition;
+	glm::vec3 mViewForward;
+	float mFarPlane;
+	// 1 / tan(fovY / 2), turns a radius over a distance into a fraction of the screen height
+	float mLodProjectionScale;
+
+	std::vector<Item> mItems;
+	std::vector<SortItem> mSortItems;
+	std::vector<SortItem> mSortScratch;
+	std::vector<Batch> mBatches;
+	std::vector<glm::mat4> mInstanceMatrices;
+	std::vector<Core::BoundingBox> mInstanceBounds;
+	std::unordered_map<const Mesh*, unsigned int> mMeshIds;
+	std::map<MaterialKey, unsigned int> mMaterialIds;
+	std::unordered_map<uint64_t, float> mGroupDepths;
+	std::unordered_map<const Mesh*, LodHistory> mLodHistories;
+	uint64_t mFrameIndex;
+	Stats mStats;
+	uint64_t mStaticHash;
+	uint64_t mShaderFeatureSets;
+	unsigned int mNumDynamicItems;
+	Core::BoundingBox mDynamicBounds;
+};
@@ -0,0 +1,86 @@
+#include "DynamicResolution.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+// frame times within this fraction of the target leave the scale alone
+static constexpr float DEAD_BAND = 0.05f;
+// the measurement lags a few frames behind the scale it was taken at, so only part of the step is taken
+static constexpr float DAMPING = 0.25f;
+// smaller changes are not worth a different viewport
+static constexpr float MIN_SCALE_STEP = 0.01f;
+
+DynamicResolution::DynamicResolution() :
+	mEnabled(false),
+	mTargetMs(16.6f),
+	mMinScale(0.5f),
+	mMaxScale(1.0f),
+	mScale(1.0f),
+	mNumUpdates(0)
+{
+}
+
+DynamicResolution::~DynamicResolution()
+{
+}
+
+void DynamicResolution::SetScaleRange(float minScale, float maxScale)
+{
+	mMinScale = std::clamp(minScale, 0.1f, 1.0f);
+	mMaxScale = std::clamp(maxScale, mMinScale, 1.0f);
+}
+
+void DynamicResolution::SetEnabled(bool enabled)
+{
+	mEnabled = enabled;
+	mScale = mMaxScale;
+}
+
+bool DynamicResolution::Update(float gpuMs)
+{
+	mNumUpdates++;
+	if (!mEnabled || gpuMs <= 0.0f)
+	{
+		return false;
+	}
+
+	float scale = mScale;
+	if (std::abs(gpuMs - mTargetMs) > mTargetMs * DEAD_BAND)
+	{
+		float desired = mScale * std::sqrt(mTargetMs / gpuMs);
+		scale = mScale + (desired - mScale) * DAMPING;
+	}
+	scale = std::clamp(scale, mMinScale, mMaxScale);
+
+	bool changed = std::abs(scale - mScale) >= MIN_SCALE_STEP || (scale != mScale && (scale == mMinScale || scale == mMaxScale));
+	if (changed)
+	{
+		mScale = scale;
+	}
+	mLog.push_back({ mNumUpdates, gpuMs, mScale });
+	return changed;
+}
+
+void DynamicResolution::ClearLog()
+{
+	mLog.clear();
+	mNumUpdates = 0;
+}
+
+bool DynamicResolution::WriteLog(const std::string& path) const
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		std::cout << "ERROR: Could not write the resolution log to " << path << std::endl;
+		return false;
+	}
+
+	file << "frame,gpu_ms,scale\n";
+	for (const Sample& sample : mLog)
+	{
+		file << sample.Frame << "," << sample.GpuMs << "," << sample.Scale << "\n";
+	}
+	return true;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+// Picks the fraction of the window the scene is rendered at from the measured GPU frame time.
+// The cost of the screen space passes grows with the pixel count, so the scale moves towards
+// scale * sqrt(target / measured), damped and with a dead band to keep it from oscillating.
+class DynamicResolution
+{
+public:
+	struct Sample
+	{
+		unsigned int Frame = 0;
+		float GpuMs = 0.0f;
+		float Scale = 1.0f;
+	};
+
+	DynamicResolution();
+	virtual ~DynamicResolution();
+
+	// the previous scale is kept, Update() moves it into the new range
+	void SetScaleRange(float minScale, float maxScale);
+	inline void SetTargetFrameMs(float targetMs) { mTargetMs = targetMs; }
+	void SetEnabled(bool enabled);
+
+	// fed once per new GPU frame time measurement, returns true when the scale changed
+	bool Update(float gpuMs);
+	void ClearLog();
+	bool WriteLog(const std::string& path) const;
+
+	inline bool IsEnabled() const { return mEnabled; }
+	inline float GetScale() const { return mEnabled ? mScale : 1.0f; }
+	inline float GetTargetFrameMs() const { return mTargetMs; }
+	inline float GetMinScale() const { return mMinScale; }
+	inline float GetMaxScale() const { return mMaxScale; }
+	inline const std::vector<Sample>& GetLog() const { return mLog; }
+
+private:
+	bool mEnabled;
+	float mTargetMs;
+	float mMinScale;
+	float mMaxScale;
+	float mScale;
+	unsigned int mNumUpdates;
+	std::vector<Sample> mLog;
+};
@@ -8,11 +8,14 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <random>
-#include <map>
+#include <chrono>
+#include <filesystem>
 #include "Shader.h"
 #include "Camera.h"
 #include "Time.h"
 #include "Utils.h"
+#include "ProgramBinaryCache.h"
+#include "ConeStepMap.h"
 
 Graphics::Engine* Graphics::Engine::mInstance(nullptr);
 
@@ -24,10 +27,32 @@ static Model FLOOR_MODEL;
 static Model NANOSUIT_MODEL;
 static Model SPONZA_MODEL;
 static Model BACKPACK_MODEL(true);
+static Model PARALLAX_MODEL;
+
+static constexpr float POINT_SHADOW_NEAR_PLANE = 0.1f;
+static constexpr float POINT_SHADOW_FAR_PLANE = 100.0f;
+
+static constexpr unsigned int NUM_ATLAS_LIGHTS = 64;
+static constexpr unsigned int ATLAS_LIGHT_GRID_SIZE = 8;
+static constexpr float ATLAS_LIGHT_RADIUS = 4.0f;
+static constexpr unsigned int SHADOW_ATLAS_SIZE = 4096;
+static constexpr unsigned int UNIFORM_BLOCK_MATRICES = 0;
+static constexpr unsigned int UNIFORM_BLOCK_ATLAS_LIGHTS = 1;
+static std::vector<glm::vec3> ATLAS_LIGHT_CENTERS;
+static std::vector<glm::vec3> ATLAS_LIGHT_COLORS;
+
+// std140 layout of AtlasLight in deferred.frag
+struct AtlasLightData
+{
+	glm::vec4 PositionRadius;
+	glm::vec4 Color;
+	glm::vec4 FaceRects[6];
+};
+
+static const char* POINT_SHADOW_MODE_NAMES[]{ "geometry shader", "per-face passes", "layered per-face" };
+static const char* SHADOW_FILTER_NAMES[]{ "PCF", "EVSM" };
 
 static glm::vec3 LIGHT_DIRECTION = glm::normalize(glm::vec3(1.0f, -0.5f, 1.0f));
-static glm::mat4 DIR_LIGHT_SPACE_MAT;
-static glm::vec3 DIR_LIGHT_POS;
 
 static constexpr int NUM_POINT_LIGHTS = 1;
 static glm::vec3 POINT_LIGHT_POSITIONS[NUM_POINT_LIGHTS]{
@@ -76,12 +101,52 @@ static std::vector<glm::vec3> BACKPACK_POSITIONS{
 		glm::vec3(10.0, -11.5, 10.0),
 };
 
+static constexpr unsigned int TRANSPARENT_PROP_COUNTS[]{ 0, 256, 1024, 4096 };
+static constexpr int PROP_GRID_SIZE = 20;
+static std::vector<glm::vec3> PROP_POSITIONS;
+
+// brick crates between the backpacks, for comparing the parallax mapping paths
+static constexpr const char* PARALLAX_HEIGHT_MAP = "resources/textures/bricks2_disp.jpg";
+static const std::vector<glm::vec3> PARALLAX_PROP_POSITIONS{
+	glm::vec3(-5.0f, -11.75f, 5.0f),
+	glm::vec3(5.0f, -11.75f, -5.0f),
+	glm::vec3(-8.0f, -11.75f, 0.0f),
+	glm::vec3(8.0f, -11.75f, 0.0f),
+};
+
+static constexpr unsigned int BLOOM_MAX_MIPS = 6;
+
+static constexpr const char* SHADER_CACHE_DIRECTORY = "shadercache";
+
+// indexed by the Mesh::ShaderFeature bits
+static const std::vector<std::string> MATERIAL_FEATURE_DEFINES{ "USE_SPECULAR_TEXTURE", "USE_NORMAL_TEXTURE", "USE_HEIGHT_TEXTURE" };
+
+// pixels between the samples of the luminance histogram along each axis
+static constexpr int EXPOSURE_SAMPLE_SPACING = 8;
+static constexpr float EXPOSURE_MIN_LOG_LUMINANCE = -8.0f;
+static constexpr float EXPOSURE_LOG_LUMINANCE_RANGE = 12.0f;
+
+// jitter positions repeat after this many frames
+static constexpr unsigned int NUM_TAA_JITTER_SAMPLES = 8;
+
+// the auto depth prepass turns on above the first overdraw and off below the second, so it does not flip every frame
+static constexpr float DEPTH_PREPASS_ENABLE_OVERDRAW = 1.5f;
+static constexpr float DEPTH_PREPASS_DISABLE_OVERDRAW = 1.25f;
+static constexpr unsigned int OVERDRAW_PROBE_INTERVAL = 120;
+
 static constexpr int NUM_SSAO_KERNEL_SAMPLES = 64;
 static constexpr int SSAO_NOISE_TEXTURE_SIZE = 4;
 static constexpr int NUM_SSAO_NOISE_SAMPLES = SSAO_NOISE_TEXTURE_SIZE * SSAO_NOISE_TEXTURE_SIZE;
 static glm::vec3 SSAO_KERNEL[NUM_SSAO_KERNEL_SAMPLES];
 static glm::vec3 SSAO_NOISE[NUM_SSAO_NOISE_SAMPLES];
 
+// IDs of the specialization constants, the same in every shader that declares them
+static constexpr GLuint SPECIALIZATION_MAX_POINT_LIGHTS = 0;
+static constexpr GLuint SPECIALIZATION_PCF_RADIUS = 1;
+static constexpr GLuint SPECIALIZATION_MAX_SAMPLES = 2;
+// the cascade PCF filter reads (2 * radius + 1)^2 taps
+static constexpr GLuint CASCADE_PCF_RADIUS = 2;
+
 Graphics::Engine::Engine(const int windowWidth, const int windowHeight, const char* title) :
 	mWindowWidth(windowWidth),
 	mWindowHeight(windowHeight),
@@ -89,10 +154,60 @@ Graphics::Engine::Engine(const int windowWidth, const int windowHeight, const ch
 	mTitle(title),
 	mWindow(nullptr),
 	mBaseShaderProgram(),
+	mShaderPermutations(true),
+	mConeStepMapping(true),
+	mSSAODownsample(1),
+	mTemporalSSAO(false),
+	mSSAOHistoryIndex(0),
+	mSSAOHistoryValid(false),
+	mSSAOFrameIndex(0),
+	mAOTechnique(KernelSSAOTechnique),
+	mSSAOKernelStride(1),
+	mGTAOSlices(2),
+	mGTAOSteps(4),
+	mRenderWidth(windowWidth),
+	mRenderHeight(windowHeight),
+	mRenderScale(1.0f),
+	mPrevRenderScale(1.0f),
+	mUpscaleSharpness(0.0f),
+	mTemporalAA(false),
+	mTAAHistoryIndex(0),
+	mTAAHistoryValid(false),
+	mTAAFrameIndex(0),
+	mTAAJitter(0.0f),
+	mPostAAMode(NoPostAA),
+	mAutoExposure(true),
+	mExposureGridWidth(0),
+	mExposureGridHeight(0),
+	mDepthPrepassMode(AutoDepthPrepass),
+	mDepthPrepassActive(false),
+	mAutoDepthPrepass(false),
+	mMeasuredOverdraw(0.0f),
+	mNumOverdrawResults(0),
+	mFramesSinceOverdrawProbe(OVERDRAW_PROBE_INTERVAL),
+	mShowOverdraw(false),
+	mShadowFilter(PCFShadowFilter),
+	mPointShadowMode(PerFacePointShadows),
+	mSupportsVertexLayer(false),
+	mPointShadowHardwareDepth(false),
+	mDrawAtlasLights(false),
+	mTransparencyMode(SortedBlending),
+	mNumFrameTimes(0),
+	mTransparencyCpuMs(0.0),
 	mCamera(glm::vec3(0.0f, -10.0f, 0.0f), 5.0f, 0.1f),
-	mLastMouseXPos(0.0f), mLastMouseYPos(0.0f), mIsFirstMouseMove(true),
+	mViewProjection(1.0f),
+	mPrevViewProjection(1.0f),
+	mJitteredViewProjection(1.0f),
 	mDefaultTexture{},
-	mUBOMatrices(0u)
+	mLastMouseXPos(0.0f), mLastMouseYPos(0.0f), mIsFirstMouseMove(true),
+	mDrawPropGrid(false),
+	mDrawParallaxProps(false),
+	mParallaxConeStepMap(false),
+	mDrawSponza(false),
+	mAnimateLights(true),
+	mUBOMatrices(0u),
+	mUBOAtlasLights(0u),
+	mNoiseTexture(0u)
 {
 	mInstance = this;
 }
@@ -105,9 +220,8 @@ Graphics::Engine::~Engine()
 	}
 
 	glDeleteBuffers(1, &mUBOMatrices);
+	glDeleteBuffers(1, &mUBOAtlasLights);
 
-	glDeleteFramebuffers(2, mPingPongFrameBuffers);
-	glDeleteTextures(2, mPingPongColorBuffers);
 	glDeleteTextures(1, &mNoiseTexture);
 
 	glfwTerminate();
@@ -128,20 +242,35 @@ static void OnMouseScrollCallback(GLFWwindow* window, double xoffset, double yof
 	Graphics::Engine::GetInstance()->OnMouseScroll(static_cast<float>(xoffset), static_cast<float>(yoffset));
 }
 
+// low discrepancy sequence in [0, 1), consecutive indices spread evenly over the interval
+static float Halton(unsigned int index, unsigned int base)
+{
+	float result = 0.0f;
+	float fraction = 1.0f;
+	while (index > 0)
+	{
+		fraction /= static_cast<float>(base);
+		result += fraction * static_cast<float>(index % base);
+		index /= base;
+	}
+	return result;
+}
+
 static float Lerp(float a, float b, float t)
 {
 	return a + t * (b - a);
 }
 
-bool Graphics::Engine::Init(bool vsync, bool windowedFullscreen)
+bool Graphics::Engine::Init(bool vsync, bool windowedFullscreen, bool headless)
 {
 	glfwInit();
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	glfwWindowHint(GLFW_VISIBLE, headless ? GLFW_FALSE : GLFW_TRUE);
 	//glfwWindowHint(GLFW_SAMPLES, 4);
 
-	if (windowedFullscreen)
+	if (windowedFullscreen && !headless)
 	{
 		GLFWmonitor* monitor = glfwGetPrimaryMonitor();
 		const GLFWvidmode* mode = glfwGetVideoMode(monitor);
@@ -190,121 +319,63 @@ bool Graphics::Engine::Init(bool vsync, bool windowedFullscreen)
 	glfwSetCursorPosCallback(mWindow, OnCursorPoseCallback);
 	glfwSetScrollCallback(mWindow, OnMouseScrollCallback);
 
-	glfwSetInputMode(mWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-	Shader baseVertexShader("src/Shaders/base.vert", Shader::Vertex);
-	Shader baseInstancedVertexShader("src/Shaders/baseInstanced.vert", Shader::Vertex);
-	Shader baseFragmentShader("src/Shaders/base.frag", Shader::Fragment);
-	Shader outlineFragmentShader("src/Shaders/outline.frag", Shader::Fragment);
-	Shader environmentMappingFragmentShader("src/Shaders/environmentMapping.frag", Shader::Fragment);
-	Shader cubemapVertexShader("src/Shaders/cubemap.vert", Shader::Vertex);
-	Shader cubemapFragmentShader("src/Shaders/cubemap.frag", Shader::Fragment);
-	Shader framebufferVertexShader("src/Shaders/framebufferScreen.vert", Shader::Vertex);
-	Shader framebufferFragmentShader("src/Shaders/framebufferScreen.frag", Shader::Fragment);
-	Shader explodeGeometryShader("src/Shaders/explode.geom", Shader::Geometry);
-	Shader normalsVisualizationVertexShader("src/Shaders/normalsVisualization.vert", Shader::Vertex);
-	Shader normalsVisualizationFragmentShader("src/Shaders/normalsVisualization.frag", Shader::Fragment);
-	Shader normalsVisualizationGeometryShader("src/Shaders/normalsVisualization.geom", Shader::Geometry);
-	Shader lightSourceVertexShader("src/Shaders/lightSource.vert", Shader::Vertex);
-	Shader lightSourceFragmentShader("src/Shaders/lightSource.frag", Shader::Fragment);
-
-	Shader dirShadowMappingVertexShader("src/Shaders/directionalShadowMapping.vert", Shader::Vertex);
-	Shader dirShadowMappingFragmentShader("src/Shaders/directionalShadowMapping.frag", Shader::Fragment);
-	Shader dirShadowMappingVertexInstancedShader("src/Shaders/directionalShadowMappingInstanced.vert", Shader::Vertex);
-
-	Shader pointShadowMappingVertShader("src/Shaders/pointShadowMapping.vert", Shader::Vertex);
-	Shader pointShadowMappingFragShader("src/Shaders/pointShadowMapping.frag", Shader::Fragment);
-	Shader pointShadowMappingGeomShader("src/Shaders/pointShadowMapping.geom", Shader::Geometry);
-	Shader pointShadowMappingVertInstancedShader("src/Shaders/pointShadowMappingInstanced.vert", Shader::Vertex);
-
-	Shader gaussianBlurVertShader("src/Shaders/gaussianBlur.vert", Shader::Vertex);
-	Shader gaussianBlurFragShader("src/Shaders/gaussianBlur.frag", Shader::Fragment);
-
-	Shader gBufferVertShader("src/Shaders/gBuffer.vert", Shader::Vertex);
-	Shader gBufferFragShader("src/Shaders/gBuffer.frag", Shader::Fragment);
-	Shader gBufferInstancedVertShader("src/Shaders/gBufferInstanced.vert", Shader::Vertex);
-
-	Shader deferredVertShader("src/Shaders/deferred.vert", Shader::Vertex);
-	Shader deferredFragShader("src/Shaders/deferred.frag", Shader::Fragment);
-
-	Shader ssaoVertShader("src/Shaders/ssao.vert", Shader::Vertex);
-	Shader ssaoFragShader("src/Shaders/ssao.frag", Shader::Fragment);
-	Shader ssaoBlurFragShader("src/Shaders/ssaoBlur.frag", Shader::Fragment);
+	if (!headless)
+	{
+		glfwSetInputMode(mWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	}
 
-	mBaseShaderProgram.Build({ baseVertexShader, baseFragmentShader });
-	//mBaseInstancedShaderProgram.Build({ baseInstancedVertexShader, baseFragmentShader });
-	mOutlineShaderProgram.Build({ baseVertexShader, outlineFragmentShader });
-	mEnvironmentMappingShaderProgram.Build({ baseVertexShader, environmentMappingFragmentShader });
-	mSkyboxShaderProgram.Build({ cubemapVertexShader, cubemapFragmentShader });
-	mPostProcessingShaderProgram.Build({ framebufferVertexShader, framebufferFragmentShader });
-	mNormalsVisualizationShaderProgram.Build({ normalsVisualizationVertexShader, normalsVisualizationFragmentShader, normalsVisualizationGeometryShader });
-	mLightSourceShaderProgram.Build({ lightSourceFragmentShader, lightSourceVertexShader });
-	mDirectionalShadowMappingShaderProgram.Build({ dirShadowMappingFragmentShader, dirShadowMappingVertexShader });
-	mPointShadowMappingShaderProgram.Build({ pointShadowMappingVertShader, pointShadowMappingFragShader, pointShadowMappingGeomShader });
-	mGaussianBlurShaderProgram.Build({ gaussianBlurVertShader, gaussianBlurFragShader });
-	mGBufferShaderProgram.Build({ gBufferVertShader, gBufferFragShader });
-	mDeferredShaderProgram.Build({ deferredVertShader,deferredFragShader });
-	mGBufferInstancedShaderProgram.Build({ gBufferInstancedVertShader, gBufferFragShader });
-	mDirectionalShadowMappingInstancedShaderProgram.Build({ dirShadowMappingFragmentShader, dirShadowMappingVertexInstancedShader });
-	mPointShadowMappingInstancedShaderProgram.Build({ pointShadowMappingVertInstancedShader, pointShadowMappingFragShader, pointShadowMappingGeomShader });
-	mSSAOShaderProgram.Build({ ssaoVertShader, ssaoFragShader });
-	mSSAOBlurShaderProgram.Build({ ssaoVertShader, ssaoBlurFragShader });
-
-	// Setting texture units
-	mPostProcessingShaderProgram.Bind();
-	mPostProcessingShaderProgram.SetUniform1i("uScreenTexture", 0);
-	mPostProcessingShaderProgram.SetUniform1i("uBloomTexture", 1);
-	mPostProcessingShaderProgram.Unbind();
-	mSkyboxShaderProgram.Bind();
-	mSkyboxShaderProgram.SetUniform1i("uSkybox", 0);
-	mSkyboxShaderProgram.Unbind();
-	mEnvironmentMappingShaderProgram.Bind();
-	mEnvironmentMappingShaderProgram.SetUniform1i("uSkybox", 0);
-	mEnvironmentMappingShaderProgram.Unbind();
-	mBaseShaderProgram.Bind();
-	mBaseShaderProgram.SetUniform1i("uShadowMap", 16);
-	mBaseShaderProgram.SetUniform1i("uShadowCubeMap", 17);
-	mBaseShaderProgram.Unbind();
-	mGaussianBlurShaderProgram.Bind();
-	mGaussianBlurShaderProgram.SetUniform1i("uImage", 0);
-	mGaussianBlurShaderProgram.Unbind();
-	mDeferredShaderProgram.Bind();
-	mDeferredShaderProgram.SetUniform1i("gPosition", 0);
-	mDeferredShaderProgram.SetUniform1i("gNormal", 1);
-	mDeferredShaderProgram.SetUniform1i("gAlbedoSpec", 2);
-	mDeferredShaderProgram.SetUniform1i("uDirLights[0].shadowMap", 3);
-	mDeferredShaderProgram.SetUniform1i("uPointLights[0].shadowCubeMap", 4);
-	mDeferredShaderProgram.SetUniform1i("uSSAOTexture", 5);
-	mDeferredShaderProgram.Unbind();
-	mSSAOShaderProgram.Bind();
-	mSSAOShaderProgram.SetUniform1i("gPosition", 0);
-	mSSAOShaderProgram.SetUniform1i("gNormal", 1);
-	mSSAOShaderProgram.SetUniform1i("uNoiseTexture", 2);
-	mSSAOShaderProgram.Unbind();
-	mSSAOBlurShaderProgram.Bind();
-	mSSAOBlurShaderProgram.SetUniform1i("uSSAOTexture", 0);
-	mSSAOBlurShaderProgram.Unbind();
+	// lets the driver spread the compiles and links BuildShaderPrograms() issues over its own threads
+	bool parallelCompile = GLHasExtension("GL_KHR_parallel_shader_compile") || GLHasExtension("GL_ARB_parallel_shader_compile");
+	if (parallelCompile)
+	{
+		typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+		MaxShaderCompilerThreadsProc maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+		if (!maxShaderCompilerThreads)
+		{
+			maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+		}
+		parallelCompile = maxShaderCompilerThreads != nullptr;
+		if (parallelCompile)
+		{
+			// 0xFFFFFFFF leaves the number of threads to the driver
+			maxShaderCompilerThreads(0xFFFFFFFF);
+		}
+	}
+	std::cout << "Parallel shader compile: " << (parallelCompile ? "enabled" : "not supported") << std::endl;
+	if (Shader::IsSpirvEnabled())
+	{
+		std::cout << "SPIR-V shaders: " << (GLAD_GL_VERSION_4_6 ? "enabled" : "needs OpenGL 4.6, compiling GLSL") << std::endl;
+	}
 
-	//Setting uniform block bindings
-	unsigned int uniformMatricesBlockBinding = 0;
-	mBaseShaderProgram.SetUniformBlockBinding("Matrices", uniformMatricesBlockBinding);
-	mBaseInstancedShaderProgram.SetUniformBlockBinding("Matrices", uniformMatricesBlockBinding);
-	mOutlineShaderProgram.SetUniformBlockBinding("Matrices", uniformMatricesBlockBinding);
-	mEnvironmentMappingShaderProgram.SetUniformBlockBinding("Matrices", uniformMatricesBlockBinding);
-	mLightSourceShaderProgram.SetUniformBlockBinding("Matrices", uniformMatricesBlockBinding);
-	mGBufferShaderProgram.SetUniformBlockBinding("Matrices", uniformMatricesBlockBinding);
-	mGBufferInstancedShaderProgram.SetUniformBlockBinding("Matrices", uniformMatricesBlockBinding);
-	mSSAOShaderProgram.SetUniformBlockBinding("Matrices", uniformMatricesBlockBinding);
+	ProgramBinaryCache::Init(SHADER_CACHE_DIRECTORY);
+	auto shaderStart = std::chrono::high_resolution_clock::now();
+	BuildShaderPrograms();
+	auto shaderEnd = std::chrono::high_resolution_clock::now();
+	std::cout << std::format(
+		"Shaders built in {:.1f} ms, {} of {} programs from the binary cache\n",
+		std::chrono::duration<double, std::milli>(shaderEnd - shaderStart).count(),
+		ProgramBinaryCache::GetNumHits(), ProgramBinaryCache::GetNumHits() + ProgramBinaryCache::GetNumMisses()
+	);
+	mSMAAFrameBuffer.CreateLookupTextures();
+	mAutoExposureTargets.Create();
 
 	size_t bufferSize = 2 * sizeof(glm::mat4);
 	glGenBuffers(1, &mUBOMatrices);
 	glBindBuffer(GL_UNIFORM_BUFFER, mUBOMatrices);
 	glBufferData(GL_UNIFORM_BUFFER, bufferSize, NULL, GL_STATIC_DRAW);
 	glBindBuffer(GL_UNIFORM_BUFFER, 0);
-	glBindBufferRange(GL_UNIFORM_BUFFER, uniformMatricesBlockBinding, mUBOMatrices, 0, bufferSize);
+	glBindBufferRange(GL_UNIFORM_BUFFER, UNIFORM_BLOCK_MATRICES, mUBOMatrices, 0, bufferSize);
+
+	size_t atlasLightsBufferSize = NUM_ATLAS_LIGHTS * sizeof(AtlasLightData);
+	glGenBuffers(1, &mUBOAtlasLights);
+	glBindBuffer(GL_UNIFORM_BUFFER, mUBOAtlasLights);
+	glBufferData(GL_UNIFORM_BUFFER, atlasLightsBufferSize, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferRange(GL_UNIFORM_BUFFER, UNIFORM_BLOCK_ATLAS_LIGHTS, mUBOAtlasLights, 0, atlasLightsBufferSize);
 
-	mDirectionalDepthMap.Build(2048, 2048, DepthMap::Directional);
-	mPointDepthMap.Build(2048, 2048, DepthMap::Point);
+	mCascadedShadowMap.Build(2048, 4);
+	mPointShadowCache.Build(2048, NUM_POINT_LIGHTS);
+	mShadowAtlas.Build(SHADOW_ATLAS_SIZE, 32, 512);
 
 	//constexpr unsigned int uniformsNum = 6;
 	//const char* uniformNames[uniformsNum]{
@@ -324,30 +395,27 @@ bool Graphics::Engine::Init(bool vsync, bool windowedFullscreen)
 	mLoadedTextures["resources/textures/default.png"] = defaultDiffuseTextureId;
 	mDefaultTexture = { defaultDiffuseTextureId, Core::Diffuse };
 
-	mDeferredLightingFrameBuffer.Create(mWindowWidth, mWindowHeight);
-	mGFrameBuffer.Create(mWindowWidth, mWindowHeight);
-	mSSAOFrameBuffer.Create(mWindowWidth, mWindowHeight);
-	mSSAOBlurFrameBuffer.Create(mWindowWidth, mWindowHeight);
+	CreateRenderTargets(mWindowWidth, mWindowHeight);
+	mTransparencyTimer.Create();
+	mDirectionalShadowTimer.Create();
+	mPointShadowTimer.Create();
+	mShadowAtlasTimer.Create();
+	mShadowPrefilterTimer.Create();
+	mLightingTimer.Create();
+	mSSAOTimer.Create();
+	mBloomTimer.Create();
+	mGeometryTimer.Create();
+	mDepthPrepassTimer.Create();
+	mPrepassSampleCounter.Create();
+	mGeometrySampleCounter.Create();
+	mTAATimer.Create();
+	mPostAATimer.Create();
+	mExposureTimer.Create();
+	mFrameTimer.Create(true);
 	mScreenQuad.Create();
 
-	// Pingpong fbos for blurring
-	glGenFramebuffers(2, mPingPongFrameBuffers);
-	glGenTextures(2, mPingPongColorBuffers);
-	for (int i = 0; i < 2; i++)
-	{
-		glBindFramebuffer(GL_FRAMEBUFFER, mPingPongFrameBuffers[i]);
-		glBindTexture(GL_TEXTURE_2D, mPingPongColorBuffers[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, mWindowWidth, mWindowHeight, 0, GL_RGBA, GL_FLOAT, NULL);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mPingPongColorBuffers[i], 0);
-
-		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-			std::cout << "Ping Pong Framebuffer is not complete!" << std::endl;
-	}
-
+	// the transparent props are spheres, T sorts their triangles back-to-front
+	SPHERE_MODEL.SetTriangleSortingEnabled(true);
 	SPHERE_MODEL.Load("resources/objects/sphere/sphere.obj");
 
 	CUBE_MODEL.SetDefaultTexture({ LoadTexture("resources/textures/container2.png", false, true), Core::Diffuse });
@@ -359,19 +427,44 @@ bool Graphics::Engine::Init(bool vsync, bool windowedFullscreen)
 	//FLOOR_MODEL.SetDefaultTexture({ LoadTexture("resources/textures/bricks2_disp.jpg", false, false), Core::Height });
 	FLOOR_MODEL.Load("resources/objects/cube/cube.obj");
 
-	//instance model matrices for backpack model
-	glm::mat4* instanceModelMatrices = new glm::mat4[BACKPACK_POSITIONS.size()];
-	for (unsigned int i = 0; i < BACKPACK_POSITIONS.size(); i++)
+	BACKPACK_MODEL.Load("resources/objects/backpack/backpack.obj");
+
+	// the cone step map is baked on the first run and reused after that
+	std::string coneStepMapPath = GetConeStepMapPath(PARALLAX_HEIGHT_MAP);
+	mParallaxConeStepMap = std::filesystem::exists(coneStepMapPath) || BakeConeStepMap(PARALLAX_HEIGHT_MAP, coneStepMapPath.c_str());
+	PARALLAX_MODEL.SetDefaultTexture({ LoadTexture("resources/textures/bricks2.jpg", false, true), Core::Diffuse });
+	PARALLAX_MODEL.SetDefaultTexture({ LoadTexture("resources/textures/bricks2_normal.jpg"), Core::Normal });
+	PARALLAX_MODEL.SetDefaultTexture({ LoadTexture(mParallaxConeStepMap ? coneStepMapPath.c_str() : PARALLAX_HEIGHT_MAP), Core::Height });
+	PARALLAX_MODEL.Load("resources/objects/cube/cube.obj");
+
+	// instance matrices are streamed by the draw queue at attribute location 4
+	mDrawQueue.Create(4);
+	mTransparentDrawQueue.Create(4);
+	mTransparentDrawQueue.Reserve(1024);
+	SetTransparencyMode(SortedBlending);
+	SetNumTransparentProps(TRANSPARENT_PROP_COUNTS[1]);
+
+	// grid of small crates used to stress the draw submission
+	PROP_POSITIONS.reserve(PROP_GRID_SIZE * PROP_GRID_SIZE);
+	for (int x = 0; x < PROP_GRID_SIZE; x++)
 	{
-		glm::mat4 model = glm::translate(glm::mat4(1.0f), BACKPACK_POSITIONS[i]);
-		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-		//model = glm::scale(model, glm::vec3(1.0f, 2.0f, 1.0f));
-		instanceModelMatrices[i] = model;
+		for (int z = 0; z < PROP_GRID_SIZE; z++)
+		{
+			PROP_POSITIONS.push_back(glm::vec3(-10.0f + x, -12.25f, -10.0f + z));
+		}
 	}
 
-	BACKPACK_MODEL.Load("resources/objects/backpack/backpack.obj");
-	BACKPACK_MODEL.SetupInstancedDrawing(instanceModelMatrices, BACKPACK_POSITIONS.size(), 4);
-	delete[] instanceModelMatrices;
+	// a grid of small shadowed lights over the floor for the shadow atlas
+	mAtlasLights.resize(NUM_ATLAS_LIGHTS);
+	for (unsigned int i = 0; i < NUM_ATLAS_LIGHTS; i++)
+	{
+		unsigned int x = i % ATLAS_LIGHT_GRID_SIZE;
+		unsigned int z = i / ATLAS_LIGHT_GRID_SIZE;
+		ATLAS_LIGHT_CENTERS.push_back(glm::vec3(-8.75f + 2.5f * x, -11.0f, -8.75f + 2.5f * z));
+		ATLAS_LIGHT_COLORS.push_back(glm::vec3(0.5f + 0.5f * (x % 2), 0.4f + 0.3f * (z % 3), 0.5f + 0.5f * ((x + z) % 2)) * 3.0f);
+		mAtlasLights[i].Position = ATLAS_LIGHT_CENTERS[i];
+		mAtlasLights[i].Radius = ATLAS_LIGHT_RADIUS;
+	}
 
 	//ssao kernel
 	std::uniform_real_distribution<float> randomFloats(0.0, 1.0); // random floats between [0.0, 1.0]
@@ -446,6 +539,273 @@ bool Graphics::Engine::Init(bool vsync, bool windowedFullscreen)
 	return true;
 }
 
+void Graphics::Engine::BuildShaderPrograms()
+{
+	Shader baseVertexShader("src/Shaders/base.vert", Shader::Vertex);
+	Shader baseInstancedVertexShader("src/Shaders/baseInstanced.vert", Shader::Vertex);
+	Shader baseFragmentShader("src/Shaders/base.frag", Shader::Fragment);
+	Shader outlineFragmentShader("src/Shaders/outline.frag", Shader::Fragment);
+	Shader environmentMappingFragmentShader("src/Shaders/environmentMapping.frag", Shader::Fragment);
+	Shader cubemapVertexShader("src/Shaders/cubemap.vert", Shader::Vertex);
+	Shader cubemapFragmentShader("src/Shaders/cubemap.frag", Shader::Fragment);
+	Shader framebufferVertexShader("src/Shaders/framebufferScreen.vert", Shader::Vertex);
+	Shader framebufferFragmentShader("src/Shaders/framebufferScreen.frag", Shader::Fragment);
+	Shader explodeGeometryShader("src/Shaders/explode.geom", Shader::Geometry);
+	Shader normalsVisualizationVertexShader("src/Shaders/normalsVisualization.vert", Shader::Vertex);
+	Shader normalsVisualizationFragmentShader("src/Shaders/normalsVisualization.frag", Shader::Fragment);
+	Shader normalsVisualizationGeometryShader("src/Shaders/normalsVisualization.geom", Shader::Geometry);
+	Shader lightSourceVertexShader("src/Shaders/lightSource.vert", Shader::Vertex);
+	Shader lightSourceFragmentShader("src/Shaders/lightSource.frag", Shader::Fragment);
+
+	Shader dirShadowMappingVertexShader("src/Shaders/directionalShadowMapping.vert", Shader::Vertex);
+	Shader dirShadowMappingFragmentShader("src/Shaders/directionalShadowMapping.frag", Shader::Fragment);
+	Shader dirShadowMappingVertexInstancedShader("src/Shaders/directionalShadowMappingInstanced.vert", Shader::Vertex);
+
+	Shader pointShadowMappingVertShader("src/Shaders/pointShadowMapping.vert", Shader::Vertex);
+	Shader pointShadowMappingFragShader("src/Shaders/pointShadowMapping.frag", Shader::Fragment);
+	Shader pointShadowMappingGeomShader("src/Shaders/pointShadowMapping.geom", Shader::Geometry);
+	Shader pointShadowMappingVertInstancedShader("src/Shaders/pointShadowMappingInstanced.vert", Shader::Vertex);
+	Shader pointShadowMappingHardwareFragShader("src/Shaders/pointShadowMappingHardware.frag", Shader::Fragment);
+	Shader pointShadowMappingFaceVertShader("src/Shaders/pointShadowMappingFace.vert", Shader::Vertex);
+	Shader pointShadowMappingFaceVertInstancedShader("src/Shaders/pointShadowMappingFaceInstanced.vert", Shader::Vertex);
+
+	Shader gaussianBlurVertShader("src/Shaders/gaussianBlur.vert", Shader::Vertex);
+	Shader gaussianBlurFragShader("src/Shaders/gaussianBlur.frag", Shader::Fragment);
+
+	Shader gBufferVertShader("src/Shaders/gBuffer.vert", Shader::Vertex);
+	Shader gBufferFragShader("src/Shaders/gBuffer.frag", Shader::Fragment, { "RUNTIME_MATERIAL_FEATURES" });
+	Shader gBufferInstancedVertShader("src/Shaders/gBufferInstanced.vert", Shader::Vertex);
+
+	Shader deferredVertShader("src/Shaders/deferred.vert", Shader::Vertex);
+	Shader deferredFragShader("src/Shaders/deferred.frag", Shader::Fragment, {}, {
+		{ SPECIALIZATION_MAX_POINT_LIGHTS, "MAX_POINT_LIGHTS", NUM_POINT_LIGHTS },
+		{ SPECIALIZATION_PCF_RADIUS, "PCF_RADIUS", CASCADE_PCF_RADIUS }
+	});
+
+	Shader ssaoVertShader("src/Shaders/ssao.vert", Shader::Vertex);
+	// the kernel loops of the SSAO shaders stop at the samples actually uploaded
+	std::vector<SpecializationConstant> ssaoConstants{ { SPECIALIZATION_MAX_SAMPLES, "MAX_SAMPLES", NUM_SSAO_KERNEL_SAMPLES } };
+	Shader ssaoFragShader("src/Shaders/ssao.frag", Shader::Fragment, {}, ssaoConstants);
+	Shader ssaoBlurFragShader("src/Shaders/ssaoBlur.frag", Shader::Fragment);
+	Shader ssaoDownsampleFragShader("src/Shaders/ssaoDownsample.frag", Shader::Fragment);
+	Shader ssaoDepthFragShader("src/Shaders/ssaoDepth.frag", Shader::Fragment, {}, ssaoConstants);
+	Shader ssaoUpsampleFragShader("src/Shaders/ssaoUpsample.frag", Shader::Fragment);
+	Shader ssaoTemporalFragShader("src/Shaders/ssaoTemporal.frag", Shader::Fragment, {}, ssaoConstants);
+	Shader ssaoDenoiseFragShader("src/Shaders/ssaoDenoise.frag", Shader::Fragment);
+	Shader gtaoFragShader("src/Shaders/gtao.frag", Shader::Fragment);
+
+	Shader transparentVertShader("src/Shaders/transparent.vert", Shader::Vertex);
+	Shader transparentInstancedVertShader("src/Shaders/transparentInstanced.vert", Shader::Vertex);
+	Shader transparentFragShader("src/Shaders/transparent.frag", Shader::Fragment);
+	Shader oitCompositeFragShader("src/Shaders/oitComposite.frag", Shader::Fragment);
+	Shader evsmMomentsFragShader("src/Shaders/evsmMoments.frag", Shader::Fragment);
+	Shader bloomDownsampleFragShader("src/Shaders/bloomDownsample.frag", Shader::Fragment);
+	Shader bloomUpsampleFragShader("src/Shaders/bloomUpsample.frag", Shader::Fragment);
+	Shader taaResolveFragShader("src/Shaders/taaResolve.frag", Shader::Fragment);
+	Shader fxaaFragShader("src/Shaders/fxaa.frag", Shader::Fragment);
+	Shader smaaEdgesFragShader("src/Shaders/smaaEdges.frag", Shader::Fragment);
+	Shader smaaWeightsFragShader("src/Shaders/smaaWeights.frag", Shader::Fragment);
+	Shader smaaBlendFragShader("src/Shaders/smaaBlend.frag", Shader::Fragment);
+	Shader luminanceHistogramVertShader("src/Shaders/luminanceHistogram.vert", Shader::Vertex);
+	Shader luminanceHistogramFragShader("src/Shaders/luminanceHistogram.frag", Shader::Fragment);
+	Shader exposureAdaptFragShader("src/Shaders/exposureAdapt.frag", Shader::Fragment);
+	Shader overdrawFragShader("src/Shaders/overdraw.frag", Shader::Fragment);
+	Shader overdrawHeatmapFragShader("src/Shaders/overdrawHeatmap.frag", Shader::Fragment);
+
+	mBaseShaderProgram.BeginBuild({ baseVertexShader, baseFragmentShader });
+	//mBaseInstancedShaderProgram.Build({ baseInstancedVertexShader, baseFragmentShader });
+	// debug and effect programs most runs never use are only built when they are first bound
+	auto setupMatricesBinding = [](ShaderProgram& program) {
+		program.SetUniformBlockBinding("Matrices", UNIFORM_BLOCK_MATRICES);
+	};
+	mOutlineShaderProgram.BuildOnFirstUse({ baseVertexShader, outlineFragmentShader }, setupMatricesBinding);
+	mEnvironmentMappingShaderProgram.BuildOnFirstUse({ baseVertexShader, environmentMappingFragmentShader }, [](ShaderProgram& program) {
+		program.SetUniformBlockBinding("Matrices", UNIFORM_BLOCK_MATRICES);
+		program.Bind();
+		program.SetUniform1i("uSkybox", 0);
+		program.Unbind();
+	});
+	mSkyboxShaderProgram.BeginBuild({ cubemapVertexShader, cubemapFragmentShader });
+	mPostProcessingShaderProgram.BeginBuild({ framebufferVertexShader, framebufferFragmentShader });
+	mNormalsVisualizationShaderProgram.BuildOnFirstUse({ normalsVisualizationVertexShader, normalsVisualizationFragmentShader, normalsVisualizationGeometryShader });
+	mOverdrawShaderProgram.BuildOnFirstUse({ dirShadowMappingVertexShader, overdrawFragShader });
+	mOverdrawInstancedShaderProgram.BuildOnFirstUse({ dirShadowMappingVertexInstancedShader, overdrawFragShader });
+	mOverdrawHeatmapShaderProgram.BuildOnFirstUse({ framebufferVertexShader, overdrawHeatmapFragShader }, [](ShaderProgram& program) {
+		program.Bind();
+		program.SetUniform1i("uOverdraw", 0);
+		program.Unbind();
+	});
+	mLightSourceShaderProgram.BeginBuild({ lightSourceFragmentShader, lightSourceVertexShader });
+	mDirectionalShadowMappingShaderProgram.BeginBuild({ dirShadowMappingFragmentShader, dirShadowMappingVertexShader });
+	mPointShadowMappingShaderProgram.BeginBuild({ pointShadowMappingVertShader, pointShadowMappingFragShader, pointShadowMappingGeomShader });
+	mGaussianBlurShaderProgram.BeginBuild({ gaussianBlurVertShader, gaussianBlurFragShader });
+	mGBufferUberShaderProgram.BeginBuild({ gBufferVertShader, gBufferFragShader });
+	mDeferredShaderProgram.BeginBuild({ deferredVertShader,deferredFragShader });
+	mGBufferUberInstancedShaderProgram.BeginBuild({ gBufferInstancedVertShader, gBufferFragShader });
+	mDirectionalShadowMappingInstancedShaderProgram.BeginBuild({ dirShadowMappingFragmentShader, dirShadowMappingVertexInstancedShader });
+	mPointShadowMappingInstancedShaderProgram.BeginBuild({ pointShadowMappingVertInstancedShader, pointShadowMappingFragShader, pointShadowMappingGeomShader });
+	mPointShadowFaceShaderProgram.BeginBuild({ pointShadowMappingFaceVertShader, pointShadowMappingFragShader });
+	mPointShadowFaceInstancedShaderProgram.BeginBuild({ pointShadowMappingFaceVertInstancedShader, pointShadowMappingFragShader });
+	mPointShadowMappingHardwareShaderProgram.BeginBuild({ pointShadowMappingVertShader, pointShadowMappingHardwareFragShader, pointShadowMappingGeomShader });
+	mPointShadowMappingHardwareInstancedShaderProgram.BeginBuild({ pointShadowMappingVertInstancedShader, pointShadowMappingHardwareFragShader, pointShadowMappingGeomShader });
+	mPointShadowFaceHardwareShaderProgram.BeginBuild({ pointShadowMappingFaceVertShader, pointShadowMappingHardwareFragShader });
+	mPointShadowFaceHardwareInstancedShaderProgram.BeginBuild({ pointShadowMappingFaceVertInstancedShader, pointShadowMappingHardwareFragShader });
+
+	// writing gl_Layer from the vertex stage needs an extension on GL 3.3
+	mSupportsVertexLayer = GLHasExtension("GL_ARB_shader_viewport_layer_array") || GLHasExtension("GL_AMD_vertex_shader_layer");
+	if (mSupportsVertexLayer)
+	{
+		Shader pointShadowMappingLayeredVertShader("src/Shaders/pointShadowMappingLayered.vert", Shader::Vertex);
+		Shader pointShadowMappingLayeredVertInstancedShader("src/Shaders/pointShadowMappingLayeredInstanced.vert", Shader::Vertex);
+		mPointShadowLayeredShaderProgram.BeginBuild({ pointShadowMappingLayeredVertShader, pointShadowMappingFragShader });
+		mPointShadowLayeredInstancedShaderProgram.BeginBuild({ pointShadowMappingLayeredVertInstancedShader, pointShadowMappingFragShader });
+		mPointShadowLayeredHardwareShaderProgram.BeginBuild({ pointShadowMappingLayeredVertShader, pointShadowMappingHardwareFragShader });
+		mPointShadowLayeredHardwareInstancedShaderProgram.BeginBuild({ pointShadowMappingLayeredVertInstancedShader, pointShadowMappingHardwareFragShader });
+		mPointShadowMode = LayeredPointShadows;
+	}
+	std::cout << "Vertex stage gl_Layer: " << (mSupportsVertexLayer ? "supported" : "not supported, point shadows render face by face") << std::endl;
+	mSSAOShaderProgram.BeginBuild({ ssaoVertShader, ssaoFragShader });
+	mSSAOBlurShaderProgram.BeginBuild({ ssaoVertShader, ssaoBlurFragShader });
+	mSSAODownsampleShaderProgram.BeginBuild({ ssaoVertShader, ssaoDownsampleFragShader });
+	mSSAODepthShaderProgram.BeginBuild({ ssaoVertShader, ssaoDepthFragShader });
+	mSSAOUpsampleShaderProgram.BeginBuild({ ssaoVertShader, ssaoUpsampleFragShader });
+	mSSAOTemporalShaderProgram.BeginBuild({ ssaoVertShader, ssaoTemporalFragShader });
+	mSSAODenoiseShaderProgram.BeginBuild({ ssaoVertShader, ssaoDenoiseFragShader });
+	mGTAOShaderProgram.BeginBuild({ ssaoVertShader, gtaoFragShader });
+	mTransparentShaderProgram.BeginBuild({ transparentVertShader, transparentFragShader });
+	mTransparentInstancedShaderProgram.BeginBuild({ transparentInstancedVertShader, transparentFragShader });
+	mOITCompositeShaderProgram.BeginBuild({ framebufferVertexShader, oitCompositeFragShader });
+	mEVSMMomentsShaderProgram.BeginBuild({ framebufferVertexShader, evsmMomentsFragShader });
+	mBloomDownsampleShaderProgram.BeginBuild({ framebufferVertexShader, bloomDownsampleFragShader });
+	mBloomUpsampleShaderProgram.BeginBuild({ framebufferVertexShader, bloomUpsampleFragShader });
+	mTAAShaderProgram.BeginBuild({ framebufferVertexShader, taaResolveFragShader });
+	mFXAAShaderProgram.BeginBuild({ framebufferVertexShader, fxaaFragShader });
+	mSMAAEdgesShaderProgram.BeginBuild({ framebufferVertexShader, smaaEdgesFragShader });
+	mSMAAWeightsShaderProgram.BeginBuild({ framebufferVertexShader, smaaWeightsFragShader });
+	mSMAABlendShaderProgram.BeginBuild({ framebufferVertexShader, smaaBlendFragShader });
+	mLuminanceHistogramShaderProgram.BeginBuild({ luminanceHistogramVertShader, luminanceHistogramFragShader });
+	mExposureAdaptShaderProgram.BeginBuild({ framebufferVertexShader, exposureAdaptFragShader });
+
+	// Setting texture units, the first uniform set on a program waits for its link
+	mPostProcessingShaderProgram.Bind();
+	mPostProcessingShaderProgram.SetUniform1i("uScreenTexture", 0);
+	mPostProcessingShaderProgram.SetUniform1i("uBloomTexture", 1);
+	mPostProcessingShaderProgram.SetUniform1i("uAverageLuminance", 2);
+	mPostProcessingShaderProgram.Unbind();
+	mTAAShaderProgram.Bind();
+	mTAAShaderProgram.SetUniform1i("uCurrent", 0);
+	mTAAShaderProgram.SetUniform1i("uVelocity", 1);
+	mTAAShaderProgram.SetUniform1i("uHistory", 2);
+	mTAAShaderProgram.Unbind();
+	mSMAAWeightsShaderProgram.Bind();
+	mSMAAWeightsShaderProgram.SetUniform1i("uEdgesTexture", 0);
+	mSMAAWeightsShaderProgram.SetUniform1i("uAreaTexture", 1);
+	mSMAAWeightsShaderProgram.SetUniform1i("uSearchTexture", 2);
+	mSMAAWeightsShaderProgram.Unbind();
+	mSMAABlendShaderProgram.Bind();
+	mSMAABlendShaderProgram.SetUniform1i("uScreenTexture", 0);
+	mSMAABlendShaderProgram.SetUniform1i("uBlendWeightsTexture", 1);
+	mSMAABlendShaderProgram.Unbind();
+	mLuminanceHistogramShaderProgram.Bind();
+	mLuminanceHistogramShaderProgram.SetUniform1i("uSceneTexture", 0);
+	mLuminanceHistogramShaderProgram.SetUniform1i("uNumBins", AutoExposure::HISTOGRAM_BINS);
+	mLuminanceHistogramShaderProgram.SetUniform1f("uMinLogLuminance", EXPOSURE_MIN_LOG_LUMINANCE);
+	mLuminanceHistogramShaderProgram.SetUniform1f("uLogLuminanceRange", EXPOSURE_LOG_LUMINANCE_RANGE);
+	mLuminanceHistogramShaderProgram.Unbind();
+	mExposureAdaptShaderProgram.Bind();
+	mExposureAdaptShaderProgram.SetUniform1i("uHistogram", 0);
+	mExposureAdaptShaderProgram.SetUniform1i("uPrevLuminance", 1);
+	mExposureAdaptShaderProgram.SetUniform1f("uMinLogLuminance", EXPOSURE_MIN_LOG_LUMINANCE);
+	mExposureAdaptShaderProgram.SetUniform1f("uLogLuminanceRange", EXPOSURE_LOG_LUMINANCE_RANGE);
+	mExposureAdaptShaderProgram.Unbind();
+	mSkyboxShaderProgram.Bind();
+	mSkyboxShaderProgram.SetUniform1i("uSkybox", 0);
+	mSkyboxShaderProgram.Unbind();
+	mBaseShaderProgram.Bind();
+	mBaseShaderProgram.SetUniform1i("uShadowMap", 16);
+	mBaseShaderProgram.SetUniform1i("uShadowCubeMap", 17);
+	mBaseShaderProgram.Unbind();
+	mGaussianBlurShaderProgram.Bind();
+	mGaussianBlurShaderProgram.SetUniform1i("uImage", 0);
+	mGaussianBlurShaderProgram.Unbind();
+	mDeferredShaderProgram.Bind();
+	mDeferredShaderProgram.SetUniform1i("gPosition", 0);
+	mDeferredShaderProgram.SetUniform1i("gNormal", 1);
+	mDeferredShaderProgram.SetUniform1i("gAlbedoSpec", 2);
+	mDeferredShaderProgram.SetUniform1i("uCascadeShadowMap", 3);
+	mDeferredShaderProgram.SetUniform1i("uPointLights[0].shadowCubeMap", 4);
+	mDeferredShaderProgram.SetUniform1i("uSSAOTexture", 5);
+	mDeferredShaderProgram.SetUniform1i("uShadowAtlas", 6);
+	mDeferredShaderProgram.SetUniform1i("uCascadeMoments", 7);
+	mDeferredShaderProgram.Unbind();
+	mSSAOShaderProgram.Bind();
+	mSSAOShaderProgram.SetUniform1i("gPosition", 0);
+	mSSAOShaderProgram.SetUniform1i("gNormal", 1);
+	mSSAOShaderProgram.SetUniform1i("uNoiseTexture", 2);
+	mSSAOShaderProgram.Unbind();
+	mSSAOBlurShaderProgram.Bind();
+	mSSAOBlurShaderProgram.SetUniform1i("uSSAOTexture", 0);
+	mSSAOBlurShaderProgram.Unbind();
+	mSSAODownsampleShaderProgram.Bind();
+	mSSAODownsampleShaderProgram.SetUniform1i("gPosition", 0);
+	mSSAODownsampleShaderProgram.SetUniform1i("gNormal", 1);
+	mSSAODownsampleShaderProgram.Unbind();
+	mSSAODepthShaderProgram.Bind();
+	mSSAODepthShaderProgram.SetUniform1i("uDepthNormal", 0);
+	mSSAODepthShaderProgram.SetUniform1i("uNoiseTexture", 2);
+	mSSAODepthShaderProgram.Unbind();
+	mSSAOUpsampleShaderProgram.Bind();
+	mSSAOUpsampleShaderProgram.SetUniform1i("gPosition", 0);
+	mSSAOUpsampleShaderProgram.SetUniform1i("gNormal", 1);
+	mSSAOUpsampleShaderProgram.SetUniform1i("uSSAOTexture", 2);
+	mSSAOUpsampleShaderProgram.SetUniform1i("uDepthNormal", 3);
+	mSSAOUpsampleShaderProgram.Unbind();
+	mSSAOTemporalShaderProgram.Bind();
+	mSSAOTemporalShaderProgram.SetUniform1i("gPosition", 0);
+	mSSAOTemporalShaderProgram.SetUniform1i("gNormal", 1);
+	mSSAOTemporalShaderProgram.SetUniform1i("uNoiseTexture", 2);
+	mSSAOTemporalShaderProgram.SetUniform1i("uHistory", 4);
+	mSSAOTemporalShaderProgram.Unbind();
+	mSSAODenoiseShaderProgram.Bind();
+	mSSAODenoiseShaderProgram.SetUniform1i("uSSAOTexture", 0);
+	mSSAODenoiseShaderProgram.SetUniform1i("uDepthNormal", 3);
+	mSSAODenoiseShaderProgram.Unbind();
+	mGTAOShaderProgram.Bind();
+	mGTAOShaderProgram.SetUniform1i("uDepthNormal", 0);
+	mGTAOShaderProgram.SetUniform1i("uNoiseTexture", 2);
+	mGTAOShaderProgram.Unbind();
+	mOITCompositeShaderProgram.Bind();
+	mOITCompositeShaderProgram.SetUniform1i("uAccumulation", 0);
+	mOITCompositeShaderProgram.SetUniform1i("uWeight", 1);
+	mOITCompositeShaderProgram.Unbind();
+	mEVSMMomentsShaderProgram.Bind();
+	mEVSMMomentsShaderProgram.SetUniform1i("uDepthMap", 0);
+	mEVSMMomentsShaderProgram.Unbind();
+	mBloomDownsampleShaderProgram.Bind();
+	mBloomDownsampleShaderProgram.SetUniform1i("uSource", 0);
+	mBloomDownsampleShaderProgram.Unbind();
+	mBloomUpsampleShaderProgram.Bind();
+	mBloomUpsampleShaderProgram.SetUniform1i("uSource", 0);
+	mBloomUpsampleShaderProgram.Unbind();
+
+	//Setting uniform block bindings
+	mBaseShaderProgram.SetUniformBlockBinding("Matrices", UNIFORM_BLOCK_MATRICES);
+	mBaseInstancedShaderProgram.SetUniformBlockBinding("Matrices", UNIFORM_BLOCK_MATRICES);
+	mLightSourceShaderProgram.SetUniformBlockBinding("Matrices", UNIFORM_BLOCK_MATRICES);
+	// the G-buffer programs take their view-projection as a uniform, see uJitteredViewProjection
+	mGBufferPermutations.Create("src/Shaders/gBuffer.vert", "src/Shaders/gBuffer.frag", MATERIAL_FEATURE_DEFINES);
+	mGBufferInstancedPermutations.Create("src/Shaders/gBufferInstanced.vert", "src/Shaders/gBuffer.frag", MATERIAL_FEATURE_DEFINES);
+	mSSAOShaderProgram.SetUniformBlockBinding("Matrices", UNIFORM_BLOCK_MATRICES);
+	mSSAODownsampleShaderProgram.SetUniformBlockBinding("Matrices", UNIFORM_BLOCK_MATRICES);
+	mSSAODepthShaderProgram.SetUniformBlockBinding("Matrices", UNIFORM_BLOCK_MATRICES);
+	mSSAOUpsampleShaderProgram.SetUniformBlockBinding("Matrices", UNIFORM_BLOCK_MATRICES);
+	mSSAOTemporalShaderProgram.SetUniformBlockBinding("Matrices", UNIFORM_BLOCK_MATRICES);
+	mGTAOShaderProgram.SetUniformBlockBinding("Matrices", UNIFORM_BLOCK_MATRICES);
+	mTransparentShaderProgram.SetUniformBlockBinding("Matrices", UNIFORM_BLOCK_MATRICES);
+	mTransparentInstancedShaderProgram.SetUniformBlockBinding("Matrices", UNIFORM_BLOCK_MATRICES);
+	mDeferredShaderProgram.SetUniformBlockBinding("AtlasLights", UNIFORM_BLOCK_ATLAS_LIGHTS);
+}
+
 void Graphics::Engine::Run()
 {
 	while (!glfwWindowShouldClose(mWindow))
@@ -456,12 +816,38 @@ void Graphics::Engine::Run()
 		OnRender();
 		glfwPollEvents();
 	}
+
+	if (!mResolutionLogPath.empty())
+	{
+		mDynamicResolution.WriteLog(mResolutionLogPath);
+	}
 }
 
 void Graphics::Engine::Update()
 {
-	POINT_LIGHT_POSITIONS[0].x = sin(Time::LastFrame) * 4.0f;
-	POINT_LIGHT_POSITIONS[0].z = cos(Time::LastFrame) * 4.0f;
+	if (mAnimateLights)
+	{
+		POINT_LIGHT_POSITIONS[0].x = sin(Time::LastFrame) * 4.0f;
+		POINT_LIGHT_POSITIONS[0].z = cos(Time::LastFrame) * 4.0f;
+
+		// every eighth atlas light circles around its place, the others stay put
+		for (unsigned int i = 0; i < mAtlasLights.size(); i += 8)
+		{
+			float phase = Time::LastFrame + static_cast<float>(i);
+			mAtlasLights[i].Position = ATLAS_LIGHT_CENTERS[i] + glm::vec3(sin(phase), 0.0f, cos(phase));
+		}
+	}
+}
+
+void Graphics::Engine::RenderFrames(unsigned int numFrames)
+{
+	for (unsigned int i = 0; i < numFrames; i++)
+	{
+		UpdateTimer();
+		Update();
+		OnRender();
+		glfwPollEvents();
+	}
 }
 
 void Graphics::Engine::UpdateTimer()
@@ -472,12 +858,122 @@ void Graphics::Engine::UpdateTimer()
 }
 
 void Graphics::Engine::OnResize(GLFWwindow* window, int width, int height)
+{
+	// a minimized window reports a zero sized framebuffer
+	if (width <= 0 || height <= 0)
+	{
+		return;
+	}
+
+	CreateRenderTargets(width, height);
+	glViewport(0, 0, width, height);
+}
+
+void Graphics::Engine::CreateRenderTargets(int width, int height)
 {
 	mWindowWidth = width;
 	mWindowHeight = height;
 	mAspectRatio = static_cast<float>(width) / static_cast<float>(height);
 
-	glViewport(0, 0, width, height);
+	// every Create and Build releases the targets it made before, so resizing goes through here as well
+	mDeferredLightingFrameBuffer.Create(width, height);
+	mGFrameBuffer.Create(width, height);
+	mSSAOFrameBuffer.Create(width, height);
+	mSSAOBlurFrameBuffer.Create(width, height);
+	mOITFrameBuffer.Create(width, height, mDeferredLightingFrameBuffer.GetDepthRenderBufferId());
+	SetSSAODownsample(mSSAODownsample);
+	mBloomMipChain.Build(width, height, BLOOM_MAX_MIPS);
+	for (FrameBuffer& history : mTAAHistoryFrameBuffers)
+	{
+		history.Create(width, height);
+	}
+	mPostAAFrameBuffer.Create(width, height);
+	mSMAAFrameBuffer.Create(width, height);
+	mOverdrawFrameBuffer.Create(width, height);
+	mExposureGridWidth = (width + EXPOSURE_SAMPLE_SPACING - 1) / EXPOSURE_SAMPLE_SPACING;
+	mExposureGridHeight = (height + EXPOSURE_SAMPLE_SPACING - 1) / EXPOSURE_SAMPLE_SPACING;
+	mTAAHistoryValid = false;
+}
+
+void Graphics::Engine::SetSSAODownsample(unsigned int downsample)
+{
+	mSSAODownsample = downsample;
+
+	// rounded up so the reduced targets always cover the whole screen
+	int width = (mWindowWidth + downsample - 1) / downsample;
+	int height = (mWindowHeight + downsample - 1) / downsample;
+	// needed at full resolution too, horizon based AO always reads it
+	mSSAODepthNormalFrameBuffer.Create(width, height, SSAOFrameBuffer::DepthNormal);
+	if (downsample > 1)
+	{
+		mSSAOLowResFrameBuffer.Create(width, height);
+		mSSAOLowResBlurFrameBuffer.Create(width, height);
+	}
+
+	// the history lives at the resolution the kernel runs at
+	for (SSAOFrameBuffer& history : mSSAOHistoryFrameBuffers)
+	{
+		history.Create(width, height, SSAOFrameBuffer::History);
+	}
+	mSSAOHistoryValid = false;
+}
+
+void Graphics::Engine::SetDynamicResolution(bool enabled, float targetFrameMs, float minScale, float maxScale)
+{
+	mDynamicResolution.SetTargetFrameMs(targetFrameMs);
+	mDynamicResolution.SetScaleRange(minScale, maxScale);
+	mDynamicResolution.SetEnabled(enabled);
+}
+
+void Graphics::Engine::UpdateRenderScale()
+{
+	float scale = mDynamicResolution.GetScale();
+	mRenderWidth = std::max(static_cast<int>(std::lround(mWindowWidth * scale)), 1);
+	mRenderHeight = std::max(static_cast<int>(std::lround(mWindowHeight * scale)), 1);
+
+	mPrevRenderScale = mRenderScale;
+	mRenderScale = glm::vec2(
+		static_cast<float>(mRenderWidth) / static_cast<float>(mWindowWidth),
+		static_cast<float>(mRenderHeight) / static_cast<float>(mWindowHeight)
+	);
+	if (mRenderScale == mPrevRenderScale)
+	{
+		return;
+	}
+
+	// the full screen passes that read the scene scale their texture coordinates into the rendered part
+	for (ShaderProgram* shader : {
+		&mSSAOShaderProgram, &mSSAOBlurShaderProgram, &mSSAODownsampleShaderProgram, &mSSAODepthShaderProgram,
+		&mSSAOUpsampleShaderProgram, &mSSAOTemporalShaderProgram, &mSSAODenoiseShaderProgram, &mGTAOShaderProgram,
+		&mDeferredShaderProgram, &mOITCompositeShaderProgram })
+	{
+		shader->Bind();
+		shader->SetUniformVec2("uRenderScale", glm::value_ptr(mRenderScale));
+	}
+}
+
+void Graphics::Engine::SetTemporalAA(bool enabled)
+{
+	mTemporalAA = enabled;
+	mTAAHistoryValid = false;
+}
+
+bool Graphics::Engine::SetDrawSponza(bool draw)
+{
+	// the model is large and only used by some benchmarks, so it is loaded on first use
+	if (draw && SPONZA_MODEL.GetMeshes().empty())
+	{
+		SPONZA_MODEL.Load("resources/objects/sponza/sponza.obj");
+	}
+
+	mDrawSponza = draw && !SPONZA_MODEL.GetMeshes().empty();
+	return mDrawSponza;
+}
+
+void Graphics::Engine::SetTemporalSSAO(bool enabled)
+{
+	mTemporalSSAO = enabled;
+	mSSAOHistoryValid = false;
 }
 
 void Graphics::Engine::OnInput()
@@ -511,29 +1007,193 @@ void Graphics::Engine::OnInput()
 	{
 		mCamera.Move(Camera::Movement::Up);
 	}
-}
-
-void Graphics::Engine::OnRender()
-{
-	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
-	//Render to depth map
-	ShadowPass();
-
-	glViewport(0, 0, mWindowWidth, mWindowHeight);
-
-	// Geometry pass
-	mGFrameBuffer.Bind();
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glm::mat4 viewMatrix = mCamera.GetViewMatrix();
-	glm::mat4 projectionMatrix = mCamera.GetProjectionMatrix(mAspectRatio);
-	SetupScene(viewMatrix, projectionMatrix);
-	DrawScene(mGBufferShaderProgram, &mGBufferInstancedShaderProgram);
+	if (IsKeyPressed(GLFW_KEY_B))
+	{
+		mDrawQueue.SetBatchingEnabled(!mDrawQueue.IsBatchingEnabled());
+		std::cout << "Draw batching: " << (mDrawQueue.IsBatchingEnabled() ? "on" : "off") << std::endl;
+	}
+	if (IsKeyPressed(GLFW_KEY_K))
+	{
+		mDrawQueue.SetSortingEnabled(!mDrawQueue.IsSortingEnabled());
+		std::cout << "Draw sorting: " << (mDrawQueue.IsSortingEnabled() ? "on" : "off") << std::endl;
+	}
+	if (IsKeyPressed(GLFW_KEY_T))
+	{
+		mTransparentDrawQueue.SetTriangleSortingEnabled(!mTransparentDrawQueue.IsTriangleSortingEnabled());
+		std::cout << "Transparent triangle sorting: " << (mTransparentDrawQueue.IsTriangleSortingEnabled() ? "on" : "off") << std::endl;
+	}
+	if (IsKeyPressed(GLFW_KEY_P))
+	{
+		mDrawPropGrid = !mDrawPropGrid;
+	}
+	if (IsKeyPressed(GLFW_KEY_L))
+	{
+		mAnimateLights = !mAnimateLights;
+	}
+	if (IsKeyPressed(GLFW_KEY_G))
+	{
+		SetPointShadowMode(mPointShadowMode == GeometryShaderPointShadows ?
+			(mSupportsVertexLayer ? LayeredPointShadows : PerFacePointShadows) : GeometryShaderPointShadows);
+	}
+	if (IsKeyPressed(GLFW_KEY_H))
+	{
+		// linear distance, then hardware depth, then 16-bit hardware depth
+		unsigned int resolution = mPointShadowCache.GetResolution();
+		if (!mPointShadowHardwareDepth)
+		{
+			SetPointShadowDepth(true, DepthMap::Depth32, resolution);
+		}
+		else if (mPointShadowCache.GetFormat() == DepthMap::Depth32)
+		{
+			SetPointShadowDepth(true, DepthMap::Depth16, resolution);
+		}
+		else
+		{
+			SetPointShadowDepth(false, DepthMap::Depth32, resolution);
+		}
+	}
+	if (IsKeyPressed(GLFW_KEY_C))
+	{
+		mPointShadowCache.SetCachingEnabled(!mPointShadowCache.IsCachingEnabled());
+		std::cout << "Point shadow caching: " << (mPointShadowCache.IsCachingEnabled() ? "on" : "off") << std::endl;
+	}
+	if (IsKeyPressed(GLFW_KEY_M))
+	{
+		mDrawAtlasLights = !mDrawAtlasLights;
+		std::cout << "Shadow atlas lights: " << (mDrawAtlasLights ? NUM_ATLAS_LIGHTS : 0) << std::endl;
+	}
+	if (IsKeyPressed(GLFW_KEY_F))
+	{
+		SetShadowFilter(mShadowFilter == PCFShadowFilter ? EVSMShadowFilter : PCFShadowFilter);
+	}
+	if (IsKeyPressed(GLFW_KEY_R))
+	{
+		SetSSAODownsample(mSSAODownsample >= 4 ? 1 : mSSAODownsample * 2);
+		std::cout << "SSAO resolution: 1/" << mSSAODownsample << std::endl;
+	}
+	if (IsKeyPressed(GLFW_KEY_U))
+	{
+		SetTemporalSSAO(!mTemporalSSAO);
+		std::cout << "Temporal SSAO: " << (mTemporalSSAO ? "on" : "off") << std::endl;
+	}
+	if (IsKeyPressed(GLFW_KEY_J))
+	{
+		mAOTechnique = mAOTechnique == KernelSSAOTechnique ? GTAOTechnique : KernelSSAOTechnique;
+		std::cout << "Ambient occlusion: " << (mAOTechnique == KernelSSAOTechnique ? "kernel SSAO" : "GTAO") << std::endl;
+	}
+	if (IsKeyPressed(GLFW_KEY_V))
+	{
+		mDynamicResolution.SetEnabled(!mDynamicResolution.IsEnabled());
+		std::cout << "Dynamic resolution: " << (mDynamicResolution.IsEnabled() ? std::format("on, {:.1f} ms target", mDynamicResolution.GetTargetFrameMs()) : "off") << std::endl;
+	}
+	if (IsKeyPressed(GLFW_KEY_Y))
+	{
+		mUpscaleSharpness = mUpscaleSharpness > 0.0f ? 0.0f : 0.5f;
+		std::cout << "Upscale sharpening: " << (mUpscaleSharpness > 0.0f ? "on" : "off") << std::endl;
+	}
+	if (IsKeyPressed(GLFW_KEY_X))
+	{
+		SetTemporalAA(!mTemporalAA);
+		std::cout << "Temporal AA: " << (mTemporalAA ? "on" : "off") << std::endl;
+	}
+	if (IsKeyPressed(GLFW_KEY_Z))
+	{
+		static const char* postAAModeNames[]{ "off", "FXAA", "SMAA 1x" };
+		mPostAAMode = static_cast<PostAAMode>((mPostAAMode + 1) % 3);
+		std::cout << "Post-process AA: " << postAAModeNames[mPostAAMode] << std::endl;
+	}
+	if (IsKeyPressed(GLFW_KEY_1))
+	{
+		mShaderPermutations = !mShaderPermutations;
+		std::cout << "G-buffer shaders: " << (mShaderPermutations
+			? std::format("{} permutations", mGBufferPermutations.GetNumVariants() + mGBufferInstancedPermutations.GetNumVariants())
+			: std::string("uber-shader")) << std::endl;
+	}
+	if (IsKeyPressed(GLFW_KEY_2))
+	{
+		static const char* depthPrepassModeNames[]{ "off", "always", "auto" };
+		mDepthPrepassMode = static_cast<DepthPrepassMode>((mDepthPrepassMode + 1) % 3);
+		std::cout << "Depth prepass: " << depthPrepassModeNames[mDepthPrepassMode] << std::endl;
+	}
+	if (IsKeyPressed(GLFW_KEY_3))
+	{
+		mShowOverdraw = !mShowOverdraw;
+		std::cout << "Overdraw heat map: " << (mShowOverdraw ? "on" : "off");
+		if (mNumOverdrawResults > 0)
+		{
+			// from the last frame that ran the prepass
+			std::cout << std::format(" ({:.2f} fragments per pixel without the prepass)", mMeasuredOverdraw);
+		}
+		std::cout << std::endl;
+	}
+	if (IsKeyPressed(GLFW_KEY_4))
+	{
+		mDrawParallaxProps = !mDrawParallaxProps;
+		std::cout << "Parallax props: " << (mDrawParallaxProps ? "on" : "off") << std::endl;
+	}
+	if (IsKeyPressed(GLFW_KEY_5))
+	{
+		mConeStepMapping = !mConeStepMapping;
+		std::cout << "Parallax mapping: " << (mConeStepMapping ? "relaxed cone steps" : "occlusion layers");
+		if (mConeStepMapping && !mParallaxConeStepMap)
+		{
+			std::cout << " (no cone step map was baked, the props use the layers)";
+		}
+		std::cout << std::endl;
+	}
+	if (IsKeyPressed(GLFW_KEY_6))
+	{
+		mDrawQueue.SetLodSelectionEnabled(!mDrawQueue.IsLodSelectionEnabled());
+		std::cout << "Levels of detail: " << (mDrawQueue.IsLodSelectionEnabled() ? "by screen size" : "full resolution")
+			<< std::format(" ({} triangles drawn last frame)", mDrawQueue.GetStats().NumTriangles) << std::endl;
+	}
+	if (IsKeyPressed(GLFW_KEY_I))
+	{
+		mAutoExposure = !mAutoExposure;
+		mAutoExposureTargets.Reset();
+		std::cout << "Auto exposure: " << (mAutoExposure ? "on" : "off");
+		if (mAutoExposure)
+		{
+			// the last value that made it back to the CPU, a few frames old
+			std::cout << " (adapted luminance " << mAutoExposureTargets.GetReadbackLuminance() << ")";
+		}
+		std::cout << std::endl;
+	}
+	if (IsKeyPressed(GLFW_KEY_O))
+	{
+		SetTransparencyMode(mTransparencyMode == SortedBlending ? WeightedBlendedOIT : SortedBlending);
+		std::cout << "Transparency: " << (mTransparencyMode == SortedBlending ? "sorted blending" : "weighted blended OIT") << std::endl;
+	}
+	if (IsKeyPressed(GLFW_KEY_N))
+	{
+		constexpr size_t numCounts = sizeof(TRANSPARENT_PROP_COUNTS) / sizeof(TRANSPARENT_PROP_COUNTS[0]);
+		size_t next = 0;
+		while (next < numCounts && TRANSPARENT_PROP_COUNTS[next] <= mTransparentPropPositions.size())
+		{
+			next++;
+		}
+		SetNumTransparentProps(TRANSPARENT_PROP_COUNTS[next % numCounts]);
+		std::cout << "Transparent objects: " << mTransparentPropPositions.size() << std::endl;
+	}
+}
+
+void Graphics::Engine::SSAOPass()
+{
+	mSSAOTimer.Begin();
+	glDisable(GL_DEPTH_TEST);
+
+	// reduced resolution and horizon based AO read linear depth from a packed depth/normal target
+	bool isReduced = mSSAODownsample > 1;
+	bool isGTAO = mAOTechnique == GTAOTechnique;
+	bool isTemporal = mTemporalSSAO && !isGTAO;
+	bool usesDepthNormal = isReduced || isGTAO;
+	SSAOFrameBuffer* occlusionFrameBuffer = isReduced ? &mSSAOLowResFrameBuffer : &mSSAOFrameBuffer;
+	SSAOFrameBuffer& blurFrameBuffer = isReduced ? mSSAOLowResBlurFrameBuffer : mSSAOBlurFrameBuffer;
+	int width = (mRenderWidth + mSSAODownsample - 1) / mSSAODownsample;
+	int height = (mRenderHeight + mSSAODownsample - 1) / mSSAODownsample;
+	glViewport(0, 0, width, height);
 
-	// SSAO
-	mSSAOFrameBuffer.Bind();
-	glClear(GL_COLOR_BUFFER_BIT);
-	mSSAOShaderProgram.Bind();
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, mGFrameBuffer.GetPositionTextureId());
 	glActiveTexture(GL_TEXTURE1);
@@ -541,33 +1201,206 @@ void Graphics::Engine::OnRender()
 	glActiveTexture(GL_TEXTURE2);
 	glBindTexture(GL_TEXTURE_2D, mNoiseTexture);
 
+	if (usesDepthNormal)
+	{
+		mSSAODepthNormalFrameBuffer.Bind();
+		mSSAODownsampleShaderProgram.Bind();
+		mSSAODownsampleShaderProgram.SetUniform1i("uDownsample", static_cast<int>(mSSAODownsample));
+		mScreenQuad.Draw();
+		glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_2D, mSSAODepthNormalFrameBuffer.GetTextureColorId());
+	}
+
+	ShaderProgram* ssaoShaderProgram = &mSSAOShaderProgram;
+	int sampleOffset = 0;
+	int sampleStride = static_cast<int>(mSSAOKernelStride);
+	if (isGTAO)
+	{
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, mSSAODepthNormalFrameBuffer.GetTextureColorId());
+		ssaoShaderProgram = &mGTAOShaderProgram;
+	}
+	else if (isTemporal)
+	{
+		// the history keeps plain visibility so it can be averaged, the power curve is applied by the blur
+		occlusionFrameBuffer = &mSSAOHistoryFrameBuffers[1 - mSSAOHistoryIndex];
+		ssaoShaderProgram = &mSSAOTemporalShaderProgram;
+		sampleOffset = static_cast<int>(mSSAOFrameIndex % SSAO_TEMPORAL_STRIDE);
+		sampleStride = static_cast<int>(SSAO_TEMPORAL_STRIDE);
+
+		glActiveTexture(GL_TEXTURE4);
+		glBindTexture(GL_TEXTURE_2D, mSSAOHistoryFrameBuffers[mSSAOHistoryIndex].GetTextureColorId());
+		ssaoShaderProgram->Bind();
+		ssaoShaderProgram->SetUniformMat4("uPrevViewProjection", glm::value_ptr(mPrevViewProjection));
+		ssaoShaderProgram->SetUniform1i("uHistoryValid", mSSAOHistoryValid);
+		ssaoShaderProgram->SetUniform1f("uMaxHistoryFrames", static_cast<float>(SSAO_TEMPORAL_STRIDE));
+		ssaoShaderProgram->SetUniformVec2("uPrevRenderScale", glm::value_ptr(mPrevRenderScale));
+	}
+	else if (isReduced)
+	{
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, mSSAODepthNormalFrameBuffer.GetTextureColorId());
+		ssaoShaderProgram = &mSSAODepthShaderProgram;
+	}
+
+	occlusionFrameBuffer->Bind();
+	glClear(GL_COLOR_BUFFER_BIT);
+	ssaoShaderProgram->Bind();
+
+	// the texture coordinates span the whole target, one noise texel per pixel at any render scale
 	glm::vec2 noiseScale(
-		static_cast<float>(mWindowWidth) / static_cast<float>(SSAO_NOISE_TEXTURE_SIZE),
-		static_cast<float>(mWindowHeight) / static_cast<float>(SSAO_NOISE_TEXTURE_SIZE)
+		static_cast<float>(blurFrameBuffer.GetWidth()) / static_cast<float>(SSAO_NOISE_TEXTURE_SIZE),
+		static_cast<float>(blurFrameBuffer.GetHeight()) / static_cast<float>(SSAO_NOISE_TEXTURE_SIZE)
 	);
-	mSSAOShaderProgram.SetUniformVec2("uNoiseScale", glm::value_ptr(noiseScale));
-	mSSAOShaderProgram.SetUniform1i("uNumSamples", NUM_SSAO_KERNEL_SAMPLES);
-	mSSAOShaderProgram.SetUniform1f("uPower", 5.0f);
-	for (int i = 0; i < NUM_SSAO_KERNEL_SAMPLES; i++)
+	ssaoShaderProgram->SetUniformVec2("uNoiseScale", glm::value_ptr(noiseScale));
+	if (isGTAO)
 	{
-		mSSAOShaderProgram.SetUniformVec3(std::format("uSamples[{}]", i), glm::value_ptr(SSAO_KERNEL[i]));
+		ssaoShaderProgram->SetUniform1i("uNumSlices", mGTAOSlices);
+		ssaoShaderProgram->SetUniform1i("uNumSteps", mGTAOSteps);
+		ssaoShaderProgram->SetUniform1f("uPower", 2.0f);
+	}
+	else
+	{
+		ssaoShaderProgram->SetUniform1i("uNumSamples", NUM_SSAO_KERNEL_SAMPLES);
+		ssaoShaderProgram->SetUniform1i("uSampleStride", sampleStride);
+		if (isTemporal)
+		{
+			ssaoShaderProgram->SetUniform1i("uSampleOffset", sampleOffset);
+		}
+		else
+		{
+			ssaoShaderProgram->SetUniform1f("uPower", 5.0f);
+		}
+		for (int i = sampleOffset; i < NUM_SSAO_KERNEL_SAMPLES; i += sampleStride)
+		{
+			ssaoShaderProgram->SetUniformVec3(std::format("uSamples[{}]", i), glm::value_ptr(SSAO_KERNEL[i]));
+		}
 	}
-
-	glDisable(GL_DEPTH_TEST);
 	mScreenQuad.Draw();
-	glEnable(GL_DEPTH_TEST);
 
-	mSSAOBlurFrameBuffer.Bind();
+	if (isTemporal)
+	{
+		mSSAOHistoryIndex = 1 - mSSAOHistoryIndex;
+		mSSAOHistoryValid = true;
+	}
+	mSSAOFrameIndex++;
+
+	// the horizon based result gets a depth aware denoise, the kernel keeps its plain box blur
+	blurFrameBuffer.Bind();
 	glClear(GL_COLOR_BUFFER_BIT);
-	mSSAOBlurShaderProgram.Bind();
+	if (isGTAO)
+	{
+		mSSAODenoiseShaderProgram.Bind();
+	}
+	else
+	{
+		mSSAOBlurShaderProgram.Bind();
+		mSSAOBlurShaderProgram.SetUniform1f("uPower", isTemporal ? 5.0f : 1.0f);
+	}
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, mSSAOFrameBuffer.GetTextureColorId());
-
-	glDisable(GL_DEPTH_TEST);
+	glBindTexture(GL_TEXTURE_2D, occlusionFrameBuffer->GetTextureColorId());
 	mScreenQuad.Draw();
+
+	// joint bilateral upsample, the full resolution depth and normals pick which low resolution samples apply
+	if (isReduced)
+	{
+		glViewport(0, 0, mRenderWidth, mRenderHeight);
+		mSSAOBlurFrameBuffer.Bind();
+		mSSAOUpsampleShaderProgram.Bind();
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, mGFrameBuffer.GetPositionTextureId());
+		glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_2D, mSSAOLowResBlurFrameBuffer.GetTextureColorId());
+		mScreenQuad.Draw();
+	}
+
 	glEnable(GL_DEPTH_TEST);
+	mSSAOTimer.End();
+}
+
+bool Graphics::Engine::IsKeyPressed(int key)
+{
+	bool isDown = glfwGetKey(mWindow, key) == GLFW_PRESS;
+	bool wasDown = mKeyStates[key];
+	mKeyStates[key] = isDown;
+	return isDown && !wasDown;
+}
+
+void Graphics::Engine::OnRender()
+{
+	mFrameTimer.Begin();
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+	BuildDrawQueue();
+	UpdateRenderScale();
+
+	//Render to depth map
+	ShadowPass();
+
+	glViewport(0, 0, mRenderWidth, mRenderHeight);
+
+	// a different sub-pixel offset every frame, in pixels of the resolution the scene renders at
+	mTAAJitter = glm::vec2(0.0f);
+	if (mTemporalAA)
+	{
+		unsigned int sample = mTAAFrameIndex % NUM_TAA_JITTER_SAMPLES + 1;
+		glm::vec2 offset(Halton(sample, 2) - 0.5f, Halton(sample, 3) - 0.5f);
+		mTAAJitter = offset * 2.0f / glm::vec2(mRenderWidth, mRenderHeight);
+	}
+
+	glm::mat4 viewMatrix = mCamera.GetViewMatrix();
+	glm::mat4 projectionMatrix = mCamera.GetProjectionMatrix(mAspectRatio, CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE);
+	glm::mat4 jitteredProjectionMatrix = mCamera.GetProjectionMatrix(mAspectRatio, CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE, mTAAJitter);
+	SetupScene(viewMatrix, jitteredProjectionMatrix);
+	// reprojection and velocities work with the unjittered matrices
+	mPrevViewProjection = mViewProjection;
+	mViewProjection = projectionMatrix * viewMatrix;
+	mJitteredViewProjection = jitteredProjectionMatrix * viewMatrix;
+
+	mGFrameBuffer.Bind();
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	mDepthPrepassActive = UpdateDepthPrepass();
+	if (mDepthPrepassActive)
+	{
+		DepthPrepass();
+	}
+
+	// Geometry pass
+	mGeometryTimer.Begin();
+	PrepareGBufferPrograms();
+	if (mDepthPrepassActive)
+	{
+		// only the nearest surface is left to shade, the depth is already final
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+		mGeometrySampleCounter.Begin();
+	}
+	if (mShaderPermutations)
+	{
+		mDrawQueue.Flush(mGBufferPermutations, &mGBufferInstancedPermutations);
+	}
+	else
+	{
+		DrawScene(mGBufferUberShaderProgram, &mGBufferUberInstancedShaderProgram);
+	}
+	if (mDepthPrepassActive)
+	{
+		mGeometrySampleCounter.End();
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+	}
+	mGeometryTimer.End();
+
+	if (mShowOverdraw)
+	{
+		OverdrawPass();
+	}
+
+	SSAOPass();
+	glViewport(0, 0, mRenderWidth, mRenderHeight);
 
 	// Lighting pass
+	mLightingTimer.Begin();
 	mDeferredLightingFrameBuffer.Bind();
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	mDeferredShaderProgram.Bind();
@@ -579,20 +1412,25 @@ void Graphics::Engine::OnRender()
 	glActiveTexture(GL_TEXTURE2);
 	glBindTexture(GL_TEXTURE_2D, mGFrameBuffer.GetAlbedoSpecularTextureId());
 	glActiveTexture(GL_TEXTURE3);
-	glBindTexture(GL_TEXTURE_2D, mDirectionalDepthMap.GetTextureColorId());
+	glBindTexture(GL_TEXTURE_2D_ARRAY, mCascadedShadowMap.GetTextureId());
 	glActiveTexture(GL_TEXTURE4);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, mPointDepthMap.GetTextureColorId());
+	glBindTexture(GL_TEXTURE_CUBE_MAP, mPointShadowCache.GetTextureId(0));
 	glActiveTexture(GL_TEXTURE5);
 	glBindTexture(GL_TEXTURE_2D, mSSAOBlurFrameBuffer.GetTextureColorId());
+	glActiveTexture(GL_TEXTURE6);
+	glBindTexture(GL_TEXTURE_2D, mShadowAtlas.GetTextureId());
+	glActiveTexture(GL_TEXTURE7);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, mCascadeMoments.GetTextureId());
 
 	glDisable(GL_DEPTH_TEST);
 	mScreenQuad.Draw();
 	glEnable(GL_DEPTH_TEST);
+	mLightingTimer.End();
 
 	// Forward pass
 	glBindFramebuffer(GL_READ_FRAMEBUFFER, mGFrameBuffer.GetFrameBufferId());
 	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mDeferredLightingFrameBuffer.GetFrameBufferId());
-	glBlitFramebuffer(0, 0, mWindowWidth, mWindowHeight, 0, 0, mWindowWidth, mWindowHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBlitFramebuffer(0, 0, mRenderWidth, mRenderHeight, 0, 0, mRenderWidth, mRenderHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
 
 	mDeferredLightingFrameBuffer.Bind();
 	mLightSourceShaderProgram.Bind();
@@ -604,139 +1442,787 @@ void Graphics::Engine::OnRender()
 		lightSourceMat = glm::scale(lightSourceMat, glm::vec3(0.15f));
 		SPHERE_MODEL.Draw(mLightSourceShaderProgram, lightSourceMat);
 	}
+	for (unsigned int i = 0; mDrawAtlasLights && i < mAtlasLights.size(); i++)
+	{
+		mLightSourceShaderProgram.SetUniformVec3("uLightColor", glm::value_ptr(ATLAS_LIGHT_COLORS[i]));
+		glm::mat4 lightSourceMat = glm::translate(glm::mat4(1.0f), mAtlasLights[i].Position);
+		lightSourceMat = glm::scale(lightSourceMat, glm::vec3(0.05f));
+		SPHERE_MODEL.Draw(mLightSourceShaderProgram, lightSourceMat);
+	}
 
-	// Blurring bright fragments with two-pass Gaussian Blur
-	mGaussianBlurShaderProgram.Bind();
-	mGaussianBlurShaderProgram.SetUniformVec2("uSampleDistance", glm::value_ptr(glm::vec2(1.0f, 1.0f)));
-	bool isHorizontal = true, isFirstIteration = true;
-	unsigned int numPasses = 5;
-	glDisable(GL_DEPTH_TEST);
-	for (unsigned int i = 0; i < numPasses * 2; i++)
+	// Transparent pass, composited into the lighting buffer so it is picked up by bloom
+	TransparentPass();
+
+	// with TAA the rest of the frame reads the resolved scene, which always covers the whole window
+	unsigned int sceneTextureId = mDeferredLightingFrameBuffer.GetTextureColorId();
+	glm::vec2 sceneScale = mRenderScale;
+	if (mTemporalAA)
 	{
-		mGaussianBlurShaderProgram.SetUniform1i("uHorizontal", isHorizontal);
-		glBindFramebuffer(GL_FRAMEBUFFER, mPingPongFrameBuffers[isHorizontal]);
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, isFirstIteration ? mDeferredLightingFrameBuffer.GetBrightTextureColorId() : mPingPongColorBuffers[!isHorizontal]);
-		mScreenQuad.Draw();
-		isHorizontal = !isHorizontal;
-		isFirstIteration = false;
+		TAAPass();
+		sceneTextureId = mTAAHistoryFrameBuffers[mTAAHistoryIndex].GetTextureColorId();
+		sceneScale = glm::vec2(1.0f);
 	}
-	glEnable(GL_DEPTH_TEST);
+
+	BloomPass(sceneTextureId, sceneScale);
+	if (mAutoExposure)
+	{
+		AutoExposurePass(sceneTextureId, sceneScale);
+	}
+	glViewport(0, 0, mWindowWidth, mWindowHeight);
 
 	// Post-processing
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	bool usesPostAA = mPostAAMode != NoPostAA;
+	if (usesPostAA)
+	{
+		mPostAAFrameBuffer.Bind();
+	}
+	else
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 	mPostProcessingShaderProgram.Bind();
 
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, mDeferredLightingFrameBuffer.GetTextureColorId());
+	glBindTexture(GL_TEXTURE_2D, sceneTextureId);
 	glActiveTexture(GL_TEXTURE1);
-	glBindTexture(GL_TEXTURE_2D, mPingPongColorBuffers[!isHorizontal]);
+	glBindTexture(GL_TEXTURE_2D, mBloomMipChain.GetMip(0).TextureId);
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, mAutoExposureTargets.GetLuminanceTextureId());
+	mPostProcessingShaderProgram.SetUniformVec2("uRenderScale", glm::value_ptr(sceneScale));
+	mPostProcessingShaderProgram.SetUniform1i("uAutoExposure", mAutoExposure);
+	// every level adds its own copy of the bright parts on the way up
+	mPostProcessingShaderProgram.SetUniform1f("uBloomStrength", 1.0f / static_cast<float>(mBloomMipChain.GetNumMips()));
+	mPostProcessingShaderProgram.SetUniform1f("uSharpness", mRenderScale.x < 1.0f ? mUpscaleSharpness : 0.0f);
+	mPostProcessingShaderProgram.SetUniform1i("uOutputLuma", usesPostAA);
 
 	glDisable(GL_DEPTH_TEST);
 	mScreenQuad.Draw();
 	glEnable(GL_DEPTH_TEST);
 
+	if (usesPostAA)
+	{
+		PostAAPass();
+	}
+
+	// replaces the frame, so the tone mapping and exposure do not change the colours of the counts
+	if (mShowOverdraw)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDisable(GL_DEPTH_TEST);
+		mOverdrawHeatmapShaderProgram.Bind();
+		mOverdrawHeatmapShaderProgram.SetUniformVec2("uRenderScale", glm::value_ptr(mRenderScale));
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, mOverdrawFrameBuffer.GetTextureColorId());
+		mScreenQuad.Draw();
+		glEnable(GL_DEPTH_TEST);
+	}
+	mFrameTimer.End();
+
+	if (!mScreenshotPath.empty())
+	{
+		GLSaveScreenshot(mScreenshotPath.c_str(), mWindowWidth, mWindowHeight);
+		mScreenshotPath.clear();
+	}
+
 	glfwSwapBuffers(mWindow);
+
+	mTransparencyTimer.Resolve();
+	mDirectionalShadowTimer.Resolve();
+	mPointShadowTimer.Resolve();
+	mShadowAtlasTimer.Resolve();
+	mShadowPrefilterTimer.Resolve();
+	mLightingTimer.Resolve();
+	mSSAOTimer.Resolve();
+	mBloomTimer.Resolve();
+	mGeometryTimer.Resolve();
+	mDepthPrepassTimer.Resolve();
+	mPrepassSampleCounter.Resolve();
+	mGeometrySampleCounter.Resolve();
+	mTAATimer.Resolve();
+	mPostAATimer.Resolve();
+	mExposureTimer.Resolve();
+	mAutoExposureTargets.PollReadback();
+	mFrameTimer.Resolve();
+	if (mFrameTimer.GetNumResults() != mNumFrameTimes)
+	{
+		mNumFrameTimes = mFrameTimer.GetNumResults();
+		mDynamicResolution.Update(static_cast<float>(mFrameTimer.GetElapsedMs()));
+	}
 }
 
-void Graphics::Engine::ShadowPass()
+void Graphics::Engine::BloomPass(unsigned int sceneTextureId, const glm::vec2& sceneScale)
 {
-	float nearPlane = 0.1f, farPlane = 100.0f;
+	mBloomTimer.Begin();
+	glDisable(GL_DEPTH_TEST);
 
-	glm::mat4 dirLightProjection = glm::ortho(-20.0f, 20.0f, -20.0f, 20.0f, nearPlane, farPlane);
-	DIR_LIGHT_POS = -LIGHT_DIRECTION * 30.0f;
-	glm::mat4 dirLightView = glm::lookAt(
-		DIR_LIGHT_POS,
-		glm::vec3(0.0f, 0.0f, 0.0f),
-		glm::vec3(0.0f, 1.0f, 0.0f)
-	);
-	DIR_LIGHT_SPACE_MAT = dirLightProjection * dirLightView;
+	// the threshold is applied by the first downsample, straight from the lit scene
+	mBloomDownsampleShaderProgram.Bind();
+	glActiveTexture(GL_TEXTURE0);
+	for (unsigned int i = 0; i < mBloomMipChain.GetNumMips(); i++)
+	{
+		mBloomMipChain.BindMip(i);
+		glBindTexture(GL_TEXTURE_2D, i == 0 ? sceneTextureId : mBloomMipChain.GetMip(i - 1).TextureId);
+		mBloomDownsampleShaderProgram.SetUniform1i("uIsFirstPass", i == 0);
+		// the levels always cover the whole screen, only the lit scene is rendered into part of its target
+		mBloomDownsampleShaderProgram.SetUniformVec2("uRenderScale", glm::value_ptr(i == 0 ? sceneScale : glm::vec2(1.0f)));
+		mScreenQuad.Draw();
+	}
 
-	float shadowAspect = static_cast<float>(mPointDepthMap.GetWidth()) / static_cast<float>(mPointDepthMap.GetHeight());
-	glm::mat4 pointLightProjection = glm::perspective(glm::radians(90.0f), shadowAspect, nearPlane, farPlane);
-	glm::mat4 pointShadowTransforms[6];
-	pointShadowTransforms[0] = pointLightProjection * glm::lookAt(POINT_LIGHT_POSITIONS[0], POINT_LIGHT_POSITIONS[0] + glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)); // right
-	pointShadowTransforms[1] = pointLightProjection * glm::lookAt(POINT_LIGHT_POSITIONS[0], POINT_LIGHT_POSITIONS[0] + glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)); // left
-	pointShadowTransforms[2] = pointLightProjection * glm::lookAt(POINT_LIGHT_POSITIONS[0], POINT_LIGHT_POSITIONS[0] + glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)); // top
-	pointShadowTransforms[3] = pointLightProjection * glm::lookAt(POINT_LIGHT_POSITIONS[0], POINT_LIGHT_POSITIONS[0] + glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f)); // bottom
-	pointShadowTransforms[4] = pointLightProjection * glm::lookAt(POINT_LIGHT_POSITIONS[0], POINT_LIGHT_POSITIONS[0] + glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f)); // back
-	pointShadowTransforms[5] = pointLightProjection * glm::lookAt(POINT_LIGHT_POSITIONS[0], POINT_LIGHT_POSITIONS[0] + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f)); // forward
+	// back up the chain, each level blurred and added onto the next larger one
+	mBloomUpsampleShaderProgram.Bind();
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE);
+	for (unsigned int i = mBloomMipChain.GetNumMips() - 1; i > 0; i--)
+	{
+		mBloomMipChain.BindMip(i - 1);
+		glBindTexture(GL_TEXTURE_2D, mBloomMipChain.GetMip(i).TextureId);
+		mScreenQuad.Draw();
+	}
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_BLEND);
 
-	mDirectionalShadowMappingShaderProgram.Bind();
-	mDirectionalShadowMappingShaderProgram.SetUniformMat4("uLightSpaceMatrix", glm::value_ptr(DIR_LIGHT_SPACE_MAT));
-	mDirectionalShadowMappingInstancedShaderProgram.Bind();
-	mDirectionalShadowMappingInstancedShaderProgram.SetUniformMat4("uLightSpaceMatrix", glm::value_ptr(DIR_LIGHT_SPACE_MAT));
+	glEnable(GL_DEPTH_TEST);
+	mBloomTimer.End();
+}
 
-	mPointShadowMappingShaderProgram.Bind();
-	for (unsigned int i = 0; i < 6; i++)
+void Graphics::Engine::AutoExposurePass(unsigned int sceneTextureId, const glm::vec2& sceneScale)
+{
+	mExposureTimer.Begin();
+	glDisable(GL_DEPTH_TEST);
+
+	// every sample adds one to the texel of its bin
+	mAutoExposureTargets.BindHistogram();
+	glClear(GL_COLOR_BUFFER_BIT);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE);
+	mLuminanceHistogramShaderProgram.Bind();
+	mLuminanceHistogramShaderProgram.SetUniform1i("uGridWidth", mExposureGridWidth);
+	mLuminanceHistogramShaderProgram.SetUniform1i("uGridHeight", mExposureGridHeight);
+	mLuminanceHistogramShaderProgram.SetUniformVec2("uRenderScale", glm::value_ptr(sceneScale));
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, sceneTextureId);
+	mAutoExposureTargets.DrawSamplePoints(static_cast<unsigned int>(mExposureGridWidth * mExposureGridHeight));
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_BLEND);
+
+	// the histogram is averaged into a single texel, eased towards from the previous frame's
+	bool historyValid = mAutoExposureTargets.IsHistoryValid();
+	mAutoExposureTargets.BindAdaptation();
+	mExposureAdaptShaderProgram.Bind();
+	mExposureAdaptShaderProgram.SetUniform1i("uHistoryValid", historyValid);
+	mExposureAdaptShaderProgram.SetUniform1f("uDeltaTime", Time::DeltaTime);
+	glBindTexture(GL_TEXTURE_2D, mAutoExposureTargets.GetHistogramTextureId());
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, mAutoExposureTargets.GetPrevLuminanceTextureId());
+	mScreenQuad.Draw();
+
+	mAutoExposureTargets.QueueReadback();
+
+	glEnable(GL_DEPTH_TEST);
+	mExposureTimer.End();
+}
+
+void Graphics::Engine::TAAPass()
+{
+	mTAATimer.Begin();
+	glDisable(GL_DEPTH_TEST);
+	glViewport(0, 0, mWindowWidth, mWindowHeight);
+
+	// the two targets swap every frame, the one written now is the history of the next frame
+	unsigned int historyTextureId = mTAAHistoryFrameBuffers[mTAAHistoryIndex].GetTextureColorId();
+	mTAAHistoryIndex = 1 - mTAAHistoryIndex;
+	mTAAHistoryFrameBuffers[mTAAHistoryIndex].Bind();
+
+	mTAAShaderProgram.Bind();
+	mTAAShaderProgram.SetUniformVec2("uRenderScale", glm::value_ptr(mRenderScale));
+	mTAAShaderProgram.SetUniformVec2("uJitter", glm::value_ptr(mTAAJitter * 0.5f));
+	mTAAShaderProgram.SetUniform1i("uHistoryValid", mTAAHistoryValid);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, mDeferredLightingFrameBuffer.GetTextureColorId());
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, mGFrameBuffer.GetVelocityTextureId());
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, historyTextureId);
+	mScreenQuad.Draw();
+
+	mTAAHistoryValid = true;
+	mTAAFrameIndex++;
+
+	glEnable(GL_DEPTH_TEST);
+	mTAATimer.End();
+}
+
+void Graphics::Engine::PostAAPass()
+{
+	mPostAATimer.Begin();
+	glDisable(GL_DEPTH_TEST);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, mPostAAFrameBuffer.GetTextureColorId());
+	if (mPostAAMode == FXAAPostAA)
 	{
-		mPointShadowMappingShaderProgram.SetUniformMat4(
-			std::format("uShadowMatrices[{}]", i), glm::value_ptr(pointShadowTransforms[i])
-		);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		mFXAAShaderProgram.Bind();
+		mScreenQuad.Draw();
+	}
+	else
+	{
+		// edges from the luma, blend weights from the edge patterns, then every pixel mixes with a neighbour
+		mSMAAFrameBuffer.BindEdges();
+		glClear(GL_COLOR_BUFFER_BIT);
+		mSMAAEdgesShaderProgram.Bind();
+		mScreenQuad.Draw();
+
+		mSMAAFrameBuffer.BindBlendWeights();
+		glClear(GL_COLOR_BUFFER_BIT);
+		mSMAAWeightsShaderProgram.Bind();
+		glBindTexture(GL_TEXTURE_2D, mSMAAFrameBuffer.GetEdgesTextureId());
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, mSMAAFrameBuffer.GetAreaTextureId());
+		glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_2D, mSMAAFrameBuffer.GetSearchTextureId());
+		mScreenQuad.Draw();
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		mSMAABlendShaderProgram.Bind();
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, mPostAAFrameBuffer.GetTextureColorId());
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, mSMAAFrameBuffer.GetBlendWeightsTextureId());
+		mScreenQuad.Draw();
+	}
+
+	glEnable(GL_DEPTH_TEST);
+	mPostAATimer.End();
+}
+
+void Graphics::Engine::TransparentPass()
+{
+	auto cpuStart = std::chrono::high_resolution_clock::now();
+	mTransparencyTimer.Begin();
+
+	BeginTransparentDrawQueue();
+	SubmitTransparentProps(mTransparentDrawQueue);
+
+	static glm::vec3 lightColor(0.9, 0.68, 0.24);
+	bool isWeightedBlended = mTransparencyMode == WeightedBlendedOIT;
+	for (ShaderProgram* shader : { &mTransparentShaderProgram, &mTransparentInstancedShaderProgram })
+	{
+		shader->Bind();
+		shader->SetUniformVec3("uViewPos", glm::value_ptr(mCamera.GetWorldPosition()));
+		shader->SetUniformVec3("uLightDirection", glm::value_ptr(LIGHT_DIRECTION));
+		shader->SetUniformVec3("uLightColor", glm::value_ptr(lightColor * 0.5f));
+		shader->SetUniformVec3("uPointLightPos", glm::value_ptr(POINT_LIGHT_POSITIONS[0]));
+		shader->SetUniformVec3("uPointLightColor", glm::value_ptr(POINT_LIGHT_COLORS[0]));
+		shader->SetUniform1i("uWeightedOIT", isWeightedBlended);
+	}
+
+	// tested against the opaque depth, but never written, so layers behind each other all contribute
+	glDepthMask(GL_FALSE);
+	glEnable(GL_BLEND);
+
+	if (isWeightedBlended)
+	{
+		// one unsorted pass: colours and weights add up, revealage multiplies in the accumulation alpha
+		mOITFrameBuffer.Bind();
+		mOITFrameBuffer.Clear();
+		glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE_MINUS_SRC_ALPHA);
+		mTransparentDrawQueue.Flush(mTransparentShaderProgram, &mTransparentInstancedShaderProgram, DrawQueue::Transparent);
+
+		mDeferredLightingFrameBuffer.Bind();
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		mOITCompositeShaderProgram.Bind();
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, mOITFrameBuffer.GetAccumulationTextureId());
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, mOITFrameBuffer.GetWeightTextureId());
+
+		glDisable(GL_DEPTH_TEST);
+		mScreenQuad.Draw();
+		glEnable(GL_DEPTH_TEST);
+	}
+	else
+	{
+		mDeferredLightingFrameBuffer.Bind();
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		mTransparentDrawQueue.Flush(mTransparentShaderProgram, nullptr, DrawQueue::Transparent);
 	}
-	mPointShadowMappingShaderProgram.SetUniformVec3("uLightPos", glm::value_ptr(POINT_LIGHT_POSITIONS[0]));
-	mPointShadowMappingShaderProgram.SetUniform1f("uFarPlane", farPlane);
 
-	mPointShadowMappingInstancedShaderProgram.Bind();
+	glDisable(GL_BLEND);
+	glDepthMask(GL_TRUE);
+
+	mTransparencyTimer.End();
+	auto cpuEnd = std::chrono::high_resolution_clock::now();
+	mTransparencyCpuMs = std::chrono::duration<double, std::milli>(cpuEnd - cpuStart).count();
+}
+
+void Graphics::Engine::SetPointShadowUniforms(const glm::vec3& lightPosition, float farPlane)
+{
+	float shadowAspect = 1.0f;
+	glm::mat4 pointLightProjection = glm::perspective(glm::radians(90.0f), shadowAspect, POINT_SHADOW_NEAR_PLANE, farPlane);
+	glm::mat4 pointShadowTransforms[6];
+	pointShadowTransforms[0] = pointLightProjection * glm::lookAt(lightPosition, lightPosition + glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)); // right
+	pointShadowTransforms[1] = pointLightProjection * glm::lookAt(lightPosition, lightPosition + glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)); // left
+	pointShadowTransforms[2] = pointLightProjection * glm::lookAt(lightPosition, lightPosition + glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)); // top
+	pointShadowTransforms[3] = pointLightProjection * glm::lookAt(lightPosition, lightPosition + glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f)); // bottom
+	pointShadowTransforms[4] = pointLightProjection * glm::lookAt(lightPosition, lightPosition + glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f)); // back
+	pointShadowTransforms[5] = pointLightProjection * glm::lookAt(lightPosition, lightPosition + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f)); // forward
+
 	for (unsigned int i = 0; i < 6; i++)
 	{
-		mPointShadowMappingInstancedShaderProgram.SetUniformMat4(
-			std::format("uShadowMatrices[{}]", i), glm::value_ptr(pointShadowTransforms[i])
+		mPointShadowMatrices[i] = pointShadowTransforms[i];
+	}
+
+	// the geometry shader path takes all six matrices at once, the per-face paths one per face in DrawPointShadowCasters
+	for (ShaderProgram* shader : {
+		&mPointShadowMappingShaderProgram, &mPointShadowMappingInstancedShaderProgram,
+		&mPointShadowMappingHardwareShaderProgram, &mPointShadowMappingHardwareInstancedShaderProgram })
+	{
+		shader->Bind();
+		for (unsigned int i = 0; i < 6; i++)
+		{
+			shader->SetUniformMat4(std::format("uShadowMatrices[{}]", i), glm::value_ptr(pointShadowTransforms[i]));
+		}
+	}
+
+	for (ShaderProgram* shader : {
+		&mPointShadowMappingShaderProgram, &mPointShadowMappingInstancedShaderProgram,
+		&mPointShadowFaceShaderProgram, &mPointShadowFaceInstancedShaderProgram,
+		&mPointShadowLayeredShaderProgram, &mPointShadowLayeredInstancedShaderProgram })
+	{
+		if (shader->GetID() == 0)
+		{
+			continue;
+		}
+
+		shader->Bind();
+		shader->SetUniformVec3("uLightPos", glm::value_ptr(lightPosition));
+		shader->SetUniform1f("uFarPlane", farPlane);
+	}
+}
+
+void Graphics::Engine::DrawPointShadowCasters(unsigned int mobilityMask)
+{
+	bool isHardwareDepth = mPointShadowHardwareDepth;
+	if (mPointShadowMode == GeometryShaderPointShadows)
+	{
+		DrawScene(
+			isHardwareDepth ? mPointShadowMappingHardwareShaderProgram : mPointShadowMappingShaderProgram,
+			isHardwareDepth ? &mPointShadowMappingHardwareInstancedShaderProgram : &mPointShadowMappingInstancedShaderProgram,
+			nullptr, mobilityMask
 		);
+		return;
 	}
-	mPointShadowMappingInstancedShaderProgram.SetUniformVec3("uLightPos", glm::value_ptr(POINT_LIGHT_POSITIONS[0]));
-	mPointShadowMappingInstancedShaderProgram.SetUniform1f("uFarPlane", farPlane);
 
-	//glViewport(0, 0, mDirectionalDepthMap.GetWidth(), mDirectionalDepthMap.GetHeight());
-	//mDirectionalDepthMap.Bind();
-	//glClear(GL_DEPTH_BUFFER_BIT);
-	//DrawScene(mDirectionalShadowMappingShaderProgram, &mDirectionalShadowMappingInstancedShaderProgram);
+	// every face only draws the casters inside its own 90 degree frustum
+	bool isLayered = mPointShadowMode == LayeredPointShadows;
+	ShaderProgram& shader = isLayered ?
+		(isHardwareDepth ? mPointShadowLayeredHardwareShaderProgram : mPointShadowLayeredShaderProgram) :
+		(isHardwareDepth ? mPointShadowFaceHardwareShaderProgram : mPointShadowFaceShaderProgram);
+	ShaderProgram& shaderInstanced = isLayered ?
+		(isHardwareDepth ? mPointShadowLayeredHardwareInstancedShaderProgram : mPointShadowLayeredInstancedShaderProgram) :
+		(isHardwareDepth ? mPointShadowFaceHardwareInstancedShaderProgram : mPointShadowFaceInstancedShaderProgram);
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		for (ShaderProgram* faceShader : { &shader, &shaderInstanced })
+		{
+			faceShader->Bind();
+			faceShader->SetUniformMat4("uShadowMatrix", glm::value_ptr(mPointShadowMatrices[face]));
+			if (isLayered)
+			{
+				faceShader->SetUniform1i("uFace", face);
+			}
+		}
+
+		if (!isLayered)
+		{
+			mPointShadowCache.BindFace(face);
+		}
 
-	glViewport(0, 0, mPointDepthMap.GetWidth(), mPointDepthMap.GetHeight());
-	mPointDepthMap.Bind();
-	glClear(GL_DEPTH_BUFFER_BIT);
-	DrawScene(mPointShadowMappingShaderProgram, &mPointShadowMappingInstancedShaderProgram);
+		Frustum faceFrustum(mPointShadowMatrices[face]);
+		DrawScene(shader, &shaderInstanced, &faceFrustum, mobilityMask);
+	}
 }
 
-void Graphics::Engine::DrawScene(
-	ShaderProgram& shader,
-	ShaderProgram* const shaderInstanced
-)
+void Graphics::Engine::SetPointShadowMode(PointShadowMode mode)
 {
-	shader.Bind();
+	if (mode == LayeredPointShadows && !mSupportsVertexLayer)
+	{
+		mode = PerFacePointShadows;
+	}
+
+	mPointShadowMode = mode;
+	std::cout << "Point shadows: " << POINT_SHADOW_MODE_NAMES[mode] << std::endl;
+}
+
+void Graphics::Engine::SetPointShadowDepth(bool hardwareDepth, DepthMap::DepthMapFormat format, unsigned int resolution)
+{
+	// the cached maps hold depths in the old encoding, so they are rebuilt even if only the encoding changes
+	if (hardwareDepth != mPointShadowHardwareDepth || format != mPointShadowCache.GetFormat() || resolution != mPointShadowCache.GetResolution())
+	{
+		mPointShadowHardwareDepth = hardwareDepth;
+		mPointShadowCache.Build(resolution, NUM_POINT_LIGHTS, format);
+	}
+
+	std::cout << std::format(
+		"Point shadow depth: {}, {} bit, {}^2\n",
+		hardwareDepth ? "hardware" : "linear distance", format == DepthMap::Depth16 ? 16 : 32, resolution
+	);
+}
+
+void Graphics::Engine::ShadowPass()
+{
+	// every cascade only draws the casters inside its own light frustum
+	mDirectionalShadowTimer.Begin();
+	mCascadedShadowMap.Update(mCamera, mAspectRatio, CAMERA_NEAR_PLANE, LIGHT_DIRECTION);
+	glViewport(0, 0, mCascadedShadowMap.GetResolution(), mCascadedShadowMap.GetResolution());
+	for (unsigned int i = 0; i < mCascadedShadowMap.GetNumCascades(); i++)
+	{
+		const CascadedShadowMap::Cascade& cascade = mCascadedShadowMap.GetCascade(i);
+		mDirectionalShadowMappingShaderProgram.Bind();
+		mDirectionalShadowMappingShaderProgram.SetUniformMat4("uLightSpaceMatrix", glm::value_ptr(cascade.LightSpaceMatrix));
+		mDirectionalShadowMappingInstancedShaderProgram.Bind();
+		mDirectionalShadowMappingInstancedShaderProgram.SetUniformMat4("uLightSpaceMatrix", glm::value_ptr(cascade.LightSpaceMatrix));
+
+		mCascadedShadowMap.BindCascade(i);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		DrawScene(mDirectionalShadowMappingShaderProgram, &mDirectionalShadowMappingInstancedShaderProgram, &cascade.CullingFrustum);
+	}
+	mDirectionalShadowTimer.End();
+
+	if (mShadowFilter == EVSMShadowFilter)
+	{
+		PrefilterShadowPass();
+	}
+
+	// static casters only when their cache is stale, dynamic ones every frame on top of a copy of the cache
+	mPointShadowTimer.Begin();
+	mPointShadowCache.BeginFrame(POINT_LIGHT_POSITIONS, mDrawQueue.GetStaticHash(), mDrawQueue.GetNumDynamicItems() > 0);
+	glViewport(0, 0, mPointShadowCache.GetResolution(), mPointShadowCache.GetResolution());
+	for (unsigned int light : mPointShadowCache.GetStaticUpdates())
+	{
+		SetPointShadowUniforms(POINT_LIGHT_POSITIONS[light], POINT_SHADOW_FAR_PLANE);
+		mPointShadowCache.BindStatic(light);
+		glClear(GL_DEPTH_BUFFER_BIT);
+		DrawPointShadowCasters(DrawQueue::Static);
+	}
+
+	unsigned int compositeMobility = mPointShadowCache.IsCachingEnabled() ? DrawQueue::Dynamic : DrawQueue::AnyMobility;
+	for (unsigned int light : mPointShadowCache.GetCompositeUpdates())
+	{
+		SetPointShadowUniforms(POINT_LIGHT_POSITIONS[light], POINT_SHADOW_FAR_PLANE);
+		mPointShadowCache.BeginComposite(light);
+		DrawPointShadowCasters(compositeMobility);
+	}
+	mPointShadowTimer.End();
+
+	if (mDrawAtlasLights)
+	{
+		ShadowAtlasPass();
+	}
+}
+
+void Graphics::Engine::PrefilterShadowPass()
+{
+	// the moments are kept at half the cascade resolution, the conversion already averages 2x2 depth texels
+	unsigned int resolution = mCascadedShadowMap.GetResolution() / 2;
+	unsigned int numCascades = mCascadedShadowMap.GetNumCascades();
+	if (mCascadeMoments.GetResolution() != resolution || mCascadeMoments.GetNumLayers() != numCascades)
+	{
+		mCascadeMoments.Build(resolution, numCascades);
+	}
+
+	mShadowPrefilterTimer.Begin();
+	glViewport(0, 0, resolution, resolution);
+	glDisable(GL_DEPTH_TEST);
+	for (unsigned int i = 0; i < numCascades; i++)
+	{
+		mCascadeMoments.BindScratch(0);
+		mEVSMMomentsShaderProgram.Bind();
+		mEVSMMomentsShaderProgram.SetUniform1i("uLayer", i);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, mCascadedShadowMap.GetTextureId());
+		mScreenQuad.Draw();
+
+		// separable Gaussian, the vertical half writes straight into the cascade's layer
+		mGaussianBlurShaderProgram.Bind();
+		mGaussianBlurShaderProgram.SetUniformVec2("uSampleDistance", glm::value_ptr(glm::vec2(1.0f, 1.0f)));
+		mGaussianBlurShaderProgram.SetUniform1i("uHorizontal", true);
+		mCascadeMoments.BindScratch(1);
+		glBindTexture(GL_TEXTURE_2D, mCascadeMoments.GetScratchTextureId(0));
+		mScreenQuad.Draw();
+
+		mGaussianBlurShaderProgram.SetUniform1i("uHorizontal", false);
+		mCascadeMoments.BindLayer(i);
+		glBindTexture(GL_TEXTURE_2D, mCascadeMoments.GetScratchTextureId(1));
+		mScreenQuad.Draw();
+	}
+	glEnable(GL_DEPTH_TEST);
+	mCascadeMoments.GenerateMipmaps();
+	mShadowPrefilterTimer.End();
+}
+
+void Graphics::Engine::SetShadowFilter(ShadowFilter filter)
+{
+	mShadowFilter = filter;
+	std::cout << "Directional shadow filter: " << SHADOW_FILTER_NAMES[filter] << std::endl;
+}
+
+void Graphics::Engine::UpdateAtlasLights()
+{
+	glm::mat4 viewProjection = mCamera.GetProjectionMatrix(mAspectRatio, CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE) * mCamera.GetViewMatrix();
+	Frustum viewFrustum(viewProjection);
+	float tanHalfFovY = std::tan(0.5f * glm::radians(mCamera.GetZoom()));
+	bool hasDynamicCasters = mDrawQueue.GetNumDynamicItems() > 0;
+	const Core::BoundingBox& dynamicBounds = mDrawQueue.GetDynamicBounds();
+
+	for (ShadowAtlas::Light& light : mAtlasLights)
+	{
+		Core::BoundingBox bounds{ light.Position - glm::vec3(light.Radius), light.Position + glm::vec3(light.Radius) };
+
+		// lights that cannot reach anything in view need no shadow this frame
+		light.Importance = 0.0f;
+		if (viewFrustum.Intersects(bounds))
+		{
+			float distance = std::max(glm::distance(mCamera.GetWorldPosition(), light.Position), light.Radius);
+			light.Importance = light.Radius / (distance * tanHalfFovY);
+		}
+
+		light.IsDirty = hasDynamicCasters &&
+			glm::all(glm::lessThanEqual(bounds.Min, dynamicBounds.Max)) &&
+			glm::all(glm::greaterThanEqual(bounds.Max, dynamicBounds.Min));
+	}
+}
+
+void Graphics::Engine::ShadowAtlasPass()
+{
+	// only the lights the atlas picked for this frame, every face culled against its own frustum
+	mShadowAtlasTimer.Begin();
+	UpdateAtlasLights();
+	mShadowAtlas.Update(mAtlasLights, mDrawQueue.GetStaticHash());
+	for (unsigned int light : mShadowAtlas.GetUpdates())
+	{
+		SetPointShadowUniforms(mAtlasLights[light].Position, mAtlasLights[light].Radius);
+		for (unsigned int face = 0; face < 6; face++)
+		{
+			for (ShaderProgram* faceShader : { &mPointShadowFaceShaderProgram, &mPointShadowFaceInstancedShaderProgram })
+			{
+				faceShader->Bind();
+				faceShader->SetUniformMat4("uShadowMatrix", glm::value_ptr(mPointShadowMatrices[face]));
+			}
+
+			mShadowAtlas.BindFace(light, face);
+			Frustum faceFrustum(mPointShadowMatrices[face]);
+			DrawScene(mPointShadowFaceShaderProgram, &mPointShadowFaceInstancedShaderProgram, &faceFrustum);
+		}
+	}
+	mShadowAtlas.Unbind();
+	mShadowAtlasTimer.End();
+}
+
+void Graphics::Engine::BuildDrawQueue()
+{
+	mDrawQueue.Clear();
+	mDrawQueue.SetView(mCamera.GetWorldPosition(), mCamera.GetForwardDirection(), CAMERA_FAR_PLANE, glm::radians(mCamera.GetZoom()));
+
+	Core::Material floorMaterial;
+	floorMaterial.TexTiling = 4.0f;
+	floorMaterial.NormalsMultiplier = -1.0f;
+	floorMaterial.TwoSided = true;
 
 	glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.0));
 	model = glm::scale(model, glm::vec3(12.5f, 12.5f, 12.5f));
-	shader.SetUniform1f("uNormalsMultiplier", -1.0f);
-	shader.SetUniform1f("uTexTiling", 4.0f);
-	glDisable(GL_CULL_FACE);
-	FLOOR_MODEL.Draw(shader, model);
-	glEnable(GL_CULL_FACE);
-	shader.SetUniform1f("uTexTiling", 1.0f);
-	shader.SetUniform1f("uNormalsMultiplier", 1.0f);
+	mDrawQueue.Submit(FLOOR_MODEL, model, floorMaterial);
 
+	// the bobbing sphere is the dynamic shadow caster of the scene
 	model = glm::mat4(1.0f);
-	model = glm::translate(model, glm::vec3(0.0f, -11.5f, -5.0f));
-	SPHERE_MODEL.Draw(shader, model);
+	model = glm::translate(model, glm::vec3(0.0f, -11.5f + 0.5f * std::sin(2.0f * Time::LastFrame), -5.0f));
+	mDrawQueue.Submit(SPHERE_MODEL, model, {}, DrawQueue::Opaque, DrawQueue::Dynamic);
 
-	if (shaderInstanced)
+	for (size_t i = 0; i < BACKPACK_POSITIONS.size(); i++)
 	{
-		shaderInstanced->Bind();
-		BACKPACK_MODEL.DrawInstanced(*shaderInstanced, BACKPACK_POSITIONS.size());
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), BACKPACK_POSITIONS[i]);
+		model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+		mDrawQueue.Submit(BACKPACK_MODEL, model);
 	}
-	else
+
+	if (mDrawSponza)
+	{
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -12.5f, 0.0f));
+		model = glm::scale(model, glm::vec3(0.008f));
+		mDrawQueue.Submit(SPONZA_MODEL, model);
+	}
+
+	if (mDrawPropGrid)
+	{
+		// crates and spheres alternate, so the submission order interleaves materials
+		for (size_t i = 0; i < PROP_POSITIONS.size(); i++)
+		{
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), PROP_POSITIONS[i]);
+			model = glm::scale(model, glm::vec3(0.25f));
+			mDrawQueue.Submit(i % 2 == 0 ? CUBE_MODEL : SPHERE_MODEL, model);
+		}
+	}
+
+	if (mDrawParallaxProps)
 	{
-		for (int i = 0; i < BACKPACK_POSITIONS.size(); i++)
+		Core::Material parallaxMaterial;
+		parallaxMaterial.ConeStepMap = mParallaxConeStepMap;
+		for (const glm::vec3& position : PARALLAX_PROP_POSITIONS)
 		{
-			glm::mat4 model = glm::translate(glm::mat4(1.0f), BACKPACK_POSITIONS[i]);
-			model = glm::scale(model, glm::vec3(0.5f));
-			BACKPACK_MODEL.Draw(shader, model);
+			glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+			model = glm::scale(model, glm::vec3(0.75f));
+			mDrawQueue.Submit(PARALLAX_MODEL, model, parallaxMaterial);
 		}
 	}
 }
 
+void Graphics::Engine::DrawScene(
+	ShaderProgram& shader,
+	ShaderProgram* const shaderInstanced,
+	const Frustum* frustum,
+	unsigned int mobilityMask
+)
+{
+	mDrawQueue.Flush(shader, shaderInstanced, DrawQueue::Opaque, frustum, mobilityMask);
+}
+
+void Graphics::Engine::PrepareGBufferPrograms()
+{
+	// parallax needs the view position, materials without a specular map use a constant
+	auto setUniforms = [this](ShaderProgram& program, bool parallax, bool constantSpecular) {
+		program.Bind();
+		program.SetUniformMat4("uViewProjection", glm::value_ptr(mViewProjection));
+		program.SetUniformMat4("uPrevViewProjection", glm::value_ptr(mPrevViewProjection));
+		program.SetUniformMat4("uJitteredViewProjection", glm::value_ptr(mJitteredViewProjection));
+		if (parallax)
+		{
+			program.SetUniformVec3("uViewPos", glm::value_ptr(mCamera.GetWorldPosition()));
+			program.SetUniform1i("uConeStepMapping", mConeStepMapping);
+		}
+		if (constantSpecular)
+		{
+			program.SetUniformVec3("uMaterial.specular", glm::value_ptr(glm::vec3(0.1f)));
+		}
+	};
+
+	if (!mShaderPermutations)
+	{
+		setUniforms(mGBufferUberShaderProgram, true, true);
+		setUniforms(mGBufferUberInstancedShaderProgram, true, true);
+		return;
+	}
+
+	// the variants the queued meshes need are built here rather than in the middle of the draws,
+	// so every one of them has this frame's uniforms
+	uint64_t featureSets = mDrawQueue.GetShaderFeatureSets();
+	for (unsigned int features = 0; features < 64; features++)
+	{
+		if ((featureSets >> features) & 1)
+		{
+			bool parallax = (features & Mesh::HeightTextureFeature) != 0;
+			bool constantSpecular = (features & Mesh::SpecularTextureFeature) == 0;
+			setUniforms(mGBufferPermutations.Get(features), parallax, constantSpecular);
+			setUniforms(mGBufferInstancedPermutations.Get(features), parallax, constantSpecular);
+		}
+	}
+}
+
+bool Graphics::Engine::UpdateDepthPrepass()
+{
+	// both counters run in the same frames, so equal result counts are from the same frame
+	unsigned int numResults = mGeometrySampleCounter.GetNumResults();
+	if (numResults == mPrepassSampleCounter.GetNumResults() && numResults != mNumOverdrawResults)
+	{
+		mNumOverdrawResults = numResults;
+		unsigned long long numCovered = mGeometrySampleCounter.GetNumSamples();
+		if (numCovered > 0)
+		{
+			mMeasuredOverdraw = static_cast<float>(mPrepassSampleCounter.GetNumSamples()) / static_cast<float>(numCovered);
+			if (mMeasuredOverdraw > DEPTH_PREPASS_ENABLE_OVERDRAW)
+			{
+				mAutoDepthPrepass = true;
+			}
+			else if (mMeasuredOverdraw < DEPTH_PREPASS_DISABLE_OVERDRAW)
+			{
+				mAutoDepthPrepass = false;
+			}
+		}
+	}
+
+	switch (mDepthPrepassMode)
+	{
+	case NoDepthPrepass:
+		return false;
+	case AlwaysDepthPrepass:
+		return true;
+	default:
+		break;
+	}
+
+	mFramesSinceOverdrawProbe++;
+	if (mAutoDepthPrepass || mFramesSinceOverdrawProbe >= OVERDRAW_PROBE_INTERVAL)
+	{
+		mFramesSinceOverdrawProbe = 0;
+		return true;
+	}
+	return false;
+}
+
+void Graphics::Engine::DepthPrepass()
+{
+	mDepthPrepassTimer.Begin();
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+	// the samples passing here are the fragments the G-buffer pass would shade without the prepass
+	mPrepassSampleCounter.Begin();
+	// the shadow mapping vertex shaders and the G-buffer ones compute the position with the same expression from
+	// the same matrices and declare it invariant, so the G-buffer pass can test the depth for equality
+	mDirectionalShadowMappingShaderProgram.Bind();
+	mDirectionalShadowMappingShaderProgram.SetUniformMat4("uLightSpaceMatrix", glm::value_ptr(mJitteredViewProjection));
+	mDirectionalShadowMappingInstancedShaderProgram.Bind();
+	mDirectionalShadowMappingInstancedShaderProgram.SetUniformMat4("uLightSpaceMatrix", glm::value_ptr(mJitteredViewProjection));
+	DrawScene(mDirectionalShadowMappingShaderProgram, &mDirectionalShadowMappingInstancedShaderProgram);
+	mPrepassSampleCounter.End();
+
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	mDepthPrepassTimer.End();
+}
+
+void Graphics::Engine::OverdrawPass()
+{
+	mOverdrawFrameBuffer.Bind();
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	// repeats the depth test of the G-buffer pass: against the prepass depth, or building up the depth as it draws
+	if (mDepthPrepassActive)
+	{
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, mGFrameBuffer.GetFrameBufferId());
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mOverdrawFrameBuffer.GetFrameBufferId());
+		glBlitFramebuffer(0, 0, mRenderWidth, mRenderHeight, 0, 0, mRenderWidth, mRenderHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+		mOverdrawFrameBuffer.Bind();
+		glDepthFunc(GL_EQUAL);
+		glDepthMask(GL_FALSE);
+	}
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE);
+
+	mOverdrawShaderProgram.Bind();
+	mOverdrawShaderProgram.SetUniformMat4("uLightSpaceMatrix", glm::value_ptr(mJitteredViewProjection));
+	mOverdrawInstancedShaderProgram.Bind();
+	mOverdrawInstancedShaderProgram.SetUniformMat4("uLightSpaceMatrix", glm::value_ptr(mJitteredViewProjection));
+	DrawScene(mOverdrawShaderProgram, &mOverdrawInstancedShaderProgram);
+
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDisable(GL_BLEND);
+	glDepthFunc(GL_LESS);
+	glDepthMask(GL_TRUE);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
 void Graphics::Engine::SetupScene(
 	const glm::mat4& view,
 	const glm::mat4& projection
@@ -754,22 +2240,30 @@ void Graphics::Engine::SetupScene(
 	glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(projection));
 	glBindBuffer(GL_UNIFORM_BUFFER, 0);
 
-	mGBufferShaderProgram.Bind();
-	mGBufferShaderProgram.SetUniformVec3("uViewPos", glm::value_ptr(mCamera.GetWorldPosition()));
-	mGBufferShaderProgram.SetUniformVec3("uMaterial.specular", glm::value_ptr(glm::vec3(0.1f)));
-
 	mDeferredShaderProgram.Bind();
 	mDeferredShaderProgram.SetUniformVec3("uViewPos", glm::value_ptr(mCamera.GetWorldPosition()));
 	mDeferredShaderProgram.SetUniform1f("uMaterial.shininess", shininess);
 
-	mDeferredShaderProgram.SetUniform1i("uNumDirLights", 0);
-	mDeferredShaderProgram.SetUniformMat4("uDirLights[0].lightSpaceMat", glm::value_ptr(DIR_LIGHT_SPACE_MAT));
+	mDeferredShaderProgram.SetUniform1i("uNumDirLights", 1);
+	mDeferredShaderProgram.SetUniformVec3("uViewForward", glm::value_ptr(mCamera.GetForwardDirection()));
+	mDeferredShaderProgram.SetUniform1i("uNumCascades", mCascadedShadowMap.GetNumCascades());
+	mDeferredShaderProgram.SetUniform1i("uShadowFilter", mShadowFilter);
+	for (unsigned int i = 0; i < mCascadedShadowMap.GetNumCascades(); i++)
+	{
+		const CascadedShadowMap::Cascade& cascade = mCascadedShadowMap.GetCascade(i);
+		// one and a half texels of world space in depth units of the cascade
+		float bias = 1.5f * cascade.TexelWorldSize / cascade.DepthRange;
+		mDeferredShaderProgram.SetUniformMat4(std::format("uCascadeMatrices[{}]", i), glm::value_ptr(cascade.LightSpaceMatrix));
+		mDeferredShaderProgram.SetUniform1f(std::format("uCascadeSplits[{}]", i), cascade.SplitFar);
+		mDeferredShaderProgram.SetUniform1f(std::format("uCascadeBiases[{}]", i), bias);
+	}
 	mDeferredShaderProgram.SetUniformVec3("uDirLights[0].direction", glm::value_ptr(LIGHT_DIRECTION));
 	mDeferredShaderProgram.SetUniformVec3("uDirLights[0].ambient", glm::value_ptr(ambientColor));
 	mDeferredShaderProgram.SetUniformVec3("uDirLights[0].diffuse", glm::value_ptr(diffuseColor));
 	mDeferredShaderProgram.SetUniformVec3("uDirLights[0].specular", glm::value_ptr(specularColor));
 
 	mDeferredShaderProgram.SetUniform1i("uNumPointLights", NUM_POINT_LIGHTS);
+	mDeferredShaderProgram.SetUniform1i("uPointShadowHardwareDepth", mPointShadowHardwareDepth);
 	for (int i = 0; i < NUM_POINT_LIGHTS; i++)
 	{
 		glm::vec3 ambientColor = glm::vec3(0.025f) * POINT_LIGHT_COLORS[i];
@@ -790,7 +2284,26 @@ void Graphics::Engine::SetupScene(
 		mDeferredShaderProgram.SetUniform1f(std::format("uPointLights[{}].linear", i), linear);
 		mDeferredShaderProgram.SetUniform1f(std::format("uPointLights[{}].quadratic", i), quadratic);
 		mDeferredShaderProgram.SetUniform1f(std::format("uPointLights[{}].radius", i), radius);
-		mDeferredShaderProgram.SetUniform1f(std::format("uPointLights[{}].farPlane", i), 100.0f);
+		mDeferredShaderProgram.SetUniform1f(std::format("uPointLights[{}].nearPlane", i), POINT_SHADOW_NEAR_PLANE);
+		mDeferredShaderProgram.SetUniform1f(std::format("uPointLights[{}].farPlane", i), POINT_SHADOW_FAR_PLANE);
+	}
+
+	mDeferredShaderProgram.SetUniform1i("uNumAtlasLights", mDrawAtlasLights ? static_cast<int>(mAtlasLights.size()) : 0);
+	if (mDrawAtlasLights)
+	{
+		std::vector<AtlasLightData> atlasLights(mAtlasLights.size());
+		for (unsigned int i = 0; i < mAtlasLights.size(); i++)
+		{
+			atlasLights[i].PositionRadius = glm::vec4(mAtlasLights[i].Position, mAtlasLights[i].Radius);
+			atlasLights[i].Color = glm::vec4(ATLAS_LIGHT_COLORS[i], 1.0f);
+			for (unsigned int face = 0; face < 6; face++)
+			{
+				atlasLights[i].FaceRects[face] = mShadowAtlas.GetFaceRect(i, face);
+			}
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, mUBOAtlasLights);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, atlasLights.size() * sizeof(AtlasLightData), atlasLights.data());
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
 	}
 
 	//mSkyboxShaderProgram.Bind();
@@ -865,25 +2378,63 @@ void Graphics::Engine::DrawModels(
 	}
 }
 
-void Graphics::Engine::DrawTransparentModels(const std::vector<std::shared_ptr<Model>>& models, ShaderProgram& shader)
+void Graphics::Engine::BeginTransparentDrawQueue()
 {
-	shader.Bind();
+	mTransparentDrawQueue.Clear();
+	mTransparentDrawQueue.SetView(mCamera.GetWorldPosition(), mCamera.GetForwardDirection(), CAMERA_FAR_PLANE, glm::radians(mCamera.GetZoom()));
+}
 
-	std::map<float, std::shared_ptr<Model>> sorted;
-	for (unsigned int i = 0; i < models.size(); i++)
+void Graphics::Engine::SetNumTransparentProps(unsigned int numProps)
+{
+	// a square grid of small spheres centred on the origin, just above the floor
+	mTransparentPropPositions.clear();
+	mTransparentPropPositions.reserve(numProps);
+	int gridSize = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(numProps))));
+	float spacing = 0.3f;
+	float offset = -0.5f * spacing * (gridSize - 1);
+	for (unsigned int i = 0; i < numProps; i++)
 	{
-		Core::Transform transform = models[i]->GetTransform();
-		glm::vec3 v = mCamera.GetWorldPosition() - transform.Position;
-		float distanceSquared = glm::dot(v, v);
-		sorted[distanceSquared] = models[i];
+		int x = static_cast<int>(i) % gridSize;
+		int z = static_cast<int>(i) / gridSize;
+		mTransparentPropPositions.push_back(glm::vec3(offset + x * spacing, -11.0f, offset + z * spacing));
 	}
 
-	for (auto it = sorted.rbegin(); it != sorted.rend(); it++)
+	mTransparentDrawQueue.Reserve(numProps * SPHERE_MODEL.GetMeshes().size());
+}
+
+void Graphics::Engine::SetTransparencyMode(TransparencyMode mode)
+{
+	// sorted blending needs every mesh drawn back-to-front on its own, the weighted blend is order
+	// independent, so the packets stay unsorted and repeated meshes collapse into instanced draws
+	mTransparencyMode = mode;
+	mTransparentDrawQueue.SetSortingEnabled(mode == SortedBlending);
+	mTransparentDrawQueue.SetBatchingEnabled(mode == WeightedBlendedOIT);
+}
+
+void Graphics::Engine::SubmitTransparentProps(DrawQueue& queue)
+{
+	for (const glm::vec3& position : mTransparentPropPositions)
 	{
-		it->second->Draw(shader);
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+		model = glm::scale(model, glm::vec3(0.1f));
+		queue.Submit(SPHERE_MODEL, model, {}, DrawQueue::Transparent);
 	}
 }
 
+void Graphics::Engine::DrawTransparentModels(const std::vector<std::shared_ptr<Model>>& models, ShaderProgram& shader)
+{
+	shader.Bind();
+
+	// every mesh is sorted back-to-front on its own view depth, ties keep the order of the models
+	BeginTransparentDrawQueue();
+	for (const std::shared_ptr<Model>& model : models)
+	{
+		mTransparentDrawQueue.Submit(*model, model->GetModelMatrix(), {}, DrawQueue::Transparent);
+	}
+
+	mTransparentDrawQueue.Flush(shader, nullptr, DrawQueue::Transparent);
+}
+
 unsigned int Graphics::Engine::LoadTexture(const char* path, bool flip, bool srgb)
 {
 	unsigned int textureId = GLLoadTextureFromFile(path, flip, srgb);
@@ -4,8 +4,11 @@
 #include <glad/glad.h>
 #include <string>
 #include <unordered_map>
+#include <functional>
+#include <initializer_list>
 #include "CoreTypes.h"
 #include "ShaderProgram.h"
+#include "ShaderPermutations.h"
 #include "Camera.h"
 #include "Model.h"
 #include "FrameBuffer.h"
@@ -14,6 +17,18 @@
 #include "DepthMap.h"
 #include "GFrameBuffer.h"
 #include "SSAOFrameBuffer.h"
+#include "BloomMipChain.h"
+#include "SMAAFrameBuffer.h"
+#include "AutoExposure.h"
+#include "DrawQueue.h"
+#include "OITFrameBuffer.h"
+#include "GpuTimer.h"
+#include "SampleCounter.h"
+#include "DynamicResolution.h"
+#include "CascadedShadowMap.h"
+#include "PointShadowCache.h"
+#include "ShadowAtlas.h"
+#include "MomentShadowMap.h"
 
 struct GLFWwindow;
 
@@ -22,6 +37,36 @@ namespace Graphics
 	class Engine
 	{
 	public:
+		enum TransparencyMode
+		{
+			SortedBlending = 0, WeightedBlendedOIT
+		};
+
+		enum PointShadowMode
+		{
+			GeometryShaderPointShadows = 0, PerFacePointShadows, LayeredPointShadows
+		};
+
+		enum ShadowFilter
+		{
+			PCFShadowFilter = 0, EVSMShadowFilter
+		};
+
+		enum AmbientOcclusionTechnique
+		{
+			KernelSSAOTechnique = 0, GTAOTechnique
+		};
+
+		enum PostAAMode
+		{
+			NoPostAA = 0, FXAAPostAA, SMAAPostAA
+		};
+
+		enum DepthPrepassMode
+		{
+			NoDepthPrepass = 0, AlwaysDepthPrepass, AutoDepthPrepass
+		};
+
 		Engine(const int windowWidth, const int windowHeight, const char* title);
 
 		Engine(const Engine& other) = delete;
@@ -31,8 +76,9 @@ namespace Graphics
 
 		static inline Engine* GetInstance() { return mInstance; }
 
-		bool Init(bool vsync, bool windowedFullscreen);
+		bool Init(bool vsync, bool windowedFullscreen, bool headless = false);
 		void Run();
+		void RunBenchmark(const std::string& name);
 		void Update();
 		void UpdateTimer();
 
@@ -42,10 +88,49 @@ namespace Graphics
 		virtual void OnMouseMove(float xpos, float ypos);
 		virtual void OnMouseScroll(float xOffset, float yOffset);
 
+		// renders the scene below the window resolution when the GPU frame time goes over the target
+		void SetDynamicResolution(bool enabled, float targetFrameMs, float minScale, float maxScale);
+		// the chosen scales are written to this file as CSV when Run() returns
+		inline void SetResolutionLogPath(const std::string& path) { mResolutionLogPath = path; }
+
 	private:
-		void DrawScene(ShaderProgram& shader, ShaderProgram* const shaderInstanced);
+		// compiles, or loads from the binary cache, every program and sets the uniforms that never change
+		void BuildShaderPrograms();
+		void BuildDrawQueue();
+		void DrawScene(
+			ShaderProgram& shader,
+			ShaderProgram* const shaderInstanced,
+			const Frustum* frustum = nullptr,
+			unsigned int mobilityMask = DrawQueue::AnyMobility
+		);
 		void SetupScene(const glm::mat4& view, const glm::mat4& projection);
+		void PrepareGBufferPrograms();
+		// picks whether this frame gets the depth prepass, from the mode and the last overdraw measurement
+		bool UpdateDepthPrepass();
+		void DepthPrepass();
+		// counts the fragments the G-buffer pass shaded per pixel, for the heat map
+		void OverdrawPass();
 		void ShadowPass();
+		void SetPointShadowUniforms(const glm::vec3& lightPosition, float farPlane);
+		void SetPointShadowMode(PointShadowMode mode);
+		void SetPointShadowDepth(bool hardwareDepth, DepthMap::DepthMapFormat format, unsigned int resolution);
+		void DrawPointShadowCasters(unsigned int mobilityMask);
+		void UpdateAtlasLights();
+		void PrefilterShadowPass();
+		void SetShadowFilter(ShadowFilter filter);
+		void ShadowAtlasPass();
+		void TransparentPass();
+		void CreateRenderTargets(int width, int height);
+		void SetSSAODownsample(unsigned int downsample);
+		void SSAOPass();
+		void BloomPass(unsigned int sceneTextureId, const glm::vec2& sceneScale);
+		void TAAPass();
+		void PostAAPass();
+		void AutoExposurePass(unsigned int sceneTextureId, const glm::vec2& sceneScale);
+		void SetTemporalAA(bool enabled);
+		void UpdateRenderScale();
+		void SetTemporalSSAO(bool enabled);
+		bool SetDrawSponza(bool draw);
 		void ImportModels(
 			const std::vector<Core::ModelImport>& imports,
 			std::vector<std::shared_ptr<Model>>* models
@@ -60,6 +145,103 @@ namespace Graphics
 			ShaderProgram& shader
 		);
 		unsigned int LoadTexture(const char* path, bool flip = false, bool srgb = false);
+		bool IsKeyPressed(int key);
+		void RenderFrames(unsigned int numFrames);
+
+		void BeginTransparentDrawQueue();
+		void SetNumTransparentProps(unsigned int numProps);
+		void SubmitTransparentProps(DrawQueue& queue);
+		void SetTransparencyMode(TransparencyMode mode);
+
+		// the settings the benchmarks change, RunBenchmark puts them back once a benchmark returns
+		struct BenchmarkState
+		{
+			int WindowWidth, WindowHeight;
+			bool AnimateLights;
+			bool DrawPropGrid;
+			bool DrawParallaxProps;
+			bool DrawSponza;
+			bool DrawAtlasLights;
+			bool Batching;
+			bool Sorting;
+			bool LodSelection;
+			TransparencyMode Transparency;
+			size_t NumTransparentProps;
+			bool TriangleSorting;
+			unsigned int CascadeResolution;
+			unsigned int NumCascades;
+			PointShadowMode PointShadows;
+			bool PointShadowCaching;
+			bool PointShadowHardwareDepth;
+			DepthMap::DepthMapFormat PointShadowFormat;
+			unsigned int PointShadowResolution;
+			ShadowFilter Filter;
+			unsigned int AtlasUpdateBudget;
+			unsigned int SSAODownsample;
+			bool TemporalSSAO;
+			AmbientOcclusionTechnique AOTechnique;
+			unsigned int SSAOKernelStride;
+			int GTAOSlices, GTAOSteps;
+			bool DynamicResolution;
+			float TargetFrameMs, MinScale, MaxScale;
+			bool TemporalAA;
+			PostAAMode PostAA;
+			bool AutoExposure;
+			bool ShaderPermutations;
+			bool ConeStepMapping;
+			DepthPrepassMode DepthPrepass;
+			bool BinaryCache;
+			bool DeferredBuilds;
+			bool Spirv;
+		};
+		BenchmarkState SaveBenchmarkState() const;
+		void RestoreBenchmarkState(const BenchmarkState& state);
+		// Renders the warm-up frames, then numFrames more with renderFrame, or RenderFrames(1) without one, and resolves
+		// the timers after each. Returns the average time of every timer in ms over the measured frames, a frame
+		// a timer did not run in adds nothing to it.
+		std::vector<double> MeasureGpuMs(
+			std::initializer_list<GpuTimer*> timers,
+			unsigned int numFrames,
+			const std::function<void()>& renderFrame = nullptr,
+			unsigned int numWarmupFrames = BENCHMARK_WARMUP_FRAMES
+		);
+		double MeasureGpuMs(
+			GpuTimer& timer,
+			unsigned int numFrames,
+			const std::function<void()>& renderFrame = nullptr,
+			unsigned int numWarmupFrames = BENCHMARK_WARMUP_FRAMES
+		);
+		void BenchmarkBatching();
+		void BenchmarkSorting();
+		void BenchmarkTransparencySorting();
+		void BenchmarkTransparency();
+		void BenchmarkCascadedShadows();
+		void BenchmarkPointShadowCache();
+		void BenchmarkPointShadows();
+		void BenchmarkShadowAtlas();
+		void BenchmarkShadowFiltering();
+		void BenchmarkPointShadowDepth();
+		void BenchmarkSSAO();
+		void BenchmarkTemporalSSAO();
+		void BenchmarkAmbientOcclusion();
+		void BenchmarkBloom();
+		void BenchmarkDynamicResolution();
+		void BenchmarkTemporalAA();
+		void BenchmarkPostAA();
+		void BenchmarkAutoExposure();
+		void BenchmarkShaderPermutations();
+		void BenchmarkShaderCache();
+		void BenchmarkShaderCompile();
+		void BenchmarkSpirv();
+		void BenchmarkDepthPrepass();
+		void BenchmarkConeStepMapping();
+		void BenchmarkLod();
+
+		static constexpr float CAMERA_NEAR_PLANE = 0.1f;
+		static constexpr float CAMERA_FAR_PLANE = 500.0f;
+		static constexpr unsigned int BENCHMARK_WARMUP_FRAMES = 10;
+		// the temporal SSAO evaluates every n-th kernel sample per frame and covers the kernel over n frames
+		static constexpr unsigned int SSAO_TEMPORAL_STRIDE = 8;
 
 		static Engine* mInstance;
 
@@ -81,36 +263,176 @@ namespace Graphics
 		ShaderProgram mDirectionalShadowMappingInstancedShaderProgram;
 		ShaderProgram mPointShadowMappingShaderProgram;
 		ShaderProgram mPointShadowMappingInstancedShaderProgram;
+		ShaderProgram mPointShadowFaceShaderProgram;
+		ShaderProgram mPointShadowFaceInstancedShaderProgram;
+		ShaderProgram mPointShadowLayeredShaderProgram;
+		ShaderProgram mPointShadowLayeredInstancedShaderProgram;
+		ShaderProgram mPointShadowMappingHardwareShaderProgram;
+		ShaderProgram mPointShadowMappingHardwareInstancedShaderProgram;
+		ShaderProgram mPointShadowFaceHardwareShaderProgram;
+		ShaderProgram mPointShadowFaceHardwareInstancedShaderProgram;
+		ShaderProgram mPointShadowLayeredHardwareShaderProgram;
+		ShaderProgram mPointShadowLayeredHardwareInstancedShaderProgram;
 		ShaderProgram mGaussianBlurShaderProgram;
 		ShaderProgram mSSAOShaderProgram;
 		ShaderProgram mSSAOBlurShaderProgram;
+		ShaderProgram mSSAODownsampleShaderProgram;
+		ShaderProgram mSSAODepthShaderProgram;
+		ShaderProgram mSSAOUpsampleShaderProgram;
+		ShaderProgram mSSAOTemporalShaderProgram;
+		ShaderProgram mSSAODenoiseShaderProgram;
+		ShaderProgram mGTAOShaderProgram;
+		ShaderProgram mBloomDownsampleShaderProgram;
+		ShaderProgram mBloomUpsampleShaderProgram;
+		ShaderProgram mEVSMMomentsShaderProgram;
+		ShaderProgram mTAAShaderProgram;
+		ShaderProgram mFXAAShaderProgram;
+		ShaderProgram mSMAAEdgesShaderProgram;
+		ShaderProgram mSMAAWeightsShaderProgram;
+		ShaderProgram mSMAABlendShaderProgram;
+		ShaderProgram mLuminanceHistogramShaderProgram;
+		ShaderProgram mExposureAdaptShaderProgram;
+		ShaderProgram mOverdrawShaderProgram;
+		ShaderProgram mOverdrawInstancedShaderProgram;
+		ShaderProgram mOverdrawHeatmapShaderProgram;
 
-		ShaderProgram mGBufferShaderProgram;
-		ShaderProgram mGBufferInstancedShaderProgram;
+		// one G-buffer variant per set of material textures, the uber-shader branches on uniforms instead
+		ShaderPermutations mGBufferPermutations;
+		ShaderPermutations mGBufferInstancedPermutations;
+		ShaderProgram mGBufferUberShaderProgram;
+		ShaderProgram mGBufferUberInstancedShaderProgram;
+		bool mShaderPermutations;
+		// steps the materials with a baked cone step map by their cones, by fixed layers otherwise
+		bool mConeStepMapping;
 		ShaderProgram mDeferredShaderProgram;
+		ShaderProgram mTransparentShaderProgram;
+		ShaderProgram mTransparentInstancedShaderProgram;
+		ShaderProgram mOITCompositeShaderProgram;
 
 		FrameBuffer mDeferredLightingFrameBuffer;
 		GFrameBuffer mGFrameBuffer;
 		SSAOFrameBuffer mSSAOFrameBuffer;
 		SSAOFrameBuffer mSSAOBlurFrameBuffer;
+		SSAOFrameBuffer mSSAODepthNormalFrameBuffer;
+		SSAOFrameBuffer mSSAOLowResFrameBuffer;
+		SSAOFrameBuffer mSSAOLowResBlurFrameBuffer;
+		// 1 for full resolution SSAO, 2 or 4 for half or quarter resolution with a bilateral upsample
+		unsigned int mSSAODownsample;
+		// a few kernel samples per frame, accumulated into a history reprojected with the previous view-projection
+		bool mTemporalSSAO;
+		SSAOFrameBuffer mSSAOHistoryFrameBuffers[2];
+		unsigned int mSSAOHistoryIndex;
+		bool mSSAOHistoryValid;
+		unsigned int mSSAOFrameIndex;
+		AmbientOcclusionTechnique mAOTechnique;
+		// quality knobs: every n-th kernel sample, GTAO slices and horizon steps per side
+		unsigned int mSSAOKernelStride;
+		int mGTAOSlices;
+		int mGTAOSteps;
+		OITFrameBuffer mOITFrameBuffer;
+		BloomMipChain mBloomMipChain;
+		// the scene passes render into the lower left render size part of the screen targets,
+		// the post-processing stretches it over the window
+		DynamicResolution mDynamicResolution;
+		int mRenderWidth, mRenderHeight;
+		glm::vec2 mRenderScale;
+		glm::vec2 mPrevRenderScale;
+		// strength of the sharpening applied by the upscale, 0 for plain bilinear
+		float mUpscaleSharpness;
+		std::string mResolutionLogPath;
+		// the projection is jittered by a sub-pixel offset every frame, the resolve blends the lit scene
+		// into a window resolution history reprojected with the G-buffer velocity
+		bool mTemporalAA;
+		FrameBuffer mTAAHistoryFrameBuffers[2];
+		unsigned int mTAAHistoryIndex;
+		bool mTAAHistoryValid;
+		unsigned int mTAAFrameIndex;
+		// in NDC units
+		glm::vec2 mTAAJitter;
+		// morphological anti-aliasing on the tone mapped image, the post-processing renders into
+		// mPostAAFrameBuffer first and the last pass of the mode writes the window
+		PostAAMode mPostAAMode;
+		FrameBuffer mPostAAFrameBuffer;
+		SMAAFrameBuffer mSMAAFrameBuffer;
+		// the exposure follows the average luminance of a histogram of the lit scene, sampled on a coarse grid
+		bool mAutoExposure;
+		AutoExposure mAutoExposureTargets;
+		int mExposureGridWidth, mExposureGridHeight;
+		// a depth only pass with the shadow mapping programs lets the G-buffer pass shade each pixel once,
+		// the auto mode runs it while the measured overdraw is high
+		DepthPrepassMode mDepthPrepassMode;
+		bool mDepthPrepassActive;
+		bool mAutoDepthPrepass;
+		// fragments passing the depth test of the prepass per fragment shaded by the G-buffer pass after it
+		float mMeasuredOverdraw;
+		unsigned int mNumOverdrawResults;
+		// with the prepass off nothing measures the overdraw, every so often a frame runs it anyway
+		unsigned int mFramesSinceOverdrawProbe;
+		SampleCounter mPrepassSampleCounter;
+		SampleCounter mGeometrySampleCounter;
+		bool mShowOverdraw;
+		FrameBuffer mOverdrawFrameBuffer;
 
 		ScreenQuad mScreenQuad;
 		CubeMap mCubemap;
-		DepthMap mDirectionalDepthMap;
-		DepthMap mPointDepthMap;
+		CascadedShadowMap mCascadedShadowMap;
+		MomentShadowMap mCascadeMoments;
+		ShadowFilter mShadowFilter;
+		PointShadowCache mPointShadowCache;
+		PointShadowMode mPointShadowMode;
+		bool mSupportsVertexLayer;
+		// the point shadow maps keep the rasterized depth instead of a linear distance written from the fragment shader
+		bool mPointShadowHardwareDepth;
+		glm::mat4 mPointShadowMatrices[6];
+		ShadowAtlas mShadowAtlas;
+		std::vector<ShadowAtlas::Light> mAtlasLights;
+		bool mDrawAtlasLights;
+
+		DrawQueue mDrawQueue;
+		DrawQueue mTransparentDrawQueue;
+		std::vector<glm::vec3> mTransparentPropPositions;
+		TransparencyMode mTransparencyMode;
+		GpuTimer mTransparencyTimer;
+		GpuTimer mDirectionalShadowTimer;
+		GpuTimer mPointShadowTimer;
+		GpuTimer mShadowAtlasTimer;
+		GpuTimer mShadowPrefilterTimer;
+		GpuTimer mLightingTimer;
+		GpuTimer mSSAOTimer;
+		GpuTimer mBloomTimer;
+		GpuTimer mGeometryTimer;
+		GpuTimer mDepthPrepassTimer;
+		GpuTimer mTAATimer;
+		GpuTimer mPostAATimer;
+		GpuTimer mExposureTimer;
+		// timestamps around the whole frame, the other timers nest inside it
+		GpuTimer mFrameTimer;
+		unsigned int mNumFrameTimes;
+		double mTransparencyCpuMs;
 
 		Camera mCamera;
+		glm::mat4 mViewProjection;
+		glm::mat4 mPrevViewProjection;
+		// what the scene is rasterized with, the jitter included
+		glm::mat4 mJitteredViewProjection;
 		std::unordered_map<std::string, unsigned int> mLoadedTextures;
 
 		Core::Texture mDefaultTexture;
 
 		float mLastMouseXPos, mLastMouseYPos;
 		bool mIsFirstMouseMove;
+		bool mDrawPropGrid;
+		bool mDrawParallaxProps;
+		// false when the cone step map couldn't be baked and the props fell back to the plain height map
+		bool mParallaxConeStepMap;
+		bool mDrawSponza;
+		bool mAnimateLights;
+		std::unordered_map<int, bool> mKeyStates;
+		// the next presented frame is written here, then cleared
+		std::string mScreenshotPath;
 
 		unsigned int mUBOMatrices;
-
-		unsigned int mPingPongFrameBuffers[2];
-		unsigned int mPingPongColorBuffers[2];
+		unsigned int mUBOAtlasLights;
 		unsigned int mNoiseTexture;
 	};
 }
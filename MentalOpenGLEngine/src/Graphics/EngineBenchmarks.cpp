@@ -0,0 +1,1338 @@
+#include "Engine.h"
+
+#include <iostream>
+#include <format>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <map>
+#include <cmath>
+#include "RadixSort.h"
+#include "ProgramBinaryCache.h"
+#include "Shader.h"
+#include "ConeStepMap.h"
+#include "External/stb_image.h"
+
+// reads the first channel of a float texture
+static void ReadTexture(unsigned int textureId, std::vector<float>& data)
+{
+	glBindTexture(GL_TEXTURE_2D, textureId);
+	glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, data.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// the curve of the post-processing pass with its default exposure and gamma, maps HDR values to [0, 1]
+static void ToneMap(std::vector<float>& data)
+{
+	for (float& value : data)
+	{
+		value = std::pow(1.0f - std::exp(-value), 1.0f / 2.2f);
+	}
+}
+
+// error metrics of a single channel [0, 1] image against a reference of the same size
+static std::string FormatImageError(const std::vector<float>& image, const std::vector<float>& reference)
+{
+	double absoluteError = 0.0;
+	double squaredError = 0.0;
+	size_t numVisibleErrors = 0;
+	for (size_t i = 0; i < image.size(); i++)
+	{
+		double error = std::abs(static_cast<double>(image[i]) - reference[i]);
+		absoluteError += error;
+		squaredError += error * error;
+		numVisibleErrors += error > 0.05 ? 1 : 0;
+	}
+	double meanSquaredError = squaredError / image.size();
+	double psnr = meanSquaredError > 0.0 ? 10.0 * std::log10(1.0 / meanSquaredError) : INFINITY;
+	return std::format(
+		"MAE {:.4f}, RMSE {:.4f}, PSNR {:.1f} dB, {:.2f}% of pixels off by more than 0.05",
+		absoluteError / image.size(), std::sqrt(meanSquaredError), psnr, 100.0 * numVisibleErrors / image.size()
+	);
+}
+
+void Graphics::Engine::RunBenchmark(const std::string& name)
+{
+	static const std::unordered_map<std::string, void (Engine::*)()> benchmarks{
+		{ "batching", &Engine::BenchmarkBatching },
+		{ "sorting", &Engine::BenchmarkSorting },
+		{ "transparency-sorting", &Engine::BenchmarkTransparencySorting },
+		{ "transparency", &Engine::BenchmarkTransparency },
+		{ "cascaded-shadows", &Engine::BenchmarkCascadedShadows },
+		{ "point-shadow-cache", &Engine::BenchmarkPointShadowCache },
+		{ "point-shadows", &Engine::BenchmarkPointShadows },
+		{ "shadow-atlas", &Engine::BenchmarkShadowAtlas },
+		{ "shadow-filtering", &Engine::BenchmarkShadowFiltering },
+		{ "point-shadow-depth", &Engine::BenchmarkPointShadowDepth },
+		{ "ssao", &Engine::BenchmarkSSAO },
+		{ "ssao-temporal", &Engine::BenchmarkTemporalSSAO },
+		{ "ambient-occlusion", &Engine::BenchmarkAmbientOcclusion },
+		{ "bloom", &Engine::BenchmarkBloom },
+		{ "dynamic-resolution", &Engine::BenchmarkDynamicResolution },
+		{ "taa", &Engine::BenchmarkTemporalAA },
+		{ "post-aa", &Engine::BenchmarkPostAA },
+		{ "auto-exposure", &Engine::BenchmarkAutoExposure },
+		{ "shader-permutations", &Engine::BenchmarkShaderPermutations },
+		{ "shader-cache", &Engine::BenchmarkShaderCache },
+		{ "shader-compile", &Engine::BenchmarkShaderCompile },
+		{ "spirv", &Engine::BenchmarkSpirv },
+		{ "depth-prepass", &Engine::BenchmarkDepthPrepass },
+		{ "cone-step-mapping", &Engine::BenchmarkConeStepMapping },
+		{ "lod", &Engine::BenchmarkLod },
+	};
+
+	auto it = benchmarks.find(name);
+	if (it == benchmarks.end())
+	{
+		std::cout << "Unknown benchmark '" << name << "'. Available benchmarks:" << std::endl;
+		for (const auto& benchmark : benchmarks)
+		{
+			std::cout << "  " << benchmark.first << std::endl;
+		}
+		return;
+	}
+
+	BenchmarkState state = SaveBenchmarkState();
+	(this->*it->second)();
+	RestoreBenchmarkState(state);
+}
+
+Graphics::Engine::BenchmarkState Graphics::Engine::SaveBenchmarkState() const
+{
+	BenchmarkState state{};
+	state.WindowWidth = mWindowWidth;
+	state.WindowHeight = mWindowHeight;
+	state.AnimateLights = mAnimateLights;
+	state.DrawPropGrid = mDrawPropGrid;
+	state.DrawParallaxProps = mDrawParallaxProps;
+	state.DrawSponza = mDrawSponza;
+	state.DrawAtlasLights = mDrawAtlasLights;
+	state.Batching = mDrawQueue.IsBatchingEnabled();
+	state.Sorting = mDrawQueue.IsSortingEnabled();
+	state.LodSelection = mDrawQueue.IsLodSelectionEnabled();
+	state.Transparency = mTransparencyMode;
+	state.NumTransparentProps = mTransparentPropPositions.size();
+	state.TriangleSorting = mTransparentDrawQueue.IsTriangleSortingEnabled();
+	state.CascadeResolution = mCascadedShadowMap.GetResolution();
+	state.NumCascades = mCascadedShadowMap.GetNumCascades();
+	state.PointShadows = mPointShadowMode;
+	state.PointShadowCaching = mPointShadowCache.IsCachingEnabled();
+	state.PointShadowHardwareDepth = mPointShadowHardwareDepth;
+	state.PointShadowFormat = mPointShadowCache.GetFormat();
+	state.PointShadowResolution = mPointShadowCache.GetResolution();
+	state.Filter = mShadowFilter;
+	state.AtlasUpdateBudget = mShadowAtlas.GetUpdateBudget();
+	state.SSAODownsample = mSSAODownsample;
+	state.TemporalSSAO = mTemporalSSAO;
+	state.AOTechnique = mAOTechnique;
+	state.SSAOKernelStride = mSSAOKernelStride;
+	state.GTAOSlices = mGTAOSlices;
+	state.GTAOSteps = mGTAOSteps;
+	state.DynamicResolution = mDynamicResolution.IsEnabled();
+	state.TargetFrameMs = mDynamicResolution.GetTargetFrameMs();
+	state.MinScale = mDynamicResolution.GetMinScale();
+	state.MaxScale = mDynamicResolution.GetMaxScale();
+	state.TemporalAA = mTemporalAA;
+	state.PostAA = mPostAAMode;
+	state.AutoExposure = mAutoExposure;
+	state.ShaderPermutations = mShaderPermutations;
+	state.ConeStepMapping = mConeStepMapping;
+	state.DepthPrepass = mDepthPrepassMode;
+	state.BinaryCache = ProgramBinaryCache::IsEnabled();
+	state.DeferredBuilds = ShaderProgram::AreBuildsDeferred();
+	state.Spirv = Shader::IsSpirvEnabled();
+	return state;
+}
+
+void Graphics::Engine::RestoreBenchmarkState(const BenchmarkState& state)
+{
+	// only what changed is rebuilt, most benchmarks touch a few of the settings
+	if (mWindowWidth != state.WindowWidth || mWindowHeight != state.WindowHeight)
+	{
+		CreateRenderTargets(state.WindowWidth, state.WindowHeight);
+	}
+	glViewport(0, 0, mWindowWidth, mWindowHeight);
+
+	mAnimateLights = state.AnimateLights;
+	mDrawPropGrid = state.DrawPropGrid;
+	mDrawParallaxProps = state.DrawParallaxProps;
+	if (mDrawSponza != state.DrawSponza)
+	{
+		SetDrawSponza(state.DrawSponza);
+	}
+	mDrawAtlasLights = state.DrawAtlasLights;
+	mDrawQueue.SetBatchingEnabled(state.Batching);
+	mDrawQueue.SetSortingEnabled(state.Sorting);
+	mDrawQueue.SetLodSelectionEnabled(state.LodSelection);
+
+	SetTransparencyMode(state.Transparency);
+	if (mTransparentPropPositions.size() != state.NumTransparentProps)
+	{
+		SetNumTransparentProps(static_cast<unsigned int>(state.NumTransparentProps));
+	}
+	mTransparentDrawQueue.SetTriangleSortingEnabled(state.TriangleSorting);
+
+	if (mCascadedShadowMap.GetResolution() != state.CascadeResolution || mCascadedShadowMap.GetNumCascades() != state.NumCascades)
+	{
+		mCascadedShadowMap.Build(state.CascadeResolution, state.NumCascades);
+	}
+	if (mPointShadowMode != state.PointShadows)
+	{
+		SetPointShadowMode(state.PointShadows);
+	}
+	mPointShadowCache.SetCachingEnabled(state.PointShadowCaching);
+	if (mPointShadowHardwareDepth != state.PointShadowHardwareDepth || mPointShadowCache.GetFormat() != state.PointShadowFormat ||
+		mPointShadowCache.GetResolution() != state.PointShadowResolution)
+	{
+		SetPointShadowDepth(state.PointShadowHardwareDepth, state.PointShadowFormat, state.PointShadowResolution);
+	}
+	if (mShadowFilter != state.Filter)
+	{
+		SetShadowFilter(state.Filter);
+	}
+	mShadowAtlas.SetUpdateBudget(state.AtlasUpdateBudget);
+
+	if (mSSAODownsample != state.SSAODownsample)
+	{
+		SetSSAODownsample(state.SSAODownsample);
+	}
+	if (mTemporalSSAO != state.TemporalSSAO)
+	{
+		SetTemporalSSAO(state.TemporalSSAO);
+	}
+	mAOTechnique = state.AOTechnique;
+	mSSAOKernelStride = state.SSAOKernelStride;
+	mGTAOSlices = state.GTAOSlices;
+	mGTAOSteps = state.GTAOSteps;
+
+	SetDynamicResolution(state.DynamicResolution, state.TargetFrameMs, state.MinScale, state.MaxScale);
+	if (mTemporalAA != state.TemporalAA)
+	{
+		SetTemporalAA(state.TemporalAA);
+	}
+	mPostAAMode = state.PostAA;
+	mAutoExposure = state.AutoExposure;
+	mShaderPermutations = state.ShaderPermutations;
+	mConeStepMapping = state.ConeStepMapping;
+	mDepthPrepassMode = state.DepthPrepass;
+
+	// the programs were last built with the settings of the benchmark
+	if (ProgramBinaryCache::IsEnabled() != state.BinaryCache || ShaderProgram::AreBuildsDeferred() != state.DeferredBuilds ||
+		Shader::IsSpirvEnabled() != state.Spirv)
+	{
+		ProgramBinaryCache::SetEnabled(state.BinaryCache);
+		ShaderProgram::SetDeferredBuilds(state.DeferredBuilds);
+		Shader::SetSpirvEnabled(state.Spirv);
+		BuildShaderPrograms();
+	}
+}
+
+std::vector<double> Graphics::Engine::MeasureGpuMs(
+	std::initializer_list<GpuTimer*> timers,
+	unsigned int numFrames,
+	const std::function<void()>& renderFrame,
+	unsigned int numWarmupFrames
+)
+{
+	RenderFrames(numWarmupFrames);
+	// results of the warm-up frames still in flight would be taken for the first measured frame
+	for (GpuTimer* timer : timers)
+	{
+		timer->Resolve(true);
+	}
+
+	std::vector<double> totalMs(timers.size(), 0.0);
+	std::vector<unsigned int> numResults(timers.size());
+	for (unsigned int i = 0; i < numFrames; i++)
+	{
+		size_t t = 0;
+		for (GpuTimer* timer : timers)
+		{
+			numResults[t++] = timer->GetNumResults();
+		}
+
+		if (renderFrame)
+		{
+			renderFrame();
+		}
+		else
+		{
+			RenderFrames(1);
+		}
+
+		t = 0;
+		for (GpuTimer* timer : timers)
+		{
+			timer->Resolve(true);
+			totalMs[t] += timer->GetNumResults() != numResults[t] ? timer->GetElapsedMs() : 0.0;
+			t++;
+		}
+	}
+
+	for (double& ms : totalMs)
+	{
+		ms /= std::max(numFrames, 1u);
+	}
+	return totalMs;
+}
+
+double Graphics::Engine::MeasureGpuMs(GpuTimer& timer, unsigned int numFrames, const std::function<void()>& renderFrame, unsigned int numWarmupFrames)
+{
+	return MeasureGpuMs({ &timer }, numFrames, renderFrame, numWarmupFrames)[0];
+}
+
+void Graphics::Engine::BenchmarkBatching()
+{
+	mDrawPropGrid = true;
+
+	for (bool batching : { false, true })
+	{
+		mDrawQueue.SetBatchingEnabled(batching);
+		RenderFrames(BENCHMARK_WARMUP_FRAMES);
+
+		const DrawQueue::Stats& stats = mDrawQueue.GetStats();
+		std::cout << std::format(
+			"Batching {}: {} mesh items, {} draw calls per frame ({} instanced) over all passes\n",
+			batching ? "on " : "off", stats.NumItems, stats.NumDrawCalls, stats.NumInstancedDrawCalls
+		);
+	}
+}
+
+void Graphics::Engine::BenchmarkSorting()
+{
+	constexpr size_t numPackets = 100000;
+	constexpr int numRuns = 20;
+
+	std::mt19937_64 generator;
+	std::vector<SortItem> packets(numPackets), items, scratch;
+	for (size_t i = 0; i < numPackets; i++)
+	{
+		packets[i] = { generator(), static_cast<uint32_t>(i) };
+	}
+
+	auto measure = [&](const char* name, auto sort) {
+		double totalMs = 0.0;
+		for (int run = 0; run < numRuns; run++)
+		{
+			items = packets;
+			auto start = std::chrono::high_resolution_clock::now();
+			sort();
+			auto end = std::chrono::high_resolution_clock::now();
+			totalMs += std::chrono::duration<double, std::milli>(end - start).count();
+		}
+		double ms = totalMs / numRuns;
+		std::cout << std::format("{}: {:.3f} ms per {} packets, {:.1f} Mpackets/s\n", name, ms, numPackets, numPackets / ms / 1000.0);
+	};
+
+	measure("Radix sort, 1 thread", [&]() { RadixSort(items, scratch, 1); });
+	measure("Radix sort, all threads", [&]() { RadixSort(items, scratch); });
+	measure("std::sort", [&]() {
+		std::sort(items.begin(), items.end(), [](const SortItem& a, const SortItem& b) { return a.Key < b.Key; });
+	});
+
+	mDrawPropGrid = true;
+	mDrawQueue.SetBatchingEnabled(false);
+	for (bool sorting : { false, true })
+	{
+		mDrawQueue.SetSortingEnabled(sorting);
+		RenderFrames(BENCHMARK_WARMUP_FRAMES);
+
+		const DrawQueue::Stats& stats = mDrawQueue.GetStats();
+		std::cout << std::format(
+			"Sorting {}: {} draw calls, {} program changes, {} material changes, {} mesh changes per frame\n",
+			sorting ? "on " : "off", stats.NumDrawCalls, stats.NumProgramChanges, stats.NumMaterialChanges, stats.NumMeshChanges
+		);
+	}
+}
+
+void Graphics::Engine::BenchmarkTransparencySorting()
+{
+	constexpr unsigned int numObjects = 10000;
+	constexpr int numRuns = 20;
+
+	// the grid is symmetric around the origin, so mirrored props are at exactly the same distance from a centred viewer,
+	// which is what the old map keyed by distance collapsed into a single object
+	SetNumTransparentProps(numObjects);
+	SetTransparencyMode(SortedBlending);
+	glm::vec3 viewPosition = mCamera.GetWorldPosition();
+
+	double mapMs = 0.0;
+	size_t numKept = 0;
+	for (int run = 0; run < numRuns; run++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		std::map<float, size_t> sortedByDistance;
+		for (size_t i = 0; i < mTransparentPropPositions.size(); i++)
+		{
+			glm::vec3 v = viewPosition - mTransparentPropPositions[i];
+			sortedByDistance[glm::dot(v, v)] = i;
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		mapMs += std::chrono::duration<double, std::milli>(end - start).count();
+		numKept = sortedByDistance.size();
+	}
+	std::cout << std::format("std::map by distance: {:.3f} ms, kept {} of {} objects\n", mapMs / numRuns, numKept, numObjects);
+
+	// submitting computes the view depth of every mesh, like filling the map does above
+	double queueMs = 0.0;
+	for (int run = 0; run < numRuns; run++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		BeginTransparentDrawQueue();
+		SubmitTransparentProps(mTransparentDrawQueue);
+		mTransparentDrawQueue.Prepare();
+		auto end = std::chrono::high_resolution_clock::now();
+		queueMs += std::chrono::duration<double, std::milli>(end - start).count();
+	}
+	std::cout << std::format("Draw queue submit and radix sort: {:.3f} ms\n", queueMs / numRuns);
+
+	// looking straight down -z from the centre of the grid, every row of props is at the same view depth,
+	// and the props mirrored across the centre of a row are at the same distance
+	mTransparentDrawQueue.Clear();
+	mTransparentDrawQueue.SetView(glm::vec3(0.0f, -10.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), CAMERA_FAR_PLANE, glm::radians(mCamera.GetZoom()));
+	SubmitTransparentProps(mTransparentDrawQueue);
+	unsigned int numSubmitted = mTransparentDrawQueue.GetStats().NumItems;
+	unsigned int numProps = static_cast<unsigned int>(mTransparentPropPositions.size());
+
+	std::vector<DrawQueue::Packet> packets;
+	mTransparentDrawQueue.GetDrawOrder(DrawQueue::Transparent, packets);
+
+	std::vector<unsigned int> timesDrawn(numSubmitted, 0u);
+	unsigned int numOutOfRange = 0;
+	unsigned int numDepthIncreases = 0;
+	unsigned int numTies = 0;
+	unsigned int numUnstableTies = 0;
+	for (size_t i = 0; i < packets.size(); i++)
+	{
+		if (packets[i].SubmissionIndex < numSubmitted)
+		{
+			timesDrawn[packets[i].SubmissionIndex]++;
+		}
+		else
+		{
+			numOutOfRange++;
+		}
+
+		if (i > 0)
+		{
+			const DrawQueue::Packet& previous = packets[i - 1];
+			numDepthIncreases += packets[i].Depth > previous.Depth ? 1 : 0;
+			if (packets[i].Depth == previous.Depth)
+			{
+				numTies++;
+				numUnstableTies += packets[i].SubmissionIndex < previous.SubmissionIndex ? 1 : 0;
+			}
+		}
+	}
+	unsigned int numMissing = static_cast<unsigned int>(std::count(timesDrawn.begin(), timesDrawn.end(), 0u));
+	unsigned int numDuplicated = static_cast<unsigned int>(std::count_if(timesDrawn.begin(), timesDrawn.end(), [](unsigned int n) { return n > 1; }));
+
+	// every prop submits the same meshes, so each of them has to show up as whole props' worth of packets
+	bool passed = numSubmitted >= numProps && numSubmitted % numProps == 0 && packets.size() == numSubmitted &&
+		numOutOfRange == 0 && numMissing == 0 && numDuplicated == 0 && numDepthIncreases == 0 && numTies > 0 && numUnstableTies == 0;
+	std::cout << std::format(
+		"Draw order of {} packets: {} missing or unknown, {} drawn more than once, {} depth increases, "
+		"{} of {} equal depth pairs out of submission order: {}\n",
+		numSubmitted, numMissing + numOutOfRange, numDuplicated, numDepthIncreases, numUnstableTies, numTies, passed ? "PASS" : "FAIL"
+	);
+}
+
+void Graphics::Engine::BenchmarkTransparency()
+{
+	constexpr unsigned int numFrames = 30;
+
+	for (unsigned int numObjects : { 256u, 1024u, 4096u, 16384u })
+	{
+		SetNumTransparentProps(numObjects);
+		for (TransparencyMode mode : { SortedBlending, WeightedBlendedOIT })
+		{
+			SetTransparencyMode(mode);
+			double cpuMs = 0.0;
+			double gpuMs = MeasureGpuMs(mTransparencyTimer, numFrames, [&]() {
+				RenderFrames(1);
+				cpuMs += mTransparencyCpuMs;
+			});
+
+			std::cout << std::format(
+				"{:>6} objects, {:<20}: cpu {:.3f} ms, gpu {:.3f} ms, {} draw calls\n",
+				numObjects, mode == SortedBlending ? "sorted blending" : "weighted blended OIT",
+				cpuMs / numFrames, gpuMs, mTransparentDrawQueue.GetStats().NumDrawCalls
+			);
+		}
+	}
+
+	// per-triangle sorting fixes the order within each sphere, only sorted blending draws the meshes one by one
+	SetNumTransparentProps(256);
+	SetTransparencyMode(SortedBlending);
+	for (bool sortTriangles : { false, true })
+	{
+		mTransparentDrawQueue.SetTriangleSortingEnabled(sortTriangles);
+		double cpuMs = 0.0;
+		double gpuMs = MeasureGpuMs(mTransparencyTimer, numFrames, [&]() {
+			RenderFrames(1);
+			cpuMs += mTransparencyCpuMs;
+		});
+
+		unsigned int numSorts = mTransparentDrawQueue.GetStats().NumTriangleSorts;
+		std::cout << std::format(
+			"   256 objects, triangle sorting {:<3}: cpu {:.3f} ms, gpu {:.3f} ms, {} meshes sorted per frame\n",
+			sortTriangles ? "on" : "off", cpuMs / numFrames, gpuMs, numSorts
+		);
+		if (sortTriangles && numSorts == 0)
+		{
+			std::cout << "Error: No transparent mesh had its triangles sorted" << std::endl;
+		}
+	}
+}
+
+void Graphics::Engine::BenchmarkCascadedShadows()
+{
+	constexpr unsigned int numFrames = 30;
+	constexpr unsigned int resolution = 2048;
+	mDrawPropGrid = true;
+
+	float fovY = glm::radians(mCamera.GetZoom());
+	float fullRadius = CascadedShadowMap::GetSliceRadius(CAMERA_NEAR_PLANE, mCascadedShadowMap.GetShadowDistance(), fovY, mAspectRatio);
+
+	for (unsigned int numCascades = 1; numCascades <= CascadedShadowMap::MAX_CASCADES; numCascades++)
+	{
+		mCascadedShadowMap.Build(resolution, numCascades);
+		double gpuMs = MeasureGpuMs(mDirectionalShadowTimer, numFrames);
+
+		// a single map needs the texel density of the nearest cascade over the whole shadow distance
+		float nearestTexelSize = mCascadedShadowMap.GetCascade(0).TexelWorldSize;
+		unsigned int equivalentResolution = static_cast<unsigned int>(std::ceil(2.0f * fullRadius / nearestTexelSize));
+		double equivalentMb = static_cast<double>(equivalentResolution) * equivalentResolution * sizeof(float) / (1024.0 * 1024.0);
+
+		std::cout << std::format(
+			"{} cascade(s) of {}^2: shadow pass {:.3f} ms, {:.1f} MB, nearest texel {:.4f} m, {} casters culled | single map of equal quality: {}^2, {:.1f} MB\n",
+			numCascades, resolution, gpuMs,
+			mCascadedShadowMap.GetMemorySize() / (1024.0 * 1024.0), nearestTexelSize, mDrawQueue.GetStats().NumCulledItems,
+			equivalentResolution, equivalentMb
+		);
+	}
+}
+
+void Graphics::Engine::BenchmarkPointShadowCache()
+{
+	constexpr unsigned int numFrames = 30;
+
+	for (bool caching : { false, true })
+	{
+		mPointShadowCache.SetCachingEnabled(caching);
+		for (bool animateLights : { true, false })
+		{
+			mAnimateLights = animateLights;
+			unsigned int numStaticUpdates = 0;
+			double gpuMs = MeasureGpuMs(mPointShadowTimer, numFrames, [&]() {
+				RenderFrames(1);
+				numStaticUpdates += mPointShadowCache.GetStats().NumStaticUpdates;
+			});
+
+			std::cout << std::format(
+				"Caching {}, {:<10} light: point shadow pass {:.3f} ms, {} static cache updates in {} frames\n",
+				caching ? "on " : "off", animateLights ? "moving" : "stationary",
+				gpuMs, numStaticUpdates, numFrames
+			);
+		}
+	}
+}
+
+void Graphics::Engine::BenchmarkPointShadows()
+{
+	constexpr unsigned int numFrames = 30;
+
+	// the cache would hide the cost of the static casters, the light keeps moving through the scene
+	mPointShadowCache.SetCachingEnabled(false);
+	mAnimateLights = true;
+	mDrawPropGrid = true;
+
+	for (PointShadowMode mode : { GeometryShaderPointShadows, PerFacePointShadows, LayeredPointShadows })
+	{
+		if (mode == LayeredPointShadows && !mSupportsVertexLayer)
+		{
+			std::cout << "Layered per-face point shadows skipped, no vertex stage gl_Layer support" << std::endl;
+			continue;
+		}
+
+		SetPointShadowMode(mode);
+		double gpuMs = MeasureGpuMs(mPointShadowTimer, numFrames);
+
+		const DrawQueue::Stats& stats = mDrawQueue.GetStats();
+		std::cout << std::format(
+			"Point shadow pass {:.3f} ms, {} draw calls and {} culled packets per frame over all passes\n",
+			gpuMs, stats.NumDrawCalls, stats.NumCulledItems
+		);
+	}
+}
+
+void Graphics::Engine::BenchmarkShadowAtlas()
+{
+	constexpr unsigned int numFrames = 60;
+	constexpr unsigned int cubeMapResolution = 2048;
+
+	// what the same lights would take with a float cube map each, like the main point light
+	size_t numLights = mAtlasLights.size();
+	double cubeMapsMb = static_cast<double>(numLights) * 6.0 * cubeMapResolution * cubeMapResolution * sizeof(float) / (1024.0 * 1024.0);
+	std::cout << std::format(
+		"{} shadowed point lights: atlas {}^2 16-bit {:.1f} MB | {} cube maps of {}^2: {:.1f} MB\n",
+		numLights, mShadowAtlas.GetSize(), mShadowAtlas.GetMemorySize() / (1024.0 * 1024.0), numLights, cubeMapResolution, cubeMapsMb
+	);
+
+	auto measure = [&](const std::string& name) {
+		double frameMs = 0.0;
+		unsigned int numUpdates = 0, numDeferredUpdates = 0, numEvictions = 0;
+		double atlasMs = MeasureGpuMs(mShadowAtlasTimer, numFrames, [&]() {
+			auto start = std::chrono::high_resolution_clock::now();
+			RenderFrames(1);
+			glFinish();
+			auto end = std::chrono::high_resolution_clock::now();
+			frameMs += std::chrono::duration<double, std::milli>(end - start).count();
+
+			if (mDrawAtlasLights)
+			{
+				const ShadowAtlas::Stats& stats = mShadowAtlas.GetStats();
+				numUpdates += stats.NumUpdates;
+				numDeferredUpdates += stats.NumDeferredUpdates;
+				numEvictions += stats.NumEvictions;
+			}
+		});
+
+		const ShadowAtlas::Stats& stats = mShadowAtlas.GetStats();
+		std::cout << std::format(
+			"{:<24}: frame {:.3f} ms, atlas pass {:.3f} ms, {:.1f} light updates and {:.1f} deferred per frame, {} evictions, {} shadowed, {} unshadowed, tiles",
+			name, frameMs / numFrames, atlasMs,
+			static_cast<double>(numUpdates) / numFrames, static_cast<double>(numDeferredUpdates) / numFrames,
+			numEvictions, stats.NumShadowed, stats.NumUnshadowed
+		);
+		for (unsigned int size = 512, i = 0; size >= 32; size /= 2, i++)
+		{
+			std::cout << std::format(" {}:{}", size, stats.NumTilesPerSize[i]);
+		}
+		std::cout << std::endl;
+	};
+
+	mAnimateLights = true;
+	mDrawAtlasLights = false;
+	measure("No atlas lights");
+
+	mDrawAtlasLights = true;
+	for (unsigned int budget : { 2u, 8u, 64u })
+	{
+		mShadowAtlas.SetUpdateBudget(budget);
+		measure(std::format("Update budget {}", budget));
+	}
+}
+
+void Graphics::Engine::BenchmarkShadowFiltering()
+{
+	constexpr unsigned int numFrames = 30;
+
+	// a still point light and the crate grid, so the two images differ only in the directional shadows
+	mAnimateLights = false;
+	mDrawPropGrid = true;
+
+	for (ShadowFilter filter : { PCFShadowFilter, EVSMShadowFilter })
+	{
+		SetShadowFilter(filter);
+		// only the EVSM filter runs the prefilter pass
+		std::vector<double> gpuMs = MeasureGpuMs({ &mLightingTimer, &mDirectionalShadowTimer, &mShadowPrefilterTimer }, numFrames);
+
+		const char* name = filter == PCFShadowFilter ? "pcf" : "evsm";
+		std::string imagePath = std::format("shadow_filter_{}.ppm", name);
+		mScreenshotPath = imagePath;
+		RenderFrames(1);
+
+		double memoryMb = (mCascadedShadowMap.GetMemorySize() + (filter == EVSMShadowFilter ? mCascadeMoments.GetMemorySize() : 0)) / (1024.0 * 1024.0);
+		std::cout << std::format(
+			"{:<4}: lighting pass {:.3f} ms, cascades {:.3f} ms, prefilter {:.3f} ms, shadow memory {:.1f} MB, image {}\n",
+			name, gpuMs[0], gpuMs[1], gpuMs[2], memoryMb, imagePath
+		);
+	}
+}
+
+void Graphics::Engine::BenchmarkPointShadowDepth()
+{
+	constexpr unsigned int numFrames = 30;
+
+	// every frame redraws all casters into all six faces, so the pass time is dominated by fill
+	mPointShadowCache.SetCachingEnabled(false);
+	mAnimateLights = true;
+	mDrawPropGrid = true;
+
+	struct DepthConfig
+	{
+		const char* Name;
+		bool HardwareDepth;
+		DepthMap::DepthMapFormat Format;
+	};
+	const DepthConfig configs[]{
+		{ "linear distance 32-bit", false, DepthMap::Depth32 },
+		{ "hardware depth 32-bit", true, DepthMap::Depth32 },
+		{ "hardware depth 16-bit", true, DepthMap::Depth16 },
+	};
+
+	for (unsigned int resolution : { 1024u, 2048u, 4096u })
+	{
+		for (const DepthConfig& config : configs)
+		{
+			SetPointShadowDepth(config.HardwareDepth, config.Format, resolution);
+			double gpuMs = MeasureGpuMs(mPointShadowTimer, numFrames);
+
+			std::cout << std::format(
+				"{}^2 {:<22}: point shadow pass {:.3f} ms, {:.1f} MB for the static and the composed cube map\n",
+				resolution, config.Name, gpuMs, mPointShadowCache.GetMemorySize() / (1024.0 * 1024.0)
+			);
+		}
+	}
+}
+
+void Graphics::Engine::BenchmarkSSAO()
+{
+	constexpr unsigned int numRuns = 30;
+
+	mAnimateLights = false;
+	mDrawPropGrid = true;
+
+	const glm::ivec2 resolutions[]{ { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 } };
+	for (const glm::ivec2& resolution : resolutions)
+	{
+		CreateRenderTargets(resolution.x, resolution.y);
+		RenderFrames(BENCHMARK_WARMUP_FRAMES);
+
+		// every mode runs on the G-buffer of the last frame, so the images differ only by the SSAO resolution
+		std::vector<float> reference;
+		std::vector<float> occlusion(static_cast<size_t>(resolution.x) * resolution.y);
+		for (unsigned int downsample : { 1u, 2u, 4u })
+		{
+			SetSSAODownsample(downsample);
+			double gpuMs = MeasureGpuMs(mSSAOTimer, numRuns, [this]() { SSAOPass(); }, 0);
+
+			ReadTexture(mSSAOBlurFrameBuffer.GetTextureColorId(), occlusion);
+			std::string errorText = "reference";
+			if (downsample == 1)
+			{
+				reference = occlusion;
+			}
+			else
+			{
+				errorText = FormatImageError(occlusion, reference);
+			}
+
+			std::cout << std::format(
+				"{}x{} SSAO 1/{}: {:.3f} ms, {}\n",
+				resolution.x, resolution.y, downsample, gpuMs, errorText
+			);
+		}
+	}
+}
+
+void Graphics::Engine::BenchmarkTemporalSSAO()
+{
+	constexpr unsigned int numRuns = 30;
+
+	mAnimateLights = false;
+	mDrawPropGrid = true;
+	SetSSAODownsample(1);
+	SetTemporalSSAO(false);
+	RenderFrames(BENCHMARK_WARMUP_FRAMES);
+
+	// the G-buffer and the camera stay fixed, so the accumulation sees a static scene
+	std::vector<float> reference(static_cast<size_t>(mWindowWidth) * mWindowHeight);
+	std::vector<float> occlusion(reference.size());
+	auto ssaoPass = [this]() { SSAOPass(); };
+
+	double referenceMs = MeasureGpuMs(mSSAOTimer, numRuns, ssaoPass, 0);
+	ReadTexture(mSSAOBlurFrameBuffer.GetTextureColorId(), reference);
+	std::cout << std::format("{}x{} SSAO full kernel per frame: {:.3f} ms\n", mWindowWidth, mWindowHeight, referenceMs);
+
+	SetTemporalSSAO(true);
+	unsigned int numAccumulated = 0;
+	for (unsigned int numFrames : { 1u, SSAO_TEMPORAL_STRIDE, 2u * SSAO_TEMPORAL_STRIDE, 8u * SSAO_TEMPORAL_STRIDE })
+	{
+		double gpuMs = MeasureGpuMs(mSSAOTimer, numFrames - numAccumulated, ssaoPass, 0);
+		numAccumulated = numFrames;
+		ReadTexture(mSSAOBlurFrameBuffer.GetTextureColorId(), occlusion);
+		std::cout << std::format(
+			"{}x{} temporal SSAO 1/{} of the kernel per frame, after {:>2} frames: {:.3f} ms, {}\n",
+			mWindowWidth, mWindowHeight, SSAO_TEMPORAL_STRIDE, numFrames, gpuMs, FormatImageError(occlusion, reference)
+		);
+	}
+}
+
+void Graphics::Engine::BenchmarkAmbientOcclusion()
+{
+	constexpr unsigned int numRuns = 30;
+
+	struct AOConfig
+	{
+		const char* Name;
+		AmbientOcclusionTechnique Technique;
+		unsigned int KernelStride;
+		int Slices;
+		int Steps;
+		// the first config of each technique is its converged reference
+		bool IsReference;
+	};
+	const AOConfig configs[]{
+		{ "kernel 64 samples", KernelSSAOTechnique, 1, 0, 0, true },
+		{ "kernel 32 samples", KernelSSAOTechnique, 2, 0, 0, false },
+		{ "kernel 16 samples", KernelSSAOTechnique, 4, 0, 0, false },
+		{ "kernel 8 samples", KernelSSAOTechnique, 8, 0, 0, false },
+		{ "GTAO 16x16", GTAOTechnique, 1, 16, 16, true },
+		{ "GTAO 1x4", GTAOTechnique, 1, 1, 4, false },
+		{ "GTAO 2x4", GTAOTechnique, 1, 2, 4, false },
+		{ "GTAO 4x4", GTAOTechnique, 1, 4, 4, false },
+		{ "GTAO 4x8", GTAOTechnique, 1, 4, 8, false },
+	};
+
+	mAnimateLights = false;
+	SetSSAODownsample(1);
+	SetTemporalSSAO(false);
+
+	for (bool sponza : { true, false })
+	{
+		if (sponza && !SetDrawSponza(true))
+		{
+			std::cout << "Sponza is not available, skipping it" << std::endl;
+			continue;
+		}
+		mDrawPropGrid = !sponza;
+		RenderFrames(BENCHMARK_WARMUP_FRAMES);
+
+		// quality is the error against the converged result of the same technique, both run on the G-buffer of the last frame
+		std::vector<float> reference(static_cast<size_t>(mWindowWidth) * mWindowHeight);
+		std::vector<float> occlusion(reference.size());
+		for (const AOConfig& config : configs)
+		{
+			mAOTechnique = config.Technique;
+			mSSAOKernelStride = config.KernelStride;
+			mGTAOSlices = config.Slices;
+			mGTAOSteps = config.Steps;
+			double gpuMs = MeasureGpuMs(mSSAOTimer, numRuns, [this]() { SSAOPass(); }, 0);
+
+			ReadTexture(mSSAOBlurFrameBuffer.GetTextureColorId(), config.IsReference ? reference : occlusion);
+			std::cout << std::format(
+				"{} {:<17}: {:.3f} ms, {}\n",
+				sponza ? "sponza" : "scene ", config.Name, gpuMs,
+				config.IsReference ? "reference" : FormatImageError(occlusion, reference)
+			);
+		}
+
+		SetDrawSponza(false);
+	}
+}
+
+void Graphics::Engine::BenchmarkBloom()
+{
+	constexpr unsigned int numFrames = 30;
+	constexpr double megabyte = 1024.0 * 1024.0;
+
+	const glm::ivec2 resolutions[]{ { 1920, 1080 }, { 2560, 1440 }, { 3840, 2160 } };
+	for (const glm::ivec2& resolution : resolutions)
+	{
+		CreateRenderTargets(resolution.x, resolution.y);
+		double gpuMs = MeasureGpuMs(mBloomTimer, numFrames);
+
+		// the lit scene is RGBA16F; the replaced blur wrote a bright copy of it from the lighting pass,
+		// then ran ten full resolution passes between two more RGBA16F targets
+		constexpr size_t sceneBytesPerTexel = 8;
+		size_t screenBytes = size_t(resolution.x) * resolution.y * sceneBytesPerTexel;
+		size_t pingPongBytesPerFrame = screenBytes + 10 * 2 * screenBytes;
+		std::cout << std::format(
+			"{}x{} bloom: {:.3f} ms, {} levels, {:.1f} MB of targets, ~{:.1f} MB moved per frame "
+			"(ping-pong blur: {:.1f} MB of targets, ~{:.1f} MB per frame)\n",
+			resolution.x, resolution.y, gpuMs, mBloomMipChain.GetNumMips(),
+			mBloomMipChain.GetMemorySize() / megabyte,
+			mBloomMipChain.GetBytesPerFrame(resolution.x, resolution.y, sceneBytesPerTexel) / megabyte,
+			3 * screenBytes / megabyte, pingPongBytesPerFrame / megabyte
+		);
+	}
+}
+
+void Graphics::Engine::BenchmarkDynamicResolution()
+{
+	constexpr unsigned int numFrames = 60;
+	constexpr unsigned int numControlledFrames = 240;
+	float initialTargetMs = mDynamicResolution.GetTargetFrameMs();
+
+	// fixed scales first, they show how much of the frame follows the pixel count
+	double nativeMs = 0.0;
+	for (float scale : { 1.0f, 0.75f, 0.5f })
+	{
+		SetDynamicResolution(scale < 1.0f, initialTargetMs, scale, scale);
+		double frameMs = MeasureGpuMs(mFrameTimer, numFrames);
+		nativeMs = scale == 1.0f ? frameMs : nativeMs;
+		std::cout << std::format("fixed scale {:.2f}: {:.3f} ms GPU frame\n", scale, frameMs);
+	}
+
+	// a target the full resolution frame misses, the controller has to find the scale that meets it
+	float targetMs = static_cast<float>(nativeMs * 0.7);
+	SetDynamicResolution(true, targetMs, 0.5f, 1.0f);
+	mDynamicResolution.ClearLog();
+	RenderFrames(numControlledFrames);
+
+	// the second half, after the controller settled
+	const std::vector<DynamicResolution::Sample>& log = mDynamicResolution.GetLog();
+	size_t first = log.size() / 2;
+	double gpuMs = 0.0;
+	float minScale = 1.0f;
+	float maxScale = 0.0f;
+	unsigned int numChanges = 0;
+	for (size_t i = first; i < log.size(); i++)
+	{
+		gpuMs += log[i].GpuMs;
+		minScale = std::min(minScale, log[i].Scale);
+		maxScale = std::max(maxScale, log[i].Scale);
+		numChanges += i > first && log[i].Scale != log[i - 1].Scale;
+	}
+	size_t numSamples = std::max(log.size() - first, size_t(1));
+	std::cout << std::format(
+		"dynamic resolution, {:.3f} ms target: {:.3f} ms GPU frame, scale {:.2f} to {:.2f}, final {:.2f}, "
+		"{} changes over the last {} measurements\n",
+		targetMs, gpuMs / numSamples, minScale, maxScale, mDynamicResolution.GetScale(), numChanges, numSamples
+	);
+
+	if (!mResolutionLogPath.empty())
+	{
+		mDynamicResolution.WriteLog(mResolutionLogPath);
+	}
+}
+
+void Graphics::Engine::BenchmarkTemporalAA()
+{
+	constexpr unsigned int numFrames = 30;
+	constexpr unsigned int convergenceFrames[]{ 1, 2, 4, 8, 16, 32, 64 };
+	int width = mWindowWidth;
+	int height = mWindowHeight;
+
+	// nothing may move, the remaining error is then the aliasing TAA is meant to remove
+	mAnimateLights = false;
+	mDynamicResolution.SetEnabled(false);
+	SetTemporalAA(false);
+
+	// the reference has four samples per pixel on an ordered grid: a twice as large frame, box filtered down
+	CreateRenderTargets(width * 2, height * 2);
+	RenderFrames(BENCHMARK_WARMUP_FRAMES);
+	std::vector<float> supersampled(size_t(width) * height * 4);
+	ReadTexture(mDeferredLightingFrameBuffer.GetTextureColorId(), supersampled);
+	std::vector<float> reference(size_t(width) * height);
+	for (int y = 0; y < height; y++)
+	{
+		for (int x = 0; x < width; x++)
+		{
+			size_t topLeft = size_t(y) * 2 * width * 2 + size_t(x) * 2;
+			size_t bottomLeft = topLeft + size_t(width) * 2;
+			reference[size_t(y) * width + x] = 0.25f * (
+				supersampled[topLeft] + supersampled[topLeft + 1] + supersampled[bottomLeft] + supersampled[bottomLeft + 1]
+			);
+		}
+	}
+	ToneMap(reference);
+	CreateRenderTargets(width, height);
+
+	std::vector<float> image(size_t(width) * height);
+	RenderFrames(BENCHMARK_WARMUP_FRAMES);
+	ReadTexture(mDeferredLightingFrameBuffer.GetTextureColorId(), image);
+	ToneMap(image);
+	std::cout << std::format("no AA against 4x supersampling: {}\n", FormatImageError(image, reference));
+
+	// the history starts empty, every frame adds another jitter position
+	SetTemporalAA(true);
+	unsigned int numRendered = 0;
+	for (unsigned int frames : convergenceFrames)
+	{
+		RenderFrames(frames - numRendered);
+		numRendered = frames;
+		ReadTexture(mTAAHistoryFrameBuffers[mTAAHistoryIndex].GetTextureColorId(), image);
+		ToneMap(image);
+		std::cout << std::format("TAA after {} frames: {}\n", frames, FormatImageError(image, reference));
+	}
+
+	std::vector<double> gpuMs = MeasureGpuMs({ &mGeometryTimer, &mLightingTimer, &mTAATimer, &mFrameTimer }, numFrames);
+	std::cout << std::format(
+		"{}x{} with TAA: geometry {:.3f} ms, lighting {:.3f} ms, resolve {:.3f} ms, frame {:.3f} ms\n",
+		width, height, gpuMs[0], gpuMs[1], gpuMs[2], gpuMs[3]
+	);
+}
+
+void Graphics::Engine::BenchmarkPostAA()
+{
+	constexpr unsigned int numFrames = 30;
+	static const char* modeNames[]{ "no AA", "FXAA", "SMAA 1x" };
+	int width = mWindowWidth;
+	int height = mWindowHeight;
+
+	mDynamicResolution.SetEnabled(false);
+
+	double nativeFrameMs = 0.0;
+	for (PostAAMode mode : { NoPostAA, FXAAPostAA, SMAAPostAA })
+	{
+		mPostAAMode = mode;
+		std::vector<double> gpuMs = MeasureGpuMs({ &mPostAATimer, &mFrameTimer }, numFrames);
+		if (mode == NoPostAA)
+		{
+			nativeFrameMs = gpuMs[1];
+		}
+		std::cout << std::format(
+			"{}x{} {}: AA pass {:.3f} ms, frame {:.3f} ms\n",
+			width, height, modeNames[mode], gpuMs[0], gpuMs[1]
+		);
+	}
+
+	// the alternative to filtering edges is rendering them with more pixels, every pass then runs at 2.25x the pixels
+	mPostAAMode = NoPostAA;
+	int supersampledWidth = width * 3 / 2;
+	int supersampledHeight = height * 3 / 2;
+	CreateRenderTargets(supersampledWidth, supersampledHeight);
+	double frameMs = MeasureGpuMs(mFrameTimer, numFrames);
+	std::cout << std::format(
+		"{}x{} no AA: frame {:.3f} ms, {:.3f} ms more than {}x{}\n",
+		supersampledWidth, supersampledHeight, frameMs, frameMs - nativeFrameMs, width, height
+	);
+}
+
+void Graphics::Engine::BenchmarkAutoExposure()
+{
+	constexpr unsigned int numFrames = 60;
+
+	mAutoExposure = false;
+	double fixedFrameMs = MeasureGpuMs(mFrameTimer, numFrames);
+
+	mAutoExposure = true;
+	mAutoExposureTargets.Reset();
+
+	// the CPU side is timed right after the frame is submitted, while the GPU is still working on it
+	double pollMs = 0.0;
+	unsigned int numReadbacks = 0;
+	std::vector<double> gpuMs = MeasureGpuMs({ &mExposureTimer, &mFrameTimer }, numFrames, [&]() {
+		RenderFrames(1);
+		auto start = std::chrono::high_resolution_clock::now();
+		numReadbacks += mAutoExposureTargets.PollReadback() ? 1 : 0;
+		auto end = std::chrono::high_resolution_clock::now();
+		pollMs += std::chrono::duration<double, std::milli>(end - start).count();
+	});
+
+	// the same value read straight from the texture has to wait for the frame to finish
+	double syncReadMs = 0.0;
+	std::vector<float> luminance(1);
+	for (unsigned int i = 0; i < numFrames; i++)
+	{
+		RenderFrames(1);
+		auto start = std::chrono::high_resolution_clock::now();
+		ReadTexture(mAutoExposureTargets.GetLuminanceTextureId(), luminance);
+		auto end = std::chrono::high_resolution_clock::now();
+		syncReadMs += std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	std::cout << std::format(
+		"{}x{} fixed exposure: frame {:.3f} ms\n"
+		"auto exposure ({}x{} samples, {} bins): pass {:.3f} ms, frame {:.3f} ms\n"
+		"readback: pixel buffer poll {:.4f} ms CPU ({} of {} frames, {} frames behind), synchronous read {:.4f} ms CPU\n"
+		"adapted luminance {:.4f}\n",
+		mWindowWidth, mWindowHeight, fixedFrameMs,
+		mExposureGridWidth, mExposureGridHeight, AutoExposure::HISTOGRAM_BINS, gpuMs[0], gpuMs[1],
+		pollMs / numFrames, numReadbacks, numFrames, mAutoExposureTargets.GetReadbackLatency(), syncReadMs / numFrames,
+		luminance[0]
+	);
+}
+
+void Graphics::Engine::BenchmarkShaderPermutations()
+{
+	constexpr unsigned int numFrames = 30;
+
+	for (bool sponza : { false, true })
+	{
+		if (sponza && !SetDrawSponza(true))
+		{
+			std::cout << "Sponza is not available, skipping it" << std::endl;
+			continue;
+		}
+		mDrawPropGrid = !sponza;
+
+		for (bool permutations : { false, true })
+		{
+			mShaderPermutations = permutations;
+			std::vector<double> gpuMs = MeasureGpuMs({ &mGeometryTimer, &mFrameTimer }, numFrames);
+
+			const DrawQueue::Stats& stats = mDrawQueue.GetStats();
+			std::cout << std::format(
+				"{} {:<12}: G-buffer {:.3f} ms, frame {:.3f} ms, {} program changes per frame\n",
+				sponza ? "sponza" : "scene ", permutations ? "permutations" : "uber-shader",
+				gpuMs[0], gpuMs[1], stats.NumProgramChanges
+			);
+		}
+
+		// the variants are cached, so the counts include the ones an earlier scene already built
+		uint64_t featureSets = mDrawQueue.GetShaderFeatureSets();
+		unsigned int numFeatureSets = 0;
+		for (unsigned int features = 0; features < 64; features++)
+		{
+			numFeatureSets += (featureSets >> features) & 1;
+		}
+		std::cout << std::format(
+			"{} uses {} material feature sets, {} + {} instanced variants built so far in {:.1f} ms\n",
+			sponza ? "sponza" : "scene ", numFeatureSets,
+			mGBufferPermutations.GetNumVariants(), mGBufferInstancedPermutations.GetNumVariants(),
+			mGBufferPermutations.GetCompileMs() + mGBufferInstancedPermutations.GetCompileMs()
+		);
+
+		SetDrawSponza(false);
+	}
+}
+
+void Graphics::Engine::BenchmarkShaderCache()
+{
+	if (!ProgramBinaryCache::IsEnabled())
+	{
+		std::cout << "The program binary cache is disabled or not supported" << std::endl;
+		return;
+	}
+
+	// cold: nothing stored, every program is compiled, linked and written out; warm: every program is loaded
+	// the driver keeps a shader cache of its own, so even the cold run may skip part of the compilation
+	for (bool cold : { true, false })
+	{
+		if (cold)
+		{
+			ProgramBinaryCache::Clear();
+		}
+		ProgramBinaryCache::ResetStats();
+
+		auto start = std::chrono::high_resolution_clock::now();
+		BuildShaderPrograms();
+		glFinish();
+		auto end = std::chrono::high_resolution_clock::now();
+		std::cout << std::format(
+			"{}: {:.1f} ms, {} programs loaded, {} compiled\n",
+			cold ? "cold" : "warm", std::chrono::duration<double, std::milli>(end - start).count(),
+			ProgramBinaryCache::GetNumHits(), ProgramBinaryCache::GetNumMisses()
+		);
+	}
+
+	// the G-buffer variants are built on demand by the first frame, the cold run removed their binaries too
+	ProgramBinaryCache::ResetStats();
+	auto start = std::chrono::high_resolution_clock::now();
+	RenderFrames(1);
+	glFinish();
+	auto end = std::chrono::high_resolution_clock::now();
+	std::cout << std::format(
+		"first frame with {} + {} G-buffer variants: {:.1f} ms, {} variants loaded, {} compiled\n",
+		mGBufferPermutations.GetNumVariants(), mGBufferInstancedPermutations.GetNumVariants(),
+		std::chrono::duration<double, std::milli>(end - start).count(),
+		ProgramBinaryCache::GetNumHits(), ProgramBinaryCache::GetNumMisses()
+	);
+}
+
+void Graphics::Engine::BenchmarkShaderCompile()
+{
+	constexpr int NUM_ROUNDS = 3;
+
+	// binaries would hide the compiles, the driver's own shader cache still can, so repeated rounds may get faster
+	ProgramBinaryCache::SetEnabled(false);
+
+	// a deferred link is only waited for on first use, so the first frame is part of the startup cost
+	double totalMs[2]{};
+	for (int round = 0; round < NUM_ROUNDS; round++)
+	{
+		for (bool deferred : { false, true })
+		{
+			ShaderProgram::SetDeferredBuilds(deferred);
+			auto start = std::chrono::high_resolution_clock::now();
+			BuildShaderPrograms();
+			RenderFrames(1);
+			glFinish();
+			auto end = std::chrono::high_resolution_clock::now();
+			totalMs[deferred ? 1 : 0] += std::chrono::duration<double, std::milli>(end - start).count();
+		}
+	}
+
+	std::cout << std::format("status queried after each program: {:.1f} ms\n", totalMs[0] / NUM_ROUNDS);
+	std::cout << std::format(
+		"status queried on first use: {:.1f} ms, outline, normals visualization and environment mapping {}\n",
+		totalMs[1] / NUM_ROUNDS, mOutlineShaderProgram.IsBuilt() ? "built" : "not built"
+	);
+}
+
+void Graphics::Engine::BenchmarkSpirv()
+{
+	constexpr int NUM_ROUNDS = 3;
+
+	if (!GLAD_GL_VERSION_4_6 || !glSpecializeShader)
+	{
+		std::cout << "SPIR-V shaders need an OpenGL 4.6 context" << std::endl;
+		return;
+	}
+
+	// every program is built from text or from SPIR-V, the binary cache would skip both
+	ProgramBinaryCache::SetEnabled(false);
+
+	double totalMs[2]{};
+	unsigned int numSpirvShaders = 0;
+	unsigned int numSpirvFallbacks = 0;
+	for (int round = 0; round < NUM_ROUNDS; round++)
+	{
+		for (bool spirv : { false, true })
+		{
+			Shader::SetSpirvEnabled(spirv);
+			Shader::ResetSpirvStats();
+			auto start = std::chrono::high_resolution_clock::now();
+			BuildShaderPrograms();
+			RenderFrames(1);
+			glFinish();
+			auto end = std::chrono::high_resolution_clock::now();
+			totalMs[spirv ? 1 : 0] += std::chrono::duration<double, std::milli>(end - start).count();
+			if (spirv)
+			{
+				numSpirvShaders = Shader::GetNumSpirvShaders();
+				numSpirvFallbacks = Shader::GetNumSpirvFallbacks();
+			}
+		}
+	}
+
+	// the driver's own cache of GLSL compiles may shorten the GLSL rounds after the first
+	std::cout << std::format("GLSL: {:.1f} ms\n", totalMs[0] / NUM_ROUNDS);
+	std::cout << std::format(
+		"SPIR-V: {:.1f} ms, {} shaders specialized, {} fell back to GLSL\n",
+		totalMs[1] / NUM_ROUNDS, numSpirvShaders, numSpirvFallbacks
+	);
+	if (numSpirvShaders == 0)
+	{
+		std::cout << "No SPIR-V was found, the shaders are compiled to src/Shaders/spirv by a build with CompileSpirv=true and VULKAN_SDK set" << std::endl;
+	}
+}
+
+void Graphics::Engine::BenchmarkDepthPrepass()
+{
+	constexpr unsigned int numFrames = 30;
+
+	for (bool sponza : { false, true })
+	{
+		if (sponza && !SetDrawSponza(true))
+		{
+			std::cout << "Sponza is not available, skipping it" << std::endl;
+			continue;
+		}
+		mDrawPropGrid = !sponza;
+
+		for (DepthPrepassMode mode : { NoDepthPrepass, AlwaysDepthPrepass, AutoDepthPrepass })
+		{
+			static const char* modeNames[]{ "no prepass", "prepass", "auto" };
+			mDepthPrepassMode = mode;
+			unsigned int numPrepassFrames = 0;
+			std::vector<double> gpuMs = MeasureGpuMs({ &mDepthPrepassTimer, &mGeometryTimer, &mFrameTimer }, numFrames, [&]() {
+				RenderFrames(1);
+				numPrepassFrames += mDepthPrepassActive ? 1 : 0;
+			});
+
+			std::cout << std::format(
+				"{} {:<10}: prepass {:.3f} ms + G-buffer {:.3f} ms, frame {:.3f} ms, prepass in {} of {} frames\n",
+				sponza ? "sponza" : "scene ", modeNames[mode], gpuMs[0], gpuMs[1], gpuMs[2], numPrepassFrames, numFrames
+			);
+		}
+
+		// samples passing the prepass depth test per sample the G-buffer pass shaded after it
+		mDepthPrepassMode = AlwaysDepthPrepass;
+		RenderFrames(1);
+		mPrepassSampleCounter.Resolve(true);
+		mGeometrySampleCounter.Resolve(true);
+		unsigned long long numCovered = mGeometrySampleCounter.GetNumSamples();
+		std::cout << std::format(
+			"{} overdraw: {:.2f} fragments per covered pixel without the prepass, {} pixels covered\n",
+			sponza ? "sponza" : "scene ",
+			numCovered > 0 ? static_cast<double>(mPrepassSampleCounter.GetNumSamples()) / numCovered : 0.0, numCovered
+		);
+
+		SetDrawSponza(false);
+	}
+}
+
+void Graphics::Engine::BenchmarkConeStepMapping()
+{
+	constexpr unsigned int numFrames = 30;
+	constexpr int numBakeRuns = 3;
+
+	const char* heightMapPath = "resources/textures/bricks2_disp.jpg";
+	int width, height, numChannels;
+	unsigned char* data = stbi_load(heightMapPath, &width, &height, &numChannels, 1);
+	if (data)
+	{
+		std::vector<float> depths(static_cast<size_t>(width) * height);
+		for (size_t i = 0; i < depths.size(); i++)
+		{
+			depths[i] = data[i] / 255.0f;
+		}
+		stbi_image_free(data);
+
+		for (unsigned int numThreads : { 1u, 0u })
+		{
+			double totalMs = 0.0;
+			for (int run = 0; run < numBakeRuns; run++)
+			{
+				auto start = std::chrono::high_resolution_clock::now();
+				BakeRelaxedCones(depths, width, height, CONE_STEP_SEARCH_RADIUS, numThreads);
+				auto end = std::chrono::high_resolution_clock::now();
+				totalMs += std::chrono::duration<double, std::milli>(end - start).count();
+			}
+			std::cout << std::format(
+				"Bake {}x{}, search radius {}, {}: {:.1f} ms\n", width, height, CONE_STEP_SEARCH_RADIUS,
+				numThreads == 1 ? "1 thread" : "all threads", totalMs / numBakeRuns
+			);
+		}
+	}
+	else
+	{
+		std::cout << "Error: Failed to load height map " << heightMapPath << std::endl;
+	}
+
+	if (!mParallaxConeStepMap)
+	{
+		std::cout << "No cone step map was baked, both paths would use the layers, skipping the frames" << std::endl;
+		return;
+	}
+
+	mDrawParallaxProps = true;
+	for (bool cones : { false, true })
+	{
+		mConeStepMapping = cones;
+		std::vector<double> gpuMs = MeasureGpuMs({ &mGeometryTimer, &mFrameTimer }, numFrames);
+		std::cout << std::format(
+			"{}: G-buffer {:.3f} ms, frame {:.3f} ms\n",
+			cones ? "Relaxed cone steps" : "Occlusion layers  ", gpuMs[0], gpuMs[1]
+		);
+	}
+}
+
+void Graphics::Engine::BenchmarkLod()
+{
+	constexpr unsigned int numFrames = 30;
+
+	// the simplification error of every loaded model is printed when it is imported
+	for (bool sponza : { false, true })
+	{
+		if (sponza && !SetDrawSponza(true))
+		{
+			std::cout << "Sponza is not available, skipping it" << std::endl;
+			continue;
+		}
+		mDrawPropGrid = !sponza;
+
+		for (bool lods : { false, true })
+		{
+			mDrawQueue.SetLodSelectionEnabled(lods);
+			unsigned long long numTriangles = 0;
+			std::vector<double> gpuMs = MeasureGpuMs({ &mGeometryTimer, &mFrameTimer }, numFrames, [&]() {
+				RenderFrames(1);
+				numTriangles += mDrawQueue.GetStats().NumTriangles;
+			});
+
+			std::cout << std::format(
+				"{} {:<15}: {} triangles per frame over all passes, G-buffer {:.3f} ms, frame {:.3f} ms\n",
+				sponza ? "sponza" : "scene ", lods ? "screen size LOD" : "full resolution", numTriangles / numFrames,
+				gpuMs[0], gpuMs[1]
+			);
+		}
+
+		SetDrawSponza(false);
+	}
+}
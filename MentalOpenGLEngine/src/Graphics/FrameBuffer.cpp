@@ -3,16 +3,27 @@
 #include <stdio.h>
 #include <iostream>
 
+FrameBuffer::FrameBuffer() :
+	mWidth(0),
+	mHeight(0),
+	mFramebufferID(0),
+	mTextureColorID(0),
+	mDepthRenderBufferID(0)
+{
+}
+
 FrameBuffer::~FrameBuffer()
 {
-	glDeleteFramebuffers(1, &mFramebufferID);
-	glDeleteRenderbuffers(1, &mDepthRenderBufferID);
-	glDeleteTextures(1, &mTextureColorID);
-	glDeleteTextures(1, &mBrightColorID);
+	Release();
 }
 
 void FrameBuffer::Create(int width, int height)
 {
+	Release();
+
+	mWidth = width;
+	mHeight = height;
+
 	glGenFramebuffers(1, &mFramebufferID);
 	glBindFramebuffer(GL_FRAMEBUFFER, mFramebufferID);
 
@@ -25,24 +36,12 @@ void FrameBuffer::Create(int width, int height)
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mTextureColorID, 0);
 
-	glGenTextures(1, &mBrightColorID);
-	glBindTexture(GL_TEXTURE_2D, mBrightColorID);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, mBrightColorID, 0);
-
 	glGenRenderbuffers(1, &mDepthRenderBufferID);
 	glBindRenderbuffer(GL_RENDERBUFFER, mDepthRenderBufferID);
 	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
 	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mDepthRenderBufferID);
 
-	unsigned int attachments[2]{
-		GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1
-	};
-	glDrawBuffers(2, attachments);
+	glDrawBuffer(GL_COLOR_ATTACHMENT0);
 
 	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 	{
@@ -53,6 +52,13 @@ void FrameBuffer::Create(int width, int height)
 	glBindTexture(GL_TEXTURE_2D, 0);
 }
 
+void FrameBuffer::Release()
+{
+	glDeleteFramebuffers(1, &mFramebufferID);
+	glDeleteRenderbuffers(1, &mDepthRenderBufferID);
+	glDeleteTextures(1, &mTextureColorID);
+}
+
 void FrameBuffer::Bind()
 {
 	glBindFramebuffer(GL_FRAMEBUFFER, mFramebufferID);
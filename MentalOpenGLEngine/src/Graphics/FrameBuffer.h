@@ -3,6 +3,7 @@
 class FrameBuffer
 {
 public:
+	FrameBuffer();
 	virtual ~FrameBuffer();
 
 	void Create(int width, int height);
@@ -11,14 +12,15 @@ public:
 	void Unbind();
 
 	inline unsigned int GetTextureColorId() const { return mTextureColorID; }
-	inline unsigned int GetBrightTextureColorId() const { return mBrightColorID; }
 	inline unsigned int GetFrameBufferId() const { return mFramebufferID; }
+	inline unsigned int GetDepthRenderBufferId() const { return mDepthRenderBufferID; }
 
 private:
+	void Release();
+
 	int mWidth, mHeight;
 
 	unsigned int mFramebufferID;
 	unsigned int mTextureColorID;
-	unsigned int mBrightColorID;
 	unsigned int mDepthRenderBufferID;
 };
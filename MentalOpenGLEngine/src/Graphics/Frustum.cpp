@@ -0,0 +1,45 @@
+#include "Frustum.h"
+
+Frustum::Frustum() :
+	mPlanes{}
+{
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+	// Gribb/Hartmann: each plane is the fourth row of the matrix plus or minus one of the others
+	glm::vec4 rowX(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+	glm::vec4 rowY(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+	glm::vec4 rowZ(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+	glm::vec4 rowW(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+	mPlanes[0] = rowW + rowX;
+	mPlanes[1] = rowW - rowX;
+	mPlanes[2] = rowW + rowY;
+	mPlanes[3] = rowW - rowY;
+	mPlanes[4] = rowW + rowZ;
+	mPlanes[5] = rowW - rowZ;
+
+	for (glm::vec4& plane : mPlanes)
+	{
+		plane /= glm::length(glm::vec3(plane));
+	}
+}
+
+bool Frustum::Intersects(const Core::BoundingBox& box) const
+{
+	glm::vec3 center = box.GetCenter();
+	glm::vec3 extents = box.GetExtents();
+
+	for (const glm::vec4& plane : mPlanes)
+	{
+		glm::vec3 normal(plane);
+		float radius = glm::dot(extents, glm::abs(normal));
+		if (glm::dot(normal, center) + plane.w < -radius)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include "CoreTypes.h"
+
+// Six planes extracted from a view-projection matrix with their normals pointing inwards,
+// used to cull world-space bounding boxes.
+class Frustum
+{
+public:
+	Frustum();
+	explicit Frustum(const glm::mat4& viewProjection);
+
+	bool Intersects(const Core::BoundingBox& box) const;
+
+private:
+	glm::vec4 mPlanes[6];
+};
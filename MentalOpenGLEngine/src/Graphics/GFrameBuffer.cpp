@@ -3,21 +3,27 @@
 #include <stdio.h>
 #include <iostream>
 
-GFrameBuffer::~GFrameBuffer()
+GFrameBuffer::GFrameBuffer() :
+	mWidth(0),
+	mHeight(0),
+	mFramebufferId(0),
+	mAlbedoSpecularTextureId(0),
+	mNormalTextureId(0),
+	mPositionTextureId(0),
+	mVelocityTextureId(0),
+	mRenderBufferId(0)
 {
-	glDeleteFramebuffers(1, &mFramebufferId);
-	glDeleteRenderbuffers(1, &mRenderBufferId);
+}
 
-	unsigned int textureIds[5]{
-		mAlbedoSpecularTextureId,
-		mNormalTextureId,
-		mPositionTextureId
-	};
-	glDeleteTextures(5, textureIds);
+GFrameBuffer::~GFrameBuffer()
+{
+	Release();
 }
 
 void GFrameBuffer::Create(int width, int height)
 {
+	Release();
+
 	mWidth = width;
 	mHeight = height;
 
@@ -51,17 +57,27 @@ void GFrameBuffer::Create(int width, int height)
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, mAlbedoSpecularTextureId, 0);
 
+	glGenTextures(1, &mVelocityTextureId);
+	glBindTexture(GL_TEXTURE_2D, mVelocityTextureId);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, width, height, 0, GL_RG, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, mVelocityTextureId, 0);
+
 	glGenRenderbuffers(1, &mRenderBufferId);
 	glBindRenderbuffer(GL_RENDERBUFFER, mRenderBufferId);
 	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
 	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mRenderBufferId);
 
-	unsigned int attachments[3] = {
+	unsigned int attachments[4] = {
 		GL_COLOR_ATTACHMENT0,
 		GL_COLOR_ATTACHMENT1,
-		GL_COLOR_ATTACHMENT2
+		GL_COLOR_ATTACHMENT2,
+		GL_COLOR_ATTACHMENT3
 	};
-	glDrawBuffers(3, attachments);
+	glDrawBuffers(4, attachments);
 
 	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
 	{
@@ -73,6 +89,20 @@ void GFrameBuffer::Create(int width, int height)
 	glBindRenderbuffer(GL_RENDERBUFFER, 0);
 }
 
+void GFrameBuffer::Release()
+{
+	glDeleteFramebuffers(1, &mFramebufferId);
+	glDeleteRenderbuffers(1, &mRenderBufferId);
+
+	unsigned int textureIds[4]{
+		mAlbedoSpecularTextureId,
+		mNormalTextureId,
+		mPositionTextureId,
+		mVelocityTextureId
+	};
+	glDeleteTextures(4, textureIds);
+}
+
 void GFrameBuffer::Bind()
 {
 	glBindFramebuffer(GL_FRAMEBUFFER, mFramebufferId);
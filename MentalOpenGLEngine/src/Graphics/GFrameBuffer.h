@@ -2,6 +2,7 @@
 class GFrameBuffer
 {
 public:
+	GFrameBuffer();
 	virtual ~GFrameBuffer();
 
 	void Create(int width, int height);
@@ -9,18 +10,25 @@ public:
 	inline unsigned int GetAlbedoSpecularTextureId() const { return mAlbedoSpecularTextureId; }
 	inline unsigned int GetNormalTextureId() const { return mNormalTextureId; }
 	inline unsigned int GetPositionTextureId() const { return mPositionTextureId; }
+	// screen space motion since the previous frame, in texture coordinates
+	inline unsigned int GetVelocityTextureId() const { return mVelocityTextureId; }
 	inline unsigned int GetFrameBufferId() const { return mFramebufferId; }
+	inline int GetWidth() const { return mWidth; }
+	inline int GetHeight() const { return mHeight; }
 
 	void Bind();
 	void Unbind();
 
 private:
+	void Release();
+
 	int mWidth, mHeight;
 
 	unsigned int mFramebufferId;
 	unsigned int mAlbedoSpecularTextureId;
 	unsigned int mNormalTextureId;
 	unsigned int mPositionTextureId;
+	unsigned int mVelocityTextureId;
 	unsigned int mRenderBufferId;
 };
 
@@ -0,0 +1,97 @@
+#include "GpuTimer.h"
+#include <glad/glad.h>
+
+GpuTimer::GpuTimer() :
+	mQueries{},
+	mEndQueries{},
+	mUseTimestamps(false),
+	mNextQuery(0),
+	mNumPending(0),
+	mNumResults(0),
+	mElapsedMs(0.0)
+{
+}
+
+GpuTimer::~GpuTimer()
+{
+	glDeleteQueries(NUM_QUERIES, mQueries);
+	glDeleteQueries(NUM_QUERIES, mEndQueries);
+}
+
+void GpuTimer::Create(bool useTimestamps)
+{
+	mUseTimestamps = useTimestamps;
+	glGenQueries(NUM_QUERIES, mQueries);
+	if (useTimestamps)
+	{
+		glGenQueries(NUM_QUERIES, mEndQueries);
+	}
+}
+
+void GpuTimer::Begin()
+{
+	// every query is still in flight, the oldest one has to be read before it is reused
+	if (mNumPending == NUM_QUERIES)
+	{
+		ReadResult(mNextQuery);
+		mNumPending--;
+	}
+
+	if (mUseTimestamps)
+	{
+		glQueryCounter(mQueries[mNextQuery], GL_TIMESTAMP);
+	}
+	else
+	{
+		glBeginQuery(GL_TIME_ELAPSED, mQueries[mNextQuery]);
+	}
+}
+
+void GpuTimer::End()
+{
+	if (mUseTimestamps)
+	{
+		glQueryCounter(mEndQueries[mNextQuery], GL_TIMESTAMP);
+	}
+	else
+	{
+		glEndQuery(GL_TIME_ELAPSED);
+	}
+	mNextQuery = (mNextQuery + 1) % NUM_QUERIES;
+	mNumPending++;
+}
+
+void GpuTimer::Resolve(bool wait)
+{
+	while (mNumPending > 0)
+	{
+		unsigned int oldestQuery = (mNextQuery + NUM_QUERIES - mNumPending) % NUM_QUERIES;
+		if (!wait)
+		{
+			// the end query is issued last, so it being available covers the begin query too
+			GLint isAvailable = GL_FALSE;
+			glGetQueryObjectiv(mUseTimestamps ? mEndQueries[oldestQuery] : mQueries[oldestQuery], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+			if (isAvailable == GL_FALSE)
+			{
+				return;
+			}
+		}
+
+		ReadResult(oldestQuery);
+		mNumPending--;
+	}
+}
+
+void GpuTimer::ReadResult(unsigned int query)
+{
+	GLuint64 elapsedNs = 0;
+	glGetQueryObjectui64v(mQueries[query], GL_QUERY_RESULT, &elapsedNs);
+	if (mUseTimestamps)
+	{
+		GLuint64 endNs = 0;
+		glGetQueryObjectui64v(mEndQueries[query], GL_QUERY_RESULT, &endNs);
+		elapsedNs = endNs - elapsedNs;
+	}
+	mElapsedMs = static_cast<double>(elapsedNs) / 1000000.0;
+	mNumResults++;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+// Measures GPU time between Begin and End with GL_TIME_ELAPSED queries. Queries are kept in a small ring,
+// so results can be read back a few frames late without stalling the pipeline.
+// Elapsed time queries cannot nest, a timer created with timestamps brackets its span with two
+// GL_TIMESTAMP queries instead and can wrap other timers, e.g. for the whole frame.
+class GpuTimer
+{
+public:
+	GpuTimer();
+	virtual ~GpuTimer();
+
+	void Create(bool useTimestamps = false);
+
+	void Begin();
+	void End();
+	void Resolve(bool wait = false);
+
+	inline double GetElapsedMs() const { return mElapsedMs; }
+	// increases with every result read back, tells a fresh measurement from a repeated one
+	inline unsigned int GetNumResults() const { return mNumResults; }
+
+private:
+	static constexpr unsigned int NUM_QUERIES = 4;
+
+	void ReadResult(unsigned int query);
+
+	unsigned int mQueries[NUM_QUERIES];
+	unsigned int mEndQueries[NUM_QUERIES];
+	bool mUseTimestamps;
+	unsigned int mNextQuery;
+	unsigned int mNumPending;
+	unsigned int mNumResults;
+	double mElapsedMs;
+};
@@ -1,6 +1,7 @@
 #include "Mesh.h"
 #include <iostream>
 #include <format>
+#include <glm/glm.hpp>
 
 Mesh::Mesh() : mVAO(0), mVBO(0), mEBO(0), mNumIndices(0), mNumVertices(0)
 {
@@ -17,26 +18,61 @@ Mesh::~Mesh()
 void Mesh::Draw(ShaderProgram& shader)
 {
 	BindTextures(shader);
-
-	glBindVertexArray(mVAO);
-	glDrawElements(GL_TRIANGLES, mNumIndices, GL_UNSIGNED_INT, 0);
-	glBindVertexArray(0);
-
+	DrawGeometry();
 	UnbindTextures();
 }
 
 void Mesh::DrawInstanced(ShaderProgram& shader, int n)
 {
 	BindTextures(shader);
+	DrawGeometryInstanced(n);
+	UnbindTextures();
+}
 
+void Mesh::DrawGeometry(unsigned int lod)
+{
 	glBindVertexArray(mVAO);
-	glDrawElementsInstanced(GL_TRIANGLES, mNumIndices, GL_UNSIGNED_INT, 0, n);
+	glDrawElements(GL_TRIANGLES, mLods[lod].NumIndices, GL_UNSIGNED_INT, (void*)(sizeof(unsigned int) * mLods[lod].FirstIndex));
 	glBindVertexArray(0);
+}
 
-	UnbindTextures();
+void Mesh::DrawGeometryInstanced(int n, unsigned int lod)
+{
+	glBindVertexArray(mVAO);
+	glDrawElementsInstanced(GL_TRIANGLES, mLods[lod].NumIndices, GL_UNSIGNED_INT, (void*)(sizeof(unsigned int) * mLods[lod].FirstIndex), n);
+	glBindVertexArray(0);
 }
 
-void Mesh::Setup(const std::vector<Core::Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<Core::Texture>& textures)
+unsigned int Mesh::GetTextureId(Core::TextureType type) const
+{
+	auto it = mTextures.find(type);
+	return it != mTextures.end() ? it->second.ID : 0u;
+}
+
+unsigned int Mesh::GetShaderFeatures() const
+{
+	unsigned int features = 0;
+	if (GetTextureId(Core::Specular))
+	{
+		features |= SpecularTextureFeature;
+	}
+	if (GetTextureId(Core::Normal))
+	{
+		features |= NormalTextureFeature;
+	}
+	if (GetTextureId(Core::Height))
+	{
+		features |= HeightTextureFeature;
+	}
+	return features;
+}
+
+void Mesh::Setup(
+	const std::vector<Core::Vertex>& vertices,
+	const std::vector<unsigned int>& indices,
+	const std::vector<Core::Texture>& textures,
+	const std::vector<MeshLod>& lods
+)
 {
 	for (const Core::Texture& texture : textures)
 	{
@@ -46,9 +82,24 @@ void Mesh::Setup(const std::vector<Core::Vertex>& vertices, const std::vector<un
 		}
 	}
 
+	mLods = lods;
+	if (mLods.empty())
+	{
+		mLods.push_back({ 0u, static_cast<unsigned int>(indices.size()), 0.0f });
+	}
 	mNumIndices = indices.size();
 	mNumVertices = vertices.size();
 
+	if (!vertices.empty())
+	{
+		mBounds = { vertices[0].Position, vertices[0].Position };
+		for (const Core::Vertex& vertex : vertices)
+		{
+			mBounds.Min = glm::min(mBounds.Min, vertex.Position);
+			mBounds.Max = glm::max(mBounds.Max, vertex.Position);
+		}
+	}
+
 	glGenVertexArrays(1, &mVAO);
 	glGenBuffers(1, &mVBO);
 	glGenBuffers(1, &mEBO);
@@ -78,7 +129,51 @@ void Mesh::Setup(const std::vector<Core::Vertex>& vertices, const std::vector<un
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 }
 
-void Mesh::BindTextures(ShaderProgram& shader)
+void Mesh::SetupTriangleSorting(const std::vector<Core::Vertex>& vertices, const std::vector<unsigned int>& indices)
+{
+	mIndices = indices;
+	mSortedIndices.resize(indices.size());
+
+	size_t numTriangles = indices.size() / 3;
+	mTriangleCentroids.resize(numTriangles);
+	for (size_t i = 0; i < numTriangles; i++)
+	{
+		mTriangleCentroids[i] = (
+			vertices[indices[3 * i]].Position +
+			vertices[indices[3 * i + 1]].Position +
+			vertices[indices[3 * i + 2]].Position
+		) / 3.0f;
+	}
+}
+
+void Mesh::SortTriangles(const glm::vec3& viewPositionModelSpace)
+{
+	size_t numTriangles = mTriangleCentroids.size();
+	mTriangleSortItems.resize(numTriangles);
+	for (size_t i = 0; i < numTriangles; i++)
+	{
+		glm::vec3 v = mTriangleCentroids[i] - viewPositionModelSpace;
+		// inverted key, so the farthest triangle comes first
+		uint32_t key = ~FloatToSortableUint(glm::dot(v, v));
+		mTriangleSortItems[i] = { key, static_cast<uint32_t>(i) };
+	}
+
+	RadixSort(mTriangleSortItems, mTriangleSortScratch);
+
+	for (size_t i = 0; i < numTriangles; i++)
+	{
+		size_t triangle = mTriangleSortItems[i].Index;
+		mSortedIndices[3 * i] = mIndices[3 * triangle];
+		mSortedIndices[3 * i + 1] = mIndices[3 * triangle + 1];
+		mSortedIndices[3 * i + 2] = mIndices[3 * triangle + 2];
+	}
+
+	glBindVertexArray(mVAO);
+	glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, sizeof(unsigned int) * mSortedIndices.size(), mSortedIndices.data());
+	glBindVertexArray(0);
+}
+
+void Mesh::BindTextures(ShaderProgram& shader, bool setFeatureUniforms)
 {
 	auto diffuseTexture = mTextures.find(Core::Diffuse);
 	auto specularTexture = mTextures.find(Core::Specular);
@@ -93,31 +188,23 @@ void Mesh::BindTextures(ShaderProgram& shader)
 	if (specularTexture != mTextures.end())
 	{
 		SetTexture(shader, std::format(SPECULAR_TEXTURE_NAME, 1), 1, specularTexture->second.ID);
-		shader.SetUniform1i("uMaterial.useSpecularTexture", 1);
-	}
-	else
-	{
-		shader.SetUniform1i("uMaterial.useSpecularTexture", 0);
 	}
 
 	if (normalTexture != mTextures.end())
 	{
 		SetTexture(shader, std::format(NORMAL_TEXTURE_NAME, 1), 2, normalTexture->second.ID);
-		shader.SetUniform1i("uMaterial.useNormalTexture", 1);
-	}
-	else
-	{
-		shader.SetUniform1i("uMaterial.useNormalTexture", 0);
 	}
 
 	if (heightTexture != mTextures.end())
 	{
 		SetTexture(shader, std::format(HEIGHT_TEXTURE_NAME, 1), 3, heightTexture->second.ID);
-		shader.SetUniform1i("uMaterial.useHeightTexture", 1);
 	}
-	else
+
+	if (setFeatureUniforms)
 	{
-		shader.SetUniform1i("uMaterial.useHeightTexture", 0);
+		shader.SetUniform1i("uMaterial.useSpecularTexture", specularTexture != mTextures.end());
+		shader.SetUniform1i("uMaterial.useNormalTexture", normalTexture != mTextures.end());
+		shader.SetUniform1i("uMaterial.useHeightTexture", heightTexture != mTextures.end());
 	}
 }
 
@@ -5,22 +5,54 @@
 #include <string>
 #include "CoreTypes.h"
 #include "Graphics/ShaderProgram.h"
+#include "Graphics/ShaderPermutations.h"
+#include "Graphics/RadixSort.h"
+#include "Graphics/MeshSimplifier.h"
 
 class Mesh
 {
 public:
+	// the material features a permuted shader is specialized for, as bits of a feature mask
+	enum ShaderFeature
+	{
+		SpecularTextureFeature = 1, NormalTextureFeature = 2, HeightTextureFeature = 4
+	};
+
 	Mesh();
 	virtual ~Mesh();
 
 	void Draw(ShaderProgram& shader);
 	void DrawInstanced(ShaderProgram& shader, int n);
-	void Setup(const std::vector<Core::Vertex>& vertices, const std::vector<unsigned int>& indices, const std::vector<Core::Texture>& textures);
+	// indices holds the ranges of every level of detail in lods, without lods all of them are the only level
+	void Setup(
+		const std::vector<Core::Vertex>& vertices,
+		const std::vector<unsigned int>& indices,
+		const std::vector<Core::Texture>& textures,
+		const std::vector<MeshLod>& lods = {}
+	);
+
+	// Keeps a CPU copy of the triangles so SortTriangles can reorder the index buffer back-to-front
+	void SetupTriangleSorting(const std::vector<Core::Vertex>& vertices, const std::vector<unsigned int>& indices);
+	void SortTriangles(const glm::vec3& viewPositionModelSpace);
+	inline bool SupportsTriangleSorting() const { return !mTriangleCentroids.empty(); }
+	inline unsigned int GetNumTriangles(unsigned int lod = 0) const { return mLods[lod].NumIndices / 3; }
+	inline unsigned int GetNumLods() const { return static_cast<unsigned int>(mLods.size()); }
+	inline const MeshLod& GetLod(unsigned int lod) const { return mLods[lod]; }
 
+	// Draw calls without texture binding, for callers that manage texture state themselves.
+	// Programs specialized for the mesh's features have no feature uniforms to set.
+	void BindTextures(ShaderProgram& shader, bool setFeatureUniforms = true);
+	void DrawGeometry(unsigned int lod = 0);
+	void DrawGeometryInstanced(int n, unsigned int lod = 0);
+	static void UnbindTextures();
+
+	unsigned int GetTextureId(Core::TextureType type) const;
+	unsigned int GetShaderFeatures() const;
+	inline ShaderProgram& SelectProgram(ShaderPermutations& permutations) const { return permutations.Get(GetShaderFeatures()); }
 	inline unsigned int GetVAO() const { return mVAO; }
+	inline const Core::BoundingBox& GetBounds() const { return mBounds; }
 
 private:
-	void BindTextures(ShaderProgram& shader);
-	void UnbindTextures();
 	void SetTexture(
 		ShaderProgram& shader,
 		const std::string& textureName,
@@ -30,6 +62,14 @@ private:
 
 	unsigned int mVAO, mVBO, mEBO;
 	unsigned int mNumIndices, mNumVertices;
+	Core::BoundingBox mBounds;
+	std::vector<MeshLod> mLods;
+
+	std::vector<glm::vec3> mTriangleCentroids;
+	std::vector<unsigned int> mIndices;
+	std::vector<unsigned int> mSortedIndices;
+	std::vector<SortItem> mTriangleSortItems;
+	std::vector<SortItem> mTriangleSortScratch;
 
 	std::unordered_map<Core::TextureType, Core::Texture> mTextures;
 };
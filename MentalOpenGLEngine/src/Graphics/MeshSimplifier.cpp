@@ -0,0 +1,401 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// every level targets this fraction of the triangles of the previous one
+static constexpr float LOD_REDUCTION = 0.5f;
+// a level that keeps more than this fraction of the previous one isn't worth its memory, and ends the chain
+static constexpr float MAX_LOD_RATIO = 0.8f;
+static constexpr size_t MIN_TRIANGLES_FOR_LODS = 256;
+static constexpr size_t MIN_LOD_TRIANGLES = 32;
+// cost of the squared normal and texture coordinate differences, relative to squared distances in units of the mesh size
+static constexpr double ATTRIBUTE_WEIGHT = 1e-4;
+// collapses that turn a remaining triangle further than this (cosine of the angle) would fold the surface over
+static constexpr double MIN_NORMAL_COS = 0.2;
+static constexpr unsigned int MAX_COLLAPSE_PASSES = 64;
+
+// sum of area weighted squared distances to planes, as the symmetric 4x4 matrix of the plane equations
+struct Quadric
+{
+	double A2, AB, AC, AD, B2, BC, BD, C2, CD, D2;
+	double Weight;
+};
+
+struct Collapse
+{
+	double Cost;
+	double Error;
+	unsigned int From;
+	unsigned int To;
+};
+
+static Quadric MakePlaneQuadric(const glm::dvec3& normal, double distance, double weight)
+{
+	double a = normal.x, b = normal.y, c = normal.z, d = distance;
+	return {
+		a * a * weight, a * b * weight, a * c * weight, a * d * weight,
+		b * b * weight, b * c * weight, b * d * weight,
+		c * c * weight, c * d * weight,
+		d * d * weight,
+		weight
+	};
+}
+
+static void AddQuadric(Quadric& quadric, const Quadric& other)
+{
+	quadric.A2 += other.A2; quadric.AB += other.AB; quadric.AC += other.AC; quadric.AD += other.AD;
+	quadric.B2 += other.B2; quadric.BC += other.BC; quadric.BD += other.BD;
+	quadric.C2 += other.C2; quadric.CD += other.CD;
+	quadric.D2 += other.D2;
+	quadric.Weight += other.Weight;
+}
+
+// mean squared distance of the point to the planes of the quadric
+static double EvaluateQuadric(const Quadric& q, const glm::dvec3& p)
+{
+	double error =
+		q.A2 * p.x * p.x + q.B2 * p.y * p.y + q.C2 * p.z * p.z +
+		2.0 * (q.AB * p.x * p.y + q.AC * p.x * p.z + q.BC * p.y * p.z) +
+		2.0 * (q.AD * p.x + q.BD * p.y + q.CD * p.z) +
+		q.D2;
+	return q.Weight > 0.0 ? std::max(error, 0.0) / q.Weight : 0.0;
+}
+
+// Sorts the ids by the given key and numbers the runs of equal keys, returns the number of runs
+template<typename Key>
+static unsigned int GroupBy(std::vector<unsigned int>& groups, size_t count, Key key)
+{
+	std::vector<unsigned int> order(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		order[i] = static_cast<unsigned int>(i);
+	}
+	std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) { return key(a) < key(b); });
+
+	groups.resize(count);
+	unsigned int numGroups = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (i > 0 && key(order[i - 1]) < key(order[i]))
+		{
+			numGroups++;
+		}
+		groups[order[i]] = numGroups;
+	}
+	return count > 0 ? numGroups + 1 : 0;
+}
+
+static glm::dvec3 TriangleNormal(const glm::dvec3& a, const glm::dvec3& b, const glm::dvec3& c)
+{
+	return glm::cross(b - a, c - a);
+}
+
+std::vector<MeshLod> BuildMeshLods(const std::vector<Core::Vertex>& vertices, std::vector<unsigned int>& indices, unsigned int maxLods)
+{
+	size_t numVertices = vertices.size();
+	size_t numOriginalTriangles = indices.size() / 3;
+	if (maxLods < 2 || numOriginalTriangles < MIN_TRIANGLES_FOR_LODS)
+	{
+		return {};
+	}
+
+	// imported vertices are often duplicated per face, the copies are welded so collapses see the connected surface
+	auto attributeKey = [&](unsigned int v) {
+		const Core::Vertex& vertex = vertices[v];
+		return std::array<float, 8>{
+			vertex.Position.x, vertex.Position.y, vertex.Position.z,
+			vertex.Normal.x, vertex.Normal.y, vertex.Normal.z,
+			vertex.TextureCoordinates.x, vertex.TextureCoordinates.y
+		};
+	};
+	std::vector<unsigned int> wedges;
+	GroupBy(wedges, numVertices, attributeKey);
+	std::vector<unsigned int> canonical(numVertices, UINT32_MAX);
+	for (size_t v = 0; v < numVertices; v++)
+	{
+		unsigned int& first = canonical[wedges[v]];
+		first = std::min(first, static_cast<unsigned int>(v));
+	}
+
+	// vertices that share a position but not their attributes lie on a seam
+	auto positionKey = [&](unsigned int v) {
+		const glm::vec3& position = vertices[v].Position;
+		return std::array<float, 3>{ position.x, position.y, position.z };
+	};
+	std::vector<unsigned int> positions;
+	unsigned int numPositions = GroupBy(positions, numVertices, positionKey);
+	std::vector<unsigned int> positionWedge(numPositions, UINT32_MAX);
+	std::vector<bool> isSeamPosition(numPositions, false);
+	for (size_t v = 0; v < numVertices; v++)
+	{
+		unsigned int wedge = canonical[wedges[v]];
+		unsigned int& first = positionWedge[positions[v]];
+		if (first != UINT32_MAX && first != wedge)
+		{
+			isSeamPosition[positions[v]] = true;
+		}
+		first = std::min(first, wedge);
+	}
+
+	std::vector<unsigned int> current;
+	current.reserve(indices.size());
+	for (size_t t = 0; t < numOriginalTriangles; t++)
+	{
+		unsigned int a = canonical[wedges[indices[3 * t]]];
+		unsigned int b = canonical[wedges[indices[3 * t + 1]]];
+		unsigned int c = canonical[wedges[indices[3 * t + 2]]];
+		if (a != b && b != c && a != c)
+		{
+			current.insert(current.end(), { a, b, c });
+		}
+	}
+
+	// edges between positions with a single triangle are open borders, more than two make the surface non-manifold
+	std::vector<uint64_t> edges;
+	edges.reserve(current.size());
+	for (size_t i = 0; i < current.size(); i += 3)
+	{
+		for (unsigned int corner = 0; corner < 3; corner++)
+		{
+			uint64_t a = positions[current[i + corner]];
+			uint64_t b = positions[current[i + (corner + 1) % 3]];
+			edges.push_back((std::min(a, b) << 32) | std::max(a, b));
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	std::vector<bool> isLockedPosition = isSeamPosition;
+	for (size_t i = 0; i < edges.size();)
+	{
+		size_t end = i;
+		while (end < edges.size() && edges[end] == edges[i])
+		{
+			end++;
+		}
+		if (end - i != 2)
+		{
+			isLockedPosition[edges[i] >> 32] = true;
+			isLockedPosition[edges[i] & 0xFFFFFFFFu] = true;
+		}
+		i = end;
+	}
+
+	glm::dvec3 boundsMin(vertices[0].Position);
+	glm::dvec3 boundsMax(vertices[0].Position);
+	for (const Core::Vertex& vertex : vertices)
+	{
+		boundsMin = glm::min(boundsMin, glm::dvec3(vertex.Position));
+		boundsMax = glm::max(boundsMax, glm::dvec3(vertex.Position));
+	}
+	double attributeScale = ATTRIBUTE_WEIGHT * glm::dot(boundsMax - boundsMin, boundsMax - boundsMin);
+
+	std::vector<Quadric> quadrics(numVertices, Quadric{});
+	for (size_t i = 0; i < current.size(); i += 3)
+	{
+		glm::dvec3 a(vertices[current[i]].Position);
+		glm::dvec3 b(vertices[current[i + 1]].Position);
+		glm::dvec3 c(vertices[current[i + 2]].Position);
+		glm::dvec3 normal = TriangleNormal(a, b, c);
+		double length = glm::length(normal);
+		if (length > 0.0)
+		{
+			normal /= length;
+			Quadric quadric = MakePlaneQuadric(normal, -glm::dot(normal, a), 0.5 * length);
+			for (unsigned int corner = 0; corner < 3; corner++)
+			{
+				AddQuadric(quadrics[current[i + corner]], quadric);
+			}
+		}
+	}
+
+	std::vector<MeshLod> lods{ { 0u, static_cast<unsigned int>(indices.size()), 0.0f } };
+	std::vector<unsigned int> triangleOffsets(numVertices + 1);
+	std::vector<unsigned int> vertexTriangles;
+	std::vector<Collapse> collapses;
+	std::vector<bool> isTouched(numVertices);
+	std::vector<unsigned int> remap(numVertices);
+	double maxError = 0.0;
+
+	size_t numTriangles = current.size() / 3;
+	unsigned int numPasses = 0;
+	while (lods.size() < maxLods)
+	{
+		size_t previousTriangles = lods.back().NumIndices / 3;
+		size_t targetTriangles = std::max(MIN_LOD_TRIANGLES, static_cast<size_t>(previousTriangles * LOD_REDUCTION));
+
+		while (numTriangles > targetTriangles && numPasses < MAX_COLLAPSE_PASSES)
+		{
+			numPasses++;
+
+			// the triangles around every vertex
+			std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0u);
+			for (unsigned int v : current)
+			{
+				triangleOffsets[v + 1]++;
+			}
+			for (size_t v = 0; v < numVertices; v++)
+			{
+				triangleOffsets[v + 1] += triangleOffsets[v];
+			}
+			vertexTriangles.resize(current.size());
+			std::vector<unsigned int> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < current.size(); i++)
+			{
+				vertexTriangles[fill[current[i]]++] = static_cast<unsigned int>(i / 3);
+			}
+
+			auto keepsOrientation = [&](unsigned int from, unsigned int to) {
+				glm::dvec3 target(vertices[to].Position);
+				for (unsigned int k = triangleOffsets[from]; k < triangleOffsets[from + 1]; k++)
+				{
+					const unsigned int* triangle = &current[3 * vertexTriangles[k]];
+					if (triangle[0] == to || triangle[1] == to || triangle[2] == to)
+					{
+						continue;
+					}
+					std::array<glm::dvec3, 3> corners;
+					for (unsigned int corner = 0; corner < 3; corner++)
+					{
+						corners[corner] = glm::dvec3(vertices[triangle[corner]].Position);
+					}
+					glm::dvec3 before = TriangleNormal(corners[0], corners[1], corners[2]);
+					for (unsigned int corner = 0; corner < 3; corner++)
+					{
+						if (triangle[corner] == from)
+						{
+							corners[corner] = target;
+						}
+					}
+					glm::dvec3 after = TriangleNormal(corners[0], corners[1], corners[2]);
+					double lengths = glm::length(before) * glm::length(after);
+					if (lengths <= 0.0 || glm::dot(before, after) < MIN_NORMAL_COS * lengths)
+					{
+						return false;
+					}
+				}
+				return true;
+			};
+
+			// the cheapest collapse of every vertex that may move
+			collapses.clear();
+			for (unsigned int from = 0; from < numVertices; from++)
+			{
+				if (triangleOffsets[from] == triangleOffsets[from + 1] || isLockedPosition[positions[from]])
+				{
+					continue;
+				}
+
+				Collapse best{ INFINITY, 0.0, from, from };
+				for (unsigned int k = triangleOffsets[from]; k < triangleOffsets[from + 1]; k++)
+				{
+					for (unsigned int corner = 0; corner < 3; corner++)
+					{
+						unsigned int to = current[3 * vertexTriangles[k] + corner];
+						if (to == from)
+						{
+							continue;
+						}
+
+						const Core::Vertex& a = vertices[from];
+						const Core::Vertex& b = vertices[to];
+						double error = EvaluateQuadric(quadrics[from], glm::dvec3(b.Position));
+						glm::vec3 normalDifference = a.Normal - b.Normal;
+						glm::vec2 texCoordDifference = a.TextureCoordinates - b.TextureCoordinates;
+						double cost = error + attributeScale * (glm::dot(normalDifference, normalDifference) + glm::dot(texCoordDifference, texCoordDifference));
+						if (cost < best.Cost && keepsOrientation(from, to))
+						{
+							best = { cost, error, from, to };
+						}
+					}
+				}
+
+				if (best.To != from)
+				{
+					collapses.push_back(best);
+				}
+			}
+			std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.Cost < b.Cost; });
+
+			// cheapest first, and none next to another one of this pass, which would invalidate its orientation check
+			std::fill(isTouched.begin(), isTouched.end(), false);
+			for (unsigned int v = 0; v < numVertices; v++)
+			{
+				remap[v] = v;
+			}
+			size_t numRemoved = 0;
+			size_t numCollapsed = 0;
+			for (const Collapse& collapse : collapses)
+			{
+				if (isTouched[collapse.From] || isTouched[collapse.To])
+				{
+					continue;
+				}
+
+				for (unsigned int k = triangleOffsets[collapse.From]; k < triangleOffsets[collapse.From + 1]; k++)
+				{
+					const unsigned int* triangle = &current[3 * vertexTriangles[k]];
+					bool hasTarget = false;
+					for (unsigned int corner = 0; corner < 3; corner++)
+					{
+						isTouched[triangle[corner]] = true;
+						hasTarget = hasTarget || triangle[corner] == collapse.To;
+					}
+					numRemoved += hasTarget ? 1 : 0;
+				}
+
+				remap[collapse.From] = collapse.To;
+				AddQuadric(quadrics[collapse.To], quadrics[collapse.From]);
+				maxError = std::max(maxError, collapse.Error);
+				numCollapsed++;
+
+				if (numTriangles - numRemoved <= targetTriangles)
+				{
+					break;
+				}
+			}
+
+			if (numCollapsed == 0)
+			{
+				break;
+			}
+
+			size_t numKept = 0;
+			for (size_t i = 0; i < current.size(); i += 3)
+			{
+				unsigned int a = remap[current[i]];
+				unsigned int b = remap[current[i + 1]];
+				unsigned int c = remap[current[i + 2]];
+				if (a != b && b != c && a != c)
+				{
+					current[numKept++] = a;
+					current[numKept++] = b;
+					current[numKept++] = c;
+				}
+			}
+			current.resize(numKept);
+			numTriangles = numKept / 3;
+		}
+
+		if (numTriangles > previousTriangles * MAX_LOD_RATIO)
+		{
+			break;
+		}
+
+		lods.push_back({ static_cast<unsigned int>(indices.size()), static_cast<unsigned int>(current.size()), static_cast<float>(std::sqrt(maxError)) });
+		indices.insert(indices.end(), current.begin(), current.end());
+
+		if (numTriangles <= MIN_LOD_TRIANGLES)
+		{
+			break;
+		}
+	}
+
+	if (lods.size() < 2)
+	{
+		return {};
+	}
+	return lods;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <vector>
+#include "CoreTypes.h"
+
+// Levels of detail a mesh keeps at most, the full resolution one included
+static constexpr unsigned int MAX_MESH_LODS = 4;
+
+// A range of the index buffer of a mesh that draws one level of detail
+struct MeshLod
+{
+	unsigned int FirstIndex;
+	unsigned int NumIndices;
+	// estimated deviation from the full resolution surface, in model units
+	float Error;
+};
+
+// Simplifies the triangles with quadric error metric edge collapses, every level keeping about half the triangles
+// of the previous one, and appends the coarser index lists to indices. Vertices only collapse onto their neighbours,
+// so all levels share the vertex buffer. Vertices on texture coordinate or normal seams and on open borders never move,
+// and the attribute difference of a collapse adds to its cost. Returns the ranges of all levels, the first one being
+// the original triangles, or nothing for meshes too small to be worth simplifying.
+std::vector<MeshLod> BuildMeshLods(const std::vector<Core::Vertex>& vertices, std::vector<unsigned int>& indices, unsigned int maxLods = MAX_MESH_LODS);
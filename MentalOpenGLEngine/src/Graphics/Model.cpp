@@ -2,6 +2,8 @@
 
 #include <iostream>
 #include <format>
+#include <chrono>
+#include <algorithm>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
@@ -20,17 +22,14 @@ Model::~Model()
 }
 
 Model::Model(bool flipTexturesVertically) :
-	mFlipTexturesVertically(flipTexturesVertically), mInstanceMatrixVBO(0u)
+	mInstanceMatrixVBO(0u), mFlipTexturesVertically(flipTexturesVertically), mTriangleSortingEnabled(false), mLodGenerationEnabled(true), mLodBuildMs(0.0)
 {
 
 }
 
 void Model::Draw(ShaderProgram& shader)
 {
-	glm::mat4 modelMat(1.0f);
-	modelMat = glm::translate(modelMat, mTransform.Position);
-	modelMat = glm::rotate(modelMat, glm::radians(mTransform.RotationAngle), mTransform.RotationAxis);
-	modelMat = glm::scale(modelMat, mTransform.Scale);
+	glm::mat4 modelMat = GetModelMatrix();
 
 	shader.SetUniformMat4("uModel", glm::value_ptr(modelMat));
 
@@ -73,6 +72,15 @@ void Model::DrawInstanced(ShaderProgram& shader, int n)
 	}
 }
 
+glm::mat4 Model::GetModelMatrix() const
+{
+	glm::mat4 modelMat(1.0f);
+	modelMat = glm::translate(modelMat, mTransform.Position);
+	modelMat = glm::rotate(modelMat, glm::radians(mTransform.RotationAngle), mTransform.RotationAxis);
+	modelMat = glm::scale(modelMat, mTransform.Scale);
+	return modelMat;
+}
+
 bool Model::HasTexture(Core::TextureType type) const
 {
 	return false;
@@ -138,9 +146,61 @@ void Model::Load(const std::string& path)
 	mDirectory = path.substr(0, path.find_last_of('/'));
 
 	mMeshes.reserve(scene->mNumMeshes);
+	mLodBuildMs = 0.0;
 	ProcessNode(scene->mRootNode, scene);
 
 	std::cout << "Assimp: Loaded model " << path << std::endl;
+
+	unsigned int numLods = GetNumLods();
+	if (numLods > 1)
+	{
+		// the error is relative to the size of the model, the largest of any of its meshes
+		Core::BoundingBox bounds = mMeshes[0]->GetBounds();
+		for (const std::shared_ptr<Mesh>& mesh : mMeshes)
+		{
+			bounds.Min = glm::min(bounds.Min, mesh->GetBounds().Min);
+			bounds.Max = glm::max(bounds.Max, mesh->GetBounds().Max);
+		}
+		float size = glm::length(bounds.Max - bounds.Min);
+
+		std::string levels;
+		for (unsigned int lod = 0; lod < numLods; lod++)
+		{
+			float error = size > 0.0f ? 100.0f * GetLodError(lod) / size : 0.0f;
+			levels += std::format("{}{} triangles ({:.3f}% error)", lod > 0 ? ", " : "", GetNumTriangles(lod), error);
+		}
+		std::cout << std::format("LODs of {} built in {:.1f} ms: {}\n", path, mLodBuildMs, levels);
+	}
+}
+
+unsigned int Model::GetNumLods() const
+{
+	unsigned int numLods = 0;
+	for (const std::shared_ptr<Mesh>& mesh : mMeshes)
+	{
+		numLods = std::max(numLods, mesh->GetNumLods());
+	}
+	return numLods;
+}
+
+unsigned int Model::GetNumTriangles(unsigned int lod) const
+{
+	unsigned int numTriangles = 0;
+	for (const std::shared_ptr<Mesh>& mesh : mMeshes)
+	{
+		numTriangles += mesh->GetNumTriangles(std::min(lod, mesh->GetNumLods() - 1));
+	}
+	return numTriangles;
+}
+
+float Model::GetLodError(unsigned int lod) const
+{
+	float error = 0.0f;
+	for (const std::shared_ptr<Mesh>& mesh : mMeshes)
+	{
+		error = std::max(error, mesh->GetLod(std::min(lod, mesh->GetNumLods() - 1)).Error);
+	}
+	return error;
 }
 
 void Model::ProcessNode(aiNode* node, const aiScene* scene)
@@ -215,7 +275,22 @@ void Model::ProcessMesh(aiMesh* mesh, const aiScene* scene, std::shared_ptr<Mesh
 		textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
 	}
 
-	resMesh->Setup(vertices, indices, textures);
+	// sorting reorders the full resolution triangles only, before the coarser levels are appended
+	if (mTriangleSortingEnabled)
+	{
+		resMesh->SetupTriangleSorting(vertices, indices);
+	}
+
+	std::vector<MeshLod> lods;
+	if (mLodGenerationEnabled)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		lods = BuildMeshLods(vertices, indices);
+		auto end = std::chrono::high_resolution_clock::now();
+		mLodBuildMs += std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	resMesh->Setup(vertices, indices, textures, lods);
 }
 
 void Model::AddDefaultTexture(std::vector<Core::Texture>* textures, Core::TextureType textureType)
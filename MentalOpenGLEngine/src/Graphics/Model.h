@@ -18,9 +18,21 @@ public:
 	void Draw(ShaderProgram& shader, const glm::mat4& modelMat);
 	void DrawInstanced(ShaderProgram& shader, int n);
 
+	// Must be called before Load, keeps the triangles needed for Mesh::SortTriangles
+	inline void SetTriangleSortingEnabled(bool enabled) { mTriangleSortingEnabled = enabled; }
+	// Must be called before Load, on by default; meshes too small to simplify keep a single level
+	inline void SetLodGenerationEnabled(bool enabled) { mLodGenerationEnabled = enabled; }
+	glm::mat4 GetModelMatrix() const;
+
 	inline bool HasTextures() const { return mLoadedTextures.size() > 0; }
 	bool HasTexture(Core::TextureType type) const;
 	inline const Core::Transform& GetTransform() const { return mTransform; }
+	inline const std::vector<std::shared_ptr<Mesh>>& GetMeshes() const { return mMeshes; }
+	// over all meshes, the ones with fewer levels count with their coarsest
+	unsigned int GetNumLods() const;
+	unsigned int GetNumTriangles(unsigned int lod = 0) const;
+	// the largest error of any mesh at that level, in model units
+	float GetLodError(unsigned int lod) const;
 	void SetDefaultTexture(const Core::Texture& texture);
 	void SetTransform(const Core::Transform& transform);
 	bool HasDefaultTexture(Core::TextureType textureType) const;
@@ -39,6 +51,9 @@ private:
 
 	unsigned int mInstanceMatrixVBO;
 	bool mFlipTexturesVertically;
+	bool mTriangleSortingEnabled;
+	bool mLodGenerationEnabled;
+	double mLodBuildMs;
 	Core::Transform mTransform;
 	std::vector <std::shared_ptr<Mesh>> mMeshes;
 	std::string mDirectory;
@@ -0,0 +1,102 @@
+#include "MomentShadowMap.h"
+#include <glad/glad.h>
+#include <iostream>
+#include <algorithm>
+#include "Utils.h"
+
+MomentShadowMap::MomentShadowMap() :
+	mResolution(0), mNumLayers(0),
+	mFBO(0), mTextureId(0),
+	mScratchFBOs{}, mScratchTextures{}
+{
+}
+
+MomentShadowMap::~MomentShadowMap()
+{
+	glDeleteFramebuffers(1, &mFBO);
+	glDeleteTextures(1, &mTextureId);
+	glDeleteFramebuffers(2, mScratchFBOs);
+	glDeleteTextures(2, mScratchTextures);
+}
+
+void MomentShadowMap::Build(unsigned int resolution, unsigned int numLayers)
+{
+	glDeleteFramebuffers(1, &mFBO);
+	glDeleteTextures(1, &mTextureId);
+	glDeleteFramebuffers(2, mScratchFBOs);
+	glDeleteTextures(2, mScratchTextures);
+
+	mResolution = resolution;
+	mNumLayers = numLayers;
+
+	unsigned int numMips = 1;
+	while ((resolution >> numMips) > 0)
+	{
+		numMips++;
+	}
+
+	glGenTextures(1, &mTextureId);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, mTextureId);
+	for (unsigned int mip = 0; mip < numMips; mip++)
+	{
+		unsigned int size = std::max(resolution >> mip, 1u);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, mip, GL_RGBA32F, size, size, numLayers, 0, GL_RGBA, GL_FLOAT, 0);
+	}
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	if (GLAD_GL_VERSION_4_6 || GLHasExtension("GL_EXT_texture_filter_anisotropic"))
+	{
+		glTexParameterf(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_ANISOTROPY, 8.0f);
+	}
+
+	glGenFramebuffers(1, &mFBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, mTextureId, 0, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ERROR: Moment shadow map Framebuffer is not complete" << std::endl;
+	}
+
+	glGenFramebuffers(2, mScratchFBOs);
+	glGenTextures(2, mScratchTextures);
+	for (unsigned int i = 0; i < 2; i++)
+	{
+		glBindTexture(GL_TEXTURE_2D, mScratchTextures[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, resolution, resolution, 0, GL_RGBA, GL_FLOAT, 0);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, mScratchFBOs[i]);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mScratchTextures[i], 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "ERROR: Moment shadow map scratch Framebuffer is not complete" << std::endl;
+		}
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void MomentShadowMap::BindScratch(unsigned int index)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, mScratchFBOs[index]);
+}
+
+void MomentShadowMap::BindLayer(unsigned int layer)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, mTextureId, 0, layer);
+}
+
+void MomentShadowMap::GenerateMipmaps()
+{
+	glBindTexture(GL_TEXTURE_2D_ARRAY, mTextureId);
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
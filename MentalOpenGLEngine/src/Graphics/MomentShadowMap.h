@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+
+// Exponentially warped depth moments of the shadow cascades, stored as the mipmapped layers of an RGBA32F
+// texture array. The moments are linear in the depth distribution, so they can be blurred and mipmapped
+// like colours, and the lighting pass filters the shadow with a single trilinear fetch.
+class MomentShadowMap
+{
+public:
+	MomentShadowMap();
+	virtual ~MomentShadowMap();
+
+	void Build(unsigned int resolution, unsigned int numLayers);
+	// full resolution scratch targets for the separable blur
+	void BindScratch(unsigned int index);
+	void BindLayer(unsigned int layer);
+	void GenerateMipmaps();
+
+	inline unsigned int GetResolution() const { return mResolution; }
+	inline unsigned int GetNumLayers() const { return mNumLayers; }
+	inline unsigned int GetTextureId() const { return mTextureId; }
+	inline unsigned int GetScratchTextureId(unsigned int index) const { return mScratchTextures[index]; }
+	// the mip chain adds a third, the scratch targets two more layers
+	inline size_t GetMemorySize() const { return size_t(mResolution) * mResolution * 4 * sizeof(float) * (mNumLayers * 4 / 3 + 2); }
+
+private:
+	unsigned int mResolution, mNumLayers;
+	unsigned int mFBO, mTextureId;
+	unsigned int mScratchFBOs[2], mScratchTextures[2];
+};
@@ -0,0 +1,91 @@
+#include "OITFrameBuffer.h"
+#include <glad/glad.h>
+#include <iostream>
+
+OITFrameBuffer::OITFrameBuffer() :
+	mWidth(0),
+	mHeight(0),
+	mFrameBufferId(0),
+	mAccumulationTextureId(0),
+	mWeightTextureId(0)
+{
+}
+
+OITFrameBuffer::~OITFrameBuffer()
+{
+	Release();
+}
+
+void OITFrameBuffer::Create(int width, int height, unsigned int depthRenderBufferId)
+{
+	Release();
+
+	mWidth = width;
+	mHeight = height;
+
+	glGenFramebuffers(1, &mFrameBufferId);
+	glBindFramebuffer(GL_FRAMEBUFFER, mFrameBufferId);
+
+	glGenTextures(1, &mAccumulationTextureId);
+	glBindTexture(GL_TEXTURE_2D, mAccumulationTextureId);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mAccumulationTextureId, 0);
+
+	glGenTextures(1, &mWeightTextureId);
+	glBindTexture(GL_TEXTURE_2D, mWeightTextureId);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, width, height, 0, GL_RED, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, mWeightTextureId, 0);
+
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderBufferId);
+
+	unsigned int attachments[2]{
+		GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1
+	};
+	glDrawBuffers(2, attachments);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Error: OIT Framebuffer is not complete" << std::endl;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void OITFrameBuffer::Release()
+{
+	glDeleteFramebuffers(1, &mFrameBufferId);
+
+	unsigned int textureIds[2]{
+		mAccumulationTextureId,
+		mWeightTextureId
+	};
+	glDeleteTextures(2, textureIds);
+}
+
+void OITFrameBuffer::Bind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, mFrameBufferId);
+}
+
+void OITFrameBuffer::Unbind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void OITFrameBuffer::Clear()
+{
+	// nothing accumulated and full revealage, the depth is the opaque scene and stays untouched
+	const float accumulationClear[4]{ 0.0f, 0.0f, 0.0f, 1.0f };
+	const float weightClear[4]{ 0.0f, 0.0f, 0.0f, 0.0f };
+	glClearBufferfv(GL_COLOR, 0, accumulationClear);
+	glClearBufferfv(GL_COLOR, 1, weightClear);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+// Render targets for weighted blended order-independent transparency. GL 3.3 has a single blend state
+// for all draw buffers, so the revealage product rides in the alpha of the accumulation target
+// (blended multiplicatively) while the sum of the alpha weights goes to a separate additive target.
+// The depth buffer is shared with the lighting framebuffer, so transparent fragments are tested against the opaque scene.
+class OITFrameBuffer
+{
+public:
+	OITFrameBuffer();
+	virtual ~OITFrameBuffer();
+
+	void Create(int width, int height, unsigned int depthRenderBufferId);
+
+	void Bind();
+	void Unbind();
+	void Clear();
+
+	inline unsigned int GetAccumulationTextureId() const { return mAccumulationTextureId; }
+	inline unsigned int GetWeightTextureId() const { return mWeightTextureId; }
+	inline unsigned int GetFrameBufferId() const { return mFrameBufferId; }
+
+private:
+	void Release();
+
+	int mWidth, mHeight;
+
+	unsigned int mFrameBufferId;
+	unsigned int mAccumulationTextureId;
+	unsigned int mWeightTextureId;
+};
@@ -0,0 +1,168 @@
+#include "PointShadowCache.h"
+#include <glad/glad.h>
+#include <algorithm>
+
+// lights closer than this to their cached position keep the cache
+static constexpr float LIGHT_MOVE_THRESHOLD = 1e-4f;
+
+PointShadowCache::PointShadowCache() :
+	mResolution(0),
+	mFormat(DepthMap::Depth32),
+	mUpdateBudget(2),
+	mCachingEnabled(true),
+	mCopyFBOs{},
+	mBoundMap(nullptr)
+{
+}
+
+PointShadowCache::~PointShadowCache()
+{
+	glDeleteFramebuffers(2, mCopyFBOs);
+}
+
+void PointShadowCache::Build(unsigned int resolution, unsigned int numLights, DepthMap::DepthMapFormat format)
+{
+	mResolution = resolution;
+	mFormat = format;
+	mEntries.clear();
+	mEntries.resize(numLights);
+	for (Entry& entry : mEntries)
+	{
+		entry.StaticMap = std::make_unique<DepthMap>();
+		entry.StaticMap->Build(resolution, resolution, DepthMap::Point, format);
+		entry.ShadowMap = std::make_unique<DepthMap>();
+		entry.ShadowMap->Build(resolution, resolution, DepthMap::Point, format);
+
+		// lights that have not been rendered yet cast no shadows rather than garbage
+		for (DepthMap* depthMap : { entry.StaticMap.get(), entry.ShadowMap.get() })
+		{
+			depthMap->Bind();
+			glClear(GL_DEPTH_BUFFER_BIT);
+		}
+	}
+
+	// read and draw framebuffers for copying cube faces when glCopyImageSubData is not available
+	if (mCopyFBOs[0] == 0)
+	{
+		glGenFramebuffers(2, mCopyFBOs);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, mCopyFBOs[0]);
+		glReadBuffer(GL_NONE);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mCopyFBOs[1]);
+		glDrawBuffer(GL_NONE);
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void PointShadowCache::BeginFrame(const glm::vec3* lightPositions, uint64_t staticHash, bool hasDynamicCasters)
+{
+	mStats = {};
+	mStaticUpdates.clear();
+	mCompositeUpdates.clear();
+
+	if (!mCachingEnabled)
+	{
+		for (unsigned int i = 0; i < mEntries.size(); i++)
+		{
+			mEntries[i].IsStaticValid = false;
+			mCompositeUpdates.push_back(i);
+		}
+		mStats.NumCompositeUpdates = static_cast<unsigned int>(mCompositeUpdates.size());
+		return;
+	}
+
+	for (unsigned int i = 0; i < mEntries.size(); i++)
+	{
+		Entry& entry = mEntries[i];
+		bool isStale = !entry.IsStaticValid || entry.CachedStaticHash != staticHash ||
+			glm::distance(entry.CachedPosition, lightPositions[i]) > LIGHT_MOVE_THRESHOLD;
+		if (isStale)
+		{
+			mStaticUpdates.push_back(i);
+		}
+	}
+
+	// the longest waiting lights get the budget, the rest keep their old cache for another frame
+	std::stable_sort(mStaticUpdates.begin(), mStaticUpdates.end(), [this](unsigned int a, unsigned int b) {
+		return mEntries[a].FramesWaiting > mEntries[b].FramesWaiting;
+	});
+	if (mStaticUpdates.size() > mUpdateBudget)
+	{
+		for (size_t i = mUpdateBudget; i < mStaticUpdates.size(); i++)
+		{
+			mEntries[mStaticUpdates[i]].FramesWaiting++;
+		}
+		mStats.NumDeferredUpdates = static_cast<unsigned int>(mStaticUpdates.size() - mUpdateBudget);
+		mStaticUpdates.resize(mUpdateBudget);
+	}
+
+	for (unsigned int light : mStaticUpdates)
+	{
+		Entry& entry = mEntries[light];
+		entry.CachedPosition = lightPositions[light];
+		entry.CachedStaticHash = staticHash;
+		entry.FramesWaiting = 0;
+		entry.IsStaticValid = true;
+		entry.IsShadowValid = false;
+	}
+
+	// without dynamic casters an untouched shadow map is still correct
+	for (unsigned int i = 0; i < mEntries.size(); i++)
+	{
+		if (hasDynamicCasters || !mEntries[i].IsShadowValid)
+		{
+			mCompositeUpdates.push_back(i);
+			mEntries[i].IsShadowValid = true;
+		}
+	}
+
+	mStats.NumStaticUpdates = static_cast<unsigned int>(mStaticUpdates.size());
+	mStats.NumCompositeUpdates = static_cast<unsigned int>(mCompositeUpdates.size());
+}
+
+void PointShadowCache::BindStatic(unsigned int light)
+{
+	mBoundMap = mEntries[light].StaticMap.get();
+	mBoundMap->Bind();
+}
+
+void PointShadowCache::BindFace(unsigned int face)
+{
+	mBoundMap->BindFace(face);
+}
+
+void PointShadowCache::BeginComposite(unsigned int light)
+{
+	Entry& entry = mEntries[light];
+	mBoundMap = entry.ShadowMap.get();
+	if (!mCachingEnabled)
+	{
+		entry.ShadowMap->Bind();
+		glClear(GL_DEPTH_BUFFER_BIT);
+		return;
+	}
+
+	unsigned int source = entry.StaticMap->GetTextureColorId();
+	unsigned int destination = entry.ShadowMap->GetTextureColorId();
+	if (GLAD_GL_VERSION_4_3)
+	{
+		glCopyImageSubData(
+			source, GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0,
+			destination, GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0,
+			mResolution, mResolution, 6
+		);
+	}
+	else
+	{
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, mCopyFBOs[0]);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mCopyFBOs[1]);
+		for (unsigned int face = 0; face < 6; face++)
+		{
+			glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, source, 0);
+			glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, destination, 0);
+			glBlitFramebuffer(0, 0, mResolution, mResolution, 0, 0, mResolution, mResolution, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+		}
+	}
+
+	entry.ShadowMap->Bind();
+}
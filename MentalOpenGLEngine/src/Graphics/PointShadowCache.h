@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "DepthMap.h"
+
+// Point light shadow cubemaps split into a cached static layer and a per-frame dynamic layer.
+// Static casters are rendered into the cache only when the light or a static caster moved, every frame the cache
+// is copied into the shadow map sampled by the lighting pass and the dynamic casters are drawn on top of it.
+// Static refreshes are limited by a per-frame budget, the lights that waited the longest go first.
+class PointShadowCache
+{
+public:
+	struct Stats
+	{
+		unsigned int NumStaticUpdates{ 0 };
+		unsigned int NumCompositeUpdates{ 0 };
+		unsigned int NumDeferredUpdates{ 0 };
+	};
+
+	PointShadowCache();
+	virtual ~PointShadowCache();
+
+	void Build(unsigned int resolution, unsigned int numLights, DepthMap::DepthMapFormat format = DepthMap::Depth32);
+	void BeginFrame(const glm::vec3* lightPositions, uint64_t staticHash, bool hasDynamicCasters);
+	void BindStatic(unsigned int light);
+	void BeginComposite(unsigned int light);
+	void BindFace(unsigned int face);
+
+	inline void SetCachingEnabled(bool enabled) { mCachingEnabled = enabled; }
+	inline bool IsCachingEnabled() const { return mCachingEnabled; }
+	inline void SetUpdateBudget(unsigned int maxStaticUpdatesPerFrame) { mUpdateBudget = maxStaticUpdatesPerFrame; }
+	inline unsigned int GetUpdateBudget() const { return mUpdateBudget; }
+
+	// lights whose static layer has to be re-rendered this frame
+	inline const std::vector<unsigned int>& GetStaticUpdates() const { return mStaticUpdates; }
+	// lights whose shadow map has to be recomposed this frame
+	inline const std::vector<unsigned int>& GetCompositeUpdates() const { return mCompositeUpdates; }
+
+	inline unsigned int GetTextureId(unsigned int light) const { return mEntries[light].ShadowMap->GetTextureColorId(); }
+	inline unsigned int GetResolution() const { return mResolution; }
+	inline DepthMap::DepthMapFormat GetFormat() const { return mFormat; }
+	inline const Stats& GetStats() const { return mStats; }
+	inline size_t GetMemorySize() const { return mEntries.size() * 2 * 6 * size_t(mResolution) * mResolution * DepthMap::GetBytesPerTexel(mFormat); }
+
+private:
+	struct Entry
+	{
+		std::unique_ptr<DepthMap> StaticMap;
+		std::unique_ptr<DepthMap> ShadowMap;
+		glm::vec3 CachedPosition{ 0.0f };
+		uint64_t CachedStaticHash{ 0 };
+		unsigned int FramesWaiting{ 0 };
+		bool IsStaticValid{ false };
+		bool IsShadowValid{ false };
+	};
+
+	unsigned int mResolution;
+	DepthMap::DepthMapFormat mFormat;
+	unsigned int mUpdateBudget;
+	bool mCachingEnabled;
+	unsigned int mCopyFBOs[2];
+	DepthMap* mBoundMap;
+
+	std::vector<Entry> mEntries;
+	std::vector<unsigned int> mStaticUpdates;
+	std::vector<unsigned int> mCompositeUpdates;
+	Stats mStats;
+};
@@ -0,0 +1,183 @@
+#include "ProgramBinaryCache.h"
+#include "Shader.h"
+
+#include <glad/glad.h>
+#include <iostream>
+#include <fstream>
+#include <format>
+#include <filesystem>
+#include <string_view>
+
+static constexpr uint32_t CACHE_FILE_MAGIC = 0x4e494250; // "PBIN"
+
+static constexpr uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+static constexpr uint64_t FNV_PRIME = 1099511628211ull;
+
+struct CacheFileHeader
+{
+	uint32_t Magic;
+	uint32_t BinaryFormat;
+	uint64_t SourceHash;
+	uint64_t BinarySize;
+};
+
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * FNV_PRIME;
+	}
+	return hash;
+}
+
+static uint64_t HashString(uint64_t hash, const char* string)
+{
+	std::string_view view(string ? string : "");
+	// the length separates consecutive strings, "ab" + "c" must not hash like "a" + "bc"
+	size_t length = view.size();
+	hash = HashBytes(hash, &length, sizeof(length));
+	return HashBytes(hash, view.data(), view.size());
+}
+
+std::string ProgramBinaryCache::mDirectory;
+uint64_t ProgramBinaryCache::mDriverHash(FNV_OFFSET_BASIS);
+bool ProgramBinaryCache::mSupported(false);
+bool ProgramBinaryCache::mEnabled(true);
+unsigned int ProgramBinaryCache::mNumHits(0);
+unsigned int ProgramBinaryCache::mNumMisses(0);
+
+void ProgramBinaryCache::Init(const std::string& directory)
+{
+	mDirectory = directory;
+
+	// core since 4.1, a 3.3 context only has the entry points when the driver exposes them anyway
+	GLint numFormats = 0;
+	if (glGetProgramBinary && glProgramBinary && glProgramParameteri)
+	{
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+	}
+	mSupported = numFormats > 0;
+	if (!mSupported)
+	{
+		std::cout << "Program binaries are not supported, shaders are compiled on every launch" << std::endl;
+		return;
+	}
+
+	mDriverHash = FNV_OFFSET_BASIS;
+	mDriverHash = HashString(mDriverHash, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+	mDriverHash = HashString(mDriverHash, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+	mDriverHash = HashString(mDriverHash, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+
+	std::error_code error;
+	std::filesystem::create_directories(mDirectory, error);
+	if (error)
+	{
+		std::cout << "Error: could not create the shader cache directory " << mDirectory << ": " << error.message() << std::endl;
+		mSupported = false;
+	}
+}
+
+uint64_t ProgramBinaryCache::HashSources(const std::vector<Shader>& shaders)
+{
+	uint64_t hash = mDriverHash;
+	for (const Shader& shader : shaders)
+	{
+		GLenum type = shader.GetType();
+		hash = HashBytes(hash, &type, sizeof(type));
+		// a program linked from SPIR-V is stored apart from the same program linked from GLSL
+		bool spirv = shader.IsSpirv();
+		hash = HashBytes(hash, &spirv, sizeof(spirv));
+		hash = HashString(hash, shader.GetSource());
+	}
+	return hash;
+}
+
+bool ProgramBinaryCache::Load(uint64_t sourceHash, unsigned int program)
+{
+	if (!IsEnabled())
+	{
+		return false;
+	}
+
+	std::ifstream stream(GetPath(sourceHash), std::ios::binary);
+	CacheFileHeader header{};
+	if (!stream || !stream.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+		header.Magic != CACHE_FILE_MAGIC || header.SourceHash != sourceHash)
+	{
+		mNumMisses++;
+		return false;
+	}
+
+	std::vector<char> binary(header.BinarySize);
+	if (!stream.read(binary.data(), binary.size()))
+	{
+		mNumMisses++;
+		return false;
+	}
+
+	glProgramBinary(program, header.BinaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+	GLint linkStatus = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+	if (linkStatus == GL_FALSE)
+	{
+		mNumMisses++;
+		return false;
+	}
+
+	mNumHits++;
+	return true;
+}
+
+void ProgramBinaryCache::MarkRetrievable(unsigned int program)
+{
+	if (IsEnabled())
+	{
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+}
+
+void ProgramBinaryCache::Store(uint64_t sourceHash, unsigned int program)
+{
+	if (!IsEnabled())
+	{
+		return;
+	}
+
+	GLint binaryLength = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
+	if (binaryLength <= 0)
+	{
+		return;
+	}
+
+	std::vector<char> binary(binaryLength);
+	GLenum binaryFormat = 0;
+	glGetProgramBinary(program, binaryLength, nullptr, &binaryFormat, binary.data());
+
+	CacheFileHeader header{ CACHE_FILE_MAGIC, binaryFormat, sourceHash, binary.size() };
+	std::ofstream stream(GetPath(sourceHash), std::ios::binary | std::ios::trunc);
+	stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	stream.write(binary.data(), binary.size());
+	if (!stream)
+	{
+		std::cout << "Error: could not write the program binary " << GetPath(sourceHash) << std::endl;
+	}
+}
+
+void ProgramBinaryCache::Clear()
+{
+	std::error_code error;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(mDirectory, error))
+	{
+		if (entry.path().extension() == ".bin")
+		{
+			std::filesystem::remove(entry.path(), error);
+		}
+	}
+}
+
+std::string ProgramBinaryCache::GetPath(uint64_t sourceHash)
+{
+	return std::format("{}/{:016x}.bin", mDirectory, sourceHash);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+class Shader;
+
+// Linked program binaries on disk, one file per program. The key hashes the source of every stage (defines
+// included, they are part of the source) together with the GL vendor, renderer and version strings, so an
+// edited shader or an updated driver misses instead of loading a stale binary. The driver may still reject
+// a binary it wrote itself, the program is then compiled from source as usual and the file rewritten.
+class ProgramBinaryCache
+{
+public:
+	// needs a current context, leaves the cache disabled when the driver offers no binary formats
+	static void Init(const std::string& directory);
+
+	inline static void SetEnabled(bool enabled) { mEnabled = enabled; }
+	inline static bool IsEnabled() { return mEnabled && mSupported; }
+
+	static uint64_t HashSources(const std::vector<Shader>& shaders);
+	// links the program from the stored binary, false when there is none or the driver rejects it
+	static bool Load(uint64_t sourceHash, unsigned int program);
+	// has to be called before linking a program that is going to be stored
+	static void MarkRetrievable(unsigned int program);
+	static void Store(uint64_t sourceHash, unsigned int program);
+	// removes every stored binary
+	static void Clear();
+
+	inline static void ResetStats() { mNumHits = 0; mNumMisses = 0; }
+	inline static unsigned int GetNumHits() { return mNumHits; }
+	inline static unsigned int GetNumMisses() { return mNumMisses; }
+
+private:
+	static std::string GetPath(uint64_t sourceHash);
+
+	static std::string mDirectory;
+	static uint64_t mDriverHash;
+	static bool mSupported;
+	static bool mEnabled;
+	static unsigned int mNumHits;
+	static unsigned int mNumMisses;
+};
@@ -0,0 +1,120 @@
+#include "RadixSort.h"
+
+#include <algorithm>
+#include <array>
+#include <barrier>
+#include <thread>
+
+static constexpr unsigned int RADIX_BITS = 8;
+static constexpr unsigned int RADIX_SIZE = 1 << RADIX_BITS;
+static constexpr unsigned int NUM_PASSES = 64 / RADIX_BITS;
+static constexpr size_t MIN_ITEMS_PER_THREAD = 16384;
+
+using Histogram = std::array<size_t, RADIX_SIZE>;
+
+static inline unsigned int Digit(uint64_t key, unsigned int pass)
+{
+	return static_cast<unsigned int>((key >> (pass * RADIX_BITS)) & (RADIX_SIZE - 1));
+}
+
+// Turns per-thread digit counts into per-thread scatter offsets.
+// Returns false when all keys share the digit and the pass can be skipped.
+static bool ComputeOffsets(std::vector<Histogram>& histograms, size_t numItems)
+{
+	size_t offset = 0;
+	for (unsigned int digit = 0; digit < RADIX_SIZE; digit++)
+	{
+		size_t digitTotal = 0;
+		for (Histogram& histogram : histograms)
+		{
+			size_t count = histogram[digit];
+			histogram[digit] = offset;
+			offset += count;
+			digitTotal += count;
+		}
+
+		if (digitTotal == numItems)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void RadixSort(std::vector<SortItem>& items, std::vector<SortItem>& scratch, unsigned int numThreads)
+{
+	size_t numItems = items.size();
+	if (numItems < 2)
+	{
+		return;
+	}
+
+	scratch.resize(numItems);
+
+	if (numThreads == 0)
+	{
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	numThreads = static_cast<unsigned int>(std::clamp<size_t>(numItems / MIN_ITEMS_PER_THREAD, 1, numThreads));
+
+	std::vector<Histogram> histograms(numThreads);
+	std::barrier sync(static_cast<std::ptrdiff_t>(numThreads));
+	bool doPass = true;
+	unsigned int numPassesDone = 0;
+
+	auto worker = [&](unsigned int thread) {
+		size_t begin = numItems * thread / numThreads;
+		size_t end = numItems * (thread + 1) / numThreads;
+		SortItem* src = items.data();
+		SortItem* dst = scratch.data();
+		Histogram& histogram = histograms[thread];
+
+		for (unsigned int pass = 0; pass < NUM_PASSES; pass++)
+		{
+			histogram.fill(0);
+			for (size_t i = begin; i < end; i++)
+			{
+				histogram[Digit(src[i].Key, pass)]++;
+			}
+			sync.arrive_and_wait();
+
+			if (thread == 0)
+			{
+				doPass = ComputeOffsets(histograms, numItems);
+				numPassesDone += doPass ? 1 : 0;
+			}
+			sync.arrive_and_wait();
+
+			if (!doPass)
+			{
+				continue;
+			}
+
+			// every thread scatters its own chunk in order, which keeps the sort stable
+			for (size_t i = begin; i < end; i++)
+			{
+				dst[histogram[Digit(src[i].Key, pass)]++] = src[i];
+			}
+			std::swap(src, dst);
+			sync.arrive_and_wait();
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(numThreads - 1);
+	for (unsigned int i = 1; i < numThreads; i++)
+	{
+		threads.emplace_back(worker, i);
+	}
+	worker(0);
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+
+	if (numPassesDone % 2 == 1)
+	{
+		items.swap(scratch);
+	}
+}
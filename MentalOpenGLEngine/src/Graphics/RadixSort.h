@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <bit>
+
+struct SortItem
+{
+	uint64_t Key;
+	uint32_t Index;
+};
+
+// Stable LSD radix sort on the 64-bit keys, 8 bits per pass. Passes in which every key has
+// the same digit are skipped, so narrow keys only pay for the bytes they actually use.
+// numThreads = 0 uses every hardware thread; small inputs are always sorted on the calling thread.
+void RadixSort(std::vector<SortItem>& items, std::vector<SortItem>& scratch, unsigned int numThreads = 0);
+
+// Maps a float to an unsigned integer with the same ordering, so floats can be radix sorted
+inline uint32_t FloatToSortableUint(float value)
+{
+	uint32_t bits = std::bit_cast<uint32_t>(value);
+	uint32_t mask = (bits & 0x80000000u) ? 0xFFFFFFFFu : 0x80000000u;
+	return bits ^ mask;
+}
@@ -0,0 +1,298 @@
+#include "SMAAFrameBuffer.h"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+// short lines keep a rounder revectorization, it blends into the plain one up to this length
+static constexpr float AREA_SMOOTH_MAX_DISTANCE = 32.0f;
+
+// the crossing edges at both ends of a line, as the area lookup indexes them: 0 none, 1 above, 3 below, 4 both
+static constexpr int ORTHO_PATTERN_EDGES[16][2]{
+	{ 0, 0 }, { 3, 0 }, { 0, 3 }, { 3, 3 }, { 1, 0 }, { 4, 0 }, { 1, 3 }, { 4, 3 },
+	{ 0, 1 }, { 3, 1 }, { 0, 4 }, { 3, 4 }, { 1, 1 }, { 4, 1 }, { 1, 4 }, { 4, 4 }
+};
+
+// area between the edge and the line p1->p2 over the pixel [x, x + 1], x for the side below the edge, y for above
+static glm::vec2 LineArea(const glm::vec2& p1, const glm::vec2& p2, float x)
+{
+	glm::vec2 d = p2 - p1;
+	float x1 = x;
+	float x2 = x + 1.0f;
+	float y1 = p1.y + d.y * (x1 - p1.x) / d.x;
+	float y2 = p1.y + d.y * (x2 - p1.x) / d.x;
+
+	bool inside = (x1 >= p1.x && x1 < p2.x) || (x2 > p1.x && x2 <= p2.x);
+	if (!inside)
+	{
+		return glm::vec2(0.0f);
+	}
+
+	bool isTrapezoid = std::copysign(1.0f, y1) == std::copysign(1.0f, y2) || std::abs(y1) < 1e-4f || std::abs(y2) < 1e-4f;
+	if (isTrapezoid)
+	{
+		float area = (y1 + y2) / 2.0f;
+		return area < 0.0f ? glm::vec2(std::abs(area), 0.0f) : glm::vec2(0.0f, std::abs(area));
+	}
+
+	// the line crosses the edge inside the pixel, one triangle on each side
+	float crossing = -p1.y * d.x / d.y + p1.x;
+	float integral = 0.0f;
+	float fraction = std::modf(crossing, &integral);
+	float a1 = crossing > p1.x ? y1 * fraction / 2.0f : 0.0f;
+	float a2 = crossing < p2.x ? y2 * (1.0f - fraction) / 2.0f : 0.0f;
+	float area = std::abs(a1) > std::abs(a2) ? a1 : -a2;
+	return area < 0.0f ? glm::vec2(std::abs(a1), std::abs(a2)) : glm::vec2(std::abs(a2), std::abs(a1));
+}
+
+static void SmoothArea(float d, glm::vec2& a1, glm::vec2& a2)
+{
+	glm::vec2 b1 = glm::sqrt(a1 * 2.0f) * 0.5f;
+	glm::vec2 b2 = glm::sqrt(a2 * 2.0f) * 0.5f;
+	float p = std::clamp(d / AREA_SMOOTH_MAX_DISTANCE, 0.0f, 1.0f);
+	a1 = glm::mix(b1, a1, p);
+	a2 = glm::mix(b2, a2, p);
+}
+
+// coverage for an edge pattern with the given distances to its left and right end, the line is
+// revectorized from the middle of the edge to the half pixel steps the crossing edges mark
+static glm::vec2 OrthoArea(int pattern, float left, float right)
+{
+	float d = left + right + 1.0f;
+	float o1 = 0.5f;
+	float o2 = -0.5f;
+
+	switch (pattern)
+	{
+	case 1:
+		// L shapes are only revectorized on the side of the crossing edge, to meet the plain edge smoothly
+		return left <= right ? LineArea({ 0.0f, o2 }, { d / 2.0f, 0.0f }, left) : glm::vec2(0.0f);
+	case 2:
+		return left >= right ? LineArea({ d / 2.0f, 0.0f }, { d, o2 }, left) : glm::vec2(0.0f);
+	case 3:
+	{
+		glm::vec2 a1 = LineArea({ 0.0f, o2 }, { d / 2.0f, 0.0f }, left);
+		glm::vec2 a2 = LineArea({ d / 2.0f, 0.0f }, { d, o2 }, left);
+		SmoothArea(d, a1, a2);
+		return a1 + a2;
+	}
+	case 4:
+		return left <= right ? LineArea({ 0.0f, o1 }, { d / 2.0f, 0.0f }, left) : glm::vec2(0.0f);
+	case 6:
+		return LineArea({ 0.0f, o1 }, { d, o2 }, left);
+	case 7:
+		return LineArea({ 0.0f, o1 }, { d, o2 }, left);
+	case 8:
+		return left >= right ? LineArea({ d / 2.0f, 0.0f }, { d, o1 }, left) : glm::vec2(0.0f);
+	case 9:
+		return LineArea({ 0.0f, o2 }, { d, o1 }, left);
+	case 11:
+		return LineArea({ 0.0f, o2 }, { d, o1 }, left);
+	case 12:
+	{
+		glm::vec2 a1 = LineArea({ 0.0f, o1 }, { d / 2.0f, 0.0f }, left);
+		glm::vec2 a2 = LineArea({ d / 2.0f, 0.0f }, { d, o1 }, left);
+		SmoothArea(d, a1, a2);
+		return a1 + a2;
+	}
+	case 13:
+		return LineArea({ 0.0f, o2 }, { d, o1 }, left);
+	case 14:
+		return LineArea({ 0.0f, o1 }, { d, o2 }, left);
+	default:
+		// no crossing edges or crossings on both sides of one end, nothing to revectorize
+		return glm::vec2(0.0f);
+	}
+}
+
+// the value a bilinear fetch a quarter texel left and an eighth texel above the current pixel returns for
+// four edges: e[0] above left, e[1] above, e[2] left, e[3] the current pixel; always a multiple of 1/32
+static int BilinearEdgeIndex(const int e[4])
+{
+	float above = e[0] * 0.25f + e[1] * 0.75f;
+	float current = e[2] * 0.25f + e[3] * 0.75f;
+	return static_cast<int>(std::round((above * 0.125f + current * 0.875f) * 32.0f));
+}
+
+// how many more pixels a search to the left gets to go past its last fetch
+static int SearchDeltaLeft(const int left[4], const int top[4])
+{
+	int d = 0;
+	if (top[3] == 1)
+	{
+		d++;
+	}
+	if (d == 1 && top[2] == 1 && left[1] != 1 && left[3] != 1)
+	{
+		d++;
+	}
+	return d;
+}
+
+static int SearchDeltaRight(const int left[4], const int top[4])
+{
+	int d = 0;
+	if (top[3] == 1 && left[1] != 1 && left[3] != 1)
+	{
+		d++;
+	}
+	if (d == 1 && top[2] == 1 && left[0] != 1 && left[2] != 1)
+	{
+		d++;
+	}
+	return d;
+}
+
+SMAAFrameBuffer::SMAAFrameBuffer() :
+	mWidth(0),
+	mHeight(0),
+	mEdgesFrameBufferId(0),
+	mEdgesTextureId(0),
+	mBlendWeightsFrameBufferId(0),
+	mBlendWeightsTextureId(0),
+	mAreaTextureId(0),
+	mSearchTextureId(0)
+{
+}
+
+SMAAFrameBuffer::~SMAAFrameBuffer()
+{
+	Release();
+	glDeleteTextures(1, &mAreaTextureId);
+	glDeleteTextures(1, &mSearchTextureId);
+}
+
+void SMAAFrameBuffer::CreateLookupTextures()
+{
+	// one AREA_MAX_DISTANCE square per crossing edge pattern, left distance along x and right along y
+	std::vector<unsigned char> area(AREA_TEXTURE_SIZE * AREA_TEXTURE_SIZE * 2, 0);
+	for (int pattern = 0; pattern < 16; pattern++)
+	{
+		for (int left = 0; left < AREA_MAX_DISTANCE; left++)
+		{
+			for (int right = 0; right < AREA_MAX_DISTANCE; right++)
+			{
+				glm::vec2 value = OrthoArea(pattern, static_cast<float>(left * left), static_cast<float>(right * right));
+				int x = ORTHO_PATTERN_EDGES[pattern][0] * AREA_MAX_DISTANCE + left;
+				int y = ORTHO_PATTERN_EDGES[pattern][1] * AREA_MAX_DISTANCE + right;
+				size_t texel = (size_t(y) * AREA_TEXTURE_SIZE + x) * 2;
+				area[texel] = static_cast<unsigned char>(std::round(std::clamp(value.x, 0.0f, 1.0f) * 255.0f));
+				area[texel + 1] = static_cast<unsigned char>(std::round(std::clamp(value.y, 0.0f, 1.0f) * 255.0f));
+			}
+		}
+	}
+
+	// every bilinear fetch value maps back to exactly one combination of four edges
+	int edgeCombinations[33][4]{};
+	bool isValidFetch[33]{};
+	for (int bits = 0; bits < 16; bits++)
+	{
+		int e[4]{ bits & 1, (bits >> 1) & 1, (bits >> 2) & 1, (bits >> 3) & 1 };
+		int index = BilinearEdgeIndex(e);
+		std::copy(e, e + 4, edgeCombinations[index]);
+		isValidFetch[index] = true;
+	}
+
+	// the fetched left edges along x, the top edges along y; left searches in the first half, right searches in the second
+	std::vector<unsigned char> search(SEARCH_TEXTURE_WIDTH * SEARCH_TEXTURE_HEIGHT, 0);
+	for (int y = 0; y < SEARCH_TEXTURE_HEIGHT; y++)
+	{
+		for (int x = 0; x < 33; x++)
+		{
+			if (isValidFetch[x] && isValidFetch[y])
+			{
+				search[y * SEARCH_TEXTURE_WIDTH + x] = static_cast<unsigned char>(127 * SearchDeltaLeft(edgeCombinations[x], edgeCombinations[y]));
+				search[y * SEARCH_TEXTURE_WIDTH + 33 + x] = static_cast<unsigned char>(127 * SearchDeltaRight(edgeCombinations[x], edgeCombinations[y]));
+			}
+		}
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	glGenTextures(1, &mAreaTextureId);
+	glBindTexture(GL_TEXTURE_2D, mAreaTextureId);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, AREA_TEXTURE_SIZE, AREA_TEXTURE_SIZE, 0, GL_RG, GL_UNSIGNED_BYTE, area.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glGenTextures(1, &mSearchTextureId);
+	glBindTexture(GL_TEXTURE_2D, mSearchTextureId);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, SEARCH_TEXTURE_WIDTH, SEARCH_TEXTURE_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, search.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void SMAAFrameBuffer::Create(int width, int height)
+{
+	Release();
+
+	mWidth = width;
+	mHeight = height;
+
+	// the searches read the edges bilinearly, one fetch tells apart the edges of two pixels
+	glGenTextures(1, &mEdgesTextureId);
+	glBindTexture(GL_TEXTURE_2D, mEdgesTextureId);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, width, height, 0, GL_RG, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glGenFramebuffers(1, &mEdgesFrameBufferId);
+	glBindFramebuffer(GL_FRAMEBUFFER, mEdgesFrameBufferId);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mEdgesTextureId, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Error: SMAA edges Framebuffer is not complete" << std::endl;
+	}
+
+	glGenTextures(1, &mBlendWeightsTextureId);
+	glBindTexture(GL_TEXTURE_2D, mBlendWeightsTextureId);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glGenFramebuffers(1, &mBlendWeightsFrameBufferId);
+	glBindFramebuffer(GL_FRAMEBUFFER, mBlendWeightsFrameBufferId);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mBlendWeightsTextureId, 0);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Error: SMAA blend weights Framebuffer is not complete" << std::endl;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void SMAAFrameBuffer::Release()
+{
+	glDeleteFramebuffers(1, &mEdgesFrameBufferId);
+	glDeleteFramebuffers(1, &mBlendWeightsFrameBufferId);
+
+	unsigned int textureIds[2]{
+		mEdgesTextureId,
+		mBlendWeightsTextureId
+	};
+	glDeleteTextures(2, textureIds);
+}
+
+void SMAAFrameBuffer::BindEdges()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, mEdgesFrameBufferId);
+}
+
+void SMAAFrameBuffer::BindBlendWeights()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, mBlendWeightsFrameBufferId);
+}
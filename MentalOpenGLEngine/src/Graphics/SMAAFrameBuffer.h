@@ -0,0 +1,44 @@
+#pragma once
+
+// Targets and lookup textures of SMAA 1x (orthogonal patterns, no diagonal or corner detection).
+// The edges pass writes a RG8 mask (left edge in r, top edge in g), the weights pass turns it into
+// per-pixel blend weights with the help of two lookup textures:
+//  - the area texture maps a crossing edge pattern and the distances to both ends of a line
+//    to the coverage of the revectorized line over the pixel,
+//  - the search texture tells how far a bilinear fetch of four edges lets a line search step back.
+// Both are computed on the CPU from the pattern geometry, once at startup, instead of shipping the images.
+class SMAAFrameBuffer
+{
+public:
+	SMAAFrameBuffer();
+	virtual ~SMAAFrameBuffer();
+
+	void CreateLookupTextures();
+	void Create(int width, int height);
+
+	void BindEdges();
+	void BindBlendWeights();
+
+	inline unsigned int GetEdgesTextureId() const { return mEdgesTextureId; }
+	inline unsigned int GetBlendWeightsTextureId() const { return mBlendWeightsTextureId; }
+	inline unsigned int GetAreaTextureId() const { return mAreaTextureId; }
+	inline unsigned int GetSearchTextureId() const { return mSearchTextureId; }
+
+	// texels per pattern and axis, the distances are stored quadratically: texel i is a distance of i * i
+	static constexpr int AREA_MAX_DISTANCE = 16;
+	static constexpr int AREA_TEXTURE_SIZE = 5 * AREA_MAX_DISTANCE;
+	static constexpr int SEARCH_TEXTURE_WIDTH = 66;
+	static constexpr int SEARCH_TEXTURE_HEIGHT = 33;
+
+private:
+	void Release();
+
+	int mWidth, mHeight;
+
+	unsigned int mEdgesFrameBufferId;
+	unsigned int mEdgesTextureId;
+	unsigned int mBlendWeightsFrameBufferId;
+	unsigned int mBlendWeightsTextureId;
+	unsigned int mAreaTextureId;
+	unsigned int mSearchTextureId;
+};
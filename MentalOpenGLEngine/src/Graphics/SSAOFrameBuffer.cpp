@@ -2,22 +2,45 @@
 #include <glad/glad.h>
 #include <iostream>
 
+SSAOFrameBuffer::SSAOFrameBuffer() :
+	mWidth(0),
+	mHeight(0),
+	mFrameBufferId(0),
+	mTextureId(0)
+{
+}
+
 SSAOFrameBuffer::~SSAOFrameBuffer()
 {
 	glDeleteFramebuffers(1, &mFrameBufferId);
 	glDeleteTextures(1, &mTextureId);
 }
 
-void SSAOFrameBuffer::Create(int width, int height)
+void SSAOFrameBuffer::Create(int width, int height, SSAOFrameBufferFormat format)
 {
+	glDeleteFramebuffers(1, &mFrameBufferId);
+	glDeleteTextures(1, &mTextureId);
+
+	mWidth = width;
+	mHeight = height;
+
 	glGenFramebuffers(1, &mFrameBufferId);
 	glBindFramebuffer(GL_FRAMEBUFFER, mFrameBufferId);
 
 	glGenTextures(1, &mTextureId);
 	glBindTexture(GL_TEXTURE_2D, mTextureId);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, width, height, 0, GL_RED, GL_FLOAT, 0);
+	if (format == DepthNormal || format == History)
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, 0);
+	}
+	else
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, width, height, 0, GL_RED, GL_FLOAT, 0);
+	}
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mTextureId, 0);
 
@@ -3,16 +3,31 @@
 class SSAOFrameBuffer
 {
 public:
+	enum SSAOFrameBufferFormat
+	{
+		// a single occlusion term
+		Occlusion = 0,
+		// view space normal in rgb and linear view depth in alpha, the input of the reduced resolution SSAO
+		DepthNormal,
+		// temporally accumulated visibility, linear view depth and the number of accumulated frames
+		History
+	};
+
+	SSAOFrameBuffer();
 	virtual ~SSAOFrameBuffer();
 
-	void Create(int width, int height);
+	void Create(int width, int height, SSAOFrameBufferFormat format = Occlusion);
 
 	void Bind();
 	void Unbind();
 
 	inline unsigned int GetTextureColorId() const { return mTextureId; }
+	inline int GetWidth() const { return mWidth; }
+	inline int GetHeight() const { return mHeight; }
 
 private:
+	int mWidth, mHeight;
+
 	unsigned int mFrameBufferId;
 	unsigned int mTextureId;
 };
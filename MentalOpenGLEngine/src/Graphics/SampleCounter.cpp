@@ -0,0 +1,67 @@
+#include "SampleCounter.h"
+#include <glad/glad.h>
+
+SampleCounter::SampleCounter() :
+	mQueries{},
+	mNextQuery(0),
+	mNumPending(0),
+	mNumResults(0),
+	mNumSamples(0)
+{
+}
+
+SampleCounter::~SampleCounter()
+{
+	glDeleteQueries(NUM_QUERIES, mQueries);
+}
+
+void SampleCounter::Create()
+{
+	glGenQueries(NUM_QUERIES, mQueries);
+}
+
+void SampleCounter::Begin()
+{
+	if (mNumPending == NUM_QUERIES)
+	{
+		ReadResult(mNextQuery);
+		mNumPending--;
+	}
+
+	glBeginQuery(GL_SAMPLES_PASSED, mQueries[mNextQuery]);
+}
+
+void SampleCounter::End()
+{
+	glEndQuery(GL_SAMPLES_PASSED);
+	mNextQuery = (mNextQuery + 1) % NUM_QUERIES;
+	mNumPending++;
+}
+
+void SampleCounter::Resolve(bool wait)
+{
+	while (mNumPending > 0)
+	{
+		unsigned int oldestQuery = (mNextQuery + NUM_QUERIES - mNumPending) % NUM_QUERIES;
+		if (!wait)
+		{
+			GLint isAvailable = GL_FALSE;
+			glGetQueryObjectiv(mQueries[oldestQuery], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+			if (isAvailable == GL_FALSE)
+			{
+				return;
+			}
+		}
+
+		ReadResult(oldestQuery);
+		mNumPending--;
+	}
+}
+
+void SampleCounter::ReadResult(unsigned int query)
+{
+	GLuint64 numSamples = 0;
+	glGetQueryObjectui64v(mQueries[query], GL_QUERY_RESULT, &numSamples);
+	mNumSamples = static_cast<unsigned long long>(numSamples);
+	mNumResults++;
+}
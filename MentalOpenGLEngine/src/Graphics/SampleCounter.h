@@ -0,0 +1,31 @@
+#pragma once
+
+// Counts the samples that pass the depth test between Begin and End with GL_SAMPLES_PASSED queries.
+// The queries are kept in a small ring like the ones of GpuTimer, and reused the same way.
+class SampleCounter
+{
+public:
+	SampleCounter();
+	virtual ~SampleCounter();
+
+	void Create();
+
+	void Begin();
+	void End();
+	void Resolve(bool wait = false);
+
+	inline unsigned long long GetNumSamples() const { return mNumSamples; }
+	// increases with every result read back, tells a fresh count from a repeated one
+	inline unsigned int GetNumResults() const { return mNumResults; }
+
+private:
+	static constexpr unsigned int NUM_QUERIES = 4;
+
+	void ReadResult(unsigned int query);
+
+	unsigned int mQueries[NUM_QUERIES];
+	unsigned int mNextQuery;
+	unsigned int mNumPending;
+	unsigned int mNumResults;
+	unsigned long long mNumSamples;
+};
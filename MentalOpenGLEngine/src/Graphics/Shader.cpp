@@ -4,7 +4,12 @@
 #include <fstream>
 #include <sstream>
 
-Shader::Shader(const char* sourcePath, ShaderType type)
+bool Shader::mSpirvEnabled(false);
+unsigned int Shader::mNumSpirvShaders(0);
+unsigned int Shader::mNumSpirvFallbacks(0);
+
+Shader::Shader(const char* sourcePath, ShaderType type, const std::vector<std::string>& defines,
+	const std::vector<SpecializationConstant>& constants) : mConstants(constants)
 {
 	switch (type)
 	{
@@ -19,18 +24,39 @@ Shader::Shader(const char* sourcePath, ShaderType type)
 		break;
 	}
 
-	mSource = ReadSource(sourcePath);
-	Compile();
+	// the source is kept for the binary cache hash and as the fallback of a SPIR-V shader
+	mSource = InjectDefines(ReadSource(sourcePath), defines, constants);
+	mCompiled = std::make_shared<CompiledShader>();
+
+	// the offline compile has no defines, so only shaders without any match their SPIR-V
+	if (mSpirvEnabled && defines.empty() && GLAD_GL_VERSION_4_6 && glSpecializeShader)
+	{
+		mSpirv = ReadSpirv(sourcePath);
+		if (!mSpirv)
+		{
+			mNumSpirvFallbacks++;
+		}
+	}
 }
 
 Shader::~Shader()
 {
-	glDeleteShader(mID);
+
+}
+
+GLuint Shader::GetID() const
+{
+	if (!mCompiled->IsCompiled)
+	{
+		mCompiled->ID = mSpirv ? Specialize() : Compile(mSource.c_str(), mType);
+		mCompiled->IsCompiled = true;
+	}
+	return mCompiled->ID;
 }
 
 void Shader::Compile()
 {
-	mID = Compile(mSource.c_str(), mType);
+	GetID();
 }
 
 std::string Shader::ReadSource(const char* sourcePath)
@@ -41,13 +67,118 @@ std::string Shader::ReadSource(const char* sourcePath)
 	return sourceStream.str();
 }
 
-GLuint Shader::Compile(const char* source, GLenum type)
+std::shared_ptr<const std::vector<char>> Shader::ReadSpirv(const char* sourcePath)
+{
+	// the build writes src/Shaders/spirv/<name>.spv for src/Shaders/<name>
+	std::string path(sourcePath);
+	size_t nameStart = path.find_last_of("/\\");
+	nameStart = nameStart == std::string::npos ? 0 : nameStart + 1;
+	path = path.substr(0, nameStart) + "spirv/" + path.substr(nameStart) + ".spv";
+
+	std::ifstream stream(path, std::ios::binary | std::ios::ate);
+	if (!stream)
+	{
+		return nullptr;
+	}
+	std::streamsize size = stream.tellg();
+	// SPIR-V is a stream of 32-bit words
+	if (size <= 0 || size % 4 != 0)
+	{
+		std::cout << "Error: " << path << " is not a SPIR-V module" << std::endl;
+		return nullptr;
+	}
+	auto binary = std::make_shared<std::vector<char>>(static_cast<size_t>(size));
+	stream.seekg(0);
+	if (!stream.read(binary->data(), size))
+	{
+		return nullptr;
+	}
+	return binary;
+}
+
+std::string Shader::InjectDefines(const std::string& source, const std::vector<std::string>& defines,
+	const std::vector<SpecializationConstant>& constants)
+{
+	if (defines.empty() && constants.empty())
+	{
+		return source;
+	}
+
+	std::string defineLines;
+	for (const std::string& define : defines)
+	{
+		defineLines += "#define " + define + " 1\n";
+	}
+	for (const SpecializationConstant& constant : constants)
+	{
+		defineLines += "#define " + constant.Name + " " + std::to_string(constant.Value) + "\n";
+	}
+
+	// #version has to stay the first statement of the source
+	size_t versionPos = source.find("#version");
+	if (versionPos == std::string::npos)
+	{
+		return defineLines + source;
+	}
+	size_t lineEnd = source.find('\n', versionPos);
+	if (lineEnd == std::string::npos)
+	{
+		return source + "\n" + defineLines;
+	}
+	return source.substr(0, lineEnd + 1) + defineLines + source.substr(lineEnd + 1);
+}
+
+GLuint Shader::Compile(const char* source, GLenum type) const
 {
 	GLuint id = glCreateShader(type);
 
 	glShaderSource(id, 1, &source, nullptr);
 	glCompileShader(id);
 
+	return id;
+}
+
+GLuint Shader::Specialize() const
+{
+	GLuint id = glCreateShader(mType);
+	glShaderBinary(1, &id, GL_SHADER_BINARY_FORMAT_SPIR_V, mSpirv->data(), static_cast<GLsizei>(mSpirv->size()));
+
+	std::vector<GLuint> constantIds;
+	std::vector<GLuint> constantValues;
+	for (const SpecializationConstant& constant : mConstants)
+	{
+		constantIds.push_back(constant.ID);
+		constantValues.push_back(constant.Value);
+	}
+	glSpecializeShader(id, "main", static_cast<GLuint>(mConstants.size()), constantIds.data(), constantValues.data());
+
+	// unlike a GLSL compile the status is checked right away, a module the driver rejects still has its source
+	GLint compileStatus;
+	glGetShaderiv(id, GL_COMPILE_STATUS, &compileStatus);
+	if (compileStatus == GL_FALSE)
+	{
+		GLint infoLength;
+		glGetShaderiv(id, GL_INFO_LOG_LENGTH, &infoLength);
+		std::cout << "Error: failed to specialize a SPIR-V shader, compiling its GLSL source instead" << std::endl;
+		if (infoLength > 0)
+		{
+			char* message = (char*)alloca(infoLength * sizeof(char));
+			glGetShaderInfoLog(id, infoLength, nullptr, message);
+			std::cout << message << std::endl;
+		}
+
+		glDeleteShader(id);
+		mNumSpirvFallbacks++;
+		return Compile(mSource.c_str(), mType);
+	}
+
+	mNumSpirvShaders++;
+	return id;
+}
+
+bool Shader::CheckCompileStatus() const
+{
+	GLuint id = GetID();
 	GLint compileStatus;
 	glGetShaderiv(id, GL_COMPILE_STATUS, &compileStatus);
 
@@ -64,9 +195,8 @@ GLuint Shader::Compile(const char* source, GLenum type)
 			std::cout << message << std::endl;
 		}
 
-		glDeleteShader(id);
-		return 0;
+		return false;
 	}
 
-	return id;
+	return true;
 }
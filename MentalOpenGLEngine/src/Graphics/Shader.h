@@ -2,6 +2,16 @@
 
 #include <glad/glad.h>
 #include <string>
+#include <vector>
+#include <memory>
+
+// a "layout (constant_id = ID)" constant of a SPIR-V shader, the GLSL fallback gets it as "#define NAME VALUE"
+struct SpecializationConstant
+{
+	GLuint ID;
+	std::string Name;
+	GLuint Value;
+};
 
 class Shader
 {
@@ -11,20 +21,55 @@ public:
 		Vertex, Fragment, Geometry
 	};
 
-	Shader(const char* sourcePath, ShaderType type);
+	// every define is added as "#define NAME 1" right after the #version line. Shaders without defines are loaded
+	// from the SPIR-V the build compiled next to the source, when SPIR-V is enabled and the context supports it.
+	Shader(const char* sourcePath, ShaderType type, const std::vector<std::string>& defines = {},
+		const std::vector<SpecializationConstant>& constants = {});
 	virtual ~Shader();
 
 	inline const char* GetSource() const { return mSource.c_str(); }
-	inline GLuint GetID() const { return mID; }
+	// starts compiling on first use, so a program loaded from the binary cache never compiles its stages;
+	// copies share the compiled shader. The status is not queried, the driver may still be compiling.
+	GLuint GetID() const;
 	inline GLenum GetType() const { return mType; }
+	inline bool IsSpirv() const { return mSpirv != nullptr; }
 
 	void Compile();
+	// waits for the compile, prints the log when it failed
+	bool CheckCompileStatus() const;
+
+	// only affects shaders constructed afterwards
+	inline static void SetSpirvEnabled(bool enabled) { mSpirvEnabled = enabled; }
+	inline static bool IsSpirvEnabled() { return mSpirvEnabled; }
+	// shaders specialized from SPIR-V and ones that fell back to their GLSL source since the last reset
+	inline static unsigned int GetNumSpirvShaders() { return mNumSpirvShaders; }
+	inline static unsigned int GetNumSpirvFallbacks() { return mNumSpirvFallbacks; }
+	inline static void ResetSpirvStats() { mNumSpirvShaders = 0; mNumSpirvFallbacks = 0; }
 
 private:
+	struct CompiledShader
+	{
+		GLuint ID = 0;
+		bool IsCompiled = false;
+
+		~CompiledShader() { glDeleteShader(ID); }
+	};
+
 	std::string ReadSource(const char* sourcePath);
-	GLuint Compile(const char* source, GLenum type);
+	static std::shared_ptr<const std::vector<char>> ReadSpirv(const char* sourcePath);
+	static std::string InjectDefines(const std::string& source, const std::vector<std::string>& defines,
+		const std::vector<SpecializationConstant>& constants);
+	GLuint Compile(const char* source, GLenum type) const;
+	GLuint Specialize() const;
+
+	static bool mSpirvEnabled;
+	static unsigned int mNumSpirvShaders;
+	static unsigned int mNumSpirvFallbacks;
 
 	std::string mSource;
 	GLenum mType;
-	GLuint mID;
+	std::shared_ptr<CompiledShader> mCompiled;
+	// null for shaders compiled from source
+	std::shared_ptr<const std::vector<char>> mSpirv;
+	std::vector<SpecializationConstant> mConstants;
 };
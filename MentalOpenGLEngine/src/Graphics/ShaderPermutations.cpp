@@ -0,0 +1,65 @@
+#include "ShaderPermutations.h"
+#include "Shader.h"
+
+#include <chrono>
+
+ShaderPermutations::ShaderPermutations() : mCompileMs(0.0)
+{
+
+}
+
+ShaderPermutations::~ShaderPermutations()
+{
+
+}
+
+void ShaderPermutations::Create(
+	const char* vertexPath,
+	const char* fragmentPath,
+	const std::vector<std::string>& featureDefines,
+	const SetupFunction& setup
+)
+{
+	mVertexPath = vertexPath;
+	mFragmentPath = fragmentPath;
+	mFeatureDefines = featureDefines;
+	mSetup = setup;
+	mVariants.clear();
+	mCompileMs = 0.0;
+}
+
+ShaderProgram& ShaderPermutations::Get(unsigned int features)
+{
+	features &= (1u << mFeatureDefines.size()) - 1u;
+
+	auto it = mVariants.find(features);
+	if (it != mVariants.end())
+	{
+		return *it->second;
+	}
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::string> defines;
+	for (size_t i = 0; i < mFeatureDefines.size(); i++)
+	{
+		if (features & (1u << i))
+		{
+			defines.push_back(mFeatureDefines[i]);
+		}
+	}
+
+	Shader vertexShader(mVertexPath.c_str(), Shader::Vertex, defines);
+	Shader fragmentShader(mFragmentPath.c_str(), Shader::Fragment, defines);
+	std::unique_ptr<ShaderProgram> program = std::make_unique<ShaderProgram>();
+	program->Build({ vertexShader, fragmentShader });
+	if (mSetup)
+	{
+		mSetup(*program);
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	mCompileMs += std::chrono::duration<double, std::milli>(end - start).count();
+
+	return *mVariants.emplace(features, std::move(program)).first->second;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include "ShaderProgram.h"
+
+// Variants of one vertex/fragment program, specialized for a feature mask: for every set bit i the
+// define i is injected into both stages, so the shaders can #ifdef away what a material does not use
+// instead of branching on uniforms. A variant is compiled the first time its mask is asked for and then
+// kept, so only the feature sets the scene actually draws with are ever built.
+class ShaderPermutations
+{
+public:
+	// runs once on every new variant, for the state that never changes (sampler units, block bindings)
+	using SetupFunction = std::function<void(ShaderProgram&)>;
+
+	ShaderPermutations();
+	virtual ~ShaderPermutations();
+
+	void Create(
+		const char* vertexPath,
+		const char* fragmentPath,
+		const std::vector<std::string>& featureDefines,
+		const SetupFunction& setup = nullptr
+	);
+	// bits without a define are ignored
+	ShaderProgram& Get(unsigned int features);
+
+	inline size_t GetNumVariants() const { return mVariants.size(); }
+	// CPU time spent compiling and linking all variants so far
+	inline double GetCompileMs() const { return mCompileMs; }
+
+private:
+	std::string mVertexPath;
+	std::string mFragmentPath;
+	std::vector<std::string> mFeatureDefines;
+	SetupFunction mSetup;
+	std::unordered_map<unsigned int, std::unique_ptr<ShaderProgram>> mVariants;
+	double mCompileMs;
+};
@@ -1,8 +1,11 @@
 #include <iostream>
 #include "ShaderProgram.h"
 #include "Shader.h"
+#include "ProgramBinaryCache.h"
 
-ShaderProgram::ShaderProgram() : mID(0)
+bool ShaderProgram::mDeferredBuilds(true);
+
+ShaderProgram::ShaderProgram() : mID(0), mSourceHash(0), mIsLinking(false)
 {
 
 }
@@ -13,15 +16,36 @@ ShaderProgram::~ShaderProgram()
 }
 
 void ShaderProgram::Build(const std::vector<Shader>& shaders)
+{
+	BeginBuild(shaders);
+	FinishBuild();
+}
+
+void ShaderProgram::BeginBuild(const std::vector<Shader>& shaders)
 {
 	//Shader vertexShader(vertexShaderPath, GL_VERTEX_SHADER);
 	//Shader fragmentShader(fragmentShaderPath, GL_FRAGMENT_SHADER);
 	//vertexShader.Compile();
 	//fragmentShader.Compile();
 
+	// can be built again, the previous program and its uniform locations are gone then
+	Release();
+
 	GLuint shaderProgram;
 	shaderProgram = glCreateProgram();
 
+	mSourceHash = ProgramBinaryCache::HashSources(shaders);
+	if (ProgramBinaryCache::Load(mSourceHash, shaderProgram))
+	{
+		mID = shaderProgram;
+		return;
+	}
+	// a rejected binary may leave state behind, so linking starts from a fresh program
+	glDeleteProgram(shaderProgram);
+	shaderProgram = glCreateProgram();
+	ProgramBinaryCache::MarkRetrievable(shaderProgram);
+
+	// the stages start compiling when they are attached, their status is only checked if the link fails
 	for (size_t i = 0; i < shaders.size(); i++)
 	{
 		glAttachShader(shaderProgram, shaders[i].GetID());
@@ -31,32 +55,100 @@ void ShaderProgram::Build(const std::vector<Shader>& shaders)
 	//glAttachShader(shaderProgram, fragmentShader.GetID());
 	glLinkProgram(shaderProgram);
 
+	mID = shaderProgram;
+	mPendingShaders = shaders;
+	mIsLinking = true;
+
+	if (!mDeferredBuilds)
+	{
+		FinishBuild();
+	}
+}
+
+void ShaderProgram::FinishBuild()
+{
+	if (!mIsLinking)
+	{
+		return;
+	}
+	mIsLinking = false;
+
 	GLint programLinkStatus;
-	glGetProgramiv(shaderProgram, GL_LINK_STATUS, &programLinkStatus);
+	glGetProgramiv(mID, GL_LINK_STATUS, &programLinkStatus);
 
 	if (programLinkStatus == GL_FALSE)
 	{
+		for (const Shader& shader : mPendingShaders)
+		{
+			shader.CheckCompileStatus();
+		}
+
 		GLint infoLen = 0;
-		glGetProgramiv(shaderProgram, GL_INFO_LOG_LENGTH, &infoLen);
+		glGetProgramiv(mID, GL_INFO_LOG_LENGTH, &infoLen);
 
 		if (infoLen > 0)
 		{
 			char* infoLog = (char*)alloca(infoLen);
-			glGetProgramInfoLog(shaderProgram, infoLen, NULL, infoLog);
+			glGetProgramInfoLog(mID, infoLen, NULL, infoLog);
 			std::cout << "Shader program linking error" << std::endl << infoLog << std::endl;
 		}
 
-		glDeleteProgram(shaderProgram);
+		glDeleteProgram(mID);
 
 		mID = 0;
+		mPendingShaders.clear();
 		return;
 	}
 
-	mID = shaderProgram;
+	ProgramBinaryCache::Store(mSourceHash, mID);
+	mPendingShaders.clear();
+}
+
+void ShaderProgram::BuildOnFirstUse(const std::vector<Shader>& shaders, const SetupFunction& setup)
+{
+	Release();
+	mPendingShaders = shaders;
+	mSetup = setup;
+
+	if (!mDeferredBuilds)
+	{
+		EnsureBuilt();
+	}
+}
+
+void ShaderProgram::EnsureBuilt()
+{
+	if (mIsLinking)
+	{
+		FinishBuild();
+	}
+	else if (!mPendingShaders.empty())
+	{
+		// a lazy build, the setup may set uniforms, which comes back here once the program exists
+		std::vector<Shader> shaders = std::move(mPendingShaders);
+		SetupFunction setup = std::move(mSetup);
+		mPendingShaders.clear();
+		Build(shaders);
+		if (setup)
+		{
+			setup(*this);
+		}
+	}
+}
+
+void ShaderProgram::Release()
+{
+	glDeleteProgram(mID);
+	mID = 0;
+	mUniformLocationCache.clear();
+	mPendingShaders.clear();
+	mSetup = nullptr;
+	mIsLinking = false;
 }
 
 void ShaderProgram::Bind()
 {
+	EnsureBuilt();
 	glUseProgram(mID);
 }
 
@@ -100,14 +192,16 @@ void ShaderProgram::SetUniformVec2(const std::string& name, const GLfloat* data)
 	glUniform2fv(GetUniformLocation(name), 1, data);
 }
 
-void ShaderProgram::SetUniformBlockBinding(const char* uniformBlockName, GLuint binding) const
+void ShaderProgram::SetUniformBlockBinding(const char* uniformBlockName, GLuint binding)
 {
+	EnsureBuilt();
 	unsigned int blockIndex = glGetUniformBlockIndex(mID, uniformBlockName);
 	glUniformBlockBinding(mID, blockIndex, binding);
 }
 
 GLint ShaderProgram::GetUniformLocation(const std::string& name)
 {
+	EnsureBuilt();
 	if (mUniformLocationCache.find(name) != mUniformLocationCache.end())
 		return mUniformLocationCache[name];
 
@@ -4,18 +4,31 @@
 #include <unordered_map>
 #include <glad/glad.h>
 #include <vector>
+#include <functional>
+#include <cstdint>
 
 class ShaderProgram
 {
 public:
+	// runs once the program is linked, for lazily built programs the state set right after building
+	using SetupFunction = std::function<void(ShaderProgram&)>;
+
 	ShaderProgram();
 	virtual ~ShaderProgram();
 
 	void Build(const std::vector<class Shader>& shaders);
+	// issues the compiles and the link without waiting for them, the status is only queried by FinishBuild(),
+	// which anything that needs the linked program calls, so the driver can work on many programs at once
+	void BeginBuild(const std::vector<class Shader>& shaders);
+	void FinishBuild();
+	// nothing is compiled until the program is bound or a uniform is set for the first time
+	void BuildOnFirstUse(const std::vector<class Shader>& shaders, const SetupFunction& setup = nullptr);
 	void Bind();
 	void Unbind();
 
+	// 0 until a lazily built program is first used
 	inline GLuint GetID() const { return mID; }
+	inline bool IsBuilt() const { return !mIsLinking && mPendingShaders.empty(); }
 
 	void SetUniform1i(const std::string& name, GLint value);
 	void SetUniform1f(const std::string& name, GLfloat value);
@@ -25,11 +38,24 @@ public:
 	void SetUniformVec3(const std::string& name, const GLfloat* data);
 	void SetUniformVec2(const std::string& name, const GLfloat* data);
 
-	void SetUniformBlockBinding(const char* uniformBlockName, GLuint binding) const;
+	void SetUniformBlockBinding(const char* uniformBlockName, GLuint binding);
+
+	// with deferred builds off, BeginBuild() and BuildOnFirstUse() build right away like Build()
+	inline static void SetDeferredBuilds(bool deferred) { mDeferredBuilds = deferred; }
+	inline static bool AreBuildsDeferred() { return mDeferredBuilds; }
 
 private:
 	GLint GetUniformLocation(const std::string& name);
+	void EnsureBuilt();
+	void Release();
+
+	static bool mDeferredBuilds;
 
 	GLuint mID;
 	std::unordered_map<std::string, GLint> mUniformLocationCache;
+	// kept until the build finishes, for the compile logs of a failed link and for lazy builds
+	std::vector<class Shader> mPendingShaders;
+	SetupFunction mSetup;
+	uint64_t mSourceHash;
+	bool mIsLinking;
 };
\ No newline at end of file
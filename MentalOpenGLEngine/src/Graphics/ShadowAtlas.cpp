@@ -0,0 +1,360 @@
+#include "ShadowAtlas.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <numeric>
+#include <iostream>
+#include <cmath>
+
+static constexpr float LIGHT_MOVE_THRESHOLD = 1e-4f;
+// a light keeps its tile size until the wanted size leaves this band, so lights near a threshold do not thrash
+static constexpr float TILE_SIZE_HYSTERESIS = 0.25f;
+// part of the atlas the tile sizes are planned for, rounding down to powers of two and fragmentation need the rest
+static constexpr float ATLAS_FILL_RATIO = 0.75f;
+
+ShadowAtlas::ShadowAtlas() :
+	mSize(0),
+	mMinTileSize(0),
+	mMaxTileSize(0),
+	mUpdateBudget(8),
+	mFBO(0),
+	mTextureId(0),
+	mFrame(0)
+{
+}
+
+ShadowAtlas::~ShadowAtlas()
+{
+	glDeleteFramebuffers(1, &mFBO);
+	glDeleteTextures(1, &mTextureId);
+}
+
+void ShadowAtlas::Build(unsigned int size, unsigned int minTileSize, unsigned int maxTileSize)
+{
+	mSize = size;
+	mMinTileSize = minTileSize;
+	mMaxTileSize = std::min(maxTileSize, size);
+
+	if (mTextureId == 0)
+	{
+		glGenFramebuffers(1, &mFBO);
+		glGenTextures(1, &mTextureId);
+	}
+
+	// linear distance to the light normalized by its radius, 16 bits are plenty for radii of a few metres
+	glBindTexture(GL_TEXTURE_2D, mTextureId);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT16, size, size, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_SHORT, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, mTextureId, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ERROR: Shadow atlas Framebuffer is not complete" << std::endl;
+	}
+	glClear(GL_DEPTH_BUFFER_BIT);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	mFreeBlocks.clear();
+	mFreeBlocks.resize(GetLevel(mMinTileSize) + 1);
+	mFreeBlocks[0].push_back(glm::uvec2(0));
+	mSlots.clear();
+	mUpdates.clear();
+}
+
+void ShadowAtlas::Update(const std::vector<Light>& lights, uint64_t staticHash)
+{
+	mFrame++;
+	mStats = {};
+	mUpdates.clear();
+
+	if (mSlots.size() != lights.size())
+	{
+		for (unsigned int i = 0; i < mSlots.size(); i++)
+		{
+			FreeSlot(i);
+		}
+		mSlots.clear();
+		mSlots.resize(lights.size());
+	}
+
+	// everything in view is marked first, so no visible light is evicted for another visible light
+	for (unsigned int i = 0; i < lights.size(); i++)
+	{
+		if (lights[i].Importance > 0.0f)
+		{
+			mSlots[i].LastUsedFrame = mFrame;
+		}
+	}
+
+	// when the wanted tiles do not fit, all of them shrink by the same factor rather than the last lights losing their shadow
+	float wantedArea = 0.0f;
+	for (const Light& light : lights)
+	{
+		float wantedSize = std::min(light.Importance, 1.0f) * mMaxTileSize;
+		wantedArea += 6.0f * wantedSize * wantedSize;
+	}
+	float capacity = ATLAS_FILL_RATIO * static_cast<float>(mSize) * static_cast<float>(mSize);
+	float importanceScale = wantedArea > capacity ? std::sqrt(capacity / wantedArea) : 1.0f;
+
+	std::vector<unsigned int> order(lights.size());
+	std::iota(order.begin(), order.end(), 0u);
+	std::stable_sort(order.begin(), order.end(), [&lights](unsigned int a, unsigned int b) {
+		return lights[a].Importance > lights[b].Importance;
+	});
+
+	// the most important lights pick their tiles first, the rest fall back to smaller tiles or no shadow
+	for (unsigned int light : order)
+	{
+		if (lights[light].Importance <= 0.0f)
+		{
+			break;
+		}
+
+		Slot& slot = mSlots[light];
+		unsigned int wantedSize = PickTileSize(std::min(lights[light].Importance, 1.0f) * importanceScale, slot.TileSize);
+		if (wantedSize < slot.TileSize)
+		{
+			FreeSlot(light);
+		}
+		if (wantedSize != slot.TileSize)
+		{
+			unsigned int smallestSize = slot.TileSize != 0 ? slot.TileSize * 2 : mMinTileSize;
+			for (unsigned int size = wantedSize; size >= smallestSize; size /= 2)
+			{
+				bool isAllocated = AllocateSlot(light, size);
+				while (!isAllocated && EvictLeastRecentlyUsed())
+				{
+					isAllocated = AllocateSlot(light, size);
+				}
+				if (isAllocated)
+				{
+					break;
+				}
+			}
+		}
+
+		if (slot.TileSize == 0)
+		{
+			mStats.NumUnshadowed++;
+			continue;
+		}
+		mStats.NumShadowed++;
+		mStats.NumTilesPerSize[GetLevel(slot.TileSize) - GetLevel(mMaxTileSize)]++;
+
+		bool isStale = !slot.IsRendered || lights[light].IsDirty || slot.RenderedStaticHash != staticHash ||
+			glm::distance(slot.RenderedPosition, lights[light].Position) > LIGHT_MOVE_THRESHOLD;
+		if (isStale)
+		{
+			mUpdates.push_back(light);
+		}
+	}
+
+	// lights without any shadow yet go first, then the ones that have waited longest
+	std::stable_sort(mUpdates.begin(), mUpdates.end(), [this](unsigned int a, unsigned int b) {
+		if (mSlots[a].IsRendered != mSlots[b].IsRendered)
+		{
+			return !mSlots[a].IsRendered;
+		}
+		return mSlots[a].FramesWaiting > mSlots[b].FramesWaiting;
+	});
+	if (mUpdates.size() > mUpdateBudget)
+	{
+		for (size_t i = mUpdateBudget; i < mUpdates.size(); i++)
+		{
+			mSlots[mUpdates[i]].FramesWaiting++;
+		}
+		mStats.NumDeferredUpdates = static_cast<unsigned int>(mUpdates.size() - mUpdateBudget);
+		mUpdates.resize(mUpdateBudget);
+	}
+
+	for (unsigned int light : mUpdates)
+	{
+		Slot& slot = mSlots[light];
+		slot.RenderedPosition = lights[light].Position;
+		slot.RenderedStaticHash = staticHash;
+		slot.FramesWaiting = 0;
+		slot.IsRendered = true;
+	}
+	mStats.NumUpdates = static_cast<unsigned int>(mUpdates.size());
+}
+
+void ShadowAtlas::BindFace(unsigned int light, unsigned int face)
+{
+	const Tile& tile = mSlots[light].Faces[face];
+	glBindFramebuffer(GL_FRAMEBUFFER, mFBO);
+	glViewport(tile.X, tile.Y, tile.Size, tile.Size);
+	glScissor(tile.X, tile.Y, tile.Size, tile.Size);
+	glEnable(GL_SCISSOR_TEST);
+	glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void ShadowAtlas::Unbind()
+{
+	glDisable(GL_SCISSOR_TEST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+glm::vec4 ShadowAtlas::GetFaceRect(unsigned int light, unsigned int face) const
+{
+	if (light >= mSlots.size() || !mSlots[light].IsRendered || mSlots[light].TileSize == 0)
+	{
+		return glm::vec4(0.0f);
+	}
+
+	const Tile& tile = mSlots[light].Faces[face];
+	float scale = 1.0f / static_cast<float>(mSize);
+	return glm::vec4(tile.X * scale, tile.Y * scale, tile.Size * scale, 0.0f);
+}
+
+unsigned int ShadowAtlas::PickTileSize(float importance, unsigned int currentSize) const
+{
+	float wanted = importance * static_cast<float>(mMaxTileSize);
+	if (currentSize != 0 && wanted >= currentSize * (1.0f - TILE_SIZE_HYSTERESIS) && wanted < currentSize * 2.0f * (1.0f + TILE_SIZE_HYSTERESIS))
+	{
+		return currentSize;
+	}
+
+	unsigned int size = mMaxTileSize;
+	while (size > mMinTileSize && static_cast<float>(size) > wanted)
+	{
+		size /= 2;
+	}
+	return size;
+}
+
+bool ShadowAtlas::AllocateSlot(unsigned int light, unsigned int tileSize)
+{
+	Tile faces[6];
+	for (unsigned int face = 0; face < 6; face++)
+	{
+		if (!AllocateTile(tileSize, &faces[face]))
+		{
+			for (unsigned int i = 0; i < face; i++)
+			{
+				FreeTile(faces[i]);
+			}
+			return false;
+		}
+	}
+
+	FreeSlot(light);
+	Slot& slot = mSlots[light];
+	std::copy(std::begin(faces), std::end(faces), std::begin(slot.Faces));
+	slot.TileSize = tileSize;
+	return true;
+}
+
+void ShadowAtlas::FreeSlot(unsigned int light)
+{
+	Slot& slot = mSlots[light];
+	if (slot.TileSize != 0)
+	{
+		for (const Tile& tile : slot.Faces)
+		{
+			FreeTile(tile);
+		}
+	}
+	slot.TileSize = 0;
+	slot.IsRendered = false;
+}
+
+bool ShadowAtlas::EvictLeastRecentlyUsed()
+{
+	unsigned int victim = static_cast<unsigned int>(mSlots.size());
+	for (unsigned int i = 0; i < mSlots.size(); i++)
+	{
+		const Slot& slot = mSlots[i];
+		if (slot.TileSize != 0 && slot.LastUsedFrame < mFrame && (victim == mSlots.size() || slot.LastUsedFrame < mSlots[victim].LastUsedFrame))
+		{
+			victim = i;
+		}
+	}
+
+	if (victim == mSlots.size())
+	{
+		return false;
+	}
+	FreeSlot(victim);
+	mStats.NumEvictions++;
+	return true;
+}
+
+bool ShadowAtlas::AllocateTile(unsigned int size, Tile* tile)
+{
+	unsigned int level = GetLevel(size);
+
+	// take the smallest free block that fits and split it down, the unused quarters stay free
+	int sourceLevel = static_cast<int>(level);
+	while (sourceLevel >= 0 && mFreeBlocks[sourceLevel].empty())
+	{
+		sourceLevel--;
+	}
+	if (sourceLevel < 0)
+	{
+		return false;
+	}
+
+	glm::uvec2 block = mFreeBlocks[sourceLevel].back();
+	mFreeBlocks[sourceLevel].pop_back();
+	for (unsigned int splitLevel = sourceLevel + 1; splitLevel <= level; splitLevel++)
+	{
+		unsigned int childSize = mSize >> splitLevel;
+		mFreeBlocks[splitLevel].push_back(block + glm::uvec2(childSize, 0));
+		mFreeBlocks[splitLevel].push_back(block + glm::uvec2(0, childSize));
+		mFreeBlocks[splitLevel].push_back(block + glm::uvec2(childSize, childSize));
+	}
+
+	*tile = { block.x, block.y, size };
+	return true;
+}
+
+void ShadowAtlas::FreeTile(const Tile& tile)
+{
+	unsigned int level = GetLevel(tile.Size);
+	glm::uvec2 block(tile.X, tile.Y);
+
+	// merge back into the parent while all four quarters of it are free
+	while (level > 0)
+	{
+		unsigned int size = mSize >> level;
+		glm::uvec2 parent(block.x & ~(2 * size - 1), block.y & ~(2 * size - 1));
+		std::vector<glm::uvec2>& freeBlocks = mFreeBlocks[level];
+
+		unsigned int numFreeSiblings = 0;
+		for (const glm::uvec2& freeBlock : freeBlocks)
+		{
+			if (freeBlock != block && (freeBlock.x & ~(2 * size - 1)) == parent.x && (freeBlock.y & ~(2 * size - 1)) == parent.y)
+			{
+				numFreeSiblings++;
+			}
+		}
+		if (numFreeSiblings < 3)
+		{
+			break;
+		}
+
+		freeBlocks.erase(std::remove_if(freeBlocks.begin(), freeBlocks.end(), [&](const glm::uvec2& freeBlock) {
+			return (freeBlock.x & ~(2 * size - 1)) == parent.x && (freeBlock.y & ~(2 * size - 1)) == parent.y;
+		}), freeBlocks.end());
+		block = parent;
+		level--;
+	}
+
+	mFreeBlocks[level].push_back(block);
+}
+
+unsigned int ShadowAtlas::GetLevel(unsigned int size) const
+{
+	unsigned int level = 0;
+	while ((mSize >> level) > size)
+	{
+		level++;
+	}
+	return level;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+// One large depth texture shared by the shadows of many point lights. Every light gets six square tiles,
+// one per cube face, sized by how much of the screen the light covers. Tiles come from a quadtree buddy
+// allocator, stay with their light while the size does not change, and allocations of lights that were
+// not used recently are evicted first when space runs out. Only a bounded number of lights is re-rendered per frame.
+class ShadowAtlas
+{
+public:
+	struct Light
+	{
+		glm::vec3 Position{ 0.0f };
+		float Radius{ 1.0f };
+		// roughly the fraction of the screen height covered by the light, 0 when outside the view
+		float Importance{ 0.0f };
+		// set when casters that are not part of the static hash moved inside the light radius
+		bool IsDirty{ false };
+	};
+
+	struct Stats
+	{
+		unsigned int NumShadowed{ 0 };
+		unsigned int NumUnshadowed{ 0 };
+		unsigned int NumUpdates{ 0 };
+		unsigned int NumDeferredUpdates{ 0 };
+		unsigned int NumEvictions{ 0 };
+		unsigned int NumTilesPerSize[8]{};
+	};
+
+	ShadowAtlas();
+	virtual ~ShadowAtlas();
+
+	void Build(unsigned int size, unsigned int minTileSize, unsigned int maxTileSize);
+	void Update(const std::vector<Light>& lights, uint64_t staticHash);
+	void BindFace(unsigned int light, unsigned int face);
+	void Unbind();
+
+	// atlas offset in xy and size in z, in texture coordinates, all zero while the light has no shadow yet
+	glm::vec4 GetFaceRect(unsigned int light, unsigned int face) const;
+
+	inline void SetUpdateBudget(unsigned int maxLightUpdatesPerFrame) { mUpdateBudget = maxLightUpdatesPerFrame; }
+	inline unsigned int GetUpdateBudget() const { return mUpdateBudget; }
+	inline const std::vector<unsigned int>& GetUpdates() const { return mUpdates; }
+	inline unsigned int GetTextureId() const { return mTextureId; }
+	inline unsigned int GetSize() const { return mSize; }
+	inline const Stats& GetStats() const { return mStats; }
+	inline size_t GetMemorySize() const { return size_t(mSize) * mSize * sizeof(uint16_t); }
+
+private:
+	struct Tile
+	{
+		unsigned int X, Y, Size;
+	};
+
+	struct Slot
+	{
+		Tile Faces[6]{};
+		unsigned int TileSize{ 0 };
+		glm::vec3 RenderedPosition{ 0.0f };
+		uint64_t RenderedStaticHash{ 0 };
+		uint64_t LastUsedFrame{ 0 };
+		unsigned int FramesWaiting{ 0 };
+		bool IsRendered{ false };
+	};
+
+	unsigned int PickTileSize(float importance, unsigned int currentSize) const;
+	bool AllocateSlot(unsigned int light, unsigned int tileSize);
+	void FreeSlot(unsigned int light);
+	bool EvictLeastRecentlyUsed();
+	bool AllocateTile(unsigned int size, Tile* tile);
+	void FreeTile(const Tile& tile);
+	unsigned int GetLevel(unsigned int size) const;
+
+	unsigned int mSize, mMinTileSize, mMaxTileSize;
+	unsigned int mUpdateBudget;
+	unsigned int mFBO, mTextureId;
+	uint64_t mFrame;
+
+	// free blocks per quadtree level, level 0 is the whole atlas
+	std::vector<std::vector<glm::uvec2>> mFreeBlocks;
+	std::vector<Slot> mSlots;
+	std::vector<unsigned int> mUpdates;
+	Stats mStats;
+};
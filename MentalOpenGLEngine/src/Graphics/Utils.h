@@ -1,6 +1,9 @@
 #pragma once
 
 #include <iostream>
+#include <cstring>
+#include <fstream>
+#include <vector>
 #include <glad/glad.h>
 #include "External/stb_image.h"
 
@@ -107,3 +110,42 @@ inline unsigned int GLLoadCubemap(const char* faces[6])
 
 	return textureId;
 }
+
+inline bool GLHasExtension(const char* name)
+{
+	GLint numExtensions = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+	for (GLint i = 0; i < numExtensions; i++)
+	{
+		const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+		if (extension && std::strcmp(extension, name) == 0)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Writes the colour buffer of the bound read framebuffer as a binary PPM, top row first.
+inline bool GLSaveScreenshot(const char* path, int width, int height)
+{
+	std::vector<unsigned char> pixels(static_cast<size_t>(width) * height * 3);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cout << "Failed to write screenshot " << path << std::endl;
+		return false;
+	}
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+	for (int y = height - 1; y >= 0; y--)
+	{
+		file.write(reinterpret_cast<const char*>(pixels.data() + static_cast<size_t>(y) * width * 3), static_cast<std::streamsize>(width) * 3);
+	}
+
+	return true;
+}
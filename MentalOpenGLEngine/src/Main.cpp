@@ -1,21 +1,102 @@
 #include "Graphics/Engine.h"
+#include "Graphics/ProgramBinaryCache.h"
+#include "Graphics/Shader.h"
+#include "Graphics/ConeStepMap.h"
+#include <cstring>
+#include <cstdlib>
 
-int main()
+int main(int argc, char** argv)
 {
 #if defined(_DEBUG)
 	_CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif
 
+	// --benchmark <name> renders the named scenario in a hidden window and prints the results
+	const char* benchmark = nullptr;
+	// --dynamic-resolution scales the scene between --min-scale and --max-scale to hold --target-frame-ms,
+	// --resolution-log <path> writes the chosen scales as CSV on exit
+	bool dynamicResolution = false;
+	float targetFrameMs = 16.6f;
+	float minScale = 0.5f;
+	float maxScale = 1.0f;
+	const char* resolutionLog = nullptr;
+	// --no-shader-cache compiles every program from source instead of loading the stored binaries
+	bool shaderCache = true;
+	// --spirv loads the shaders from the SPIR-V the build compiled, on an OpenGL 4.6 context
+	bool spirv = false;
+	// --bake-cone-map <height map> writes the relaxed cone step map of the height map next to it and exits
+	const char* coneStepHeightMap = nullptr;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc)
+		{
+			benchmark = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--dynamic-resolution") == 0)
+		{
+			dynamicResolution = true;
+		}
+		else if (std::strcmp(argv[i], "--target-frame-ms") == 0 && i + 1 < argc)
+		{
+			targetFrameMs = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--min-scale") == 0 && i + 1 < argc)
+		{
+			minScale = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--max-scale") == 0 && i + 1 < argc)
+		{
+			maxScale = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--resolution-log") == 0 && i + 1 < argc)
+		{
+			resolutionLog = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--no-shader-cache") == 0)
+		{
+			shaderCache = false;
+		}
+		else if (std::strcmp(argv[i], "--spirv") == 0)
+		{
+			spirv = true;
+		}
+		else if (std::strcmp(argv[i], "--bake-cone-map") == 0 && i + 1 < argc)
+		{
+			coneStepHeightMap = argv[++i];
+		}
+	}
+
+	if (coneStepHeightMap)
+	{
+		return BakeConeStepMap(coneStepHeightMap, GetConeStepMapPath(coneStepHeightMap).c_str()) ? 0 : -1;
+	}
+
+	ProgramBinaryCache::SetEnabled(shaderCache);
+	Shader::SetSpirvEnabled(spirv);
+
 	Graphics::Engine engine(1920, 1080, "OpenGLEngine");
 
 	bool vsync = false;
 	bool windowedFullscreen = true;
+	bool headless = benchmark != nullptr;
 
-	if (!engine.Init(vsync, windowedFullscreen))
+	if (!engine.Init(vsync, windowedFullscreen, headless))
 	{
 		return -1;
 	}
 
+	engine.SetDynamicResolution(dynamicResolution, targetFrameMs, minScale, maxScale);
+	if (resolutionLog)
+	{
+		engine.SetResolutionLogPath(resolutionLog);
+	}
+
+	if (benchmark)
+	{
+		engine.RunBenchmark(benchmark);
+		return 0;
+	}
+
 	engine.Run();
 
 	return 0;
@@ -58,7 +58,6 @@ struct SpotLight
 #define MAX_POINT_LIGHTS 4
 
 layout (location = 0) out vec4 FragColor;
-layout (location = 1) out vec4 BrightColor;
 
 in VS_OUT {
     vec2 texCoords;
@@ -187,16 +186,6 @@ void main()
 	}
 
 	FragColor = vec4(color, 1.0);
-
-	float brightness = dot(FragColor.rgb, vec3(0.2126, 0.7152, 0.0722));
-    if (brightness > 1.0)
-	{
-		BrightColor = vec4(FragColor.rgb, 1.0);
-	}  
-    else
-	{
-		BrightColor = vec4(0.0, 0.0, 0.0, 1.0);
-	}
 }
 
 vec2 ParallaxOcclusionMapping(const vec2 texCoords, const vec3 viewDirection, const float minLayers, const float maxLayers)
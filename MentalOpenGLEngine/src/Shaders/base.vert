@@ -37,7 +37,7 @@ layout (std140) uniform Matrices
 uniform mat4 uModel;
 uniform mat4 uLightSpaceMatrix;
 uniform float uTexTiling = 1.0f;
-uniform vec2 uTexDisplacement = vec2(0.0);
+uniform vec2 uTexDisplacement;
 uniform float uNormalsMultiplier = 1.0;
 uniform vec3 uViewPos;
 
@@ -0,0 +1,76 @@
+#version 330 core
+
+in vec2 vTexCoords;
+
+uniform sampler2D uSource;
+// the first downsample reads the lit scene, it applies the threshold and damps single bright texels
+uniform bool uIsFirstPass;
+uniform float uThreshold = 1.0;
+uniform float uSoftKnee = 0.5;
+
+layout (location = 0) out vec3 FragColor;
+
+float Luminance(vec3 color)
+{
+	return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// quadratic soft knee around the threshold instead of a hard cut, which flickers as highlights move
+vec3 Prefilter(vec3 color)
+{
+	float brightness = Luminance(color);
+	float knee = uThreshold * uSoftKnee;
+	float soft = clamp(brightness - uThreshold + knee, 0.0, 2.0 * knee);
+	soft = soft * soft / (4.0 * knee + 1e-5);
+	float contribution = max(soft, brightness - uThreshold) / max(brightness, 1e-5);
+	return color * contribution;
+}
+
+// groups are weighted by the inverse of their luminance, so a lone firefly cannot dominate the level
+vec3 KarisAverage(vec3 a, vec3 b, vec3 c, vec3 d)
+{
+	vec3 average = (a + b + c + d) * 0.25;
+	return average / (1.0 + Luminance(average));
+}
+
+// 13 taps as five overlapping 2x2 boxes, wider than a plain box and free of its pulsing when things move
+void main()
+{
+	vec2 texelSize = 1.0 / vec2(textureSize(uSource, 0));
+
+	vec3 a = texture(uSource, vTexCoords + texelSize * vec2(-2.0, 2.0)).rgb;
+	vec3 b = texture(uSource, vTexCoords + texelSize * vec2(0.0, 2.0)).rgb;
+	vec3 c = texture(uSource, vTexCoords + texelSize * vec2(2.0, 2.0)).rgb;
+	vec3 d = texture(uSource, vTexCoords + texelSize * vec2(-2.0, 0.0)).rgb;
+	vec3 e = texture(uSource, vTexCoords).rgb;
+	vec3 f = texture(uSource, vTexCoords + texelSize * vec2(2.0, 0.0)).rgb;
+	vec3 g = texture(uSource, vTexCoords + texelSize * vec2(-2.0, -2.0)).rgb;
+	vec3 h = texture(uSource, vTexCoords + texelSize * vec2(0.0, -2.0)).rgb;
+	vec3 i = texture(uSource, vTexCoords + texelSize * vec2(2.0, -2.0)).rgb;
+	vec3 j = texture(uSource, vTexCoords + texelSize * vec2(-1.0, 1.0)).rgb;
+	vec3 k = texture(uSource, vTexCoords + texelSize * vec2(1.0, 1.0)).rgb;
+	vec3 l = texture(uSource, vTexCoords + texelSize * vec2(-1.0, -1.0)).rgb;
+	vec3 m = texture(uSource, vTexCoords + texelSize * vec2(1.0, -1.0)).rgb;
+
+	vec3 color;
+	if (uIsFirstPass)
+	{
+		vec3 center = KarisAverage(j, k, l, m);
+		vec3 topLeft = KarisAverage(a, b, d, e);
+		vec3 topRight = KarisAverage(b, c, e, f);
+		vec3 bottomLeft = KarisAverage(d, e, g, h);
+		vec3 bottomRight = KarisAverage(e, f, h, i);
+		vec3 weighted = center * 0.5 + (topLeft + topRight + bottomLeft + bottomRight) * 0.125;
+		// undo the luminance weighting of the sum so the level keeps the scene's brightness
+		color = Prefilter(weighted / max(1.0 - Luminance(weighted), 1e-4));
+	}
+	else
+	{
+		color = e * 0.125;
+		color += (a + c + g + i) * 0.03125;
+		color += (b + d + f + h) * 0.0625;
+		color += (j + k + l + m) * 0.125;
+	}
+
+	FragColor = max(color, vec3(0.0));
+}
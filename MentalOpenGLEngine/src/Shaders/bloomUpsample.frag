@@ -0,0 +1,27 @@
+#version 330 core
+
+in vec2 vTexCoords;
+
+uniform sampler2D uSource;
+// tent radius in texels of the smaller level
+uniform float uFilterRadius = 1.0;
+
+layout (location = 0) out vec3 FragColor;
+
+// 3x3 tent filter, the result is blended additively onto the next larger level
+void main()
+{
+	vec2 offset = uFilterRadius / vec2(textureSize(uSource, 0));
+
+	vec3 color = texture(uSource, vTexCoords).rgb * 4.0;
+	color += texture(uSource, vTexCoords + vec2(0.0, offset.y)).rgb * 2.0;
+	color += texture(uSource, vTexCoords + vec2(0.0, -offset.y)).rgb * 2.0;
+	color += texture(uSource, vTexCoords + vec2(offset.x, 0.0)).rgb * 2.0;
+	color += texture(uSource, vTexCoords + vec2(-offset.x, 0.0)).rgb * 2.0;
+	color += texture(uSource, vTexCoords + vec2(offset.x, offset.y)).rgb;
+	color += texture(uSource, vTexCoords + vec2(-offset.x, offset.y)).rgb;
+	color += texture(uSource, vTexCoords + vec2(offset.x, -offset.y)).rgb;
+	color += texture(uSource, vTexCoords + vec2(-offset.x, -offset.y)).rgb;
+
+	FragColor = color / 16.0;
+}
@@ -11,9 +11,6 @@ struct DirectionalLight
     vec3 ambient;
     vec3 diffuse;
     vec3 specular;
-
-	mat4 lightSpaceMat;
-	sampler2D shadowMap;
 };
 struct PointLight
 {
@@ -27,11 +24,19 @@ struct PointLight
     float linear;
     float quadratic;
 
+	float nearPlane;
 	float farPlane;
 	float radius;
 
 	samplerCube shadowCubeMap;
 };
+struct AtlasLight
+{
+	vec4 positionRadius;
+	vec4 color;
+	// atlas offset in xy and tile size in z per cube face, a zero size while the light has no shadow yet
+	vec4 faceRects[6];
+};
 struct SpotLight
 {
 	vec3 position;
@@ -67,6 +72,15 @@ vec3 CalculatePointLight(
 	const float shadow,
 	const float ambientOcclusion
 );
+vec3 CalculateAtlasLight(
+	int light,
+	const vec3 normal,
+	const vec3 viewDirection,
+	const vec3 materialDiffuse,
+	const vec3 materialSpecular,
+	const vec3 fragPos,
+	const float shadow
+);
 vec3 CalculateSpotLight(
 	SpotLight light,
 	const vec3 normal,
@@ -97,11 +111,29 @@ vec3 CalculateSpecular(
   
 float LinearizeDepth(float depth, float near, float far);
 
-float CalculateDirShadow(DirectionalLight light, const vec3 normal, const vec4 posInLightSpace);
+float CalculateDirShadow(DirectionalLight light, const vec3 normal, const vec3 worldPos);
 float CalculatePointShadow(PointLight light, const vec3 fragPos, const vec3 viewPos);
+float CalculateAtlasShadow(int light, const vec3 fragToLight);
+float CalculateMomentShadow(const vec3 projCoords, const int cascade, const float bias);
+float ChebyshevUpperBound(const vec2 moments, const float mean, const float minVariance);
 
-#define MAX_POINT_LIGHTS 16
+#define POINT_LIGHT_CAPACITY 16
 #define MAX_DIR_LIGHTS 1
+#define MAX_CASCADES 4
+#define MAX_ATLAS_LIGHTS 64
+
+// specialized by the engine to the lights it uploads and its shadow filter, so the loops have constant bounds
+#ifdef GL_SPIRV
+layout (constant_id = 0) const int MAX_POINT_LIGHTS = POINT_LIGHT_CAPACITY;
+layout (constant_id = 1) const int PCF_RADIUS = 2;
+#else
+#ifndef MAX_POINT_LIGHTS
+#define MAX_POINT_LIGHTS POINT_LIGHT_CAPACITY
+#endif
+#ifndef PCF_RADIUS
+#define PCF_RADIUS 2
+#endif
+#endif
 
 in vec2 vTexCoords;
 
@@ -114,12 +146,33 @@ uniform Material uMaterial;
 uniform vec3 uViewPos;
 
 uniform DirectionalLight uDirLights[MAX_DIR_LIGHTS];
-uniform PointLight uPointLights[MAX_POINT_LIGHTS];
-uniform int uNumPointLights = 0;
-uniform int uNumDirLights = 0;
+uniform PointLight uPointLights[POINT_LIGHT_CAPACITY];
+uniform int uNumPointLights;
+uniform int uNumDirLights;
+// the point shadow maps hold the rasterized depth of each cube face rather than the linear distance to the light
+uniform bool uPointShadowHardwareDepth;
+
+uniform sampler2DArray uCascadeShadowMap;
+uniform mat4 uCascadeMatrices[MAX_CASCADES];
+uniform float uCascadeSplits[MAX_CASCADES];
+uniform float uCascadeBiases[MAX_CASCADES];
+uniform int uNumCascades;
+uniform vec3 uViewForward;
+
+// 0 filters the cascades with PCF, 1 with a single fetch from the prefiltered EVSM moments
+uniform int uShadowFilter;
+uniform sampler2DArray uCascadeMoments;
+uniform vec2 uEVSMExponents = vec2(40.0, 5.0);
+uniform float uLightBleedingReduction = 0.3;
+
+layout (std140) uniform AtlasLights
+{
+	AtlasLight uAtlasLights[MAX_ATLAS_LIGHTS];
+};
+uniform int uNumAtlasLights;
+uniform sampler2D uShadowAtlas;
 
 layout (location = 0) out vec4 FragColor;
-layout (location = 1) out vec4 BrightColor;
 
 void main()
 {
@@ -136,8 +189,7 @@ void main()
 	float shadow = 0.0;
 	for (int i = 0; i < min(MAX_DIR_LIGHTS, uNumDirLights); i++)
 	{
-		vec4 posInLightSpace = uDirLights[i].lightSpaceMat * vec4(worldPos, 1.0);
-		shadow = CalculateDirShadow(uDirLights[i], normal, posInLightSpace);
+		shadow = CalculateDirShadow(uDirLights[i], normal, worldPos);
 		color += CalculateDirectionalLight(uDirLights[i], normal, viewDirection, albedo, vec3(specular), shadow, ambientOcclusion);
 	}
 
@@ -150,23 +202,25 @@ void main()
 		color += CalculatePointLight(uPointLights[i], normal, viewDirection, albedo, vec3(specular), worldPos, shadow, ambientOcclusion);
 //		}
 	}
-	
-	FragColor = vec4(color, 1.0);
-	float brightness = dot(FragColor.rgb, vec3(0.2126, 0.7152, 0.0722));
-    if (brightness > 1.0)
-	{
-		BrightColor = vec4(FragColor.rgb, 1.0);
-	}  
-    else
+
+	for (int i = 0; i < min(MAX_ATLAS_LIGHTS, uNumAtlasLights); i++)
 	{
-		BrightColor = vec4(0.0, 0.0, 0.0, 1.0);
+		vec3 fragToLight = worldPos - uAtlasLights[i].positionRadius.xyz;
+		float radius = uAtlasLights[i].positionRadius.w;
+		if (dot(fragToLight, fragToLight) < radius * radius)
+		{
+			shadow = CalculateAtlasShadow(i, fragToLight);
+			color += CalculateAtlasLight(i, normal, viewDirection, albedo, vec3(specular), worldPos, shadow);
+		}
 	}
+	
+	FragColor = vec4(color, 1.0);
 
 	// SSAO texture
 //	FragColor = vec4(texture(uSSAOTexture, vTexCoords).rrr, 1.0);
 
 	//dir light shadow map
-//	FragColor = vec4(texture(uDirLights[0].shadowMap, vTexCoords).rrr, 1.0);
+//	FragColor = vec4(texture(uCascadeShadowMap, vec3(vTexCoords, 0.0)).rrr, 1.0);
 	
 	// point light shadow cube map
 //	vec3 fragToLight = worldPos - uPointLights[0].position;
@@ -174,8 +228,26 @@ void main()
 //	FragColor = vec4(vec3(closestDepth), 1.0);
 }
 
-float CalculateDirShadow(DirectionalLight light, const vec3 normal, const vec4 posInLightSpace)
+float CalculateDirShadow(DirectionalLight light, const vec3 normal, const vec3 worldPos)
 {
+	// the first cascade whose slice reaches past the fragment's view depth
+	float viewDepth = dot(worldPos - uViewPos, uViewForward);
+	int cascade = uNumCascades;
+	for (int i = 0; i < uNumCascades; i++)
+	{
+		if (viewDepth < uCascadeSplits[i])
+		{
+			cascade = i;
+			break;
+		}
+	}
+	if (cascade >= uNumCascades)
+	{
+		return 0.0;
+	}
+
+	vec4 posInLightSpace = uCascadeMatrices[cascade] * vec4(worldPos, 1.0);
+
 	// perform perspective division, so it works for perspective matrices too
     vec3 projCoords = posInLightSpace.xyz / posInLightSpace.w;
 
@@ -183,26 +255,67 @@ float CalculateDirShadow(DirectionalLight light, const vec3 normal, const vec4 p
 	projCoords = projCoords * 0.5 + 0.5; 
 
 	float currentDepth = projCoords.z;
+	if (currentDepth > 1.0)
+	{
+		return 0.0;
+	}
 
-	float bias = max(0.005 * (1.0 - dot(normal, light.direction)), 0.0005);
+	// the bias is sized in texels of the selected cascade and grows on surfaces facing away from the light
+	float slope = 1.0 - max(dot(normal, normalize(-light.direction)), 0.0);
+	float bias = uCascadeBiases[cascade] * (1.0 + 2.0 * slope);
+
+	if (uShadowFilter == 1)
+	{
+		return CalculateMomentShadow(projCoords, cascade, bias);
+	}
 
 	// PCF
 	float shadow = 0.0;
-	vec2 texelSize = 1.0 / textureSize(light.shadowMap, 0);
-	for (int x = -2; x <= 2; x++)
+	vec2 texelSize = 1.0 / vec2(textureSize(uCascadeShadowMap, 0).xy);
+	for (int x = -PCF_RADIUS; x <= PCF_RADIUS; x++)
 	{
-		for (int y = -2; y <= 2; y++)
+		for (int y = -PCF_RADIUS; y <= PCF_RADIUS; y++)
 		{
-			float pcfDepth = texture(light.shadowMap, projCoords.xy + vec2(x, y) * texelSize).r;
+			float pcfDepth = texture(uCascadeShadowMap, vec3(projCoords.xy + vec2(x, y) * texelSize, float(cascade))).r;
 			bool isInShadow = currentDepth - bias > pcfDepth;
 			shadow += float(isInShadow);
 		}
 	}
-	shadow /= 25.0;
+	shadow /= float((2 * PCF_RADIUS + 1) * (2 * PCF_RADIUS + 1));
 
 	return shadow;
 }
 
+float CalculateMomentShadow(const vec3 projCoords, const int cascade, const float bias)
+{
+	vec4 moments = texture(uCascadeMoments, vec3(projCoords.xy, float(cascade)));
+
+	// the same warp as evsmMoments.frag, the positive and the negative warp each bound the visibility
+	float depth = (projCoords.z - bias) * 2.0 - 1.0;
+	vec2 warpedDepth = vec2(exp(uEVSMExponents.x * depth), -exp(-uEVSMExponents.y * depth));
+	vec2 depthScale = 0.0001 * uEVSMExponents * warpedDepth;
+	vec2 minVariance = depthScale * depthScale;
+
+	float positiveVisibility = ChebyshevUpperBound(moments.xy, warpedDepth.x, minVariance.x);
+	float negativeVisibility = ChebyshevUpperBound(moments.zw, warpedDepth.y, minVariance.y);
+	return 1.0 - min(positiveVisibility, negativeVisibility);
+}
+
+float ChebyshevUpperBound(const vec2 moments, const float mean, const float minVariance)
+{
+	if (mean <= moments.x)
+	{
+		return 1.0;
+	}
+
+	float variance = max(moments.y - moments.x * moments.x, minVariance);
+	float distanceToMean = mean - moments.x;
+	float visibility = variance / (variance + distanceToMean * distanceToMean);
+
+	// cuts off the tail of the bound, which shows up as light leaking between overlapping casters
+	return clamp((visibility - uLightBleedingReduction) / (1.0 - uLightBleedingReduction), 0.0, 1.0);
+}
+
 float CalculatePointShadow(PointLight light, const vec3 fragPos, const vec3 viewPos)
 {
 	const int numSamples = 20;
@@ -224,9 +337,23 @@ float CalculatePointShadow(PointLight light, const vec3 fragPos, const vec3 view
 
 	for(int i = 0; i < numSamples; i++)
 	{
-		float closestDepth = texture(light.shadowCubeMap, fragToLight + gridSamplingDisk[i] * diskRadius).r;
-		closestDepth *= light.farPlane;   // undo mapping [0;1]
-		bool isInShadow = currentDepth - bias > closestDepth;
+		vec3 sampleDirection = fragToLight + gridSamplingDisk[i] * diskRadius;
+		float closestDepth = texture(light.shadowCubeMap, sampleDirection).r;
+		float fragmentDepth = currentDepth;
+		if (uPointShadowHardwareDepth)
+		{
+			// view depth along the axis of the face the sample falls on, for the fragment and the stored caster alike
+			vec3 absSample = abs(sampleDirection);
+			vec3 absFragToLight = abs(fragToLight);
+			fragmentDepth = absSample.x >= absSample.y && absSample.x >= absSample.z ? absFragToLight.x :
+				(absSample.y >= absSample.z ? absFragToLight.y : absFragToLight.z);
+			closestDepth = LinearizeDepth(closestDepth, light.nearPlane, light.farPlane) * light.farPlane;
+		}
+		else
+		{
+			closestDepth *= light.farPlane;   // undo mapping [0;1]
+		}
+		bool isInShadow = fragmentDepth - bias > closestDepth;
 		shadow += float(isInShadow);
 	}
 	shadow /= float(numSamples);
@@ -234,6 +361,63 @@ float CalculatePointShadow(PointLight light, const vec3 fragPos, const vec3 view
     return shadow;
 }
 
+float CalculateAtlasShadow(int light, const vec3 fragToLight)
+{
+	// cube face and face coordinates as in the cube map lookup, the tiles are rendered with the same face matrices
+	vec3 absDirection = abs(fragToLight);
+	int face;
+	float majorAxis;
+	vec2 faceCoords;
+	if (absDirection.x >= absDirection.y && absDirection.x >= absDirection.z)
+	{
+		face = fragToLight.x > 0.0 ? 0 : 1;
+		majorAxis = absDirection.x;
+		faceCoords = vec2(fragToLight.x > 0.0 ? -fragToLight.z : fragToLight.z, -fragToLight.y);
+	}
+	else if (absDirection.y >= absDirection.z)
+	{
+		face = fragToLight.y > 0.0 ? 2 : 3;
+		majorAxis = absDirection.y;
+		faceCoords = vec2(fragToLight.x, fragToLight.y > 0.0 ? fragToLight.z : -fragToLight.z);
+	}
+	else
+	{
+		face = fragToLight.z > 0.0 ? 4 : 5;
+		majorAxis = absDirection.z;
+		faceCoords = vec2(fragToLight.z > 0.0 ? fragToLight.x : -fragToLight.x, -fragToLight.y);
+	}
+
+	vec4 rect = uAtlasLights[light].faceRects[face];
+	if (rect.z == 0.0)
+	{
+		return 0.0;
+	}
+
+	float farPlane = uAtlasLights[light].positionRadius.w;
+	float currentDepth = length(fragToLight);
+	vec2 texelSize = 1.0 / vec2(textureSize(uShadowAtlas, 0));
+	vec2 tileCoords = (0.5 * faceCoords / majorAxis + 0.5) * rect.z;
+
+	// a texel of a small tile covers more of the scene, so the bias follows the tile resolution
+	float texelWorldSize = 2.0 * currentDepth * texelSize.x / rect.z;
+	float bias = 0.02 + 2.0 * texelWorldSize;
+
+	// 2x2 PCF, the taps are clamped into the tile so they never read a neighbouring light
+	float shadow = 0.0;
+	for (int x = 0; x < 2; x++)
+	{
+		for (int y = 0; y < 2; y++)
+		{
+			vec2 offset = (vec2(x, y) - 0.5) * texelSize;
+			vec2 atlasCoords = rect.xy + clamp(tileCoords + offset, 0.5 * texelSize, rect.zz - 0.5 * texelSize);
+			float closestDepth = texture(uShadowAtlas, atlasCoords).r * farPlane;
+			shadow += float(currentDepth - bias > closestDepth);
+		}
+	}
+
+	return shadow * 0.25;
+}
+
 vec3 CalculateDirectionalLight(
 	DirectionalLight light,
 	const vec3 normal,
@@ -276,6 +460,32 @@ vec3 CalculatePointLight(
 	return attenuation * (ambient + (1.0 - shadow) * (diffuse + specular));
 }
 
+vec3 CalculateAtlasLight(
+	int light,
+	const vec3 normal,
+	const vec3 viewDirection,
+	const vec3 materialDiffuse,
+	const vec3 materialSpecular,
+	const vec3 fragPos,
+	const float shadow
+)
+{
+	vec3 lightPosition = uAtlasLights[light].positionRadius.xyz;
+	float radius = uAtlasLights[light].positionRadius.w;
+	vec3 lightColor = uAtlasLights[light].color.rgb;
+	vec3 lightDirection = normalize(lightPosition - fragPos);
+
+	// inverse square falloff windowed to reach zero at the radius, where the shadow tiles end
+	float distanceToLight = length(lightPosition - fragPos);
+	float window = clamp(1.0 - pow(distanceToLight / radius, 4.0), 0.0, 1.0);
+	float attenuation = window * window / (distanceToLight * distanceToLight + 1.0);
+
+	vec3 diffuse = CalculateDiffuse(lightColor, normal, lightDirection, materialDiffuse);
+	vec3 specular = CalculateSpecular(lightColor, normal, lightDirection, viewDirection, materialSpecular);
+
+	return attenuation * (1.0 - shadow) * (diffuse + specular);
+}
+
 vec3 CalculateSpotLight(
 	SpotLight light,
 	const vec3 normal,
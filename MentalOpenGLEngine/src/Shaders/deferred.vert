@@ -5,8 +5,10 @@ layout (location = 1) in vec2 aTexCoords;
 
 out vec2 vTexCoords;
 
+uniform vec2 uRenderScale = vec2(1.0);
+
 void main()
 {
-    vTexCoords = aTexCoords;
+    vTexCoords = aTexCoords * uRenderScale;
     gl_Position = vec4(aPos, 1.0);
 }
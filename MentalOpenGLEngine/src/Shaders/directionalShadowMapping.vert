@@ -2,6 +2,9 @@
 
 layout (location = 0) in vec3 aPos;
 
+// also the depth prepass of the camera, which has to match the G-buffer pass exactly
+invariant gl_Position;
+
 uniform mat4 uLightSpaceMatrix;
 uniform mat4 uModel;
 
@@ -3,6 +3,9 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 4) in mat4 aInstanceModelMatrix;
 
+// also the depth prepass of the camera, which has to match the G-buffer pass exactly
+invariant gl_Position;
+
 uniform mat4 uLightSpaceMatrix;
 
 void main()
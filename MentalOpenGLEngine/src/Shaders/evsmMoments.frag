@@ -0,0 +1,28 @@
+#version 330 core
+
+out vec4 FragColor;
+
+in vec2 vTexCoords;
+
+uniform sampler2DArray uDepthMap;
+uniform int uLayer;
+uniform vec2 uExponents = vec2(40.0, 5.0);
+
+void main()
+{
+	// the moments are half the resolution of the depth map, every texel averages the 2x2 depth texels it covers
+	vec2 depthTexelSize = 1.0 / vec2(textureSize(uDepthMap, 0).xy);
+	vec4 moments = vec4(0.0);
+	for (int x = 0; x < 2; x++)
+	{
+		for (int y = 0; y < 2; y++)
+		{
+			vec2 offset = (vec2(x, y) - 0.5) * depthTexelSize;
+			float depth = texture(uDepthMap, vec3(vTexCoords + offset, float(uLayer))).r * 2.0 - 1.0;
+			vec2 warpedDepth = vec2(exp(uExponents.x * depth), -exp(-uExponents.y * depth));
+			moments += vec4(warpedDepth, warpedDepth * warpedDepth).xzyw;
+		}
+	}
+
+	FragColor = moments * 0.25;
+}
@@ -0,0 +1,57 @@
+#version 330 core
+
+uniform sampler2D uHistogram;
+uniform sampler2D uPrevLuminance;
+uniform bool uHistoryValid;
+
+// must match the histogram pass
+uniform float uMinLogLuminance = -8.0;
+uniform float uLogLuminanceRange = 12.0;
+// the darkest and brightest samples are left out, so a dark corner or the sun cannot drive the exposure
+uniform float uLowPercent = 0.5;
+uniform float uHighPercent = 0.95;
+// how fast the eye adapts, per second, separately for getting brighter and darker
+uniform float uSpeedUp = 3.0;
+uniform float uSpeedDown = 1.0;
+uniform float uDeltaTime;
+
+layout (location = 0) out float FragColor;
+
+void main()
+{
+	int numBins = textureSize(uHistogram, 0).x;
+	float total = 0.0;
+	for (int i = 1; i < numBins; i++)
+	{
+		total += texelFetch(uHistogram, ivec2(i, 0), 0).r;
+	}
+
+	// only the part of every bin between the two percentiles counts
+	float low = total * uLowPercent;
+	float high = total * uHighPercent;
+	float below = 0.0;
+	float logSum = 0.0;
+	float weight = 0.0;
+	for (int i = 1; i < numBins; i++)
+	{
+		float count = texelFetch(uHistogram, ivec2(i, 0), 0).r;
+		float inRange = max(min(below + count, high) - max(below, low), 0.0);
+		below += count;
+
+		float logLuminance = uMinLogLuminance + float(i - 1) / float(numBins - 2) * uLogLuminanceRange;
+		logSum += logLuminance * inRange;
+		weight += inRange;
+	}
+
+	float previous = texelFetch(uPrevLuminance, ivec2(0), 0).r;
+	// an all black frame keeps what the eye was adapted to
+	float target = weight > 0.0 ? exp2(logSum / weight) : (uHistoryValid ? previous : 1.0);
+	if (!uHistoryValid)
+	{
+		FragColor = target;
+		return;
+	}
+
+	float speed = target > previous ? uSpeedUp : uSpeedDown;
+	FragColor = previous + (target - previous) * (1.0 - exp(-uDeltaTime * speed));
+}
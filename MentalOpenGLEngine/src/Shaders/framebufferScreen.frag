@@ -3,22 +3,70 @@
 out vec4 FragColor;
 
 in vec2 vTexCoords;
+in vec2 vScreenCoords;
 
 uniform sampler2D uScreenTexture;
 uniform sampler2D uBloomTexture;
 
 uniform float uGamma = 2.2;
 uniform float uExposure = 1.0;
+uniform float uBloomStrength = 1.0;
+// the average luminance the eye is adapted to, the exposure scales it to uKeyValue
+uniform sampler2D uAverageLuminance;
+uniform bool uAutoExposure;
+uniform float uKeyValue = 0.18;
+uniform vec2 uExposureRange = vec2(0.05, 20.0);
+// the scene covers this fraction of uScreenTexture, the bilinear fetch stretches it over the window
+uniform vec2 uRenderScale = vec2(1.0);
+// 0 is a plain bilinear upscale, up to 1 restores some of the detail it softens
+uniform float uSharpness;
+uniform bool uOutputLuma;
+
+// contrast adaptive: the cross of neighbours is subtracted, less where the neighbourhood already has contrast
+vec3 Sharpen(vec2 texCoords, vec2 texelSize, vec3 center)
+{
+    vec3 up = texture(uScreenTexture, texCoords + vec2(0.0, texelSize.y)).rgb;
+    vec3 down = texture(uScreenTexture, texCoords - vec2(0.0, texelSize.y)).rgb;
+    vec3 left = texture(uScreenTexture, texCoords - vec2(texelSize.x, 0.0)).rgb;
+    vec3 right = texture(uScreenTexture, texCoords + vec2(texelSize.x, 0.0)).rgb;
+
+    // tone mapped first, so the weight does not depend on the HDR range
+    vec3 minColor = min(center, min(min(up, down), min(left, right)));
+    vec3 maxColor = max(center, max(max(up, down), max(left, right)));
+    vec3 minMapped = minColor / (1.0 + minColor);
+    vec3 maxMapped = maxColor / (1.0 + maxColor);
+    vec3 amplitude = sqrt(clamp(min(minMapped, 1.0 - maxMapped) / max(maxMapped, 1e-4), 0.0, 1.0));
+
+    vec3 weight = -amplitude * mix(0.125, 0.2, uSharpness);
+    vec3 sharpened = (center + (up + down + left + right) * weight) / (1.0 + 4.0 * weight);
+    return max(sharpened, vec3(0.0));
+}
 
 void main()
 {   
-    vec3 screenTextureColor = texture(uScreenTexture, vTexCoords).rgb;
-    vec3 bloomTextureColor = texture(uBloomTexture, vTexCoords).rgb;
+    // kept half a texel inside the rendered part, so the filter never blends in what lies outside it
+    vec2 texelSize = 1.0 / vec2(textureSize(uScreenTexture, 0));
+    vec2 texCoords = min(vTexCoords, uRenderScale - 0.5 * texelSize);
+
+    vec3 screenTextureColor = texture(uScreenTexture, texCoords).rgb;
+    if (uSharpness > 0.0)
+    {
+        screenTextureColor = Sharpen(texCoords, texelSize, screenTextureColor);
+    }
+    vec3 bloomTextureColor = texture(uBloomTexture, vScreenCoords).rgb;
 
-    screenTextureColor += bloomTextureColor; // additive blending
+    screenTextureColor += bloomTextureColor * uBloomStrength; // additive blending
     
-    vec3 mapped = vec3(1.0) - exp(-screenTextureColor * uExposure);
+    float exposure = uExposure;
+    if (uAutoExposure)
+    {
+        float averageLuminance = texelFetch(uAverageLuminance, ivec2(0), 0).r;
+        exposure = clamp(uKeyValue / max(averageLuminance, 1e-4), uExposureRange.x, uExposureRange.y);
+    }
+
+    vec3 mapped = vec3(1.0) - exp(-screenTextureColor * exposure);
     mapped = pow(mapped, vec3(1.0 / uGamma));
     
-    FragColor = vec4(mapped, 1.0);
+    // the post-process anti-aliasing reads the luma of the tone mapped colour from alpha
+    FragColor = vec4(mapped, uOutputLuma ? dot(mapped, vec3(0.299, 0.587, 0.114)) : 1.0);
 }
@@ -4,9 +4,14 @@ layout (location = 0) in vec2 aPos;
 layout (location = 1) in vec2 aTexCoords;
 
 out vec2 vTexCoords;
+// the full screen position, for inputs that always cover the whole target
+out vec2 vScreenCoords;
+
+uniform vec2 uRenderScale = vec2(1.0);
 
 void main()
 {
-    vTexCoords = aTexCoords;
+    vTexCoords = aTexCoords * uRenderScale;
+    vScreenCoords = aTexCoords;
     gl_Position = vec4(aPos, 0.0, 1.0); 
 }  
@@ -0,0 +1,145 @@
+#version 330 core
+
+in vec2 vScreenCoords;
+
+// tone mapped scene with its luma in alpha
+uniform sampler2D uScreenTexture;
+
+// local contrast below max(uEdgeThresholdMin, uEdgeThreshold * brightest luma) is left alone
+uniform float uEdgeThreshold = 0.125;
+uniform float uEdgeThresholdMin = 0.0312;
+uniform float uSubpixelQuality = 0.75;
+
+layout (location = 0) out vec4 FragColor;
+
+#define NUM_SEARCH_STEPS 12
+// the search along the edge takes longer strides the further it gets
+const float SEARCH_STEPS[NUM_SEARCH_STEPS] = float[](1.0, 1.0, 1.0, 1.0, 1.0, 1.5, 2.0, 2.0, 2.0, 2.0, 4.0, 8.0);
+
+float Luma(vec2 texCoords)
+{
+	return textureLod(uScreenTexture, texCoords, 0.0).a;
+}
+
+float Luma(ivec2 offset)
+{
+	return textureLodOffset(uScreenTexture, vScreenCoords, 0.0, offset).a;
+}
+
+void main()
+{
+	vec2 texelSize = 1.0 / vec2(textureSize(uScreenTexture, 0));
+	vec4 center = textureLod(uScreenTexture, vScreenCoords, 0.0);
+	float lumaCenter = center.a;
+	float lumaDown = Luma(ivec2(0, -1));
+	float lumaUp = Luma(ivec2(0, 1));
+	float lumaLeft = Luma(ivec2(-1, 0));
+	float lumaRight = Luma(ivec2(1, 0));
+
+	float lumaMin = min(lumaCenter, min(min(lumaDown, lumaUp), min(lumaLeft, lumaRight)));
+	float lumaMax = max(lumaCenter, max(max(lumaDown, lumaUp), max(lumaLeft, lumaRight)));
+	float lumaRange = lumaMax - lumaMin;
+	if (lumaRange < max(uEdgeThresholdMin, lumaMax * uEdgeThreshold))
+	{
+		FragColor = vec4(center.rgb, 1.0);
+		return;
+	}
+
+	float lumaDownLeft = Luma(ivec2(-1, -1));
+	float lumaUpRight = Luma(ivec2(1, 1));
+	float lumaUpLeft = Luma(ivec2(-1, 1));
+	float lumaDownRight = Luma(ivec2(1, -1));
+
+	float lumaDownUp = lumaDown + lumaUp;
+	float lumaLeftRight = lumaLeft + lumaRight;
+	float lumaLeftCorners = lumaDownLeft + lumaUpLeft;
+	float lumaDownCorners = lumaDownLeft + lumaDownRight;
+	float lumaRightCorners = lumaDownRight + lumaUpRight;
+	float lumaUpCorners = lumaUpRight + lumaUpLeft;
+
+	// the edge runs along the axis with the stronger second derivative across it
+	float edgeHorizontal = abs(-2.0 * lumaLeft + lumaLeftCorners) + abs(-2.0 * lumaCenter + lumaDownUp) * 2.0 + abs(-2.0 * lumaRight + lumaRightCorners);
+	float edgeVertical = abs(-2.0 * lumaUp + lumaUpCorners) + abs(-2.0 * lumaCenter + lumaLeftRight) * 2.0 + abs(-2.0 * lumaDown + lumaDownCorners);
+	bool isHorizontal = edgeHorizontal >= edgeVertical;
+
+	// which side of the pixel the edge is on
+	float luma1 = isHorizontal ? lumaDown : lumaLeft;
+	float luma2 = isHorizontal ? lumaUp : lumaRight;
+	float gradient1 = luma1 - lumaCenter;
+	float gradient2 = luma2 - lumaCenter;
+	bool is1Steepest = abs(gradient1) >= abs(gradient2);
+	float gradientScaled = 0.25 * max(abs(gradient1), abs(gradient2));
+
+	float stepLength = isHorizontal ? texelSize.y : texelSize.x;
+	float lumaLocalAverage = 0.5 * (luma2 + lumaCenter);
+	if (is1Steepest)
+	{
+		stepLength = -stepLength;
+		lumaLocalAverage = 0.5 * (luma1 + lumaCenter);
+	}
+
+	// walk both ways along the edge, on the boundary between the two pixels, until the luma leaves the edge
+	vec2 currentCoords = vScreenCoords;
+	if (isHorizontal)
+	{
+		currentCoords.y += stepLength * 0.5;
+	}
+	else
+	{
+		currentCoords.x += stepLength * 0.5;
+	}
+
+	vec2 offset = isHorizontal ? vec2(texelSize.x, 0.0) : vec2(0.0, texelSize.y);
+	vec2 coords1 = currentCoords - offset;
+	vec2 coords2 = currentCoords + offset;
+	float lumaEnd1 = Luma(coords1) - lumaLocalAverage;
+	float lumaEnd2 = Luma(coords2) - lumaLocalAverage;
+	bool reached1 = abs(lumaEnd1) >= gradientScaled;
+	bool reached2 = abs(lumaEnd2) >= gradientScaled;
+
+	for (int i = 1; i < NUM_SEARCH_STEPS && !(reached1 && reached2); i++)
+	{
+		if (!reached1)
+		{
+			coords1 -= offset * SEARCH_STEPS[i];
+			lumaEnd1 = Luma(coords1) - lumaLocalAverage;
+			reached1 = abs(lumaEnd1) >= gradientScaled;
+		}
+		if (!reached2)
+		{
+			coords2 += offset * SEARCH_STEPS[i];
+			lumaEnd2 = Luma(coords2) - lumaLocalAverage;
+			reached2 = abs(lumaEnd2) >= gradientScaled;
+		}
+	}
+
+	float distance1 = isHorizontal ? vScreenCoords.x - coords1.x : vScreenCoords.y - coords1.y;
+	float distance2 = isHorizontal ? coords2.x - vScreenCoords.x : coords2.y - vScreenCoords.y;
+	bool isDirection1 = distance1 < distance2;
+	float distanceFinal = min(distance1, distance2);
+	float edgeLength = distance1 + distance2;
+	float pixelOffset = -distanceFinal / edgeLength + 0.5;
+
+	// only shifted when the end closest to the pixel goes the same way as the pixel's own luma
+	bool isLumaCenterSmaller = lumaCenter < lumaLocalAverage;
+	bool correctVariation = ((isDirection1 ? lumaEnd1 : lumaEnd2) < 0.0) != isLumaCenterSmaller;
+	float finalOffset = correctVariation ? pixelOffset : 0.0;
+
+	// single pixel features are not edges, they get blended by their contrast to the 3x3 average
+	float lumaAverage = (1.0 / 12.0) * (2.0 * (lumaDownUp + lumaLeftRight) + lumaLeftCorners + lumaRightCorners);
+	float subpixelOffset = clamp(abs(lumaAverage - lumaCenter) / lumaRange, 0.0, 1.0);
+	subpixelOffset = (-2.0 * subpixelOffset + 3.0) * subpixelOffset * subpixelOffset;
+	finalOffset = max(finalOffset, subpixelOffset * subpixelOffset * uSubpixelQuality);
+
+	vec2 finalCoords = vScreenCoords;
+	if (isHorizontal)
+	{
+		finalCoords.y += finalOffset * stepLength;
+	}
+	else
+	{
+		finalCoords.x += finalOffset * stepLength;
+	}
+
+	FragColor = vec4(textureLod(uScreenTexture, finalCoords, 0.0).rgb, 1.0);
+}
@@ -10,6 +10,9 @@ in VS_OUT {
 
 	vec3 tangentPos;
 	vec3 tangentViewPos;
+
+	vec4 currentClipPos;
+	vec4 prevClipPos;
 } fs_in;
 
 struct Material
@@ -21,28 +24,66 @@ struct Material
 
 	vec3 specular;
 
+#ifdef RUNTIME_MATERIAL_FEATURES
 	bool useNormalTexture;
 	bool useSpecularTexture;
 	bool useHeightTexture;
+#endif
 };
 
+// the features are compiled in per material, USE_*_TEXTURE is defined for the ones it has;
+// RUNTIME_MATERIAL_FEATURES builds the uber-shader that branches on uniforms instead
+#ifdef RUNTIME_MATERIAL_FEATURES
+#define HAS_NORMAL_TEXTURE uMaterial.useNormalTexture
+#define HAS_SPECULAR_TEXTURE uMaterial.useSpecularTexture
+#define HAS_HEIGHT_TEXTURE uMaterial.useHeightTexture
+#else
+#ifdef USE_NORMAL_TEXTURE
+#define HAS_NORMAL_TEXTURE true
+#else
+#define HAS_NORMAL_TEXTURE false
+#endif
+#ifdef USE_SPECULAR_TEXTURE
+#define HAS_SPECULAR_TEXTURE true
+#else
+#define HAS_SPECULAR_TEXTURE false
+#endif
+#ifdef USE_HEIGHT_TEXTURE
+#define HAS_HEIGHT_TEXTURE true
+#else
+#define HAS_HEIGHT_TEXTURE false
+#endif
+#endif
+
 layout (location = 0) out vec3 gPosition;
 layout (location = 1) out vec3 gNormal;
 layout (location = 2) out vec4 gAlbedoSpecular;
+layout (location = 3) out vec2 gVelocity;
 
 uniform Material uMaterial;
 uniform float uHeightScale = 0.1;
+// the height texture of the material is a baked cone step map, with the square root of the cone ratios in green
+uniform bool uHasConeSteps;
+// steps those materials by their cones instead of the fixed layers of the parallax occlusion mapping
+uniform bool uConeStepMapping = true;
 
 vec2 ParallaxOcclusionMapping(const vec2 texCoords, const vec3 viewDirection, const float minLayers, const float maxLayers);
+vec2 RelaxedConeStepMapping(const vec2 texCoords, const vec3 viewDirection);
 
 void main()
 {
 	vec3 viewDirectionTangent = normalize(fs_in.tangentViewPos - fs_in.tangentPos);
 
-	vec2 texCoords = uMaterial.useHeightTexture ? ParallaxOcclusionMapping(fs_in.texCoords, viewDirectionTangent, 8.0, 32.0) : fs_in.texCoords;
+	vec2 texCoords = fs_in.texCoords;
+	if (HAS_HEIGHT_TEXTURE)
+	{
+		texCoords = uHasConeSteps && uConeStepMapping
+			? RelaxedConeStepMapping(fs_in.texCoords, viewDirectionTangent)
+			: ParallaxOcclusionMapping(fs_in.texCoords, viewDirectionTangent, 8.0, 32.0);
+	}
 
 	vec3 normal = normalize(fs_in.normal);
-	if (uMaterial.useNormalTexture)
+	if (HAS_NORMAL_TEXTURE)
 	{
 		normal = texture(uMaterial.normalTexture1, texCoords).rgb;
 		normal = normalize(normal * 2.0 - 1.0); // transform to range [-1, 1]
@@ -54,7 +95,7 @@ void main()
 	albedo = vec3(0.95);
 
 	float specular = uMaterial.specular.r;
-	if (uMaterial.useSpecularTexture)
+	if (HAS_SPECULAR_TEXTURE)
 	{
 		specular = texture(uMaterial.specularTexture1, texCoords).r;
 	}
@@ -62,6 +103,7 @@ void main()
 	gPosition = fs_in.worldPos;
 	gNormal = normal;
 	gAlbedoSpecular = vec4(albedo, specular);
+	gVelocity = (fs_in.currentClipPos.xy / fs_in.currentClipPos.w - fs_in.prevClipPos.xy / fs_in.prevClipPos.w) * 0.5;
 }
 
 vec2 ParallaxOcclusionMapping(const vec2 texCoords, const vec3 viewDirection, const float minLayers, const float maxLayers)
@@ -105,3 +147,36 @@ vec2 ParallaxOcclusionMapping(const vec2 texCoords, const vec3 viewDirection, co
 
 	return finalTexCoords;
 }
+
+const int CONE_STEPS = 8;
+const int BINARY_SEARCH_STEPS = 6;
+
+vec2 RelaxedConeStepMapping(const vec2 texCoords, const vec3 viewDirection)
+{
+	// the same ray as the layers above, one unit of depth per step of p
+	vec3 ray = vec3(-viewDirection.xy * uHeightScale, 1.0);
+	float rayRatio = length(ray.xy);
+
+	// every step ends where the ray leaves the cone of the texel it starts at, the relaxed cones
+	// let it cross the surface at most once, so it stops in the first gap it enters
+	vec3 position = vec3(texCoords, 0.0);
+	for (int i = 0; i < CONE_STEPS; i++)
+	{
+		vec2 coneStep = texture(uMaterial.heightTexture1, position.xy).rg;
+		float coneRatio = coneStep.g * coneStep.g;
+		float height = clamp(coneStep.r - position.z, 0.0, 1.0);
+		position += ray * (coneRatio * height / (rayRatio + coneRatio));
+	}
+
+	// the ray crossed the surface at most once, so the intersection is between the start and where it ended up
+	vec3 range = 0.5 * ray * position.z;
+	position = vec3(texCoords, 0.0) + range;
+	for (int i = 0; i < BINARY_SEARCH_STEPS; i++)
+	{
+		float depth = texture(uMaterial.heightTexture1, position.xy).r;
+		range *= 0.5;
+		position += position.z < depth ? range : -range;
+	}
+
+	return position.xy;
+}
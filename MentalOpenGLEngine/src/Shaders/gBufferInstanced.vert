@@ -16,19 +16,24 @@ out VS_OUT {
 
 	vec3 tangentPos;
 	vec3 tangentViewPos;
+
+	vec4 currentClipPos;
+	vec4 prevClipPos;
 } vs_out;
 
-layout (std140) uniform Matrices
-{
-	mat4 uView;
-	mat4 uProjection;
-};
+// has to match the depth of the prepass exactly, see Engine::DepthPrepass
+invariant gl_Position;
 
 uniform mat4 uModel;
 uniform float uTexTiling = 1.0f;
-uniform vec2 uTexDisplacement = vec2(0.0);
+uniform vec2 uTexDisplacement;
 uniform float uNormalsMultiplier = 1.0;
 uniform vec3 uViewPos;
+// without the jitter, so only real motion ends up in the velocity
+uniform mat4 uViewProjection;
+uniform mat4 uPrevViewProjection;
+// with the jitter, the one used for rasterization
+uniform mat4 uJitteredViewProjection;
 
 mat3 TBNMat(const vec3 normal, const mat3 normalMatrix);
 
@@ -51,7 +56,10 @@ void main()
 	vs_out.tangentPos = worldToTangent * vs_out.worldPos;
 	vs_out.tangentViewPos = worldToTangent * uViewPos;
 
-	gl_Position = uProjection * uView * vec4(vs_out.worldPos, 1.0);
+	vs_out.currentClipPos = uViewProjection * vec4(vs_out.worldPos, 1.0);
+	vs_out.prevClipPos = uPrevViewProjection * vec4(vs_out.worldPos, 1.0);
+
+	gl_Position = uJitteredViewProjection * aInstanceModelMatrix * vec4(aPos, 1.0);
 }
 
 mat3 TBNMat(const vec3 normal, const mat3 normalMatrix)
@@ -14,23 +14,23 @@ void main()
 {             
      vec2 tex_offset = 1.0 / textureSize(uImage, 0); // gets size of single texel
 
-     vec3 result = texture(uImage, vTexCoords).rgb * uWeights[0];
+     vec4 result = texture(uImage, vTexCoords) * uWeights[0];
 
      if (uHorizontal)
      {
          for(int i = 1; i < 5; ++i)
          {
-            result += texture(uImage, vTexCoords + vec2(tex_offset.x * i * uSampleDistance.x, 0.0)).rgb * uWeights[i];
-            result += texture(uImage, vTexCoords - vec2(tex_offset.x * i * uSampleDistance.x, 0.0)).rgb * uWeights[i];
+            result += texture(uImage, vTexCoords + vec2(tex_offset.x * i * uSampleDistance.x, 0.0)) * uWeights[i];
+            result += texture(uImage, vTexCoords - vec2(tex_offset.x * i * uSampleDistance.x, 0.0)) * uWeights[i];
          }
      }
      else
      {
          for(int i = 1; i < 5; ++i)
          {
-             result += texture(uImage, vTexCoords + vec2(0.0, tex_offset.y * i * uSampleDistance.y)).rgb * uWeights[i];
-             result += texture(uImage, vTexCoords - vec2(0.0, tex_offset.y * i * uSampleDistance.y)).rgb * uWeights[i];
+             result += texture(uImage, vTexCoords + vec2(0.0, tex_offset.y * i * uSampleDistance.y)) * uWeights[i];
+             result += texture(uImage, vTexCoords - vec2(0.0, tex_offset.y * i * uSampleDistance.y)) * uWeights[i];
          }
      }
-     FragColor = vec4(result, 1.0);
+     FragColor = result;
 }
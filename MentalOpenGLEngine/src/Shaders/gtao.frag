@@ -0,0 +1,99 @@
+#version 330 core
+
+#define PI 3.14159265
+#define HALF_PI 1.57079633
+
+in vec2 vTexCoords;
+
+// view space normal in rgb, linear view depth in alpha
+uniform sampler2D uDepthNormal;
+uniform sampler2D uNoiseTexture;
+
+uniform vec2 uNoiseScale;
+uniform int uNumSlices = 2;
+uniform int uNumSteps = 4;
+uniform float uRadius = 0.5;
+uniform float uPower = 1.0;
+uniform vec2 uRenderScale = vec2(1.0);
+
+layout (std140) uniform Matrices
+{
+	mat4 uView;
+	mat4 uProjection;
+};
+
+layout (location = 0) out float Occlusion;
+
+vec3 GetViewPosition(vec2 texCoords, float depth)
+{
+	vec2 ndc = texCoords / uRenderScale * 2.0 - 1.0;
+	return vec3(ndc * depth / vec2(uProjection[0][0], uProjection[1][1]), -depth);
+}
+
+// cosine of the highest horizon along one side of the slice, samples fade out towards the radius
+float FindHorizon(vec3 viewPos, vec3 viewDir, vec2 direction, vec2 radiusTexCoords, float jitter)
+{
+	float horizonCos = -1.0;
+	for (int i = 0; i < uNumSteps; i++)
+	{
+		// squared spacing puts more samples close to the pixel, where the occluders matter most
+		float t = (float(i) + jitter) / float(uNumSteps);
+		vec2 texCoords = vTexCoords + direction * radiusTexCoords * t * t;
+		if (any(lessThan(texCoords, vec2(0.0))) || any(greaterThan(texCoords, uRenderScale)))
+		{
+			break;
+		}
+
+		vec3 samplePos = GetViewPosition(texCoords, texture(uDepthNormal, texCoords).a);
+		vec3 delta = samplePos - viewPos;
+		float distance = length(delta);
+		float sampleCos = dot(delta / distance, viewDir);
+		float falloff = clamp(1.0 - distance * distance / (uRadius * uRadius), 0.0, 1.0);
+		horizonCos = max(horizonCos, mix(-1.0, sampleCos, falloff));
+	}
+	return horizonCos;
+}
+
+void main()
+{
+	vec4 depthNormal = texture(uDepthNormal, vTexCoords);
+	vec3 viewPos = GetViewPosition(vTexCoords, depthNormal.a);
+	vec3 normal = normalize(depthNormal.rgb);
+	vec3 viewDir = normalize(-viewPos);
+	vec3 noise = texture(uNoiseTexture, vTexCoords * uNoiseScale).rgb;
+
+	// the world space radius projected to texture space at this depth
+	vec2 radiusTexCoords = 0.5 * uRadius * vec2(uProjection[0][0], uProjection[1][1]) / depthNormal.a * uRenderScale;
+
+	float visibility = 0.0;
+	for (int slice = 0; slice < uNumSlices; slice++)
+	{
+		float phi = (float(slice) + noise.x * 0.5 + 0.5) * PI / float(uNumSlices);
+		vec2 direction = vec2(cos(phi), sin(phi));
+
+		// the slice plane contains the view direction and the screen space direction
+		vec3 directionVec = vec3(direction, 0.0);
+		vec3 orthoDirection = directionVec - dot(directionVec, viewDir) * viewDir;
+		vec3 axis = normalize(cross(orthoDirection, viewDir));
+		vec3 projectedNormal = normal - axis * dot(normal, axis);
+		float projectedNormalLength = length(projectedNormal);
+
+		float signNormal = sign(dot(orthoDirection, projectedNormal));
+		float cosNormal = clamp(dot(projectedNormal, viewDir) / max(projectedNormalLength, 1e-4), 0.0, 1.0);
+		float n = signNormal * acos(cosNormal);
+
+		float jitter = noise.y * 0.5 + 0.5;
+		float h0 = -acos(FindHorizon(viewPos, viewDir, -direction, radiusTexCoords, jitter));
+		float h1 = acos(FindHorizon(viewPos, viewDir, direction, radiusTexCoords, jitter));
+		h0 = n + clamp(h0 - n, -HALF_PI, HALF_PI);
+		h1 = n + clamp(h1 - n, -HALF_PI, HALF_PI);
+
+		// cosine weighted integral of the visible arc between the two horizons
+		float arc0 = (cosNormal + 2.0 * h0 * sin(n) - cos(2.0 * h0 - n)) * 0.25;
+		float arc1 = (cosNormal + 2.0 * h1 * sin(n) - cos(2.0 * h1 - n)) * 0.25;
+		visibility += projectedNormalLength * (arc0 + arc1);
+	}
+	visibility /= float(uNumSlices);
+
+	Occlusion = pow(clamp(visibility, 0.0, 1.0), uPower);
+}
@@ -0,0 +1,8 @@
+#version 330 core
+
+layout (location = 0) out float FragColor;
+
+void main()
+{
+	FragColor = 1.0;
+}
@@ -0,0 +1,29 @@
+#version 330 core
+
+// no vertex attributes, every vertex is one sample on a uGridWidth x uGridHeight grid over the lit scene
+uniform sampler2D uSceneTexture;
+uniform int uGridWidth;
+uniform int uGridHeight;
+uniform vec2 uRenderScale = vec2(1.0);
+// log2 luminance covered by the histogram, black samples go to the first bin and are left out of the average
+uniform float uMinLogLuminance = -8.0;
+uniform float uLogLuminanceRange = 12.0;
+uniform int uNumBins = 64;
+
+void main()
+{
+	ivec2 cell = ivec2(gl_VertexID % uGridWidth, gl_VertexID / uGridWidth);
+	vec2 texCoords = (vec2(cell) + 0.5) / vec2(uGridWidth, uGridHeight) * uRenderScale;
+	vec3 color = textureLod(uSceneTexture, texCoords, 0.0).rgb;
+	float luminance = dot(color, vec3(0.2126, 0.7152, 0.0722));
+
+	int bin = 0;
+	if (luminance > 1e-5)
+	{
+		float t = clamp((log2(luminance) - uMinLogLuminance) / uLogLuminanceRange, 0.0, 1.0);
+		bin = 1 + int(t * float(uNumBins - 2) + 0.5);
+	}
+
+	// the point lands on the centre of its bin's texel, the blending adds it up
+	gl_Position = vec4((float(bin) + 0.5) / float(uNumBins) * 2.0 - 1.0, 0.0, 0.0, 1.0);
+}
@@ -0,0 +1,25 @@
+#version 330 core
+
+in vec2 vTexCoords;
+
+uniform sampler2D uAccumulation;
+uniform sampler2D uWeight;
+
+layout (location = 0) out vec4 FragColor;
+
+void main()
+{
+	vec4 accumulation = texture(uAccumulation, vTexCoords);
+	float revealage = accumulation.a;
+	if (revealage > 0.999)
+	{
+		discard;
+	}
+
+	float weightSum = texture(uWeight, vTexCoords).r;
+	vec3 averageColor = accumulation.rgb / max(weightSum, 1e-5);
+	float coverage = 1.0 - revealage;
+
+	// blended over the lighting buffer with the coverage, so bloom sees the transparent surfaces too
+	FragColor = vec4(averageColor, coverage);
+}
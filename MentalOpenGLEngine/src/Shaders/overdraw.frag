@@ -0,0 +1,9 @@
+#version 330 core
+
+// counted with additive blending, one per fragment that passes the depth test
+layout (location = 0) out vec4 FragColor;
+
+void main()
+{
+	FragColor = vec4(1.0);
+}
@@ -0,0 +1,25 @@
+#version 330 core
+
+in vec2 vTexCoords;
+
+uniform sampler2D uOverdraw;
+// black for nothing drawn, then blue, green, yellow and red from one shaded fragment per pixel up to this many
+uniform float uMaxOverdraw = 4.0;
+
+out vec4 FragColor;
+
+void main()
+{
+	float count = texture(uOverdraw, vTexCoords).r;
+	if (count < 0.5)
+	{
+		FragColor = vec4(0.0, 0.0, 0.0, 1.0);
+		return;
+	}
+
+	float t = clamp((count - 1.0) / (uMaxOverdraw - 1.0), 0.0, 1.0) * 3.0;
+	vec3 color = mix(vec3(0.0, 0.2, 1.0), vec3(0.0, 1.0, 0.0), clamp(t, 0.0, 1.0));
+	color = mix(color, vec3(1.0, 1.0, 0.0), clamp(t - 1.0, 0.0, 1.0));
+	color = mix(color, vec3(1.0, 0.0, 0.0), clamp(t - 2.0, 0.0, 1.0));
+	FragColor = vec4(color, 1.0);
+}
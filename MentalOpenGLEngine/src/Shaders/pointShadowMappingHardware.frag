@@ -0,0 +1,6 @@
+#version 330 core
+
+// depth only, the rasterized depth is kept and early depth testing stays enabled
+void main()
+{
+}
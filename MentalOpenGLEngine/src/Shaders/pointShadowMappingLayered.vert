@@ -0,0 +1,19 @@
+#version 330 core
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_layer : enable
+
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 uModel;
+uniform mat4 uShadowMatrix;
+uniform int uFace;
+
+out vec4 FragPos;
+
+void main()
+{
+	// the cube face is picked in the vertex stage, so the whole cubemap stays attached for all six faces
+	gl_Layer = uFace;
+	FragPos = uModel * vec4(aPos, 1.0);
+	gl_Position = uShadowMatrix * FragPos;
+}
@@ -0,0 +1,18 @@
+#version 330 core
+#extension GL_ARB_shader_viewport_layer_array : enable
+#extension GL_AMD_vertex_shader_layer : enable
+
+layout (location = 0) in vec3 aPos;
+layout (location = 4) in mat4 aInstanceModelMatrix;
+
+uniform mat4 uShadowMatrix;
+uniform int uFace;
+
+out vec4 FragPos;
+
+void main()
+{
+	gl_Layer = uFace;
+	FragPos = aInstanceModelMatrix * vec4(aPos, 1.0);
+	gl_Position = uShadowMatrix * FragPos;
+}
@@ -0,0 +1,37 @@
+#version 330 core
+
+in vec2 vScreenCoords;
+
+uniform sampler2D uScreenTexture;
+uniform sampler2D uBlendWeightsTexture;
+
+layout (location = 0) out vec4 FragColor;
+
+// every pixel blends with the one neighbour its strongest weight points at, a single bilinear fetch does the mix
+void main()
+{
+	vec2 texelSize = 1.0 / vec2(textureSize(uScreenTexture, 0));
+
+	// the weights of the edges this pixel shares: right neighbour's left edge, lower neighbour's top edge, then its own
+	vec4 a;
+	a.x = texture(uBlendWeightsTexture, vScreenCoords + vec2(texelSize.x, 0.0)).a;
+	a.y = texture(uBlendWeightsTexture, vScreenCoords - vec2(0.0, texelSize.y)).g;
+	a.wz = texture(uBlendWeightsTexture, vScreenCoords).xz;
+
+	if (dot(a, vec4(1.0)) < 1e-5)
+	{
+		FragColor = vec4(textureLod(uScreenTexture, vScreenCoords, 0.0).rgb, 1.0);
+		return;
+	}
+
+	bool isHorizontal = max(a.x, a.z) > max(a.y, a.w);
+	vec4 blendingOffset = isHorizontal ? vec4(a.x, 0.0, a.z, 0.0) : vec4(0.0, a.y, 0.0, a.w);
+	vec2 blendingWeight = isHorizontal ? a.xz : a.yw;
+	blendingWeight /= dot(blendingWeight, vec2(1.0));
+
+	vec2 coords1 = vScreenCoords + vec2(blendingOffset.x, -blendingOffset.y) * texelSize;
+	vec2 coords2 = vScreenCoords + vec2(-blendingOffset.z, blendingOffset.w) * texelSize;
+	vec3 color = blendingWeight.x * textureLod(uScreenTexture, coords1, 0.0).rgb;
+	color += blendingWeight.y * textureLod(uScreenTexture, coords2, 0.0).rgb;
+	FragColor = vec4(color, 1.0);
+}
@@ -0,0 +1,45 @@
+#version 330 core
+
+in vec2 vScreenCoords;
+
+// tone mapped scene with its luma in alpha
+uniform sampler2D uScreenTexture;
+
+uniform float uThreshold = 0.1;
+// an edge is dropped when a neighbouring edge has this much more contrast, which keeps thin lines intact
+uniform float uLocalContrastAdaptation = 2.0;
+
+layout (location = 0) out vec2 Edges;
+
+float Luma(ivec2 offset)
+{
+	return textureOffset(uScreenTexture, vScreenCoords, offset).a;
+}
+
+// luma edges between this pixel and the ones to its left (r) and above it (g)
+void main()
+{
+	float luma = Luma(ivec2(0, 0));
+	float lumaLeft = Luma(ivec2(-1, 0));
+	float lumaTop = Luma(ivec2(0, 1));
+
+	vec2 delta = abs(luma - vec2(lumaLeft, lumaTop));
+	vec2 edges = step(vec2(uThreshold), delta);
+	if (dot(edges, vec2(1.0)) == 0.0)
+	{
+		discard;
+	}
+
+	float lumaRight = Luma(ivec2(1, 0));
+	float lumaBottom = Luma(ivec2(0, -1));
+	vec2 maxDelta = max(delta, abs(luma - vec2(lumaRight, lumaBottom)));
+
+	float lumaLeftLeft = Luma(ivec2(-2, 0));
+	float lumaTopTop = Luma(ivec2(0, 2));
+	maxDelta = max(maxDelta, abs(vec2(lumaLeft, lumaTop) - vec2(lumaLeftLeft, lumaTopTop)));
+
+	float finalDelta = max(maxDelta.x, maxDelta.y);
+	edges *= step(vec2(finalDelta), uLocalContrastAdaptation * delta);
+
+	Edges = edges;
+}
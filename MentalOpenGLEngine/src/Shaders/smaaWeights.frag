@@ -0,0 +1,135 @@
+#version 330 core
+
+// SMAA 1x blending weights, orthogonal patterns only. The reference is written for a top-left origin,
+// every vertical offset and search direction here is mirrored for GL's bottom-left one.
+
+in vec2 vScreenCoords;
+
+uniform sampler2D uEdgesTexture;
+uniform sampler2D uAreaTexture;
+uniform sampler2D uSearchTexture;
+
+uniform int uMaxSearchSteps = 8;
+
+layout (location = 0) out vec4 BlendWeights;
+
+// kept in sync with SMAAFrameBuffer
+const float AREA_MAX_DISTANCE = 16.0;
+const float AREA_TEXTURE_SIZE = 80.0;
+const int SEARCH_RIGHT_OFFSET = 33;
+
+vec2 texelSize;
+
+// the search texture is indexed by the bilinear fetch of four edges, which are multiples of 1/32
+float SearchLength(vec2 e, int offset)
+{
+	ivec2 texel = ivec2(round(e * 32.0));
+	return texelFetch(uSearchTexture, texel + ivec2(offset, 0), 0).r;
+}
+
+// every fetch covers two pixels, the search texture corrects the overshoot of the last one
+float SearchXLeft(vec2 texCoords, float end)
+{
+	vec2 e = vec2(0.0, 1.0);
+	while (texCoords.x > end && e.g > 0.8281 && e.r == 0.0)
+	{
+		e = textureLod(uEdgesTexture, texCoords, 0.0).rg;
+		texCoords.x -= 2.0 * texelSize.x;
+	}
+	float offset = 3.25 - (255.0 / 127.0) * SearchLength(e, 0);
+	return texCoords.x + offset * texelSize.x;
+}
+
+float SearchXRight(vec2 texCoords, float end)
+{
+	vec2 e = vec2(0.0, 1.0);
+	while (texCoords.x < end && e.g > 0.8281 && e.r == 0.0)
+	{
+		e = textureLod(uEdgesTexture, texCoords, 0.0).rg;
+		texCoords.x += 2.0 * texelSize.x;
+	}
+	float offset = 3.25 - (255.0 / 127.0) * SearchLength(e, SEARCH_RIGHT_OFFSET);
+	return texCoords.x - offset * texelSize.x;
+}
+
+float SearchYUp(vec2 texCoords, float end)
+{
+	vec2 e = vec2(1.0, 0.0);
+	while (texCoords.y < end && e.r > 0.8281 && e.g == 0.0)
+	{
+		e = textureLod(uEdgesTexture, texCoords, 0.0).rg;
+		texCoords.y += 2.0 * texelSize.y;
+	}
+	float offset = 3.25 - (255.0 / 127.0) * SearchLength(e.gr, 0);
+	return texCoords.y - offset * texelSize.y;
+}
+
+float SearchYDown(vec2 texCoords, float end)
+{
+	vec2 e = vec2(1.0, 0.0);
+	while (texCoords.y > end && e.r > 0.8281 && e.g == 0.0)
+	{
+		e = textureLod(uEdgesTexture, texCoords, 0.0).rg;
+		texCoords.y -= 2.0 * texelSize.y;
+	}
+	float offset = 3.25 - (255.0 / 127.0) * SearchLength(e.gr, SEARCH_RIGHT_OFFSET);
+	return texCoords.y + offset * texelSize.y;
+}
+
+// the distances are stored quadratically, so the texel is found from their square roots
+vec2 Area(vec2 distance, float e1, float e2)
+{
+	vec2 texel = AREA_MAX_DISTANCE * round(4.0 * vec2(e1, e2)) + sqrt(distance);
+	return textureLod(uAreaTexture, (texel + 0.5) / AREA_TEXTURE_SIZE, 0.0).rg;
+}
+
+void main()
+{
+	texelSize = 1.0 / vec2(textureSize(uEdgesTexture, 0));
+	vec2 pixelCoords = vScreenCoords / texelSize;
+
+	vec4 weights = vec4(0.0);
+	vec2 e = texture(uEdgesTexture, vScreenCoords).rg;
+	if (dot(e, vec2(1.0)) == 0.0)
+	{
+		BlendWeights = weights;
+		return;
+	}
+
+	// the fetches sit between two pixels, so one sample tells apart the edges of both
+	vec4 offsetX = vScreenCoords.xyxy + texelSize.xyxy * vec4(-0.25, 0.125, 1.25, 0.125);
+	vec4 offsetY = vScreenCoords.xyxy + texelSize.xyxy * vec4(-0.125, 0.25, -0.125, -1.25);
+	float searchRange = 2.0 * float(uMaxSearchSteps);
+	vec4 searchEnds = vec4(offsetX.x, offsetX.z, offsetY.y, offsetY.w) + vec4(-searchRange, searchRange, searchRange, -searchRange) * texelSize.xxyy;
+
+	// edge on top
+	if (e.g > 0.0)
+	{
+		vec3 coords;
+		coords.x = SearchXLeft(offsetX.xy, searchEnds.x);
+		// a quarter texel towards the line above tells which of the two rows the crossing edges are in
+		coords.y = offsetY.y;
+		float e1 = textureLod(uEdgesTexture, coords.xy, 0.0).r;
+		coords.z = SearchXRight(offsetX.zw, searchEnds.y);
+
+		vec2 d = abs(round(vec2(coords.x, coords.z) / texelSize.x - pixelCoords.x));
+		float e2 = textureLodOffset(uEdgesTexture, coords.zy, 0.0, ivec2(1, 0)).r;
+		weights.rg = Area(d, e1, e2);
+	}
+
+	// edge on the left
+	if (e.r > 0.0)
+	{
+		vec3 coords;
+		coords.y = SearchYUp(offsetY.xy, searchEnds.z);
+		coords.x = offsetX.x;
+		float e1 = textureLod(uEdgesTexture, coords.xy, 0.0).g;
+		coords.z = SearchYDown(offsetY.zw, searchEnds.w);
+
+		vec2 d = abs(round(vec2(coords.y, coords.z) / texelSize.y - pixelCoords.y));
+		float e2 = textureLodOffset(uEdgesTexture, coords.xz, 0.0, ivec2(0, -1)).g;
+		weights.ba = Area(d, e1, e2);
+	}
+
+	BlendWeights = weights;
+}
@@ -1,6 +1,13 @@
 #version 330 core
 
-#define MAX_SAMPLES 256
+#define SAMPLE_CAPACITY 256
+
+// bounds the kernel loop, uSamples keeps its full capacity
+#ifdef GL_SPIRV
+layout (constant_id = 2) const int MAX_SAMPLES = SAMPLE_CAPACITY;
+#elif !defined(MAX_SAMPLES)
+#define MAX_SAMPLES SAMPLE_CAPACITY
+#endif
 
 in vec2 vTexCoords;
 
@@ -8,12 +15,15 @@ uniform sampler2D gPosition;
 uniform sampler2D gNormal;
 uniform sampler2D uNoiseTexture;
 
-uniform vec3 uSamples[MAX_SAMPLES];
+uniform vec3 uSamples[SAMPLE_CAPACITY];
 uniform int uNumSamples;
+// every n-th kernel sample is evaluated, a cheaper and noisier estimate
+uniform int uSampleStride = 1;
 uniform vec2 uNoiseScale;
 uniform float uRadius = 0.5;
 uniform float uBias = 0.025;
 uniform float uPower = 1.0;
+uniform vec2 uRenderScale = vec2(1.0);
 
 layout (std140) uniform Matrices
 {
@@ -35,7 +45,8 @@ void main()
 	mat3 TBN = mat3(tangent, bitangent, normal);
 
 	float occlusion = 0.0;
-	for (int i = 0; i < min(uNumSamples, MAX_SAMPLES); i++)
+	int numSamples = 0;
+	for (int i = 0; i < min(uNumSamples, MAX_SAMPLES); i += uSampleStride)
 	{
 		// get sample position
 		vec3 samplePos = TBN * uSamples[i]; // from tangent to view space
@@ -46,6 +57,7 @@ void main()
 		offset = uProjection * offset; // from view to clip-space
 		offset.xyz /= offset.w; // perspective divide
 		offset.xyz = offset.xyz * 0.5 + 0.5; // transform to range 0.0 - 1.0 
+		offset.xy *= uRenderScale; // into the part of the G-buffer the scene covers
 
 		// get sample depth
 		vec3 sampleFragPos = vec3(uView * vec4(texture(gPosition, offset.xy).rgb, 1.0));
@@ -54,8 +66,9 @@ void main()
 		// range check & accumulate
 		float rangeCheck = smoothstep(0.0, 1.0, uRadius / abs(fragPos.z - sampleDepth));
 		occlusion += (sampleDepth >= samplePos.z + uBias ? 1.0 : 0.0) * rangeCheck;
+		numSamples++;
 	}
-	occlusion = 1.0 - (occlusion / uNumSamples);
+	occlusion = 1.0 - (occlusion / float(max(numSamples, 1)));
 	occlusion = pow(occlusion, uPower);
 
 	Occlusion = occlusion;
@@ -5,6 +5,8 @@ out float Occlusion;
 in vec2 vTexCoords;
   
 uniform sampler2D uSSAOTexture;
+// applied per tap, for inputs that are still plain visibility
+uniform float uPower = 1.0;
 
 void main() {
     vec2 texelSize = 1.0 / vec2(textureSize(uSSAOTexture, 0));
@@ -15,7 +17,7 @@ void main() {
         for (int y = -2; y < 2; ++y) 
         {
             vec2 offset = vec2(float(x), float(y)) * texelSize;
-            result += texture(uSSAOTexture, vTexCoords + offset).r;
+            result += pow(texture(uSSAOTexture, vTexCoords + offset).r, uPower);
         }
     }
 
@@ -0,0 +1,34 @@
+#version 330 core
+
+in vec2 vTexCoords;
+
+uniform sampler2D uSSAOTexture;
+// view space normal in rgb, linear view depth in alpha, at the resolution of uSSAOTexture
+uniform sampler2D uDepthNormal;
+// relative depth difference at which a neighbour loses most of its weight
+uniform float uDepthSharpness = 0.05;
+
+layout (location = 0) out float Occlusion;
+
+// 4x4 depth aware blur: matches the noise tile, but does not smear occlusion across depth discontinuities
+void main()
+{
+	vec2 texelSize = 1.0 / vec2(textureSize(uSSAOTexture, 0));
+	float depth = texture(uDepthNormal, vTexCoords).a;
+
+	float occlusion = 0.0;
+	float totalWeight = 0.0;
+	for (int x = -2; x < 2; x++)
+	{
+		for (int y = -2; y < 2; y++)
+		{
+			vec2 texCoords = vTexCoords + vec2(x, y) * texelSize;
+			float sampleDepth = texture(uDepthNormal, texCoords).a;
+			float weight = exp(-abs(depth - sampleDepth) / (uDepthSharpness * depth));
+			occlusion += texture(uSSAOTexture, texCoords).r * weight;
+			totalWeight += weight;
+		}
+	}
+
+	Occlusion = occlusion / max(totalWeight, 1e-4);
+}
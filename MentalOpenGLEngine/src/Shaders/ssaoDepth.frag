@@ -0,0 +1,76 @@
+#version 330 core
+
+#define SAMPLE_CAPACITY 256
+
+#ifdef GL_SPIRV
+layout (constant_id = 2) const int MAX_SAMPLES = SAMPLE_CAPACITY;
+#elif !defined(MAX_SAMPLES)
+#define MAX_SAMPLES SAMPLE_CAPACITY
+#endif
+
+in vec2 vTexCoords;
+
+// view space normal in rgb, linear view depth in alpha
+uniform sampler2D uDepthNormal;
+uniform sampler2D uNoiseTexture;
+
+uniform vec3 uSamples[SAMPLE_CAPACITY];
+uniform int uNumSamples;
+// every n-th kernel sample is evaluated, a cheaper and noisier estimate
+uniform int uSampleStride = 1;
+uniform vec2 uNoiseScale;
+uniform float uRadius = 0.5;
+uniform float uBias = 0.025;
+uniform float uPower = 1.0;
+uniform vec2 uRenderScale = vec2(1.0);
+
+layout (std140) uniform Matrices
+{
+	mat4 uView;
+	mat4 uProjection;
+};
+
+layout (location = 0) out float Occlusion;
+
+// the projection is symmetric, so the view position follows from the linear depth and the projection diagonal
+vec3 GetViewPosition(vec2 texCoords, float depth)
+{
+	vec2 ndc = texCoords / uRenderScale * 2.0 - 1.0;
+	return vec3(ndc * depth / vec2(uProjection[0][0], uProjection[1][1]), -depth);
+}
+
+void main()
+{
+	vec4 depthNormal = texture(uDepthNormal, vTexCoords);
+	vec3 fragPos = GetViewPosition(vTexCoords, depthNormal.a);
+	vec3 normal = normalize(depthNormal.rgb);
+	vec3 noise = normalize(texture(uNoiseTexture, vTexCoords * uNoiseScale).rgb);
+
+	// create TBN change-of-basis matrix: from tangent-space to view-space
+	vec3 tangent = normalize(noise - normal * dot(noise, normal));
+	vec3 bitangent = cross(normal, tangent);
+	mat3 TBN = mat3(tangent, bitangent, normal);
+
+	float occlusion = 0.0;
+	int numSamples = 0;
+	for (int i = 0; i < min(uNumSamples, MAX_SAMPLES); i += uSampleStride)
+	{
+		vec3 samplePos = TBN * uSamples[i];
+		samplePos = fragPos + samplePos * uRadius;
+
+		vec4 offset = uProjection * vec4(samplePos, 1.0);
+		offset.xy /= offset.w;
+		offset.xy = (offset.xy * 0.5 + 0.5) * uRenderScale;
+
+		// a single channel read per sample instead of a position fetch and a matrix multiply
+		float sampleDepth = -texture(uDepthNormal, offset.xy).a;
+
+		float rangeCheck = smoothstep(0.0, 1.0, uRadius / abs(fragPos.z - sampleDepth));
+		occlusion += (sampleDepth >= samplePos.z + uBias ? 1.0 : 0.0) * rangeCheck;
+		numSamples++;
+	}
+	occlusion = 1.0 - (occlusion / float(max(numSamples, 1)));
+	occlusion = pow(occlusion, uPower);
+
+	Occlusion = occlusion;
+}
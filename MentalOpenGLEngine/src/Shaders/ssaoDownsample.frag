@@ -0,0 +1,42 @@
+#version 330 core
+
+in vec2 vTexCoords;
+
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+// full resolution texels per reduced resolution texel along each axis
+uniform int uDownsample = 2;
+
+layout (std140) uniform Matrices
+{
+	mat4 uView;
+	mat4 uProjection;
+};
+
+layout (location = 0) out vec4 DepthNormal;
+
+void main()
+{
+	vec2 texelSize = 1.0 / vec2(textureSize(gPosition, 0));
+	vec2 footprint = float(uDownsample - 1) * 0.5 * texelSize;
+
+	// keep the closest of the covered texels instead of averaging, averaged depths would float between
+	// foreground and background and show up as halos after the upsample
+	float depth = 1e30;
+	vec3 normal = vec3(0.0, 0.0, 1.0);
+	for (int x = -1; x <= 1; x += 2)
+	{
+		for (int y = -1; y <= 1; y += 2)
+		{
+			vec2 texCoords = vTexCoords + vec2(x, y) * footprint;
+			float sampleDepth = -(uView * vec4(texture(gPosition, texCoords).rgb, 1.0)).z;
+			if (sampleDepth < depth)
+			{
+				depth = sampleDepth;
+				normal = texture(gNormal, texCoords).rgb;
+			}
+		}
+	}
+
+	DepthNormal = vec4(normalize(mat3(uView) * normal), depth);
+}
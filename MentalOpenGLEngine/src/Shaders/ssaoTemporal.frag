@@ -0,0 +1,92 @@
+#version 330 core
+
+#define SAMPLE_CAPACITY 256
+
+#ifdef GL_SPIRV
+layout (constant_id = 2) const int MAX_SAMPLES = SAMPLE_CAPACITY;
+#elif !defined(MAX_SAMPLES)
+#define MAX_SAMPLES SAMPLE_CAPACITY
+#endif
+
+in vec2 vTexCoords;
+
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D uNoiseTexture;
+// accumulated visibility in r, linear view depth in g, number of accumulated frames in b
+uniform sampler2D uHistory;
+
+uniform vec3 uSamples[SAMPLE_CAPACITY];
+uniform int uNumSamples;
+// this frame evaluates the kernel samples uSampleOffset, uSampleOffset + uSampleStride, ...
+uniform int uSampleOffset;
+uniform int uSampleStride = 1;
+uniform vec2 uNoiseScale;
+uniform float uRadius = 0.5;
+uniform float uBias = 0.025;
+
+uniform mat4 uPrevViewProjection;
+uniform bool uHistoryValid;
+uniform float uMaxHistoryFrames = 8.0;
+// relative depth difference past which the reprojected history belongs to another surface
+uniform float uDepthRejection = 0.05;
+// the history was rendered at last frame's scale
+uniform vec2 uRenderScale = vec2(1.0);
+uniform vec2 uPrevRenderScale = vec2(1.0);
+
+layout (std140) uniform Matrices
+{
+	mat4 uView;
+	mat4 uProjection;
+};
+
+layout (location = 0) out vec4 History;
+
+void main()
+{
+	vec3 worldPos = texture(gPosition, vTexCoords).rgb;
+	vec3 fragPos = vec3(uView * vec4(worldPos, 1.0));
+	vec3 normal = mat3(uView) * normalize(texture(gNormal, vTexCoords).rgb);
+	vec3 noise = normalize(texture(uNoiseTexture, vTexCoords * uNoiseScale).rgb);
+
+	vec3 tangent = normalize(noise - normal * dot(noise, normal));
+	vec3 bitangent = cross(normal, tangent);
+	mat3 TBN = mat3(tangent, bitangent, normal);
+
+	// the kernel grows with the sample index, so an interleaved subset still covers the whole radius
+	float occlusion = 0.0;
+	int numSamples = 0;
+	for (int i = uSampleOffset; i < min(uNumSamples, MAX_SAMPLES); i += uSampleStride)
+	{
+		vec3 samplePos = fragPos + TBN * uSamples[i] * uRadius;
+
+		vec4 offset = uProjection * vec4(samplePos, 1.0);
+		offset.xy /= offset.w;
+		offset.xy = (offset.xy * 0.5 + 0.5) * uRenderScale;
+
+		float sampleDepth = (uView * vec4(texture(gPosition, offset.xy).rgb, 1.0)).z;
+
+		float rangeCheck = smoothstep(0.0, 1.0, uRadius / abs(fragPos.z - sampleDepth));
+		occlusion += (sampleDepth >= samplePos.z + uBias ? 1.0 : 0.0) * rangeCheck;
+		numSamples++;
+	}
+	float visibility = 1.0 - occlusion / float(max(numSamples, 1));
+
+	// where this surface was last frame, its depth there has to match what the history stored
+	vec4 prevClip = uPrevViewProjection * vec4(worldPos, 1.0);
+	vec2 prevTexCoords = prevClip.xy / prevClip.w * 0.5 + 0.5;
+	float history = 0.0;
+	float numFrames = 0.0;
+	if (uHistoryValid && prevClip.w > 0.0 && all(greaterThanEqual(prevTexCoords, vec2(0.0))) && all(lessThanEqual(prevTexCoords, vec2(1.0))))
+	{
+		vec4 previous = texture(uHistory, prevTexCoords * uPrevRenderScale);
+		if (abs(previous.g - prevClip.w) < uDepthRejection * prevClip.w)
+		{
+			history = previous.r;
+			numFrames = previous.b;
+		}
+	}
+
+	float accumulated = (history * numFrames + visibility) / (numFrames + 1.0);
+	History = vec4(accumulated, -fragPos.z, min(numFrames + 1.0, uMaxHistoryFrames), 1.0);
+}
@@ -0,0 +1,54 @@
+#version 330 core
+
+in vec2 vTexCoords;
+
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+// reduced resolution blurred occlusion and the depth/normal it was computed from
+uniform sampler2D uSSAOTexture;
+uniform sampler2D uDepthNormal;
+// relative depth difference at which a low resolution sample loses most of its weight
+uniform float uDepthSharpness = 0.05;
+uniform float uNormalPower = 8.0;
+
+layout (std140) uniform Matrices
+{
+	mat4 uView;
+	mat4 uProjection;
+};
+
+layout (location = 0) out float Occlusion;
+
+void main()
+{
+	float depth = -(uView * vec4(texture(gPosition, vTexCoords).rgb, 1.0)).z;
+	vec3 normal = normalize(mat3(uView) * texture(gNormal, vTexCoords).rgb);
+
+	// the four low resolution texels around this pixel with their bilinear weights
+	vec2 lowResSize = vec2(textureSize(uSSAOTexture, 0));
+	vec2 lowResCoords = vTexCoords * lowResSize - 0.5;
+	vec2 base = floor(lowResCoords);
+	vec2 f = lowResCoords - base;
+
+	float occlusion = 0.0;
+	float totalWeight = 0.0;
+	for (int x = 0; x <= 1; x++)
+	{
+		for (int y = 0; y <= 1; y++)
+		{
+			vec2 texCoords = (base + vec2(x, y) + 0.5) / lowResSize;
+			vec4 depthNormal = texture(uDepthNormal, texCoords);
+
+			float bilinearWeight = (x == 0 ? 1.0 - f.x : f.x) * (y == 0 ? 1.0 - f.y : f.y);
+			float depthWeight = exp(-abs(depth - depthNormal.a) / (uDepthSharpness * depth));
+			float normalWeight = pow(max(dot(normal, depthNormal.rgb), 0.0), uNormalPower);
+
+			// the small bilinear term keeps pixels that match none of the samples from dividing by zero
+			float weight = bilinearWeight * (depthWeight * normalWeight + 1e-4);
+			occlusion += texture(uSSAOTexture, texCoords).r * weight;
+			totalWeight += weight;
+		}
+	}
+
+	Occlusion = occlusion / totalWeight;
+}
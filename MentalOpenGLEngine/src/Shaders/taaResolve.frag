@@ -0,0 +1,77 @@
+#version 330 core
+
+in vec2 vScreenCoords;
+
+// the jittered lit scene and its velocity, both rendered into the uRenderScale part of their targets
+uniform sampler2D uCurrent;
+uniform sampler2D uVelocity;
+// the resolved result of the previous frame, always at the window resolution
+uniform sampler2D uHistory;
+
+uniform vec2 uRenderScale = vec2(1.0);
+// this frame's jitter in texture coordinates
+uniform vec2 uJitter;
+uniform bool uHistoryValid;
+// weight of the new frame, lower converges to a smoother result but lags more behind changes
+uniform float uBlendFactor = 0.1;
+
+layout (location = 0) out vec4 FragColor;
+
+float Luminance(vec3 color)
+{
+	return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// the neighbourhood box is tighter around the actual colours in a luma/chroma space
+vec3 RGBToYCoCg(vec3 color)
+{
+	return vec3(
+		0.25 * color.r + 0.5 * color.g + 0.25 * color.b,
+		0.5 * color.r - 0.5 * color.b,
+		-0.25 * color.r + 0.5 * color.g - 0.25 * color.b
+	);
+}
+
+vec3 YCoCgToRGB(vec3 color)
+{
+	return vec3(color.x + color.y - color.z, color.x + color.z, color.x - color.y - color.z);
+}
+
+void main()
+{
+	// undo the jitter, so a static scene samples the same surface point every frame
+	vec2 currentCoords = (vScreenCoords + uJitter) * uRenderScale;
+	vec2 texelSize = 1.0 / vec2(textureSize(uCurrent, 0));
+	vec3 current = texture(uCurrent, currentCoords).rgb;
+
+	// the history is limited to the colours around this pixel, which rejects what was disoccluded or changed
+	vec3 minColor = vec3(1e10);
+	vec3 maxColor = vec3(-1e10);
+	for (int x = -1; x <= 1; x++)
+	{
+		for (int y = -1; y <= 1; y++)
+		{
+			vec3 neighbour = RGBToYCoCg(texture(uCurrent, currentCoords + vec2(x, y) * texelSize).rgb);
+			minColor = min(minColor, neighbour);
+			maxColor = max(maxColor, neighbour);
+		}
+	}
+
+	vec2 velocity = texture(uVelocity, vScreenCoords * uRenderScale).rg;
+	vec2 prevCoords = vScreenCoords - velocity;
+	if (!uHistoryValid || any(lessThan(prevCoords, vec2(0.0))) || any(greaterThan(prevCoords, vec2(1.0))))
+	{
+		FragColor = vec4(current, 1.0);
+		return;
+	}
+
+	vec3 history = texture(uHistory, prevCoords).rgb;
+	history = YCoCgToRGB(clamp(RGBToYCoCg(history), minColor, maxColor));
+
+	// weighted by inverse luminance, so a single bright sample cannot keep flickering through the blend
+	float currentWeight = uBlendFactor / (1.0 + Luminance(current));
+	float historyWeight = (1.0 - uBlendFactor) / (1.0 + Luminance(history));
+	vec3 color = (current * currentWeight + history * historyWeight) / (currentWeight + historyWeight);
+
+	FragColor = vec4(color, 1.0);
+}
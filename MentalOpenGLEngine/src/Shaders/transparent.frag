@@ -0,0 +1,54 @@
+#version 330 core
+
+in VS_OUT {
+	vec3 normal;
+	vec3 worldPos;
+} fs_in;
+
+uniform vec3 uViewPos;
+uniform vec3 uLightDirection;
+uniform vec3 uLightColor;
+uniform vec3 uPointLightPos;
+uniform vec3 uPointLightColor;
+uniform float uOpacity = 0.35;
+uniform bool uWeightedOIT;
+
+// sorted blending: lit colour with the opacity in alpha
+// weighted blended OIT: weighted premultiplied colour with the opacity for the revealage, and the alpha weight
+layout (location = 0) out vec4 FragColor;
+layout (location = 1) out vec4 Weight;
+
+void main()
+{
+	vec3 normal = normalize(fs_in.normal);
+	if (!gl_FrontFacing)
+	{
+		normal = -normal;
+	}
+	vec3 viewDirection = normalize(uViewPos - fs_in.worldPos);
+
+	// tint varies across the scene, so overlapping layers are distinguishable
+	vec3 albedo = 0.5 + 0.5 * cos(6.2831 * (0.05 * (fs_in.worldPos.x + fs_in.worldPos.z) + vec3(0.0, 0.33, 0.67)));
+
+	vec3 lightDirection = normalize(-uLightDirection);
+	vec3 color = 0.1 * uLightColor * albedo;
+	color += max(dot(normal, lightDirection), 0.0) * uLightColor * albedo;
+
+	vec3 toPointLight = uPointLightPos - fs_in.worldPos;
+	float distanceToLight = length(toPointLight);
+	float attenuation = 1.0 / (1.0 + 0.09 * distanceToLight + 0.032 * distanceToLight * distanceToLight);
+	vec3 pointLightDirection = toPointLight / distanceToLight;
+	vec3 halfwayDirection = normalize(viewDirection + pointLightDirection);
+	color += attenuation * uPointLightColor * (max(dot(normal, pointLightDirection), 0.0) * albedo + pow(max(dot(normal, halfwayDirection), 0.0), 64.0));
+
+	if (uWeightedOIT)
+	{
+		// weight from McGuire and Bavoil, favours near and opaque fragments while staying inside half float range
+		float weight = clamp(pow(min(1.0, uOpacity * 10.0) + 0.01, 3.0) * 1e8 * pow(1.0 - gl_FragCoord.z * 0.9, 3.0), 1e-2, 3e3);
+		FragColor = vec4(color * uOpacity * weight, uOpacity);
+		Weight = vec4(uOpacity * weight);
+		return;
+	}
+
+	FragColor = vec4(color, uOpacity);
+}
@@ -0,0 +1,25 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+
+out VS_OUT {
+	vec3 normal;
+	vec3 worldPos;
+} vs_out;
+
+layout (std140) uniform Matrices
+{
+	mat4 uView;
+	mat4 uProjection;
+};
+
+uniform mat4 uModel;
+
+void main()
+{
+	vs_out.worldPos = vec3(uModel * vec4(aPos, 1.0));
+	vs_out.normal = normalize(transpose(inverse(mat3(uModel))) * aNormal);
+
+	gl_Position = uProjection * uView * vec4(vs_out.worldPos, 1.0);
+}
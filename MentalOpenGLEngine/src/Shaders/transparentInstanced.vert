@@ -0,0 +1,24 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 4) in mat4 aInstanceModelMatrix;
+
+out VS_OUT {
+	vec3 normal;
+	vec3 worldPos;
+} vs_out;
+
+layout (std140) uniform Matrices
+{
+	mat4 uView;
+	mat4 uProjection;
+};
+
+void main()
+{
+	vs_out.worldPos = vec3(aInstanceModelMatrix * vec4(aPos, 1.0));
+	vs_out.normal = normalize(transpose(inverse(mat3(aInstanceModelMatrix))) * aNormal);
+
+	gl_Position = uProjection * uView * vec4(vs_out.worldPos, 1.0);
+}